@@ -0,0 +1,115 @@
+/* ===============================================================
+ * File: ack.c                                                   =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "ack.h"
+#include "uart.h"
+#include "messages.h"
+/*================================================================*/
+
+/*================================================================*/
+// Acknowledgement window, only used from the main loop
+static uint8_t ack_top = 0; // highest sequence number received
+static uint16_t ack_rx_mask = 0; // bit i: (ack_top - i) received
+static uint16_t ack_ok_mask = 0; // bit i: (ack_top - i) succeeded
+static uint8_t ack_seen = 0; // at least one sequenced command received
+static uint8_t ack_pending = 0; // a frame must be sent this tick
+/*================================================================*/
+
+/*================================================================*/
+void ack_init(void) {
+    ack_top = 0;
+    ack_rx_mask = 0;
+    ack_ok_mask = 0;
+    ack_seen = 0;
+    ack_pending = 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+int ack_parse_seq(const char *input, uint8_t *seq) {
+    const char *p = strchr(input, ACK_SEQ_CHAR);
+    char *end;
+    long value;
+
+    if (p == NULL) return 0;
+    value = strtol(p + 1, &end, 10);
+    // The number must be followed by the end of the command
+    if (end == p + 1 || *end != '*' || value < 0 || value > 255) return 0;
+    *seq = (uint8_t) value;
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+int ack_was_received(uint8_t seq) {
+    int8_t diff;
+
+    if (!ack_seen) return 0;
+    // Serial number arithmetic: positive means newer than ack_top
+    diff = (int8_t) (seq - ack_top);
+    if (diff > 0) return 0;
+    // Too old to be tracked: it can only be a late retransmission
+    return -diff >= ACK_WINDOW || ((ack_rx_mask >> -diff) & 1);
+}
+/*================================================================*/
+
+/*================================================================*/
+int ack_is_duplicate(uint8_t seq) {
+    if (!ack_was_received(seq)) return 0;
+    ack_pending = 1;
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+void ack_record(uint8_t seq, int ok) {
+    int8_t diff = (int8_t) (seq - ack_top);
+    uint16_t bit;
+
+    if (!ack_seen) {
+        ack_seen = 1;
+        ack_top = seq;
+        diff = 0;
+    } else if (diff > 0) {
+        // Slide the window forward to the new top
+        if (diff >= ACK_WINDOW) {
+            ack_rx_mask = 0;
+            ack_ok_mask = 0;
+        } else {
+            ack_rx_mask <<= diff;
+            ack_ok_mask <<= diff;
+        }
+        ack_top = seq;
+        diff = 0;
+    } else if (-diff >= ACK_WINDOW) {
+        return; // outside the window, ack_is_duplicate() already filtered it
+    }
+
+    bit = (uint16_t) 1 << -diff;
+    ack_rx_mask |= bit;
+    if (ok) {
+        ack_ok_mask |= bit;
+    } else {
+        ack_ok_mask &= ~bit;
+    }
+    ack_pending = 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+void ack_flush(void) {
+    char ack_message[MSG_MACKS_SIZE];
+
+    if (!ack_pending) return;
+    ack_pending = 0;
+    msg_encode_macks(ack_message, ack_top, ack_rx_mask, ack_ok_mask);
+    UART_SendString(ack_message);
+}
+/*================================================================*/
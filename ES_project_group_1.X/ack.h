@@ -0,0 +1,63 @@
+/* ===============================================================
+ * File: ack.h                                                   =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef ACK_H
+#define ACK_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Any $PC command may carry an optional sequence number 0..255 written
+// as "#seq" right before the '*', e.g. "$PCSTT,#12*" or "$PCREF,10,5#13*".
+// Sequenced commands are not acknowledged one by one; instead the robot
+// sends at most one selective acknowledgement frame per main loop tick:
+//   $MACKS,top,rx_mask,ok_mask*
+// top     - highest sequence number received so far
+// rx_mask - 16 bit hex, bit i set if command (top - i) has been received
+// ok_mask - 16 bit hex, bit i set if command (top - i) succeeded
+// A missing bit means the command was lost and the PC may resend it;
+// resent commands that were already executed are not executed again.
+#define ACK_WINDOW 16
+
+// Separator that introduces the sequence number in a command
+#define ACK_SEQ_CHAR '#'
+
+// Forgets every received sequence number.
+void ack_init(void);
+
+// Extracts the optional sequence number of a command.
+// Parameters:
+//   input - received command string
+//   seq   - set to the sequence number when present
+// Returns:
+//   1 if the command carries a valid sequence number, 0 otherwise
+int ack_parse_seq(const char *input, uint8_t *seq);
+
+// Checks whether a sequenced command has already been received.
+// A duplicate also schedules the acknowledgement frame again, because
+// the PC only resends when it missed our previous one.
+// Returns:
+//   1 if the command must not be executed again, 0 otherwise
+int ack_is_duplicate(uint8_t seq);
+
+// Same test as ack_is_duplicate() without scheduling the acknowledgement
+// frame, for looking ahead at commands still queued.
+int ack_was_received(uint8_t seq);
+
+// Records the outcome of an executed sequenced command.
+// Parameters:
+//   seq - sequence number of the command
+//   ok  - 1 on success, 0 on failure
+void ack_record(uint8_t seq, int ok);
+
+// Sends the coalesced $MACKS frame if anything changed since the last
+// call. Called once per main loop tick after the commands are processed.
+void ack_flush(void);
+
+#endif /* ACK_H */
@@ -7,14 +7,39 @@
  * Mamoru Ota                                                    =
  * ===============================================================*/
 #include "adc.h"
+#include "params.h"
+#include "pwm.h"
+#include "timer.h"
+#include "recorder.h"
+#include "interrupt.h"
+#include "dsp.h"
 /*=================================================================*/
-// variables
-float distance_buffer[BUFFER_SIZE];
-float battery_buffer[BUFFER_SIZE];
-int buffer_index = 0;
-int buffer_filled = 0;
-int battery_buffer_index = 0;
-int battery_buffer_filled = 0;
+// Moving averages over the last AVG_WIN samples (mm and mV)
+static q15_t distance_samples[BUFFER_SIZE];
+static q15_t battery_samples[BUFFER_SIZE];
+static DspMovingAverage distance_average;
+static DspMovingAverage battery_average;
+/*=================================================================*/
+// Values produced by the ADC interrupt
+static volatile int adc_battery_raw = 0;
+static volatile int adc_filtered_mm = 0;
+static volatile int adc_closing_mm_s = 0;
+static volatile unsigned int adc_ttc = CONTROL_TTC_INFINITE;
+static volatile int adc_brake = 100;
+static volatile uint8_t adc_armed = 0;
+static volatile uint8_t adc_stop_request = 0;
+// Interrupt-only filter state
+static DspOversampler battery_oversampler;
+static DspOversampler ir_oversampler;
+static uint16_t adc_timer_prescaler = 1; // TIMER3 counts to cycles
+static uint16_t adc_sample_hz = ADC_SAMPLE_HZ; // IR results per second
+static uint16_t adc_time_step = 1; // between two IR results, in 1/CONTROL_TIME_HZ s
+static ControlGuard guard; // distance filter, closing speed and time-to-collision
+// Raw distances kept for the flight recorder around a hard stop
+#define ADC_TRACE_SAMPLES 8
+static int trace_history[ADC_TRACE_SAMPLES];
+static uint8_t trace_index = 0;
+static uint8_t trace_post = 0; // samples still to record after a trigger
 /*=================================================================*/
 void setup_adc(void) {
     // Configure analog pins
@@ -25,101 +50,209 @@ void setup_adc(void) {
     // Set ENABLE pin to high to activate the sensor
     TRISBbits.TRISB4 = 0; // pin B4 set as output (Enable sensor)
     LATBbits.LATB4 = 1; // pin set as high
+
+    control_guard_init(&guard);
+    dsp_movavg_init(&distance_average, distance_samples, g_params.avg_window);
+    dsp_movavg_init(&battery_average, battery_samples, g_params.avg_window);
     
-    // Setup ADC: Automatic sampling & conversion
+    // Decimation ratios are fixed until the next boot
+    dsp_oversample_init(&battery_oversampler, g_params.osr_battery_bits);
+    dsp_oversample_init(&ir_oversampler, g_params.osr_ir_bits);
+
+    // Setup ADC: Automatic sampling, conversion started by TIMER3
     AD1CON3bits.ADCS = 8; // ADC Conversion Clock Select bits
     AD1CON1bits.ASAM = 1; // Sampling begins when SAMP bit is set -> 1: Automatic
     AD1CON3bits.SAMC = 16; // Sample time 16 Tad
-    AD1CON1bits.SSRC = 7; // Conversion starts automatically -> 7: Automatic
+    AD1CON1bits.SSRC = 2; // Conversion starts on Timer3 compare -> 2: GP Timer3
     
     AD1CON2bits.VCFG = 0; // Reference Voltage
     AD1CON2bits.CHPS = 0; // Channel selection -> 0: CH0
     AD1CON1bits.SIMSAM = 0; // Sequential sampling
-    AD1CON2bits.SMPI = 1; // Interrupt after 2 conversions
+    AD1CON2bits.SMPI = 2 * ADC_PAIRS_PER_INTERRUPT - 1; // Interrupt after 8 conversions
+    AD1CON2bits.BUFM = 1; // Alternate between ADC1BUF0-7 and ADC1BUF8-F
     
     // Automatic Scanning
     AD1CON2bits.CSCNA = 1; // Enable scanning
     AD1CSSLbits.CSS11 = 1; // Select AN11 (Battery voltage)
     AD1CSSLbits.CSS15 = 1; // Select AN15 (IR sensor)
+
+    // Process every half buffer in the interrupt
+    IFS0bits.AD1IF = 0;
+    IEC0bits.AD1IE = 1;
             
     AD1CON1bits.ADON = 1; // Turn ON ADC 
+    adc_sample_hz = 0;
+    adc_set_sample_rate(ADC_SAMPLE_HZ); // Start the conversion pacing
 }
 /*=================================================================*/
 
 /*=================================================================*/
-float adc_distance(void) {
-    // Read ADC: Automatic sampling & conversion
-    while (!AD1CON1bits.DONE); // Wait for the conversion to complete
-    int ADC_value = ADC1BUF1;       // Read IR sensor value
-    
-    // Convert the result to distance
-    float voltage = (float) ADC_value * 3.3 / 1023.0;
-    
-    // Polynomial approximation for distance based on voltage
-    float distance = 2.34 - 4.74 * voltage + 4.06 * pow(voltage, 2) - 1.60 * pow(voltage, 3) + 0.24 * pow(voltage, 4);
-    
-    // Store in circular buffer
-    distance_buffer[buffer_index] = distance;
-    buffer_index = (buffer_index + 1) % BUFFER_SIZE;
-    if (buffer_filled < BUFFER_SIZE) {
-        buffer_filled++;
-    }
-    return distance;
+void adc_set_sample_rate(unsigned int hz) {
+    if (hz == adc_sample_hz) return;
+    IEC0bits.AD1IE = 0;
+    // 2 * 4^OSR_IR conversions per IR result
+    adc_timer_prescaler = tmr_setup_period_cycles(TIMER3,
+            FCY / (((long) 2 * hz) << (2 * ir_oversampler.bits)));
+    adc_sample_hz = hz;
+    adc_time_step = ADC_SAMPLE_HZ / hz;
+    IEC0bits.AD1IE = 1;
 }
 /*=================================================================*/
 
 /*=================================================================*/
-int average_distance(void) {
-    float sum = 0.0;
-    int i;
+unsigned int adc_sample_rate(void) {
+    return adc_sample_hz;
+}
+/*=================================================================*/
+
+/*=================================================================*/
+/* ADC interrupt: decimates the oversampled conversions, then for every
+ * IR result filters the distance, estimates the closing speed and the
+ * time-to-collision, and stops the motors right here when the robot is
+ * about to hit something, so the reaction time is one IR result instead
+ * of one main loop period. */
+/*=================================================================*/
+void __attribute__((__interrupt__, __auto_psv__)) _AD1Interrupt(void) {
+    volatile unsigned int *buffer;
+    uint16_t battery_value, ir_value;
+    int i, ir_ready = 0;
+    int distance_mm;
+    ControlLimits limits = CONTROL_LIMITS(g_params);
+    ControlStop stop;
+    ISR_PROFILE_BEGIN();
+    // TMR3 restarted from 0 at the last conversion trigger
+    isr_profile_latency(ISR_ADC, TMR3 * adc_timer_prescaler);
 
-    if (buffer_filled == 0) {
-        return 0.0; // Avoid division by zero
+    IFS0bits.AD1IF = 0;
+    // Read the half the ADC is not filling; in each pair AN11 (battery)
+    // is converted before AN15 (IR)
+    buffer = AD1CON2bits.BUFS ? &ADC1BUF0 : &ADC1BUF8;
+    for (i = 0; i < 2 * ADC_PAIRS_PER_INTERRUPT; i += 2) {
+        if (dsp_oversample(&battery_oversampler, buffer[i], &battery_value)) {
+            adc_battery_raw = battery_value << (ADC_RESULT_BITS - 10 - battery_oversampler.bits);
+        }
+        if (dsp_oversample(&ir_oversampler, buffer[i + 1], &ir_value)) {
+            ir_ready = 1;
+        }
     }
+    if (!ir_ready) {
+        ISR_PROFILE_END(ISR_ADC);
+        return;
+    }
+    distance_mm = control_adc_to_mm(ir_value << (ADC_RESULT_BITS - 10 - ir_oversampler.bits));
 
-    for (i = 0; i < buffer_filled; i++) {
-        sum += distance_buffer[i];
+    // Pre-trigger history, and the samples following a trigger
+    trace_history[trace_index] = distance_mm;
+    trace_index = (trace_index + 1) % ADC_TRACE_SAMPLES;
+    if (trace_post > 0) {
+        recorder_log(EV_ADC_SAMPLE, ADC_TRACE_SAMPLES + 1 - trace_post, distance_mm);
+        trace_post--;
     }
-    int result = (sum * 100) / buffer_filled; // Convert to cm
 
-    return result;
+    // Filter, closing speed, time-to-collision and braking (control.c)
+    stop = control_guard_update(&guard, distance_mm, adc_time_step, &limits);
+    adc_filtered_mm = guard.distance_mm;
+    adc_closing_mm_s = guard.closing_mm_s;
+    adc_ttc = guard.ttc_ms;
+    adc_brake = guard.brake_percent;
+
+    // Hard stop
+    if (adc_armed && stop != CONTROL_CLEAR) {
+        set_motor_pwm(0, 0);
+        adc_armed = 0;
+        adc_stop_request = 1;
+
+        // Record the raw samples leading to the trigger, then the cause
+        for (i = 0; i < ADC_TRACE_SAMPLES; i++) {
+            recorder_log(EV_ADC_SAMPLE, (uint8_t) (i - ADC_TRACE_SAMPLES + 1),
+                    trace_history[(trace_index + i) % ADC_TRACE_SAMPLES]);
+        }
+        recorder_log(EV_EMRG_ENTER,
+                (stop == CONTROL_STOP_DISTANCE) ? REC_CAUSE_DISTANCE : REC_CAUSE_TTC,
+                guard.distance_mm);
+        trace_post = ADC_TRACE_SAMPLES;
+    }
+    ISR_PROFILE_END(ISR_ADC);
 }
 /*=================================================================*/
 
 /*=================================================================*/
-float adc_battery_voltage(void) {
-    // Read ADC: Automatic sampling & conversion
-    while (!AD1CON1bits.DONE);      // Wait for the conversion to complete
-    int ADC_value = ADC1BUF0;       // Read battery voltage
-    
-    // Convert ADC value to battery voltage (considering voltage divider)
-    float bat_vsense = (float)ADC_value * 3.3 / 1023.0;
-    float vbat = bat_vsense * 3;    // Due to voltage divider (1/3 ratio)
-    
-    // Store in circular buffer
-    battery_buffer[battery_buffer_index] = vbat;
-    battery_buffer_index = (battery_buffer_index + 1) % BUFFER_SIZE;
-    if (battery_buffer_filled < BUFFER_SIZE) {
-        battery_buffer_filled++;
+// Restarts an average whose window no longer matches AVG_WIN, then adds
+// the sample
+/*=================================================================*/
+static void average_push(DspMovingAverage *average, q15_t *samples, int value) {
+    if (average->length != g_params.avg_window) {
+        dsp_movavg_init(average, samples, g_params.avg_window);
     }
-    
-    return vbat;
+    dsp_movavg_push(average, value);
 }
 /*=================================================================*/
 
 /*=================================================================*/
-float average_battery_voltage(void) {
-    float sum = 0.0;
-    int i;
+int adc_distance(void) {
+    int distance_mm = adc_filtered_mm;
+    average_push(&distance_average, distance_samples, distance_mm);
+    return distance_mm;
+}
+/*=================================================================*/
 
-    if (battery_buffer_filled == 0) {
-        return 0.0;
-    }
+/*=================================================================*/
+int adc_distance_mm(void) {
+    return adc_filtered_mm;
+}
+/*=================================================================*/
 
-    for (i = 0; i < battery_buffer_filled; i++) {
-        sum += battery_buffer[i];
-    }
-    
-    return sum / battery_buffer_filled;
+/*=================================================================*/
+int adc_closing_speed(void) {
+    return adc_closing_mm_s;
 }
-/*=================================================================*/
\ No newline at end of file
+/*=================================================================*/
+
+/*=================================================================*/
+unsigned int adc_ttc_ms(void) {
+    return adc_ttc;
+}
+/*=================================================================*/
+
+/*=================================================================*/
+int adc_brake_percent(void) {
+    return adc_brake;
+}
+/*=================================================================*/
+
+/*=================================================================*/
+void adc_arm_emergency(int armed) {
+    adc_armed = armed;
+    if (!armed) adc_stop_request = 0; // forget a stop raised in another state
+}
+/*=================================================================*/
+
+/*=================================================================*/
+int adc_emergency_request(void) {
+    if (!adc_stop_request) return 0;
+    adc_stop_request = 0;
+    return 1;
+}
+/*=================================================================*/
+
+/*=================================================================*/
+int average_distance(void) {
+    return (dsp_movavg_output(&distance_average) + 5) / 10; // mm to cm
+}
+/*=================================================================*/
+
+/*=================================================================*/
+int adc_battery_voltage(void) {
+    // Latest battery result stored by the ADC interrupt, 3.3V full
+    // scale behind a 1/3 voltage divider
+    int vbat_mv = (long) adc_battery_raw * 9900 / ADC_FULL_SCALE;
+    average_push(&battery_average, battery_samples, vbat_mv);
+    return vbat_mv;
+}
+/*=================================================================*/
+
+/*=================================================================*/
+int average_battery_voltage(void) {
+    return dsp_movavg_output(&battery_average);
+}
+/*=================================================================*/
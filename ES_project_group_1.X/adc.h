@@ -12,25 +12,71 @@
 /*=================================================================*/
 //includes
 #include <xc.h>
-#include <math.h>
+#include "control.h"
 /*=================================================================*/
-//buffer size
-#define BUFFER_SIZE 5
+//buffer size: longest averaging window, the window in use is the AVG_WIN parameter
+#define BUFFER_SIZE 16
+/*=================================================================*/
+// Conversions are paced by TIMER3 and oversampled: the two scanned
+// channels alternate, every interrupt reads 4 pairs from one half of the
+// ADC buffer while the other half fills, and each channel sums 4^bits
+// conversions (OSR_IR / OSR_BAT parameters) into one result with bits
+// extra bits. The trigger rate follows OSR_IR and the IR result rate
+// chosen with adc_set_sample_rate() (500Hz at most, see power.h).
+#define ADC_SAMPLE_HZ 500
+#define ADC_OSR_MIN_BITS 1 // 11 bits, one IR result per interrupt
+#define ADC_OSR_MAX_BITS 3 // 13 bits, 64kHz conversion rate
+#define ADC_PAIRS_PER_INTERRUPT 4
+// Results of both channels are scaled to 13 bits whatever the ratio
+#define ADC_RESULT_BITS CONTROL_ADC_BITS
+#define ADC_FULL_SCALE (1023L << (ADC_RESULT_BITS - 10))
+/*=================================================================*/
+// Interrupt routine processing every half buffer of conversions
+void __attribute__((__interrupt__, __auto_psv__)) _AD1Interrupt(void);
 /*=================================================================*/
 // Configures the Analog-to-Digital Converter (ADC).
 void setup_adc(void);
 /*=================================================================*/
-// Converts ADC reading to a distance measurement.
-float adc_distance(void);
+// Changes the IR result rate, a divider of ADC_SAMPLE_HZ. The battery
+// follows at the same conversion rate. Called from the main loop only.
+void adc_set_sample_rate(unsigned int hz);
+/*=================================================================*/
+// IR results per second currently produced.
+unsigned int adc_sample_rate(void);
+/*=================================================================*/
+// Returns the latest filtered distance (in mm) and stores it for the average.
+int adc_distance(void);
+/*=================================================================*/
+// Latest filtered distance in mm.
+int adc_distance_mm(void);
+/*=================================================================*/
+// Estimated closing speed in mm/s (positive when the obstacle gets closer).
+int adc_closing_speed(void);
+/*=================================================================*/
+// Estimated time-to-collision in ms, CONTROL_TTC_INFINITE if not closing in.
+unsigned int adc_ttc_ms(void);
+/*=================================================================*/
+// Speed scale in percent to apply to forward motion: 100 while the
+// time-to-collision is above TTC_BRAKE, decreasing to 0 at TTC_STOP.
+int adc_brake_percent(void);
+/*=================================================================*/
+// Arms or disarms the hard stop done by the ADC interrupt. While armed,
+// a distance below DIST_THR or a time-to-collision below TTC_STOP stops
+// the motors from the interrupt and raises the emergency request.
+void adc_arm_emergency(int armed);
+/*=================================================================*/
+// Returns 1 once after the ADC interrupt performed a hard stop.
+int adc_emergency_request(void);
 /*=================================================================*/
-// Calculates the average of multiple distance readings.
+// Average of the last AVG_WIN distance readings, in cm.
 int average_distance(void);
 /*=================================================================*/
-// Converts ADC reading to battery voltage.
-float adc_battery_voltage(void);
+// Converts the latest ADC reading to battery voltage (in mV) and stores
+// it for the average.
+int adc_battery_voltage(void);
 /*=================================================================*/
-// Calculates the average of multiple battery voltage readings.
-float average_battery_voltage(void);
+// Average of the last AVG_WIN battery readings, in mV.
+int average_battery_voltage(void);
 /*=================================================================*/
 #endif
 /*=================================================================*/
\ No newline at end of file
@@ -0,0 +1,134 @@
+/* ===============================================================
+ * File: boot.c                                                  =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "boot.h"
+/*================================================================*/
+
+/*================================================================*/
+// boot_swap() may only use code of its own page: the flash accesses are
+// macros rather than calls to flash.c, which lives in the application,
+// and addresses are stepped with additions (no library helper).
+// NVMCON operations and latch page as in flash.c.
+#define BOOT_NVM_DWORD_PROGRAM 0x4001
+#define BOOT_NVM_PAGE_ERASE 0x4003
+#define BOOT_LATCH_PAGE 0xFA
+
+#define BOOT_READ_LOW(address) \
+    (TBLPAG = (uint16_t) ((address) >> 16), __builtin_tblrdl((uint16_t) (address)))
+#define BOOT_READ_HIGH(address) \
+    (TBLPAG = (uint16_t) ((address) >> 16), __builtin_tblrdh((uint16_t) (address)) & 0xFF)
+#define BOOT_CONTROL(word) (UPD_CONTROL_BASE + 2 * (word))
+
+#define BOOT_NVM(address, operation) do { \
+        NVMADRU = (uint16_t) ((address) >> 16); \
+        NVMADR = (uint16_t) (address); \
+        NVMCON = (operation); \
+        __builtin_write_NVM(); \
+        while (NVMCONbits.WR); \
+    } while (0)
+
+#define BOOT_PROGRAM(address, low0, high0, low1, high1) do { \
+        TBLPAG = BOOT_LATCH_PAGE; \
+        __builtin_tblwtl(0, (low0)); \
+        __builtin_tblwth(0, (high0)); \
+        __builtin_tblwtl(2, (low1)); \
+        __builtin_tblwth(2, (high1)); \
+        BOOT_NVM(address, BOOT_NVM_DWORD_PROGRAM); \
+    } while (0)
+
+// GOTO BOOT_BASE, the two words of the reset vector
+#define BOOT_GOTO_LOW (BOOT_BASE & 0xFFFE)
+#define BOOT_GOTO_HIGH 0x04
+#define BOOT_GOTO_ARG ((BOOT_BASE >> 16) & 0x7F)
+/*================================================================*/
+
+/*================================================================*/
+// Rest of the boot page, reserved so that the linker places nothing else
+// there: the page is never part of an update (tools/fw_update.c rejects
+// data in it).
+static const uint16_t __attribute__((space(prog), noload, unused,
+address(BOOT_BASE + BOOT_CODE_ADDRESSES)))
+boot_reserved[(FLASH_PAGE_ADDRESSES - BOOT_CODE_ADDRESSES) / 2];
+/*================================================================*/
+
+/*================================================================*/
+// Also entered from the reset vector after an interrupted swap: no C
+// startup has run then, so no static data and no constants in PSV.
+/*================================================================*/
+void __attribute__((address(BOOT_BASE), noreturn)) boot_swap(void) {
+    uint16_t pages, page, i;
+    uint32_t source, destination;
+
+    SRbits.IPL = 7;
+    pages = BOOT_READ_LOW(BOOT_CONTROL(UPD_CTRL_SESSION + 1));
+
+    // From now on a reset comes back here
+    if (BOOT_READ_LOW(BOOT_CONTROL(UPD_CTRL_STUB)) != UPD_STUB_MAGIC) {
+        BOOT_NVM(0, BOOT_NVM_PAGE_ERASE);
+        BOOT_PROGRAM(0, BOOT_GOTO_LOW, BOOT_GOTO_HIGH, BOOT_GOTO_ARG, 0);
+        BOOT_PROGRAM(BOOT_CONTROL(UPD_CTRL_STUB), UPD_STUB_MAGIC, 0xFF, 0, 0xFF);
+    }
+
+    // Pages 1 .. pages-1, then page 0 which replaces the reset stub
+    source = UPD_STAGING_BASE;
+    destination = 0;
+    for (page = 1; page <= pages; page++) {
+        uint16_t index = page;
+        source += FLASH_PAGE_ADDRESSES;
+        destination += FLASH_PAGE_ADDRESSES;
+        if (page == pages) {
+            index = 0;
+            source = UPD_STAGING_BASE;
+            destination = 0;
+        }
+        if (BOOT_READ_LOW(BOOT_CONTROL(UPD_CTRL_COPIED + 2 * index)) == UPD_COPIED_MAGIC) continue;
+
+        // Blank pages are left alone, the parameter page may be one of them.
+        // The page is read back before it is marked: once marked, a reset
+        // would never rewrite it. A page that keeps failing keeps the swap
+        // here, the application could not run from it anyway.
+        if (BOOT_READ_LOW(BOOT_CONTROL(UPD_CTRL_PAGES + 2 * index)) == UPD_PAGE_MAGIC) {
+            do {
+                BOOT_NVM(destination, BOOT_NVM_PAGE_ERASE);
+                for (i = 0; i < FLASH_PAGE_ADDRESSES; i += 4) {
+                    uint16_t low0 = BOOT_READ_LOW(source + i);
+                    uint16_t high0 = BOOT_READ_HIGH(source + i);
+                    uint16_t low1 = BOOT_READ_LOW(source + i + 2);
+                    uint16_t high1 = BOOT_READ_HIGH(source + i + 2);
+                    BOOT_PROGRAM(destination + i, low0, high0, low1, high1);
+                }
+                for (i = 0; i < FLASH_PAGE_ADDRESSES; i += 2) {
+                    uint16_t low = BOOT_READ_LOW(destination + i);
+                    uint16_t high = BOOT_READ_HIGH(destination + i);
+                    if (low != BOOT_READ_LOW(source + i) || high != BOOT_READ_HIGH(source + i)) break;
+                }
+            } while (i < FLASH_PAGE_ADDRESSES);
+        }
+        BOOT_PROGRAM(BOOT_CONTROL(UPD_CTRL_COPIED + 2 * index), UPD_COPIED_MAGIC, 0xFF, index, 0xFF);
+    }
+
+    // Swap complete: the erased control page ends the session
+    BOOT_NVM(UPD_CONTROL_BASE, BOOT_NVM_PAGE_ERASE);
+    asm("RESET");
+    while (1);
+}
+/*================================================================*/
+
+/*================================================================*/
+void boot_check(void) {
+    uint16_t crc = flash_read_word(UPD_CONTROL_BASE + 2 * (UPD_CTRL_SESSION + 2));
+
+    if (flash_read_word(UPD_CONTROL_BASE + 2 * UPD_CTRL_SESSION) == UPD_SESSION_MAGIC &&
+            flash_read_word(UPD_CONTROL_BASE + 2 * UPD_CTRL_SWAP) == UPD_SWAP_MAGIC &&
+            flash_read_word(UPD_CONTROL_BASE + 2 * (UPD_CTRL_SWAP + 1)) == crc) {
+        boot_swap();
+    }
+}
+/*================================================================*/
@@ -0,0 +1,35 @@
+/* ===============================================================
+ * File: boot.h                                                  =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <xc.h>
+#include <stdint.h>
+#include "update.h"
+
+// Resident swap of a committed update (see update.h). The swap code sits
+// in its own flash page after the control page, outside the application,
+// so it keeps running while the application pages are rewritten.
+//
+// The swap first points the reset vector to BOOT_BASE, then copies the
+// staged pages 1 .. n-1 and page 0 last, marking each copied page in the
+// control page. A reset in the middle restarts the swap where it stopped.
+// Only a power loss during the two page 0 rewrites (a few ms) leaves the
+// device without reset vector.
+#define BOOT_BASE (UPD_CONTROL_BASE + FLASH_PAGE_ADDRESSES)
+// Program addresses left to boot_swap() at the start of the page, the
+// rest is reserved (boot.c): the link fails if the routine outgrows it.
+#define BOOT_CODE_ADDRESSES 0x400
+
+// Runs the swap if one was committed, never returns in that case (reset
+// at the end). Called first thing in main(), before any peripheral is set up.
+void boot_check(void);
+
+#endif /* BOOT_H */
@@ -0,0 +1,154 @@
+/* ===============================================================
+ * File: control.c                                               =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "control.h"
+/*================================================================*/
+
+/*================================================================*/
+// IR calibration curve sampled every 32 10-bit ADC counts, in mm:
+// distance = 2.34 - 4.74 v + 4.06 v^2 - 1.60 v^3 + 0.24 v^4 (m), with
+// v = code * 3.3 / 1023, computed in float and truncated. Kept in
+// flash (auto PSV) so it costs no RAM and no float code at boot.
+#define DIST_LUT_SHIFT 5
+#define DIST_LUT_SIZE ((1024 >> DIST_LUT_SHIFT) + 1)
+#define DIST_LUT_INDEX_SHIFT (DIST_LUT_SHIFT + CONTROL_ADC_BITS - 10)
+static const int distance_lut[DIST_LUT_SIZE] = {
+    2340, 1892, 1520, 1216, 969, 772, 616, 496, 404, 336, 285,
+    249, 222, 202, 186, 174, 163, 154, 146, 141, 139, 144,
+    158, 184, 227, 292, 384, 508, 673, 885, 1152, 1483, 1888
+};
+/*================================================================*/
+
+/*================================================================*/
+int control_adc_to_mm(uint16_t reading) {
+    int index = reading >> DIST_LUT_INDEX_SHIFT;
+    int fraction = reading & ((1 << DIST_LUT_INDEX_SHIFT) - 1);
+    int low = distance_lut[index];
+    int high = distance_lut[index + 1];
+    return low + (((long) (high - low) * fraction) >> DIST_LUT_INDEX_SHIFT);
+}
+/*================================================================*/
+
+/*================================================================*/
+void control_guard_init(ControlGuard *guard) {
+    int i;
+
+    guard->filter_mm_q4 = -1;
+    for (i = 0; i < CONTROL_SPEED_SPAN; i++) {
+        guard->history[i] = 0;
+        guard->history_time[i] = 0;
+    }
+    guard->time = 0;
+    guard->index = 0;
+    guard->filled = 0;
+    guard->distance_mm = 0;
+    guard->closing_mm_s = 0;
+    guard->ttc_ms = CONTROL_TTC_INFINITE;
+    guard->brake_percent = 100;
+}
+/*================================================================*/
+
+/*================================================================*/
+ControlStop control_guard_update(ControlGuard *guard, int distance_mm,
+        uint16_t time_step, const ControlLimits *limits) {
+    int oldest, closing;
+    uint16_t oldest_time;
+    unsigned int ttc;
+
+    // Exponential filter (alpha = 1/4) in 1/16 mm
+    if (guard->filter_mm_q4 < 0) {
+        guard->filter_mm_q4 = (long) distance_mm << 4;
+    } else {
+        guard->filter_mm_q4 += (((long) distance_mm << 4) - guard->filter_mm_q4) >> 2;
+    }
+    distance_mm = guard->filter_mm_q4 >> 4;
+
+    // Closing speed from the filtered history, timestamped since the
+    // sample rate may change
+    guard->time += time_step;
+    oldest = guard->history[guard->index];
+    oldest_time = guard->history_time[guard->index];
+    guard->history[guard->index] = distance_mm;
+    guard->history_time[guard->index] = guard->time;
+    guard->index = (guard->index + 1) % CONTROL_SPEED_SPAN;
+    if (guard->filled < CONTROL_SPEED_SPAN) {
+        guard->filled++;
+        closing = 0;
+    } else {
+        closing = (long) (oldest - distance_mm) * CONTROL_TIME_HZ / (uint16_t) (guard->time - oldest_time);
+    }
+    closing = guard->closing_mm_s + ((closing - guard->closing_mm_s) >> 2);
+
+    // Time-to-collision and graded deceleration
+    if (closing > CONTROL_MIN_CLOSING_SPEED) {
+        long t = (long) distance_mm * 1000 / closing;
+        ttc = (t < CONTROL_TTC_INFINITE) ? t : CONTROL_TTC_INFINITE;
+    } else {
+        ttc = CONTROL_TTC_INFINITE;
+    }
+    if (ttc >= limits->ttc_brake_ms) {
+        guard->brake_percent = 100;
+    } else if (ttc <= limits->ttc_stop_ms) {
+        guard->brake_percent = 0;
+    } else {
+        guard->brake_percent = (long) (ttc - limits->ttc_stop_ms) * 100 / (limits->ttc_brake_ms - limits->ttc_stop_ms);
+    }
+
+    guard->distance_mm = distance_mm;
+    guard->closing_mm_s = closing;
+    guard->ttc_ms = ttc;
+
+    if (distance_mm < limits->distance_threshold_mm) return CONTROL_STOP_DISTANCE;
+    if (ttc < limits->ttc_stop_ms) return CONTROL_STOP_TTC;
+    return CONTROL_CLEAR;
+}
+/*================================================================*/
+
+/*================================================================*/
+int control_brake_speed(int speed, int brake_percent) {
+    if (speed <= 0) return speed;
+    return (long) speed * brake_percent / 100;
+}
+/*================================================================*/
+
+/*================================================================*/
+int control_hold_step(uint16_t *clear_ms, int distance_mm, uint16_t elapsed_ms,
+        const ControlLimits *limits) {
+    if (distance_mm < limits->distance_threshold_mm) {
+        *clear_ms = 0;
+        return 0;
+    }
+    *clear_ms += elapsed_ms;
+    if (*clear_ms < limits->emergency_hold_ms) return 0;
+    *clear_ms = 0;
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+void control_mix(int speed, int yawrate, int period, int *left, int *right) {
+    // Map speed and yawrate from [-100, 100] to [-period, period]
+    long speed_pwm = (long) speed * period / 100;
+    long yaw_pwm = (long) yawrate * period / 100;
+
+    // For an anti-clockwise (positive yaw) turn the right motor goes
+    // faster and the left motor slower
+    long left_pwm = speed_pwm - yaw_pwm;
+    long right_pwm = speed_pwm + yaw_pwm;
+
+    // Saturate to what the motor driver accepts
+    if (left_pwm > period) left_pwm = period;
+    if (left_pwm < -period) left_pwm = -period;
+    if (right_pwm > period) right_pwm = period;
+    if (right_pwm < -period) right_pwm = -period;
+    *left = (int) left_pwm;
+    *right = (int) right_pwm;
+}
+/*================================================================*/
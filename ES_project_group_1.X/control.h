@@ -0,0 +1,99 @@
+/* ===============================================================
+ * File: control.h                                               =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdint.h>
+
+// Obstacle guard, emergency hold and motor mixer. Plain C without
+// peripheral access: adc.c, pwm.c and main.c call it on the robot, the
+// closed-loop simulator (sim/estop_sim.cpp) runs the same code on the PC.
+
+// Readings given to control_adc_to_mm(), 10-bit ADC plus oversampling bits
+#define CONTROL_ADC_BITS 13
+// Unit of the guard time steps: 1/CONTROL_TIME_HZ s
+#define CONTROL_TIME_HZ 500
+// Number of filtered samples between the two ends of the closing speed
+// difference (32ms at 500Hz, 128ms at 125Hz)
+#define CONTROL_SPEED_SPAN 16
+// Below this closing speed (mm/s) the obstacle is considered static
+#define CONTROL_MIN_CLOSING_SPEED 50
+// Time-to-collision reported when the obstacle is not getting closer
+#define CONTROL_TTC_INFINITE 0xFFFF
+
+// Thresholds, copied from the parameters of the same name (params.h)
+typedef struct {
+    uint16_t distance_threshold_mm; // DIST_THR
+    uint16_t emergency_hold_ms; // EMRG_HOLD
+    uint16_t ttc_brake_ms; // TTC_BRAKE
+    uint16_t ttc_stop_ms; // TTC_STOP
+} ControlLimits;
+
+#define CONTROL_LIMITS(params) { \
+    (params).distance_threshold_mm, (params).emergency_hold_ms, \
+    (params).ttc_brake_ms, (params).ttc_stop_ms }
+
+// Why the guard asks for a hard stop
+typedef enum {
+    CONTROL_CLEAR = 0,
+    CONTROL_STOP_DISTANCE, // closer than DIST_THR
+    CONTROL_STOP_TTC // time-to-collision below TTC_STOP
+} ControlStop;
+
+// Distance filter, closing speed and time-to-collision of one sensor
+typedef struct {
+    long filter_mm_q4; // distance EMA in 1/16 mm, -1 until the first sample
+    int history[CONTROL_SPEED_SPAN];
+    uint16_t history_time[CONTROL_SPEED_SPAN];
+    uint16_t time; // in 1/CONTROL_TIME_HZ s
+    uint8_t index;
+    uint8_t filled;
+    // Outputs of the last control_guard_update()
+    int distance_mm; // filtered
+    int closing_mm_s; // positive when the obstacle gets closer
+    unsigned int ttc_ms; // CONTROL_TTC_INFINITE if not closing in
+    int brake_percent; // forward speed scale, 100 = no braking
+} ControlGuard;
+
+// Converts a CONTROL_ADC_BITS IR reading to mm with the calibration curve.
+int control_adc_to_mm(uint16_t reading);
+
+// Starts a guard with no history.
+void control_guard_init(ControlGuard *guard);
+
+// Adds a distance sample: exponential filter (alpha = 1/4), closing
+// speed over CONTROL_SPEED_SPAN samples, time-to-collision and graded
+// deceleration (100% above TTC_BRAKE down to 0% at TTC_STOP).
+// Parameters:
+//   distance_mm - unfiltered distance
+//   time_step   - time since the previous sample, 1/CONTROL_TIME_HZ s
+// Returns:
+//   the hard stop the filtered sample calls for, CONTROL_CLEAR if none
+ControlStop control_guard_update(ControlGuard *guard, int distance_mm,
+        uint16_t time_step, const ControlLimits *limits);
+
+// Applies a brake percentage to the forward speed (reversing is free).
+int control_brake_speed(int speed, int brake_percent);
+
+// Counts the obstacle-free time in emergency, restarted by any
+// distance below DIST_THR.
+// Parameters:
+//   clear_ms   - counter, zeroed when the emergency starts
+//   elapsed_ms - time since the previous call
+// Returns:
+//   1 once the path has been clear for EMRG_HOLD, 0 otherwise
+int control_hold_step(uint16_t *clear_ms, int distance_mm, uint16_t elapsed_ms,
+        const ControlLimits *limits);
+
+// Mixes speed and yawrate (-100..100) into left and right duty cycles
+// in [-period, period]; a positive yawrate turns anti-clockwise.
+void control_mix(int speed, int yawrate, int period, int *left, int *right);
+
+#endif /* CONTROL_H */
@@ -0,0 +1,302 @@
+/* ===============================================================
+ * File: dsp.c                                                   =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "dsp.h"
+#include <stddef.h>
+#ifdef __XC16__
+#include <xc.h>
+#include "timer.h"
+#include "uart.h"
+#include "messages.h"
+#endif
+/*================================================================*/
+
+/*================================================================*/
+// Accumulator primitives. The engine versions keep the value in
+// accumulator A; the portable versions model it with 64-bit integers.
+/*================================================================*/
+#if DSP_USE_ENGINE
+
+#define DSP_ACC_DECLARE(acc) register int acc asm("A")
+#define DSP_CLR(acc) (acc = __builtin_clr())
+#define DSP_MAC(acc, a, b) (acc = __builtin_mac(acc, (a), (b), NULL, NULL, 0, NULL, NULL, 0, NULL, 0))
+#define DSP_SACR(acc, shift) ((q15_t) __builtin_sacr(acc, (shift)))
+
+#else
+
+#define DSP_ACC_DECLARE(acc) int64_t acc
+#define DSP_CLR(acc) (acc = 0)
+#define DSP_MAC(acc, a, b) (acc = dsp_sat31(acc + (((int64_t) (a) * (b)) * 2)))
+#define DSP_SACR(acc, shift) dsp_sacr(acc, (shift))
+
+// 1.31 accumulator saturation (SATA = 1, ACCSAT = 0)
+static int64_t dsp_sat31(int64_t acc) {
+    if (acc > INT32_MAX) return INT32_MAX;
+    if (acc < INT32_MIN) return INT32_MIN;
+    return acc;
+}
+
+// Store the high word with conventional rounding (RND = 1) and data
+// write saturation (SATDW = 1). A positive shift is a right shift.
+static q15_t dsp_sacr(int64_t acc, int shift) {
+    int64_t value = (shift >= 0) ? (acc >> shift) : (acc * ((int64_t) 1 << -shift));
+    value = (value + 0x8000) >> 16;
+    if (value > INT16_MAX) return INT16_MAX;
+    if (value < INT16_MIN) return INT16_MIN;
+    return (q15_t) value;
+}
+
+#endif
+/*================================================================*/
+
+/*================================================================*/
+void dsp_init(void) {
+#if DSP_USE_ENGINE
+    CORCONbits.US = 0; // signed multiplies
+    CORCONbits.IF = 0; // fractional mode
+    CORCONbits.SATA = 1; // saturate accumulator A
+    CORCONbits.SATB = 1; // saturate accumulator B
+    CORCONbits.ACCSAT = 0; // normal 1.31 saturation
+    CORCONbits.SATDW = 1; // saturate data space writes
+    CORCONbits.RND = 1; // conventional rounding
+#endif
+}
+/*================================================================*/
+
+/*================================================================*/
+q15_t dsp_scale_q15(q15_t x, q15_t gain) {
+    DSP_ACC_DECLARE(acc);
+    DSP_CLR(acc);
+    DSP_MAC(acc, x, gain);
+    return DSP_SACR(acc, 0);
+}
+/*================================================================*/
+
+/*================================================================*/
+void dsp_fir_init(DspFir *fir, const q15_t *coeffs, q15_t *delay, uint8_t taps) {
+    uint8_t i;
+    fir->coeffs = coeffs;
+    fir->delay = delay;
+    fir->taps = taps;
+    fir->index = 0;
+    for (i = 0; i < taps; i++) delay[i] = 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Dot product of the coefficients with the history, newest first
+/*================================================================*/
+static q15_t dsp_fir_output(const DspFir *fir) {
+    DSP_ACC_DECLARE(acc);
+    uint8_t k, slot = fir->index;
+
+    DSP_CLR(acc);
+    for (k = 0; k < fir->taps; k++) {
+        DSP_MAC(acc, fir->coeffs[k], fir->delay[slot]);
+        slot = (slot == 0) ? fir->taps - 1 : slot - 1;
+    }
+    return DSP_SACR(acc, 0);
+}
+/*================================================================*/
+
+/*================================================================*/
+static void dsp_fir_store(DspFir *fir, q15_t x) {
+    fir->index = (fir->index + 1 == fir->taps) ? 0 : fir->index + 1;
+    fir->delay[fir->index] = x;
+}
+/*================================================================*/
+
+/*================================================================*/
+q15_t dsp_fir(DspFir *fir, q15_t x) {
+    dsp_fir_store(fir, x);
+    return dsp_fir_output(fir);
+}
+/*================================================================*/
+
+/*================================================================*/
+void dsp_biquad_init(DspBiquad *biquad, q15_t b0, q15_t b1, q15_t b2, q15_t a1, q15_t a2) {
+    biquad->b0 = b0;
+    biquad->b1 = b1;
+    biquad->b2 = b2;
+    biquad->a1 = -a1; // stored negated so every term is a plain MAC
+    biquad->a2 = -a2;
+    biquad->x1 = biquad->x2 = biquad->y1 = biquad->y2 = 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+q15_t dsp_biquad(DspBiquad *biquad, q15_t x) {
+    DSP_ACC_DECLARE(acc);
+    q15_t y;
+
+    DSP_CLR(acc);
+    DSP_MAC(acc, biquad->b0, x);
+    DSP_MAC(acc, biquad->b1, biquad->x1);
+    DSP_MAC(acc, biquad->b2, biquad->x2);
+    DSP_MAC(acc, biquad->a1, biquad->y1);
+    DSP_MAC(acc, biquad->a2, biquad->y2);
+    y = DSP_SACR(acc, -1); // undo the halved coefficients
+
+    biquad->x2 = biquad->x1;
+    biquad->x1 = x;
+    biquad->y2 = biquad->y1;
+    biquad->y1 = y;
+    return y;
+}
+/*================================================================*/
+
+/*================================================================*/
+void dsp_decimator_init(DspDecimator *decimator, const q15_t *coeffs, q15_t *delay, uint8_t taps, uint8_t factor) {
+    dsp_fir_init(&decimator->fir, coeffs, delay, taps);
+    decimator->factor = factor;
+    decimator->phase = 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+int dsp_decimate(DspDecimator *decimator, q15_t x, q15_t *y) {
+    dsp_fir_store(&decimator->fir, x);
+    if (++decimator->phase < decimator->factor) return 0;
+    decimator->phase = 0;
+    *y = dsp_fir_output(&decimator->fir);
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+void dsp_movavg_init(DspMovingAverage *average, q15_t *buffer, uint8_t length) {
+    average->buffer = buffer;
+    average->length = length;
+    average->index = 0;
+    average->filled = 0;
+    average->sum = 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+void dsp_movavg_push(DspMovingAverage *average, q15_t x) {
+    if (average->filled == average->length) {
+        average->sum -= average->buffer[average->index]; // oldest leaves the window
+    } else {
+        average->filled++;
+    }
+    average->buffer[average->index] = x;
+    average->sum += x;
+    average->index = (average->index + 1 == average->length) ? 0 : average->index + 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+q15_t dsp_movavg_output(const DspMovingAverage *average) {
+    q31_t half;
+    if (average->filled == 0) return 0;
+    // Round half away from zero, identical on every target
+    half = average->filled / 2;
+    if (average->sum >= 0) return (average->sum + half) / average->filled;
+    return (average->sum - half) / average->filled;
+}
+/*================================================================*/
+
+/*================================================================*/
+void dsp_oversample_init(DspOversampler *oversampler, uint8_t bits) {
+    oversampler->sum = 0;
+    oversampler->count = 0;
+    oversampler->bits = bits;
+}
+/*================================================================*/
+
+/*================================================================*/
+int dsp_oversample(DspOversampler *oversampler, uint16_t x, uint16_t *y) {
+    oversampler->sum += x;
+    if (++oversampler->count < (1u << (2 * oversampler->bits))) return 0;
+    // 4^bits samples carry 2*bits extra bits, half of them is noise
+    if (oversampler->bits > 0) {
+        *y = (oversampler->sum + (1u << (oversampler->bits - 1))) >> oversampler->bits;
+    } else {
+        *y = oversampler->sum;
+    }
+    oversampler->sum = 0;
+    oversampler->count = 0;
+    return 1;
+}
+/*================================================================*/
+
+#ifdef __XC16__
+/*================================================================*/
+// Benchmark: each filter runs DSP_BENCH_SAMPLES samples timed with the
+// TIMER4 cycle counter, interrupts held off for a clean measurement
+/*================================================================*/
+#define DSP_BENCH_SAMPLES 32
+#define DSP_BENCH_TAPS 16
+
+static void dsp_bench_report(const char *name, uint16_t cycles) {
+    char message[MSG_MDSP_SIZE];
+    msg_encode_mdsp(message, name, cycles / DSP_BENCH_SAMPLES);
+    UART_SendString(message);
+}
+
+void dsp_benchmark(void) {
+    static const q15_t coeffs[DSP_BENCH_TAPS] = {
+        DSP_Q15(0.0625), DSP_Q15(0.0625), DSP_Q15(0.0625), DSP_Q15(0.0625),
+        DSP_Q15(0.0625), DSP_Q15(0.0625), DSP_Q15(0.0625), DSP_Q15(0.0625),
+        DSP_Q15(0.0625), DSP_Q15(0.0625), DSP_Q15(0.0625), DSP_Q15(0.0625),
+        DSP_Q15(0.0625), DSP_Q15(0.0625), DSP_Q15(0.0625), DSP_Q15(0.0625)
+    };
+    q15_t delay[DSP_BENCH_TAPS];
+    q15_t buffer[DSP_BENCH_TAPS];
+    DspFir fir;
+    DspBiquad biquad;
+    DspDecimator decimator;
+    DspMovingAverage average;
+    volatile q15_t sink;
+    uint16_t start, cycles;
+    int i;
+
+    __builtin_disi(0x3FFF);
+    dsp_fir_init(&fir, coeffs, delay, DSP_BENCH_TAPS);
+    start = TMR_CYCLES();
+    for (i = 0; i < DSP_BENCH_SAMPLES; i++) sink = dsp_fir(&fir, i * 512);
+    cycles = TMR_CYCLES() - start;
+    DISICNT = 0;
+    dsp_bench_report("FIR16", cycles);
+
+    __builtin_disi(0x3FFF);
+    dsp_biquad_init(&biquad, 1106, 2210, 1106, -18727, 6763);
+    start = TMR_CYCLES();
+    for (i = 0; i < DSP_BENCH_SAMPLES; i++) sink = dsp_biquad(&biquad, i * 512);
+    cycles = TMR_CYCLES() - start;
+    DISICNT = 0;
+    dsp_bench_report("BIQUAD", cycles);
+
+    __builtin_disi(0x3FFF);
+    dsp_decimator_init(&decimator, coeffs, delay, DSP_BENCH_TAPS, 4);
+    start = TMR_CYCLES();
+    for (i = 0; i < DSP_BENCH_SAMPLES; i++) {
+        q15_t y;
+        if (dsp_decimate(&decimator, i * 512, &y)) sink = y;
+    }
+    cycles = TMR_CYCLES() - start;
+    DISICNT = 0;
+    dsp_bench_report("DECIM16/4", cycles);
+
+    __builtin_disi(0x3FFF);
+    dsp_movavg_init(&average, buffer, DSP_BENCH_TAPS);
+    start = TMR_CYCLES();
+    for (i = 0; i < DSP_BENCH_SAMPLES; i++) {
+        dsp_movavg_push(&average, i * 512);
+        sink = dsp_movavg_output(&average);
+    }
+    cycles = TMR_CYCLES() - start;
+    DISICNT = 0;
+    dsp_bench_report("MAVG16", cycles);
+    (void) sink;
+}
+/*================================================================*/
+#endif
@@ -0,0 +1,109 @@
+/* ===============================================================
+ * File: dsp.h                                                   =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef DSP_H
+#define DSP_H
+
+#include <stdint.h>
+
+// Fixed-point filter library (Q15 samples and coefficients, Q31 sums).
+// On the dsPIC33E the multiply-accumulate loops run on the 40-bit DSP
+// accumulator through the XC16 builtins; everywhere else (or with
+// DSP_PORTABLE defined) a C model of the same accumulator is used:
+// fractional multiply, 1.31 saturation after every operation and
+// conventional rounding when storing, so both give identical results.
+#if defined(__dsPIC33E__) && !defined(DSP_PORTABLE)
+#define DSP_USE_ENGINE 1
+#else
+#define DSP_USE_ENGINE 0
+#endif
+
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+
+// Converts a constant in [-1, 1) to Q15
+#define DSP_Q15(x) ((q15_t) ((x) * 32768.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+// FIR filter: y = sum(coeffs[k] * x[n-k])
+typedef struct {
+    const q15_t *coeffs; // taps coefficients
+    q15_t *delay; // caller provided history, taps entries
+    uint8_t taps;
+    uint8_t index; // slot of the newest sample
+} DspFir;
+
+// Biquad IIR (direct form I): y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2
+// Coefficients are stored halved (Q15 of coef/2) so |coef| < 2 fits.
+typedef struct {
+    q15_t b0, b1, b2; // halved feed-forward coefficients
+    q15_t a1, a2; // halved feedback coefficients, stored negated
+    q15_t x1, x2, y1, y2; // state
+} DspBiquad;
+
+// FIR decimator: keeps every factor-th output of an FIR filter and only
+// computes those outputs.
+typedef struct {
+    DspFir fir;
+    uint8_t factor;
+    uint8_t phase;
+} DspDecimator;
+
+// Moving average over the last length samples (running Q31 sum).
+typedef struct {
+    q15_t *buffer; // caller provided, length entries
+    uint8_t length;
+    uint8_t index;
+    uint8_t filled;
+    q31_t sum;
+} DspMovingAverage;
+
+// Oversampling decimator: sums 4^bits samples and returns them with
+// bits extra bits of resolution (the noise on the input acts as dither).
+// Plain integer code, safe to use from interrupt routines.
+typedef struct {
+    uint32_t sum;
+    uint16_t count;
+    uint8_t bits;
+} DspOversampler;
+
+// Configures the DSP engine (fractional, saturating, conventional
+// rounding). Must run once before any filter on the target. The filters
+// use accumulator A, so they must not be used from interrupt routines.
+void dsp_init(void);
+
+// Scales a 16-bit value by a Q15 gain with rounding: round(x * gain).
+q15_t dsp_scale_q15(q15_t x, q15_t gain);
+
+void dsp_fir_init(DspFir *fir, const q15_t *coeffs, q15_t *delay, uint8_t taps);
+q15_t dsp_fir(DspFir *fir, q15_t x);
+
+void dsp_biquad_init(DspBiquad *biquad, q15_t b0, q15_t b1, q15_t b2, q15_t a1, q15_t a2);
+q15_t dsp_biquad(DspBiquad *biquad, q15_t x);
+
+void dsp_decimator_init(DspDecimator *decimator, const q15_t *coeffs, q15_t *delay, uint8_t taps, uint8_t factor);
+// Returns 1 and the output in *y once every factor input samples.
+int dsp_decimate(DspDecimator *decimator, q15_t x, q15_t *y);
+
+void dsp_movavg_init(DspMovingAverage *average, q15_t *buffer, uint8_t length);
+void dsp_movavg_push(DspMovingAverage *average, q15_t x);
+// Rounded mean of the samples pushed so far (at most length), 0 if none.
+q15_t dsp_movavg_output(const DspMovingAverage *average);
+
+void dsp_oversample_init(DspOversampler *oversampler, uint8_t bits);
+// Returns 1 and the rounded decimated value in *y once every 4^bits samples.
+int dsp_oversample(DspOversampler *oversampler, uint16_t x, uint16_t *y);
+
+#ifdef __XC16__
+// Measures the cycles per sample of each filter type and reports them
+// as $MDSP,filter,cycles* lines. Building with DSP_PORTABLE as well
+// gives the cycles of the C fallback for comparison.
+void dsp_benchmark(void);
+#endif
+
+#endif /* DSP_H */
@@ -0,0 +1,181 @@
+/* ===============================================================
+ * File: estimator.c                                             =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "estimator.h"
+#include "params.h"
+#include "pwm.h"
+#include "timer.h"
+/*================================================================*/
+// Internal state, only used from the main loop. Speeds are kept in
+// 1/16 mm/s and the heading in 1/256 mrad so small steps are not lost.
+#define EST_Q 4
+#define EST_HEADING_Q 8
+#define EST_PI_MRAD 3142L
+#define EST_BIAS_SHIFT 5 // bias EMA weight (1/32) while at rest
+
+static long est_model_speed; // 1/16 mm/s
+static long est_model_yawrate; // 1/16 mrad/s
+static long est_deviation; // accelerometer correction, 1/16 mm/s
+static long est_heading; // 1/256 mrad
+static long est_bias_x; // 1/16 mg
+static long est_bias_y; // 1/16 mg
+static int est_stall_ms;
+static int est_stall_hold_ms;
+static int est_lift_ms;
+static int est_lift_hold_ms;
+static int est_collision_hold_ms;
+static uint8_t est_budget_exceeded;
+static uint16_t est_peak_cycles;
+static Estimate est_current;
+/*================================================================*/
+
+/*================================================================*/
+void estimator_init(void) {
+    est_model_speed = 0;
+    est_model_yawrate = 0;
+    est_deviation = 0;
+    est_heading = 0;
+    est_bias_x = 0;
+    est_bias_y = 0;
+    est_stall_ms = 0;
+    est_stall_hold_ms = 0;
+    est_lift_ms = 0;
+    est_lift_hold_ms = 0;
+    est_collision_hold_ms = 0;
+    est_budget_exceeded = 0;
+    est_peak_cycles = 0;
+    est_current.speed = 0;
+    est_current.yawrate = 0;
+    est_current.heading = 0;
+    est_current.flags = 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+int estimator_period_ms(void) {
+    // ACC_BW 0x08 is 7.81Hz bandwidth (15.63Hz data rate), every step
+    // doubles it
+    int period = 64 >> (g_params.acc_bandwidth - 0x08);
+    return (period < 2) ? 2 : period;
+}
+/*================================================================*/
+
+/*================================================================*/
+// First-order lag step, snapping to the target once the step rounds to 0
+/*================================================================*/
+static long estimator_lag(long value, long target, int dt_ms) {
+    long step = (target - value) * dt_ms / EST_MOTOR_TAU_MS;
+    return (step == 0) ? target : value + step;
+}
+/*================================================================*/
+
+/*================================================================*/
+uint8_t estimator_update(int x_mg, int y_mg, int z_mg, int dt_ms) {
+    uint16_t start = TMR_CYCLES();
+    uint8_t raised = 0;
+    int left, right;
+    long command_speed, command_yawrate, model_accel, accel_x, accel_y;
+    long speed, yawrate, model_speed;
+
+    // Commanded wheel speeds from the duty cycles
+    pwm_get_duty(&left, &right);
+    command_speed = ((long) (left + right) * EST_WHEEL_MAX_MM_S / 2000) << EST_Q;
+    command_yawrate = ((long) (right - left) * EST_WHEEL_MAX_MM_S / EST_TRACK_MM) << EST_Q; // mrad/s
+
+    // Accelerometer offsets (mounting tilt) are learnt while at rest
+    if (left == 0 && right == 0 && est_model_speed == 0) {
+        est_bias_x += (((long) x_mg << EST_Q) - est_bias_x) >> EST_BIAS_SHIFT;
+        est_bias_y += (((long) y_mg << EST_Q) - est_bias_y) >> EST_BIAS_SHIFT;
+    }
+    accel_x = (((long) x_mg << EST_Q) - est_bias_x) * 981 / 100; // 1/16 mm/s^2
+    accel_y = (((long) y_mg << EST_Q) - est_bias_y) * 981 / 100;
+
+    // First-order motor model
+    model_accel = (command_speed - est_model_speed) * 1000 / EST_MOTOR_TAU_MS;
+    est_model_speed = estimator_lag(est_model_speed, command_speed, dt_ms);
+    est_model_yawrate = estimator_lag(est_model_yawrate, command_yawrate, dt_ms);
+
+    // Complementary filter: what the accelerometer saw that the model did
+    // not expect, leaking back to the model
+    est_deviation += (accel_x - model_accel) * dt_ms / 1000;
+    est_deviation -= est_deviation * dt_ms / EST_FUSION_TAU_MS;
+    speed = (est_model_speed + est_deviation) >> EST_Q;
+    model_speed = est_model_speed >> EST_Q;
+
+    // Yawrate: the centripetal acceleration corrects the model in turns
+    yawrate = est_model_yawrate >> EST_Q;
+    if (speed > EST_MIN_TURN_SPEED || speed < -EST_MIN_TURN_SPEED) {
+        long centripetal = (accel_y >> EST_Q) * 1000 / speed;
+        yawrate += (centripetal - yawrate) >> EST_YAW_TRUST_SHIFT;
+    }
+    est_heading += (yawrate * dt_ms << EST_HEADING_Q) / 1000;
+    if (est_heading >= (EST_PI_MRAD << EST_HEADING_Q)) est_heading -= (2 * EST_PI_MRAD) << EST_HEADING_Q;
+    if (est_heading < -(EST_PI_MRAD << EST_HEADING_Q)) est_heading += (2 * EST_PI_MRAD) << EST_HEADING_Q;
+
+    // Stall: the wheels are driven but the robot does not follow
+    if (g_params.stall_ms && ((model_speed > EST_STALL_MIN_SPEED && speed < model_speed / 2) ||
+            (model_speed < -EST_STALL_MIN_SPEED && speed > model_speed / 2))) {
+        est_stall_ms += dt_ms;
+        if (est_stall_ms >= (int) g_params.stall_ms) {
+            est_stall_ms = g_params.stall_ms; // no overflow while it lasts
+            est_stall_hold_ms = EST_FLAG_HOLD_MS;
+            raised |= EST_FLAG_STALL;
+        }
+    } else {
+        est_stall_ms = 0;
+    }
+    // Collision: sudden deceleration while driving forward
+    if (model_speed > EST_STALL_MIN_SPEED && accel_x < -(((long) EST_COLLISION_MG << EST_Q) * 981 / 100)) {
+        est_collision_hold_ms = EST_FLAG_HOLD_MS;
+        raised |= EST_FLAG_COLLISION;
+    }
+    // Lift: the robot is no longer upright on the floor
+    if (g_params.lift_ms && (z_mg > EST_ONE_G_MG + (int) g_params.lift_mg ||
+            z_mg < EST_ONE_G_MG - (int) g_params.lift_mg)) {
+        est_lift_ms += dt_ms;
+        if (est_lift_ms >= (int) g_params.lift_ms) {
+            est_lift_ms = g_params.lift_ms;
+            est_lift_hold_ms = EST_FLAG_HOLD_MS;
+            raised |= EST_FLAG_LIFT;
+        }
+    } else {
+        est_lift_ms = 0;
+    }
+
+    est_current.speed = speed;
+    est_current.yawrate = yawrate;
+    est_current.heading = est_heading >> EST_HEADING_Q;
+    est_current.flags = (est_stall_hold_ms > 0 ? EST_FLAG_STALL : 0) |
+            (est_collision_hold_ms > 0 ? EST_FLAG_COLLISION : 0) |
+            (est_lift_hold_ms > 0 ? EST_FLAG_LIFT : 0) |
+            (est_budget_exceeded ? EST_FLAG_BUDGET : 0);
+    if (est_stall_hold_ms > 0) est_stall_hold_ms -= dt_ms;
+    if (est_collision_hold_ms > 0) est_collision_hold_ms -= dt_ms;
+    if (est_lift_hold_ms > 0) est_lift_hold_ms -= dt_ms;
+
+    // Cycle accounting against the budget
+    start = TMR_CYCLES() - start;
+    if (start > est_peak_cycles) est_peak_cycles = start;
+    if (start > EST_CYCLE_BUDGET) est_budget_exceeded = 1;
+    return raised;
+}
+/*================================================================*/
+
+/*================================================================*/
+void estimator_get(Estimate *estimate) {
+    *estimate = est_current;
+}
+/*================================================================*/
+
+/*================================================================*/
+uint16_t estimator_peak_cycles(void) {
+    return est_peak_cycles;
+}
+/*================================================================*/
@@ -0,0 +1,86 @@
+/* ===============================================================
+ * File: estimator.h                                             =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef ESTIMATOR_H
+#define ESTIMATOR_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Velocity and heading estimate fusing the accelerometer with the wheel
+// PWMs. A first-order motor model driven by the commanded duty gives the
+// low frequency part, the accelerometer (x forward, y to the left) the
+// high frequency part:
+//   v     = v_model + d,  d' = (a_x - a_model) - d / EST_FUSION_TAU_MS
+//   omega = omega_model + (a_y / v - omega_model) / 2^EST_YAW_TRUST_SHIFT
+// Everything is integer arithmetic, run at the accelerometer data rate.
+
+// Robot model, to be calibrated on the real platform
+#define EST_WHEEL_MAX_MM_S 500 // wheel speed at 100% duty
+#define EST_TRACK_MM 100 // distance between the wheels
+#define EST_MOTOR_TAU_MS 150 // motor time constant
+// Time constant below which the accelerometer is trusted over the model
+#define EST_FUSION_TAU_MS 500
+// Weight of the centripetal yawrate (1/4)
+#define EST_YAW_TRUST_SHIFT 2
+// Below this speed (mm/s) a_y / v is meaningless
+#define EST_MIN_TURN_SPEED 100
+
+// Stall: the model speed is above EST_STALL_MIN_SPEED but the estimate
+// stays below half of it for STALL_MS (params.h)
+#define EST_STALL_MIN_SPEED 150
+// Lift: z stays more than LIFT_MG away from 1 g for LIFT_MS (picked up,
+// tipped over). Lifted and held level, the wheels spin freely and the
+// stall check sees it instead.
+#define EST_ONE_G_MG 1000
+// Collision: deceleration above EST_COLLISION_MG while driving forward
+#define EST_COLLISION_MG 800
+// Flags stay raised at least this long so a 10Hz telemetry sees them
+#define EST_FLAG_HOLD_MS 500
+
+// One update must fit in this many cycles (2% of the 2ms loop at 72MHz)
+#define EST_CYCLE_BUDGET 2880
+
+// Status flags
+#define EST_FLAG_STALL 0x01
+#define EST_FLAG_COLLISION 0x02
+#define EST_FLAG_BUDGET 0x04 // an update exceeded EST_CYCLE_BUDGET
+#define EST_FLAG_LIFT 0x08
+
+typedef struct {
+    int speed; // mm/s, positive forward
+    int yawrate; // mrad/s, positive anticlockwise
+    int heading; // mrad in [-3142, 3142), 0 at boot
+    uint8_t flags; // EST_FLAG_*
+} Estimate;
+
+// Resets the estimate (heading 0, robot at rest).
+void estimator_init(void);
+
+// Period (ms) at which the accelerometer produces new data for the
+// configured ACC_BW bandwidth, never less than one main loop tick.
+int estimator_period_ms(void);
+
+// Runs one estimator step with a new accelerometer sample (in mg).
+// Parameters:
+//   x_mg, y_mg - forward and left accelerations
+//   z_mg       - vertical acceleration, 1 g at rest
+//   dt_ms      - time since the previous step
+// Returns:
+//   the EST_FLAG_STALL / EST_FLAG_COLLISION / EST_FLAG_LIFT conditions
+//   met by this very step, without the telemetry hold
+uint8_t estimator_update(int x_mg, int y_mg, int z_mg, int dt_ms);
+
+// Copies the latest estimate.
+void estimator_get(Estimate *estimate);
+
+// Longest update measured so far, in cycles (published in $MEST).
+uint16_t estimator_peak_cycles(void);
+
+#endif /* ESTIMATOR_H */
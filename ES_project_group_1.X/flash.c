@@ -0,0 +1,96 @@
+/* ===============================================================
+ * File: flash.c                                                 =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "flash.h"
+/*================================================================*/
+
+/*================================================================*/
+// NVMCON operations (WREN set)
+#define NVM_DWORD_PROGRAM 0x4001
+#define NVM_PAGE_ERASE 0x4003
+// Table page of the write latches
+#define NVM_LATCH_PAGE 0xFA
+/*================================================================*/
+
+/*================================================================*/
+void flash_erase_page(uint32_t address) {
+    NVMADRU = (uint16_t) (address >> 16);
+    NVMADR = (uint16_t) (address & 0xFFFF);
+    NVMCON = NVM_PAGE_ERASE;
+    __builtin_write_NVM(); // unlock sequence and start, interrupts disabled inside
+    while (NVMCONbits.WR); // wait for completion
+}
+/*================================================================*/
+
+/*================================================================*/
+void flash_write_dword(uint32_t address, uint16_t word0, uint16_t word1) {
+    uint16_t saved_tblpag = TBLPAG;
+
+    // Load the two write latches, upper bytes left erased
+    TBLPAG = NVM_LATCH_PAGE;
+    __builtin_tblwtl(0, word0);
+    __builtin_tblwth(0, 0xFF);
+    __builtin_tblwtl(2, word1);
+    __builtin_tblwth(2, 0xFF);
+
+    NVMADRU = (uint16_t) (address >> 16);
+    NVMADR = (uint16_t) (address & 0xFFFF);
+    NVMCON = NVM_DWORD_PROGRAM;
+    __builtin_write_NVM();
+    while (NVMCONbits.WR);
+
+    TBLPAG = saved_tblpag;
+}
+/*================================================================*/
+
+/*================================================================*/
+void flash_write_instructions(uint32_t address, uint32_t instr0, uint32_t instr1) {
+    uint16_t saved_tblpag = TBLPAG;
+
+    TBLPAG = NVM_LATCH_PAGE;
+    __builtin_tblwtl(0, (uint16_t) instr0);
+    __builtin_tblwth(0, (uint8_t) (instr0 >> 16));
+    __builtin_tblwtl(2, (uint16_t) instr1);
+    __builtin_tblwth(2, (uint8_t) (instr1 >> 16));
+
+    NVMADRU = (uint16_t) (address >> 16);
+    NVMADR = (uint16_t) (address & 0xFFFF);
+    NVMCON = NVM_DWORD_PROGRAM;
+    __builtin_write_NVM();
+    while (NVMCONbits.WR);
+
+    TBLPAG = saved_tblpag;
+}
+/*================================================================*/
+
+/*================================================================*/
+uint16_t flash_read_word(uint32_t address) {
+    uint16_t saved_tblpag = TBLPAG;
+    uint16_t value;
+
+    TBLPAG = (uint16_t) (address >> 16);
+    value = __builtin_tblrdl((uint16_t) (address & 0xFFFF));
+    TBLPAG = saved_tblpag;
+    return value;
+}
+/*================================================================*/
+
+/*================================================================*/
+uint32_t flash_read_instruction(uint32_t address) {
+    uint16_t saved_tblpag = TBLPAG;
+    uint32_t value;
+
+    TBLPAG = (uint16_t) (address >> 16);
+    value = __builtin_tblrdl((uint16_t) (address & 0xFFFF));
+    value |= (uint32_t) (__builtin_tblrdh((uint16_t) (address & 0xFFFF)) & 0xFF) << 16;
+    TBLPAG = saved_tblpag;
+    return value;
+}
+/*================================================================*/
@@ -0,0 +1,45 @@
+/* ===============================================================
+ * File: flash.h                                                 =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef FLASH_H
+#define FLASH_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Program memory geometry of the dsPIC33EP512MU810.
+// One page is 1024 instruction words = 0x800 program addresses.
+// Only the lower 16 bits of each instruction word are used for data,
+// so a page holds FLASH_PAGE_WORDS 16-bit words.
+#define FLASH_PAGE_WORDS 1024
+#define FLASH_PAGE_ADDRESSES (FLASH_PAGE_WORDS * 2)
+
+// Erases the page containing the given program address.
+// The CPU stalls for the whole erase (tens of ms), so this must not be
+// called while the motors are controlled.
+void flash_erase_page(uint32_t address);
+
+// Programs two consecutive 16-bit words (one double instruction word).
+// Parameters:
+//   address - even program address, must be erased beforehand
+//   word0   - value of the word at address
+//   word1   - value of the word at address + 2
+void flash_write_dword(uint32_t address, uint16_t word0, uint16_t word1);
+
+// Reads the lower 16 bits of the instruction word at a program address.
+uint16_t flash_read_word(uint32_t address);
+
+// Same as flash_write_dword with full 24-bit instruction words, used to
+// program code (see update.h). The upper byte of each value is ignored.
+void flash_write_instructions(uint32_t address, uint32_t instr0, uint32_t instr1);
+
+// Reads the 24-bit instruction word at a program address.
+uint32_t flash_read_instruction(uint32_t address);
+
+#endif /* FLASH_H */
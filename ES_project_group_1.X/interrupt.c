@@ -8,79 +8,176 @@
  * ===============================================================*/
 /*===============================================================*/
 #include "interrupt.h"
+#include "uart.h"
+#include "messages.h"
 /*===============================================================*/
 
 /*===============================================================*/
-typedef enum {
-    STATE_WAIT_FOR_START = 0,
-    STATE_MOVING,
-    STATE_EMERGENCY
-} RobotState;
-extern volatile RobotState current_state;
-// External state variables
-extern int is_pwm_on;
+// Buttons: T2 on RE8, T3 on RE9, pulled up (0 when pressed)
+#define BUTTON_COUNT 2
+#define BUTTON_PRESSED_LEVEL 0
+#define BUTTON_DEBOUNCE_TICKS (BUTTON_DEBOUNCE_MS / 2)
+#define BUTTON_LONG_TICKS (BUTTON_LONG_MS / 2)
+
+typedef struct {
+    uint8_t raw; // last sampled level
+    uint8_t stable; // debounced level
+    uint8_t long_sent; // long press already reported for this press
+    uint16_t change_tick; // tick of the last raw level change
+    uint16_t press_tick; // tick of the debounced press
+} Button;
+
+static Button buttons[BUTTON_COUNT];
+static const ButtonEvent press_events[BUTTON_COUNT] = {BUTTON_T2_PRESS, BUTTON_T3_PRESS};
+static const ButtonEvent long_events[BUTTON_COUNT] = {BUTTON_T2_LONG, BUTTON_T3_LONG};
+
+// Event queue: written by the tick interrupt, read by the main loop
+#define BUTTON_QUEUE_SIZE 4
+static volatile ButtonEvent button_queue[BUTTON_QUEUE_SIZE];
+static volatile uint8_t button_head = 0;
+static volatile uint8_t button_tail = 0;
+/*===============================================================*/
+// Worst case measured per source, in cycles
+static volatile uint16_t isr_max_latency[ISR_COUNT];
+static volatile uint16_t isr_max_duration[ISR_COUNT];
+static const char *isr_names[ISR_COUNT] = {"ADC", "U1RX", "T1", "U1TX"};
 /*===============================================================*/
 
 /*===============================================================*/
 // Initialize all interrupts
 void init_interrupts(void) {
+    int i;
+
     // Set pin as input
     TRISEbits.TRISE8 = 1; // T2 button set as input
     TRISEbits.TRISE9 = 1; // T3 button set as input
+    for (i = 0; i < BUTTON_COUNT; i++) {
+        buttons[i].raw = buttons[i].stable = !BUTTON_PRESSED_LEVEL;
+        buttons[i].long_sent = 0;
+        buttons[i].change_tick = buttons[i].press_tick = 0;
+    }
+
+    // Priority plan, see interrupt.h
+    INTCON1bits.NSTDIS = 0; // Allow nesting
+    IPC3bits.AD1IP = IPL_ADC;
+    IPC2bits.U1RXIP = IPL_UART_RX;
+    IPC0bits.T1IP = IPL_TICK;
+    IPC3bits.U1TXIP = IPL_UART_TX;
 
-    // Configure INT1 interrupt for button input
-    RPINR0bits.INT1R = 0x58; // Map INT1 to RPI88 (RE8)
+    // Cycle counter used by the ISR profiling
+    tmr_start_cycle_counter();
+
+    // System tick: TIMER1 period interrupt, the buttons are polled there
+    // so neither INT1 nor TIMER2 is needed anymore
+    IFS0bits.T1IF = 0;
+    IEC0bits.T1IE = 1;
     INTCON2bits.GIE = 1; // Enable global interrupts
-    IFS1bits.INT1IF = 0; // Clear interrupt flag
-    IEC1bits.INT1IE = 1; // Enable INT1 interrupt
 }
 /*===============================================================*/
-/*===============================================================*/
 
 /*===============================================================*/
-// Interrupt routine for pressed button
+// Timestamp based debouncing: a level is accepted once it has not
+// changed for BUTTON_DEBOUNCE_MS, a long press is reported once the
+// accepted press has lasted BUTTON_LONG_MS.
 /*===============================================================*/
-void __attribute__((__interrupt__, __auto_psv__)) _INT1Interrupt(void) {
-    // Clear interrupt flag and disable interrupt during processing
-    IFS1bits.INT1IF = 0;
-    IEC1bits.INT1IE = 0;
+static void button_push_event(ButtonEvent event) {
+    uint8_t next = (button_head + 1) % BUTTON_QUEUE_SIZE;
+    if (next != button_tail) { // drop the event if main is not keeping up
+        button_queue[button_head] = event;
+        button_head = next;
+    }
+}
+/*===============================================================*/
+
+/*===============================================================*/
+void buttons_sample(uint16_t tick) {
+    uint8_t levels[BUTTON_COUNT];
+    int i;
+
+    levels[0] = PORTEbits.RE8;
+    levels[1] = PORTEbits.RE9;
 
-    if (current_state != STATE_EMERGENCY) {
-        switch (current_state) {
-            case STATE_WAIT_FOR_START:
-                // Transition to Moving state
-                current_state = STATE_MOVING;
-                break;
+    for (i = 0; i < BUTTON_COUNT; i++) {
+        Button *button = &buttons[i];
 
-            case STATE_MOVING:
-                // Transition back to Wait for Start state
-                current_state = STATE_WAIT_FOR_START;
-                set_motor_pwm(0, 0); // stop motors
-                break;
+        if (levels[i] != button->raw) {
+            button->raw = levels[i];
+            button->change_tick = tick;
+        } else if (button->raw != button->stable &&
+                (uint16_t) (tick - button->change_tick) >= BUTTON_DEBOUNCE_TICKS) {
+            button->stable = button->raw;
+            if (button->stable == BUTTON_PRESSED_LEVEL) {
+                button->press_tick = tick;
+                button->long_sent = 0;
+                button_push_event(press_events[i]);
+            }
+        }
 
-            default:
-                // Invalid state, transition to Wait for Start
-                current_state = STATE_WAIT_FOR_START;
-                set_motor_pwm(0, 0); // stop motors
-                break;
+        if (button->stable == BUTTON_PRESSED_LEVEL && !button->long_sent &&
+                (uint16_t) (tick - button->press_tick) >= BUTTON_LONG_TICKS) {
+            button->long_sent = 1;
+            button_push_event(long_events[i]);
         }
     }
+}
+/*===============================================================*/
+
+/*===============================================================*/
+ButtonEvent button_get_event(void) {
+    ButtonEvent event;
+    if (button_tail == button_head) return BUTTON_NONE;
+    event = button_queue[button_tail];
+    button_tail = (button_tail + 1) % BUTTON_QUEUE_SIZE;
+    return event;
+}
+/*===============================================================*/
+
+/*===============================================================*/
+// Profiling, each source only updates its own entries and a higher
+// priority source cannot preempt a source with its own index
+/*===============================================================*/
+void isr_profile_record(IsrSource source, uint16_t cycles) {
+    if (cycles > isr_max_duration[source]) isr_max_duration[source] = cycles;
+}
+/*===============================================================*/
 
-    // Setup debounce timer
-    tmr_setup_period(TIMER2, 20);
-    IEC0bits.T2IE = 1;
+/*===============================================================*/
+void isr_profile_latency(IsrSource source, uint16_t cycles) {
+    if (cycles > isr_max_latency[source]) isr_max_latency[source] = cycles;
 }
 /*===============================================================*/
 
 /*===============================================================*/
-// Debouncing using two interrupts
+// Besides the measured worst cases, the latency of each source is
+// bounded by the longest run of every source allowed to delay it
+// (higher priority sources and the same level), DISI sections aside.
+// This is the only figure for U1RX, whose request time is unknown.
 /*===============================================================*/
-void __attribute__((__interrupt__, __auto_psv__)) _T2Interrupt(void) {
-    // Clear timer interrupt flag
-    IFS0bits.T2IF = 0;
-    // Disable timer interrupt
-    IEC0bits.T2IE = 0;
-    // Re-enable button interrupt
-    IEC1bits.INT1IE = 1;
+void isr_profile_report(void) {
+    static const uint8_t priorities[ISR_COUNT] = {IPL_ADC, IPL_UART_RX, IPL_TICK, IPL_UART_TX};
+    char isr_message[MSG_MISR_SIZE];
+    uint16_t max_latency[ISR_COUNT], max_duration[ISR_COUNT];
+    int i, j;
+
+    // Take the worst cases and restart them with the routines held off,
+    // a new maximum between the read and the clear would be lost
+    __builtin_disi(0x3FFF);
+    for (i = 0; i < ISR_COUNT; i++) {
+        max_latency[i] = isr_max_latency[i];
+        max_duration[i] = isr_max_duration[i];
+        isr_max_latency[i] = 0;
+        isr_max_duration[i] = 0;
+    }
+    DISICNT = 0;
+
+    for (i = 0; i < ISR_COUNT; i++) {
+        uint32_t bound = 0;
+        for (j = 0; j < ISR_COUNT; j++) {
+            if (j != i && priorities[j] >= priorities[i]) bound += max_duration[j];
+        }
+        msg_encode_misr(isr_message, isr_names[i], max_latency[i], max_duration[i],
+                (bound < 0xFFFF) ? bound : 0xFFFF);
+        UART_SendString(isr_message);
+    }
 }
 /*===============================================================*/
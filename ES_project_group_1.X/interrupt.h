@@ -13,11 +13,71 @@
 #include "timer.h"
 #include <xc.h>
 
-// Interrupt handler declarations
-void __attribute__((__interrupt__, __auto_psv__)) _INT1Interrupt(void);
-void __attribute__((__interrupt__, __auto_psv__)) _T2Interrupt(void);
+// Interrupt priority plan (7 = highest, nesting enabled). A source may
+// only be preempted by a strictly higher one, and DISI critical sections
+// (state.h, recorder.c) hold off every level up to 6.
+//   6  _AD1Interrupt  IR distance hard stop, must react first
+//   5  _U1RXInterrupt 4-byte hardware FIFO, overruns if kept waiting
+//   4  _T1Interrupt   2ms system tick and button sampling
+//   3  _U1TXInterrupt only refills the transmitter
+#define IPL_ADC 6
+#define IPL_UART_RX 5
+#define IPL_TICK 4
+#define IPL_UART_TX 3
 
-// Interrupt initialization
+// Interrupt sources profiled by ISR_PROFILE_BEGIN/END
+typedef enum {
+    ISR_ADC = 0,
+    ISR_UART_RX,
+    ISR_TICK,
+    ISR_UART_TX,
+    ISR_COUNT
+} IsrSource;
+
+// Profiling of an interrupt routine with the TIMER4 cycle counter.
+// ISR_PROFILE_BEGIN must be the first statement of the routine.
+#define ISR_PROFILE_BEGIN() uint16_t isr_entry_cycles = TMR_CYCLES()
+#define ISR_PROFILE_END(source) isr_profile_record((source), TMR_CYCLES() - isr_entry_cycles)
+
+// Buttons, sampled and debounced in the system tick
+typedef enum {
+    BUTTON_NONE = 0,
+    BUTTON_T2_PRESS, // RE8 pressed (debounced)
+    BUTTON_T2_LONG, // RE8 held for BUTTON_LONG_MS
+    BUTTON_T3_PRESS, // RE9 pressed (debounced)
+    BUTTON_T3_LONG // RE9 held for BUTTON_LONG_MS
+} ButtonEvent;
+
+// A new level must be stable this long to be accepted
+#define BUTTON_DEBOUNCE_MS 20
+// Hold time of a long press
+#define BUTTON_LONG_MS 1000
+
+// Interrupt initialization: priorities, nesting, button pins and the
+// system tick interrupt.
 void init_interrupts(void);
 
+// Samples RE8/RE9 and queues the debounced button events.
+// Called from the system tick interrupt with the current tick.
+void buttons_sample(uint16_t tick);
+
+// Returns the next queued button event, BUTTON_NONE if there is none.
+// Called from the main loop, which performs the resulting actions.
+ButtonEvent button_get_event(void);
+
+// Records the duration of one run of an interrupt routine (in cycles).
+void isr_profile_record(IsrSource source, uint16_t cycles);
+
+// Records the entry latency of an interrupt (in cycles) for the sources
+// where the time of the request is known: ADC and T1 from their timer,
+// U1TX when UART_SendString wakes up the idle transmitter.
+// Called at the start of the routine.
+void isr_profile_latency(IsrSource source, uint16_t cycles);
+
+// Sends one $MISR,source,max_latency,max_duration,latency_bound* line
+// per source and restarts the measurement. max_latency is measured, 0
+// when there was no sample (always for U1RX); latency_bound is computed
+// from the max_duration of the sources that may delay the source.
+void isr_profile_report(void);
+
 #endif /* INTERRUPT_H */
@@ -10,7 +10,6 @@
 /*================================================================*/
 
 //includes                                                                  
-#include <stdio.h>
 #include "xc.h"
 #include "interrupt.h"
 #include "pwm.h"
@@ -18,6 +17,18 @@
 #include "timer.h"
 #include "uart.h"
 #include "adc.h"
+#include "trajectory.h"
+#include "ack.h"
+#include "telemetry.h"
+#include "params.h"
+#include "recorder.h"
+#include "state.h"
+#include "dsp.h"
+#include "estimator.h"
+#include "power.h"
+#include "boot.h"
+#include "messages.h"
+#include "control.h"
 /*================================================================*/
 
 // Macros
@@ -31,32 +42,18 @@
 /*===============================================================================*/
 
 // Global variables                                                                
-// 'volatile' is used because these are modified by UART and read by main loop 
-volatile int g_speed = 0;                                                      
-volatile int g_yawrate = 0;                                                    
 // State flags                                                                 
 int is_pwm_on; // Flag for PWM generation status                               
-// Command buffer "all commands receieved in circular buffer"                  
-extern volatile char rxBuffer[RX_BUFFER_COUNT][RX_STRING_LENGTH];              
-extern volatile uint8_t rx_write_index;                                        
-extern volatile uint8_t rx_read_index;                                                                                                  
 /*================================================================================*/
 
-// User defined variables
-typedef enum {
-    STATE_WAIT_FOR_START = 0,
-    STATE_MOVING,
-    STATE_EMERGENCY
-} RobotState;
-/*==============================================================================*/
-
-// Instance of the user defined variable
-volatile RobotState current_state;
+// The robot state and the setpoint are owned by state.c
 /*==============================================================================*/
 
 int main(void) {
     /*==========================================================================*/
     // Initializing variables, state and some hardware configurations
+    boot_check(); // finish a committed firmware update before anything else
+    power_init(); // Switch off the unused modules before configuring the others
 
     // Disable all analog functionalities on pins to use them as digital I/O
     ANSELA = ANSELB = ANSELC = ANSELD = ANSELE = ANSELG = 0x0000;
@@ -67,16 +64,22 @@ int main(void) {
     // Initialize state
     TURN_L = 0;
     TURN_R = 0;
-    float distance = 0.0; // Variable to store distance from IR sensor
-    float distance_threshold = 0.2; // Distance threshold for emergency state (20cm)
+    int distance_mm = 0; // Variable to store distance from IR sensor
+    // Emergency distance threshold (DIST_THR) and hold time (EMRG_HOLD)
+    // are read from g_params so they can be tuned over UART
     // Initialize states
-    current_state = STATE_WAIT_FOR_START;
+    state_init();
     is_pwm_on = 0; //pwm initially off
     // Register for accelerometer
-    int x_acc, y_acc, z_acc;
+    int x_acc = 0, y_acc = 0, z_acc = 0;
+    /*==========================================================================*/
+    // Load the tunable parameters first, the peripherals are configured from them
+    params_init();
+    dsp_init(); // fixed-point filters used by the ADC and accelerometer readings
     /*==========================================================================*/
     //peripheral initialization
     UART_Initialize();
+    recorder_init(); // flight recorder, logs the boot
     setup_adc(); // setup IR sensor and battery ADC
     // Initialize interrupts
     init_interrupts();
@@ -88,28 +91,73 @@ int main(void) {
     spi_setup();
     // Configure accelerometer
     accelerometer_config();
+    // Empty trajectory queue
+    trajectory_init();
+    // No sequenced command received yet
+    ack_init();
+    // Default telemetry rates
+    telemetry_init();
+    // Robot at rest, heading 0
+    estimator_init();
+#ifdef DSP_BENCHMARK
+    dsp_benchmark(); // report the filter cycles per sample once at boot
+#endif
     /*==========================================================================*/
     // Configure system timers
-    tmr_setup_period(TIMER1, 2); // TIMER1: 500Hz main loop timing (2ms)
-    tmr_setup_period(TIMER2, 20); // TIMER2: Used for button debouncing
+    tmr_setup_period(TIMER1, 2); // TIMER1: 500Hz system tick, also debounces the buttons
     LED1 = 1; // LED initially on indicating all inilization went good and the system is ready now
     /*==========================================================================*/
     // Initializing counters 
     int tmr_counter_led = 0;
     int tmr_counter_side_leds = 0;
-    int tmr_counter_emergency = 0;
-    int tmr_counter_send_distance = 0;
-    int tmr_counter_accelerometer = 0;
-    int tmr_counter_battery = 0;
+    uint16_t tmr_counter_emergency = 0;
     int tmr_counter_battery_read = 0;
+    int tmr_counter_imu = 0;
+    // One buffer for every message the loop sends, they are queued
+    // (copied to the TX buffer) before the next one is encoded
+    char message[MSG_MAX_SIZE];
     /*==========================================================================*/
 
     while (1) {
         /*==========================================================================*/
-        // Process all pending commands from the circular buffer
-        while (rx_read_index != rx_write_index) {
-            process_uart_command((const char *) rxBuffer[rx_read_index]);
-            rx_read_index = (rx_read_index + 1) % RX_BUFFER_COUNT;
+        // Process the pending commands within this tick's budget
+        UART_ProcessCommands();
+        // One acknowledgement frame for all sequenced commands of this tick
+        ack_flush();
+        // Switch the baud rate once the acknowledgements are out
+        UART_BaudTick();
+        // Firmware update once $PCUPD is acknowledged, only comes back
+        // here if no new image was committed
+        if (update_pending()) {
+            update_run();
+        }
+        // Continue a flight recorder dump
+        recorder_dump_step();
+        /*==========================================================================*/
+        // Button events debounced by the system tick. The actions are taken
+        // here rather than in the interrupt so the motors are only driven
+        // from the main loop (and the ADC hard stop).
+        ButtonEvent button;
+        while ((button = button_get_event()) != BUTTON_NONE) {
+            int is_t2 = (button == BUTTON_T2_PRESS || button == BUTTON_T2_LONG);
+            int is_long = (button == BUTTON_T2_LONG || button == BUTTON_T3_LONG);
+            msg_encode_mbtn(message, is_t2 ? "T2" : "T3", is_long);
+            UART_SendString(message);
+
+            if (button == BUTTON_T2_PRESS) {
+                // T2 toggles between waiting and moving, ignored in emergency
+                if (!state_transition(STATE_MASK(STATE_WAIT_FOR_START), STATE_MOVING) &&
+                        state_transition(STATE_MASK(STATE_MOVING), STATE_WAIT_FOR_START)) {
+                    set_motor_pwm(0, 0); // stop motors
+                    trajectory_flush();
+                }
+            } else if (button == BUTTON_T3_PRESS) {
+                // T3 always stops (outside emergency)
+                if (state_transition(STATE_MASK(STATE_MOVING), STATE_WAIT_FOR_START)) {
+                    set_motor_pwm(0, 0); // stop motors
+                    trajectory_flush();
+                }
+            }
         }
         /*==========================================================================*/
         // Handle LED blinking at 1Hz
@@ -119,12 +167,10 @@ int main(void) {
         }
         /*==========================================================================*/
         // Distance handling
-        distance = adc_distance(); // Read distance from ADC
-        if (tmr_counter_send_distance == 100) { // Send distance every 100ms
-            char distance_message[RX_STRING_LENGTH];
-            sprintf(distance_message, "$MDIST,%d*\r\n", average_distance());
-            UART_SendString(distance_message);
-            tmr_counter_send_distance = 0; // Reset send distance counter
+        distance_mm = adc_distance(); // Read distance from ADC
+        if (telemetry_due(TLM_DIST)) { // Send distance at the subscribed rate (10Hz default)
+            msg_encode_mdist(message, average_distance());
+            telemetry_send(TLM_DIST, message);
         }
         /*==========================================================================*/
         // Battery handling
@@ -133,69 +179,133 @@ int main(void) {
             adc_battery_voltage();
             tmr_counter_battery_read = 0;
         }
-        // Send battery voltage at 1Hz (every 1000ms)
-        if (tmr_counter_battery == 1000) {
-            double avg_battery_voltage = average_battery_voltage();
-            char bat_message[RX_STRING_LENGTH];
-            sprintf(bat_message, "$MBATT,%.2f*\r\n", avg_battery_voltage);
-            UART_SendString(bat_message);
-            tmr_counter_battery = 0;
+        // Send battery voltage at the subscribed rate (1Hz default)
+        if (telemetry_due(TLM_BATT)) {
+            int battery_cv = (average_battery_voltage() + 5) / 10; // mV to 1/100 V
+            msg_encode_mbatt(message, battery_cv);
+            telemetry_send(TLM_BATT, message);
+        }
+        /*==========================================================================*/
+        // Accelerometer handling
+        // Collision events latched by the sensor, polled every tick. Read in
+        // every state so a knock while waiting does not stop the next run.
+        uint8_t acc_events = accelerometer_events();
+        // Acquire data at its output data rate (slower while waiting) and
+        // update the estimate, which also tells a stall or a lift
+        uint8_t motion_flags = 0;
+        if (tmr_counter_imu >= power_imu_period_ms()) {
+            acquire_accelerometer_data(&x_acc, &y_acc, &z_acc);
+            motion_flags = estimator_update(x_acc, y_acc, z_acc, tmr_counter_imu);
+            tmr_counter_imu = 0;
         }
         /*==========================================================================*/
         // State moving handling
-        if (current_state == STATE_MOVING) {
-            if (distance < distance_threshold) {
-                UART_SendString("$MEMRG,1* \r\n");
+        // The ADC interrupt checks the distance and the time-to-collision on
+        // every conversion and stops the motors itself, the loop follows up
+        // with the state transition and applies the graded deceleration.
+        // A collision, stall or lift seen by the accelerometer this tick
+        // takes the same emergency path from here.
+        if (state_get() == STATE_MOVING) {
+            // Queued trajectory segments override the $PCREF setpoint
+            Setpoint setpoint;
+            state_get_setpoint(&setpoint);
+            int speed = setpoint.speed;
+            int yawrate = setpoint.yawrate;
+            trajectory_step(2, &speed, &yawrate);
+            speed = control_brake_speed(speed, adc_brake_percent()); // slow down before the obstacle
+            int motion_cause = acc_events ? REC_CAUSE_COLLISION :
+                    (motion_flags & EST_FLAG_STALL) ? REC_CAUSE_STALL :
+                    (motion_flags & EST_FLAG_LIFT) ? REC_CAUSE_LIFT : -1;
+            IEC0bits.AD1IE = 0; // a hard stop must not be overwritten by control_motors
+            int hard_stop = adc_emergency_request();
+            if (hard_stop || motion_cause >= 0) {
+                IEC0bits.AD1IE = 1;
+                set_motor_pwm(0, 0); // stop motors first, the rest is bookkeeping
+                if (!hard_stop) {
+                    recorder_log(EV_EMRG_ENTER, motion_cause, distance_mm); // the ADC logs its own causes
+                }
+                msg_encode_memrg(message, 1);
+                UART_SendString(message);
                 tmr_counter_emergency = 0; // Reset emergency counter
-                current_state = STATE_EMERGENCY;
-                set_motor_pwm(0, 0); // stop motors
+                // From any state: the button may have stopped us meanwhile, the stop still counts
+                state_transition(STATE_ANY, STATE_EMERGENCY);
+                trajectory_flush(); // never resume a stale trajectory after an emergency
             } else {
-                control_motors(g_speed, g_yawrate);
+                adc_arm_emergency(1);
+                control_motors(speed, yawrate);
+                IEC0bits.AD1IE = 1;
             }
+        } else {
+            adc_arm_emergency(0);
         }
         /*==========================================================================*/
         // State emergency handling
-        if (current_state == STATE_EMERGENCY) {
+        if (state_get() == STATE_EMERGENCY) {
             tmr_counter_side_leds += 2; // Increment side LED counter by 2ms
             if (tmr_counter_side_leds == 500) {
                 TURN_L = !TURN_L;
                 TURN_R = !TURN_R;
                 tmr_counter_side_leds = 0; // Reset side LED counter
             }
-            if (distance < distance_threshold) {
-                tmr_counter_emergency = 0; // Reset emergency counter
-            } else {
-                tmr_counter_emergency += 2; // Increment emergency counter by 2ms
-                if (tmr_counter_emergency == 5000) { // If 5000ms passed in emergency state
-                    current_state = STATE_WAIT_FOR_START; // Reset to wait for start state
-                    tmr_counter_emergency = 0; // Reset emergency counter
-                    TURN_L = 0; // Turn off left turn signal
-                    TURN_R = 0; // Turn off right turn signal
-                    tmr_counter_side_leds = 0; // Reset side LED counter
-                    UART_SendString("$MEMRG,0 \r\n");
-                }
-
+            ControlLimits limits = CONTROL_LIMITS(g_params);
+            // Counts 2ms per tick while clear, restarted by any close reading
+            if (control_hold_step(&tmr_counter_emergency, distance_mm, 2, &limits)) { // EMRG_HOLD (5000ms) passed clear
+                state_transition(STATE_MASK(STATE_EMERGENCY), STATE_WAIT_FOR_START); // Reset to wait for start state
+                TURN_L = 0; // Turn off left turn signal
+                TURN_R = 0; // Turn off right turn signal
+                tmr_counter_side_leds = 0; // Reset side LED counter
+                msg_encode_memrg(message, 0);
+                UART_SendString(message);
+                recorder_log(EV_EMRG_EXIT, 0, adc_distance_mm());
             }
         }
         /*==========================================================================*/
-        // Acquire accelerometer data at 10Hz (every 100ms)
-        if (tmr_counter_accelerometer == 100) {
-            tmr_counter_accelerometer = 0; // Reset accelerometer counter
-            acquire_accelerometer_data(&x_acc, &y_acc, &z_acc);
-            char acc_message[RX_STRING_LENGTH]; // Buffer for ACC message
-            sprintf(acc_message, "$MACC,%d,%d,%d*\r\n", x_acc, y_acc, z_acc);
-            UART_SendString(acc_message);
+        // Send the latest accelerometer sample at the subscribed rate (10Hz default)
+        if (telemetry_due(TLM_ACC)) {
+            msg_encode_macc(message, x_acc, y_acc, z_acc);
+            telemetry_send(TLM_ACC, message);
+        }
+        /*==========================================================================*/
+        // Velocity and heading estimate (5Hz default)
+        if (telemetry_due(TLM_EST)) {
+            Estimate estimate;
+            estimator_get(&estimate);
+            msg_encode_mest(message, estimate.speed, estimate.yawrate, estimate.heading, estimate.flags,
+                    estimator_peak_cycles());
+            telemetry_send(TLM_EST, message);
         }
         /*==========================================================================*/
+        // Trajectory queue telemetry (10Hz default) while a trajectory is active
+        if (telemetry_due(TLM_TRJ) && trajectory_active()) {
+            msg_encode_mtrj(message, trajectory_depth(), trajectory_underruns());
+            telemetry_send(TLM_TRJ, message);
+        }
+        // CPU load, sampling rates and estimated current (off by default)
+        if (telemetry_due(TLM_PWR)) {
+            power_report();
+        }
+        // RX error counters (off by default)
+        if (telemetry_due(TLM_LINK)) {
+            UART_ReportLink();
+        }
+        // Achieved rates and TX buffer occupancy (off by default)
+        if (telemetry_due(TLM_STAT)) {
+            telemetry_report();
+        }
+        /*==========================================================================*/
+        // Sensing schedule for the state and the speed
+        power_update(state_get());
+        /*==========================================================================*/
         // Time handling
         // Maintain 500Hz loop timing
-        tmr_wait_period(TIMER1); // Wait for timer period completion
+        if (tmr_wait_period(TIMER1)) { // Wait for timer period completion
+            recorder_log(EV_LOOP_OVERRUN, 0, 0);
+        }
         // Update timing counters (increment by 2ms)
-        tmr_counter_send_distance += 2;
         tmr_counter_led += 2;
-        tmr_counter_accelerometer += 2;
-        tmr_counter_battery += 2;
         tmr_counter_battery_read += 2;
+        tmr_counter_imu += 2;
+        telemetry_tick(); // Advance the telemetry stream schedules
         /*==========================================================================*/
     }
     return 0;
@@ -0,0 +1,587 @@
+/* ===============================================================
+ * File: messages.c                                              =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * Generated by tools/msggen.py from tools/messages.schema,      =
+ * do not edit.                                                  =
+ * ===============================================================*/
+
+/*================================================================*/
+#include <string.h>
+#include "messages.h"
+/*================================================================*/
+
+/*================================================================*/
+typedef enum {
+    MSG_SET_UPPER,
+    MSG_SET_IDENT,
+    MSG_SET_ALNUM,
+    MSG_SET_TEXT
+} MsgCharset;
+
+// Decimal digits of a 16-bit value, hardware division only
+static char *msg_put_u16(char *p, uint16_t value) {
+    char digits[5];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    while (count > 0) *p++ = digits[--count];
+    return p;
+}
+
+static char *msg_put_i16(char *p, int16_t value) {
+    if (value < 0) {
+        *p++ = '-';
+        return msg_put_u16(p, (uint16_t) -(int32_t) value);
+    }
+    return msg_put_u16(p, (uint16_t) value);
+}
+
+// 32-bit division (library call) only above 65535
+static char *msg_put_u32(char *p, uint32_t value) {
+    char digits[10];
+    int count = 0;
+    if (value <= 0xFFFF) return msg_put_u16(p, (uint16_t) value);
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    while (count > 0) *p++ = digits[--count];
+    return p;
+}
+
+static char *msg_put_i32(char *p, int32_t value) {
+    if (value < 0) {
+        *p++ = '-';
+        return msg_put_u32(p, (uint32_t) -value);
+    }
+    return msg_put_u32(p, (uint32_t) value);
+}
+
+// value / scale with log10(scale) decimals
+static char *msg_put_fixed(char *p, uint16_t value, uint16_t scale) {
+    uint16_t fraction = value % scale;
+    p = msg_put_u16(p, value / scale);
+    *p++ = '.';
+    for (scale /= 10; scale > 0; scale /= 10) {
+        *p++ = '0' + (fraction / scale) % 10;
+    }
+    return p;
+}
+
+static char *msg_put_hex(char *p, uint16_t value, int digits) {
+    static const char hex[] = "0123456789ABCDEF";
+    while (digits-- > 0) *p++ = hex[(value >> (4 * digits)) & 0xF];
+    return p;
+}
+
+static char *msg_put_str(char *p, const char *text, int max_length) {
+    while (max_length-- > 0 && *text != '\0') *p++ = *text++;
+    return p;
+}
+
+// Optional '-' and at least one digit, stops at the first other character
+static int msg_get_int(const char **text, int32_t *value) {
+    const char *p = *text;
+    uint32_t magnitude = 0;
+    int negative = (*p == '-');
+    int digits = 0;
+    if (negative) p++;
+    while (*p >= '0' && *p <= '9') {
+        uint8_t digit = *p++ - '0';
+        // above 2147483647, constant compares only (no 32-bit division)
+        if (magnitude >= 214748364UL && (magnitude > 214748364UL || digit > 7)) return 0;
+        magnitude = magnitude * 10 + digit;
+        digits++;
+    }
+    if (digits == 0) return 0;
+    *value = negative ? -(int32_t) magnitude : (int32_t) magnitude;
+    *text = p;
+    return 1;
+}
+
+static int msg_in_set(char c, MsgCharset set) {
+    int upper = (c >= 'A' && c <= 'Z');
+    switch (set) {
+        case MSG_SET_UPPER: return upper;
+        case MSG_SET_IDENT: return upper || c == '_';
+        case MSG_SET_ALNUM: return upper || (c >= '0' && c <= '9');
+        default: return c >= ' ' && c <= '~' && c != ',' && c != '*' && c != '#' && c != '$';
+    }
+}
+
+// 1 to max_length characters of the set, NUL terminated into out
+static int msg_get_str(const char **text, char *out, int max_length, MsgCharset set) {
+    const char *p = *text;
+    int length = 0;
+    while (msg_in_set(*p, set)) {
+        if (length == max_length) return 0;
+        out[length++] = *p++;
+    }
+    out[length] = '\0';
+    *text = p;
+    return length > 0;
+}
+
+// "*\r\n" and the NUL, returns the message length
+static int msg_finish(char *out, char *p) {
+    *p++ = '*';
+    *p++ = '\r';
+    *p++ = '\n';
+    *p = '\0';
+    return p - out;
+}
+/*================================================================*/
+
+/*================================================================*/
+MsgCommand msg_command_type(const char *line) {
+    if (line[0] != '$' || line[1] != 'P' || line[2] != 'C') return MSG_UNKNOWN;
+    switch (line[3]) {
+        case 'B':
+            if (line[4] == 'D' && line[5] == 'R' && line[6] == ',') return MSG_PCBDR;
+            if (line[4] == 'O' && line[5] == 'K' && line[6] == ',') return MSG_PCBOK;
+            break;
+        case 'I':
+            if (line[4] == 'S' && line[5] == 'R' && line[6] == ',') return MSG_PCISR;
+            break;
+        case 'L':
+            if (line[4] == 'O' && line[5] == 'G' && line[6] == ',') return MSG_PCLOG;
+            break;
+        case 'P':
+            if (line[4] == 'G' && line[5] == 'T' && line[6] == ',') return MSG_PCPGT;
+            if (line[4] == 'S' && line[5] == 'T' && line[6] == ',') return MSG_PCPST;
+            if (line[4] == 'S' && line[5] == 'V' && line[6] == ',') return MSG_PCPSV;
+            if (line[4] == 'D' && line[5] == 'F' && line[6] == ',') return MSG_PCPDF;
+            break;
+        case 'R':
+            if (line[4] == 'E' && line[5] == 'F' && line[6] == ',') return MSG_PCREF;
+            break;
+        case 'S':
+            if (line[4] == 'T' && line[5] == 'P' && line[6] == ',') return MSG_PCSTP;
+            if (line[4] == 'T' && line[5] == 'T' && line[6] == ',') return MSG_PCSTT;
+            if (line[4] == 'Y' && line[5] == 'N' && line[6] == ',') return MSG_PCSYN;
+            if (line[4] == 'U' && line[5] == 'B' && line[6] == ',') return MSG_PCSUB;
+            break;
+        case 'T':
+            if (line[4] == 'R' && line[5] == 'J' && line[6] == ',') return MSG_PCTRJ;
+            if (line[4] == 'R' && line[5] == 'F' && line[6] == ',') return MSG_PCTRF;
+            break;
+        case 'U':
+            if (line[4] == 'P' && line[5] == 'D' && line[6] == ',') return MSG_PCUPD;
+            break;
+    }
+    return MSG_UNKNOWN;
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mdist(char *out, uint16_t distance) {
+    char *p = out;
+    memcpy(p, "$MDIST", 6);
+    p += 6;
+    *p++ = ',';
+    p = msg_put_u16(p, (distance > 999 ? 999 : distance));
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mbatt(char *out, uint16_t voltage) {
+    char *p = out;
+    memcpy(p, "$MBATT", 6);
+    p += 6;
+    *p++ = ',';
+    p = msg_put_fixed(p, (voltage > 9999 ? 9999 : voltage), 100);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_macc(char *out, int16_t x, int16_t y, int16_t z) {
+    char *p = out;
+    memcpy(p, "$MACC", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_i16(p, (x < -16000 ? -16000 : x > 16000 ? 16000 : x));
+    *p++ = ',';
+    p = msg_put_i16(p, (y < -16000 ? -16000 : y > 16000 ? 16000 : y));
+    *p++ = ',';
+    p = msg_put_i16(p, (z < -16000 ? -16000 : z > 16000 ? 16000 : z));
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mtrj(char *out, uint8_t depth, uint16_t underruns) {
+    char *p = out;
+    memcpy(p, "$MTRJ", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_u16(p, (depth > 16 ? 16 : depth));
+    *p++ = ',';
+    p = msg_put_u16(p, underruns);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mest(char *out, int16_t speed, int16_t yawrate, int16_t heading, uint8_t flags, uint16_t peak_cycles) {
+    char *p = out;
+    memcpy(p, "$MEST", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_i16(p, speed);
+    *p++ = ',';
+    p = msg_put_i16(p, yawrate);
+    *p++ = ',';
+    p = msg_put_i16(p, (heading < -3142 ? -3142 : heading > 3142 ? 3142 : heading));
+    *p++ = ',';
+    p = msg_put_u16(p, (flags > 15 ? 15 : flags));
+    *p++ = ',';
+    p = msg_put_u16(p, peak_cycles);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mpwr(char *out, uint16_t cpu_load, uint16_t adc_hz, uint8_t acc_low_power, uint16_t current) {
+    char *p = out;
+    memcpy(p, "$MPWR", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_u16(p, (cpu_load > 1000 ? 1000 : cpu_load));
+    *p++ = ',';
+    p = msg_put_u16(p, (adc_hz > 500 ? 500 : adc_hz));
+    *p++ = ',';
+    p = msg_put_u16(p, (acc_low_power > 100 ? 100 : acc_low_power));
+    *p++ = ',';
+    p = msg_put_fixed(p, (current > 9999 ? 9999 : current), 10);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mlnk(char *out, uint32_t baud, uint16_t overruns, uint16_t framing_errors, uint16_t parity_errors) {
+    char *p = out;
+    memcpy(p, "$MLNK", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_u32(p, (baud > 1000000 ? 1000000 : baud));
+    *p++ = ',';
+    p = msg_put_u16(p, overruns);
+    *p++ = ',';
+    p = msg_put_u16(p, framing_errors);
+    *p++ = ',';
+    p = msg_put_u16(p, parity_errors);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mtlm(char *out, uint8_t dist_hz, uint8_t batt_hz, uint8_t acc_hz, uint8_t trj_hz, uint8_t est_hz, uint8_t pwr_hz, uint8_t link_hz, uint8_t stat_hz, uint8_t tx_peak, uint16_t tx_drops) {
+    char *p = out;
+    memcpy(p, "$MTLM", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_u16(p, (dist_hz > 50 ? 50 : dist_hz));
+    *p++ = ',';
+    p = msg_put_u16(p, (batt_hz > 50 ? 50 : batt_hz));
+    *p++ = ',';
+    p = msg_put_u16(p, (acc_hz > 50 ? 50 : acc_hz));
+    *p++ = ',';
+    p = msg_put_u16(p, (trj_hz > 50 ? 50 : trj_hz));
+    *p++ = ',';
+    p = msg_put_u16(p, (est_hz > 50 ? 50 : est_hz));
+    *p++ = ',';
+    p = msg_put_u16(p, (pwr_hz > 50 ? 50 : pwr_hz));
+    *p++ = ',';
+    p = msg_put_u16(p, (link_hz > 50 ? 50 : link_hz));
+    *p++ = ',';
+    p = msg_put_u16(p, (stat_hz > 50 ? 50 : stat_hz));
+    *p++ = ',';
+    p = msg_put_u16(p, (tx_peak > 128 ? 128 : tx_peak));
+    *p++ = ',';
+    p = msg_put_u16(p, tx_drops);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mack(char *out, uint8_t ok) {
+    char *p = out;
+    memcpy(p, "$MACK", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_u16(p, (ok > 1 ? 1 : ok));
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_macks(char *out, uint16_t top, uint16_t rx_mask, uint16_t ok_mask) {
+    char *p = out;
+    memcpy(p, "$MACKS", 6);
+    p += 6;
+    *p++ = ',';
+    p = msg_put_u16(p, top);
+    *p++ = ',';
+    p = msg_put_hex(p, rx_mask, 4);
+    *p++ = ',';
+    p = msg_put_hex(p, ok_mask, 4);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_memrg(char *out, uint8_t active) {
+    char *p = out;
+    memcpy(p, "$MEMRG", 6);
+    p += 6;
+    *p++ = ',';
+    p = msg_put_u16(p, (active > 1 ? 1 : active));
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mbtn(char *out, const char *button, uint8_t long_press) {
+    char *p = out;
+    memcpy(p, "$MBTN", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_str(p, button, 2);
+    *p++ = ',';
+    p = msg_put_u16(p, (long_press > 1 ? 1 : long_press));
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_msub(char *out, const char *stream, uint8_t hz) {
+    char *p = out;
+    memcpy(p, "$MSUB", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_str(p, stream, 4);
+    *p++ = ',';
+    p = msg_put_u16(p, (hz > 50 ? 50 : hz));
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mprm(char *out, const char *name, int32_t value) {
+    char *p = out;
+    memcpy(p, "$MPRM", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_str(p, name, 11);
+    *p++ = ',';
+    p = msg_put_i32(p, (value < -2147483647 ? -2147483647 : value));
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mlogs(char *out, uint16_t count, uint16_t total) {
+    char *p = out;
+    memcpy(p, "$MLOGS", 6);
+    p += 6;
+    *p++ = ',';
+    p = msg_put_u16(p, count);
+    *p++ = ',';
+    p = msg_put_u16(p, total);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mlog(char *out, uint16_t index, uint16_t tick, uint8_t type, uint8_t arg, uint16_t value) {
+    char *p = out;
+    memcpy(p, "$MLOG", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_u16(p, index);
+    *p++ = ',';
+    p = msg_put_hex(p, tick, 4);
+    p = msg_put_hex(p, type, 2);
+    p = msg_put_hex(p, arg, 2);
+    p = msg_put_hex(p, value, 4);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mloge(char *out, uint16_t lost) {
+    char *p = out;
+    memcpy(p, "$MLOGE", 6);
+    p += 6;
+    *p++ = ',';
+    p = msg_put_u16(p, lost);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_misr(char *out, const char *source, uint16_t max_latency, uint16_t max_duration, uint16_t latency_bound) {
+    char *p = out;
+    memcpy(p, "$MISR", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_str(p, source, 4);
+    *p++ = ',';
+    p = msg_put_u16(p, max_latency);
+    *p++ = ',';
+    p = msg_put_u16(p, max_duration);
+    *p++ = ',';
+    p = msg_put_u16(p, latency_bound);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mbaud(char *out, uint32_t baud, uint8_t committed) {
+    char *p = out;
+    memcpy(p, "$MBAUD", 6);
+    p += 6;
+    *p++ = ',';
+    p = msg_put_u32(p, (baud > 1000000 ? 1000000 : baud));
+    *p++ = ',';
+    p = msg_put_u16(p, (committed > 1 ? 1 : committed));
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mrxdrop(char *out, uint16_t total) {
+    char *p = out;
+    memcpy(p, "$MRXDROP", 8);
+    p += 8;
+    *p++ = ',';
+    p = msg_put_u16(p, total);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mupd(char *out, uint8_t committed) {
+    char *p = out;
+    memcpy(p, "$MUPD", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_u16(p, (committed > 1 ? 1 : committed));
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_mdsp(char *out, const char *name, uint16_t cycles) {
+    char *p = out;
+    memcpy(p, "$MDSP", 5);
+    p += 5;
+    *p++ = ',';
+    p = msg_put_str(p, name, 10);
+    *p++ = ',';
+    p = msg_put_u16(p, cycles);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_encode_err(char *out, const char *text) {
+    char *p = out;
+    memcpy(p, "$ERR", 4);
+    p += 4;
+    *p++ = ',';
+    p = msg_put_str(p, text, 20);
+    return msg_finish(out, p);
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_decode_pcref(const char *line, MsgPcref *msg) {
+    const char *p = line + 7;
+    int32_t value;
+
+    if (msg_command_type(line) != MSG_PCREF) return 0;
+    if (!msg_get_int(&p, &value) || value < -100L || value > 100L) return 0;
+    msg->speed = value;
+    if (*p++ != ',') return 0;
+    if (!msg_get_int(&p, &value) || value < -100L || value > 100L) return 0;
+    msg->yawrate = value;
+    return *p == '*' || *p == '#';
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_decode_pctrj(const char *line, MsgPctrj *msg) {
+    const char *p = line + 7;
+    int32_t value;
+
+    if (msg_command_type(line) != MSG_PCTRJ) return 0;
+    if (!msg_get_int(&p, &value) || value < 1L || value > 60000L) return 0;
+    msg->duration_ms = value;
+    if (*p++ != ',') return 0;
+    if (!msg_get_int(&p, &value) || value < -100L || value > 100L) return 0;
+    msg->speed = value;
+    if (*p++ != ',') return 0;
+    if (!msg_get_int(&p, &value) || value < -100L || value > 100L) return 0;
+    msg->yawrate = value;
+    return *p == '*' || *p == '#';
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_decode_pcsub(const char *line, MsgPcsub *msg) {
+    const char *p = line + 7;
+    int32_t value;
+
+    if (msg_command_type(line) != MSG_PCSUB) return 0;
+    if (!msg_get_str(&p, msg->stream, 4, MSG_SET_UPPER)) return 0;
+    if (*p++ != ',') return 0;
+    if (!msg_get_int(&p, &value) || value < 0L || value > 50L) return 0;
+    msg->hz = value;
+    return *p == '*' || *p == '#';
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_decode_pcpgt(const char *line, MsgPcpgt *msg) {
+    const char *p = line + 7;
+
+    if (msg_command_type(line) != MSG_PCPGT) return 0;
+    if (!msg_get_str(&p, msg->name, 11, MSG_SET_IDENT)) return 0;
+    return *p == '*' || *p == '#';
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_decode_pcpst(const char *line, MsgPcpst *msg) {
+    const char *p = line + 7;
+    int32_t value;
+
+    if (msg_command_type(line) != MSG_PCPST) return 0;
+    if (!msg_get_str(&p, msg->name, 11, MSG_SET_IDENT)) return 0;
+    if (*p++ != ',') return 0;
+    if (!msg_get_int(&p, &value)) return 0;
+    msg->value = value;
+    return *p == '*' || *p == '#';
+}
+/*================================================================*/
+
+/*================================================================*/
+int msg_decode_pcbdr(const char *line, MsgPcbdr *msg) {
+    const char *p = line + 7;
+    int32_t value;
+
+    if (msg_command_type(line) != MSG_PCBDR) return 0;
+    if (!msg_get_int(&p, &value) || value < 1200L || value > 1000000L) return 0;
+    msg->baud = value;
+    return *p == '*' || *p == '#';
+}
+/*================================================================*/
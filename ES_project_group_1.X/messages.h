@@ -0,0 +1,225 @@
+/* ===============================================================
+ * File: messages.h                                              =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * Generated by tools/msggen.py from tools/messages.schema,      =
+ * do not edit.                                                  =
+ * ===============================================================*/
+
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <stdint.h>
+
+// Robot -> PC. msg_encode_<tag>() writes the message, "\r\n" and a
+// terminating NUL to out (MSG_<TAG>_SIZE bytes), clamping every value
+// to its range, and returns the length. MSG_<TAG>_MAX_LENGTH is the
+// longest message on the wire, used for the telemetry budget.
+
+// $MDIST,distance* Average distance
+//   distance: cm
+#define MSG_MDIST_MAX_LENGTH 13
+#define MSG_MDIST_SIZE (MSG_MDIST_MAX_LENGTH + 1)
+#define MSG_MDIST_DEFAULT_HZ 10 // stream DIST
+int msg_encode_mdist(char *out, uint16_t distance);
+
+// $MBATT,voltage* Average battery voltage
+//   voltage: 1/100 V
+#define MSG_MBATT_MAX_LENGTH 15
+#define MSG_MBATT_SIZE (MSG_MBATT_MAX_LENGTH + 1)
+#define MSG_MBATT_DEFAULT_HZ 1 // stream BATT
+int msg_encode_mbatt(char *out, uint16_t voltage);
+
+// $MACC,x,y,z* Latest accelerometer sample
+//   x: mg
+#define MSG_MACC_MAX_LENGTH 29
+#define MSG_MACC_SIZE (MSG_MACC_MAX_LENGTH + 1)
+#define MSG_MACC_DEFAULT_HZ 10 // stream ACC
+int msg_encode_macc(char *out, int16_t x, int16_t y, int16_t z);
+
+// $MTRJ,depth,underruns* Trajectory queue, while a trajectory is active
+#define MSG_MTRJ_MAX_LENGTH 17
+#define MSG_MTRJ_SIZE (MSG_MTRJ_MAX_LENGTH + 1)
+#define MSG_MTRJ_DEFAULT_HZ 10 // stream TRJ
+int msg_encode_mtrj(char *out, uint8_t depth, uint16_t underruns);
+
+// $MEST,speed,yawrate,heading,flags,peak_cycles* Velocity and heading estimate (estimator.h)
+//   speed: mm/s
+//   yawrate: mrad/s
+//   heading: mrad
+//   flags: EST_FLAG_*
+//   peak_cycles: longest update so far, against EST_CYCLE_BUDGET
+#define MSG_MEST_MAX_LENGTH 37
+#define MSG_MEST_SIZE (MSG_MEST_MAX_LENGTH + 1)
+#define MSG_MEST_DEFAULT_HZ 5 // stream EST
+int msg_encode_mest(char *out, int16_t speed, int16_t yawrate, int16_t heading, uint8_t flags, uint16_t peak_cycles);
+
+// $MPWR,cpu_load,adc_hz,acc_low_power,current* CPU load, sampling rate and estimated current (power.h)
+//   cpu_load: per mille
+//   acc_low_power: percent of the time
+//   current: 1/10 mA
+#define MSG_MPWR_MAX_LENGTH 27
+#define MSG_MPWR_SIZE (MSG_MPWR_MAX_LENGTH + 1)
+#define MSG_MPWR_DEFAULT_HZ 0 // stream PWR
+int msg_encode_mpwr(char *out, uint16_t cpu_load, uint16_t adc_hz, uint8_t acc_low_power, uint16_t current);
+
+// $MLNK,baud,overruns,framing_errors,parity_errors* RX error counters since boot
+#define MSG_MLNK_MAX_LENGTH 34
+#define MSG_MLNK_SIZE (MSG_MLNK_MAX_LENGTH + 1)
+#define MSG_MLNK_DEFAULT_HZ 0 // stream LINK
+int msg_encode_mlnk(char *out, uint32_t baud, uint16_t overruns, uint16_t framing_errors, uint16_t parity_errors);
+
+// $MTLM,dist_hz,batt_hz,acc_hz,trj_hz,est_hz,pwr_hz,link_hz,stat_hz,tx_peak,tx_drops* Achieved telemetry rates and TX buffer occupancy
+//   tx_peak: bytes
+#define MSG_MTLM_MAX_LENGTH 42
+#define MSG_MTLM_SIZE (MSG_MTLM_MAX_LENGTH + 1)
+#define MSG_MTLM_DEFAULT_HZ 0 // stream STAT
+int msg_encode_mtlm(char *out, uint8_t dist_hz, uint8_t batt_hz, uint8_t acc_hz, uint8_t trj_hz, uint8_t est_hz, uint8_t pwr_hz, uint8_t link_hz, uint8_t stat_hz, uint8_t tx_peak, uint16_t tx_drops);
+
+// $MACK,ok* Acknowledgement of an unsequenced command
+#define MSG_MACK_MAX_LENGTH 10
+#define MSG_MACK_SIZE (MSG_MACK_MAX_LENGTH + 1)
+int msg_encode_mack(char *out, uint8_t ok);
+
+// $MACKS,top,rx_mask,ok_mask* Batched acknowledgement of sequenced commands (ack.h)
+#define MSG_MACKS_MAX_LENGTH 25
+#define MSG_MACKS_SIZE (MSG_MACKS_MAX_LENGTH + 1)
+int msg_encode_macks(char *out, uint16_t top, uint16_t rx_mask, uint16_t ok_mask);
+
+// $MEMRG,active* Emergency state entered (1) or left (0)
+#define MSG_MEMRG_MAX_LENGTH 11
+#define MSG_MEMRG_SIZE (MSG_MEMRG_MAX_LENGTH + 1)
+int msg_encode_memrg(char *out, uint8_t active);
+
+// $MBTN,button,long_press* Button pressed
+//   button: T2 or T3
+#define MSG_MBTN_MAX_LENGTH 13
+#define MSG_MBTN_SIZE (MSG_MBTN_MAX_LENGTH + 1)
+int msg_encode_mbtn(char *out, const char *button, uint8_t long_press);
+
+// $MSUB,stream,hz* Rate granted to a subscription
+#define MSG_MSUB_MAX_LENGTH 16
+#define MSG_MSUB_SIZE (MSG_MSUB_MAX_LENGTH + 1)
+int msg_encode_msub(char *out, const char *stream, uint8_t hz);
+
+// $MPRM,name,value* Value of a parameter (params.c)
+#define MSG_MPRM_MAX_LENGTH 32
+#define MSG_MPRM_SIZE (MSG_MPRM_MAX_LENGTH + 1)
+int msg_encode_mprm(char *out, const char *name, int32_t value);
+
+// $MLOGS,count,total* Flight recorder dump header (recorder.h)
+#define MSG_MLOGS_MAX_LENGTH 21
+#define MSG_MLOGS_SIZE (MSG_MLOGS_MAX_LENGTH + 1)
+int msg_encode_mlogs(char *out, uint16_t count, uint16_t total);
+
+// $MLOG,index,ticktypeargvalue* One flight recorder event
+#define MSG_MLOG_MAX_LENGTH 27
+#define MSG_MLOG_SIZE (MSG_MLOG_MAX_LENGTH + 1)
+int msg_encode_mlog(char *out, uint16_t index, uint16_t tick, uint8_t type, uint8_t arg, uint16_t value);
+
+// $MLOGE,lost* End of the flight recorder dump
+//   lost: events overwritten before they were sent
+#define MSG_MLOGE_MAX_LENGTH 15
+#define MSG_MLOGE_SIZE (MSG_MLOGE_MAX_LENGTH + 1)
+int msg_encode_mloge(char *out, uint16_t lost);
+
+// $MISR,source,max_latency,max_duration,latency_bound* Interrupt timing in cycles (interrupt.h)
+#define MSG_MISR_MAX_LENGTH 31
+#define MSG_MISR_SIZE (MSG_MISR_MAX_LENGTH + 1)
+int msg_encode_misr(char *out, const char *source, uint16_t max_latency, uint16_t max_duration, uint16_t latency_bound);
+
+// $MBAUD,baud,committed* Rate committed (1) or back to the previous one (0)
+#define MSG_MBAUD_MAX_LENGTH 19
+#define MSG_MBAUD_SIZE (MSG_MBAUD_MAX_LENGTH + 1)
+int msg_encode_mbaud(char *out, uint32_t baud, uint8_t committed);
+
+// $MRXDROP,total* Received lines dropped: command queue full or line too long
+#define MSG_MRXDROP_MAX_LENGTH 17
+#define MSG_MRXDROP_SIZE (MSG_MRXDROP_MAX_LENGTH + 1)
+int msg_encode_mrxdrop(char *out, uint16_t total);
+
+// $MUPD,committed* Back from update mode without a new image (update.h)
+#define MSG_MUPD_MAX_LENGTH 10
+#define MSG_MUPD_SIZE (MSG_MUPD_MAX_LENGTH + 1)
+int msg_encode_mupd(char *out, uint8_t committed);
+
+// $MDSP,name,cycles* Filter benchmark at boot, DSP_BENCHMARK builds only (dsp.h)
+#define MSG_MDSP_MAX_LENGTH 25
+#define MSG_MDSP_SIZE (MSG_MDSP_MAX_LENGTH + 1)
+int msg_encode_mdsp(char *out, const char *name, uint16_t cycles);
+
+// $ERR,text* Command not understood
+#define MSG_ERR_MAX_LENGTH 28
+#define MSG_ERR_SIZE (MSG_ERR_MAX_LENGTH + 1)
+int msg_encode_err(char *out, const char *text);
+
+// Buffer size that holds any of the messages above
+#define MSG_MAX_SIZE 43
+
+// PC -> robot, in the order of the flight recorder command type.
+// A line may end with "#seq" before the '*' (see ack.h).
+typedef enum {
+    MSG_PCREF = 0, // $PCREF,speed,yawrate* Set speed and yawrate, cancels a running trajectory
+    MSG_PCSTP, // $PCSTP,* Stop moving
+    MSG_PCSTT, // $PCSTT,* Start moving
+    MSG_PCTRJ, // $PCTRJ,duration_ms,speed,yawrate* Queue one trajectory segment
+    MSG_PCTRF, // $PCTRF,* Flush the trajectory queue
+    MSG_PCSYN, // $PCSYN,* Restart sequence numbering
+    MSG_PCSUB, // $PCSUB,stream,hz* Set a telemetry stream rate, 0 = off
+    MSG_PCPGT, // $PCPGT,name* Read a parameter
+    MSG_PCPST, // $PCPST,name,value* Write a parameter
+    MSG_PCPSV, // $PCPSV,* Save the parameters to flash, only in wait state
+    MSG_PCPDF, // $PCPDF,* Restore the default parameters in RAM
+    MSG_PCLOG, // $PCLOG,* Dump the flight recorder
+    MSG_PCISR, // $PCISR,* Report and restart the interrupt timing measurement
+    MSG_PCBDR, // $PCBDR,baud* Switch to a new rate once acknowledged
+    MSG_PCBOK, // $PCBOK,* Sent at the new rate to confirm it
+    MSG_PCUPD, // $PCUPD,* Enter firmware update mode, only in wait state (update.h)
+    MSG_UNKNOWN
+} MsgCommand;
+
+// Command of a received line, MSG_UNKNOWN if it is none of the above.
+MsgCommand msg_command_type(const char *line);
+
+// msg_decode_<tag>() fills msg from a received line. Returns 0 if the
+// line is another command, a field is malformed or out of range.
+
+typedef struct {
+    int16_t speed; // -100..100
+    int16_t yawrate; // -100..100
+} MsgPcref;
+int msg_decode_pcref(const char *line, MsgPcref *msg);
+
+typedef struct {
+    uint16_t duration_ms; // 1..60000
+    int16_t speed; // -100..100
+    int16_t yawrate; // -100..100
+} MsgPctrj;
+int msg_decode_pctrj(const char *line, MsgPctrj *msg);
+
+typedef struct {
+    char stream[5];
+    uint8_t hz; // 0..50
+} MsgPcsub;
+int msg_decode_pcsub(const char *line, MsgPcsub *msg);
+
+typedef struct {
+    char name[12];
+} MsgPcpgt;
+int msg_decode_pcpgt(const char *line, MsgPcpgt *msg);
+
+typedef struct {
+    char name[12];
+    int32_t value; // -2147483647..2147483647
+} MsgPcpst;
+int msg_decode_pcpst(const char *line, MsgPcpst *msg);
+
+typedef struct {
+    uint32_t baud; // 1200..1000000
+} MsgPcbdr;
+int msg_decode_pcbdr(const char *line, MsgPcbdr *msg);
+
+#endif /* MESSAGES_H */
@@ -0,0 +1,268 @@
+/* ===============================================================
+ * File: params.c                                                =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "params.h"
+#include "flash.h"
+#include "adc.h"
+#include "pwm.h"
+#include "uart.h"
+#include <stddef.h>
+#include <string.h>
+/*================================================================*/
+
+/*================================================================*/
+// Parameter table
+typedef enum {
+    PARAM_U8,
+    PARAM_U16,
+    PARAM_U32
+} ParamType;
+
+typedef struct {
+    const char *name;
+    ParamType type;
+    uint16_t offset; // offset of the field in Params
+    long min;
+    long max;
+    long default_value;
+    uint16_t choices; // bit n set: n is one of the valid values, 0: any value in range
+} ParamInfo;
+
+static const ParamInfo param_table[] = {
+    {"DIST_THR", PARAM_U16, offsetof(Params, distance_threshold_mm), 50, 1000, 200},
+    {"EMRG_HOLD", PARAM_U16, offsetof(Params, emergency_hold_ms), 500, 30000, 5000},
+    {"TTC_BRAKE", PARAM_U16, offsetof(Params, ttc_brake_ms), 200, 5000, 1500},
+    {"TTC_STOP", PARAM_U16, offsetof(Params, ttc_stop_ms), 100, 2000, 400},
+    {"AVG_WIN", PARAM_U16, offsetof(Params, avg_window), 1, BUFFER_SIZE, 5},
+    {"PWM_PER", PARAM_U16, offsetof(Params, pwm_period), 1800, 14400, PWM_PERIOD},
+    {"IMP_SLOPE", PARAM_U16, offsetof(Params, impact_slope_mg), 0, 4000, 400},
+    {"IMP_HIGH", PARAM_U16, offsetof(Params, impact_high_mg), 0, 16000, 1200},
+    // The stall condition ends once the estimate has leaked back to the
+    // model (EST_FUSION_TAU_MS * ln 2), a longer time would never trip
+    {"STALL_MS", PARAM_U16, offsetof(Params, stall_ms), 0, 300, 200},
+    {"LIFT_MG", PARAM_U16, offsetof(Params, lift_mg), 100, 1000, 300},
+    {"LIFT_MS", PARAM_U16, offsetof(Params, lift_ms), 0, 5000, 200},
+    {"ACC_BW", PARAM_U8, offsetof(Params, acc_bandwidth), 0x08, 0x0F, 0x08},
+    // PMU_RANGE codes for ±2g, ±4g, ±8g and ±16g, the others are reserved
+    {"ACC_RNG", PARAM_U8, offsetof(Params, acc_range), 0x03, 0x0C, 0x03,
+        (1 << 0x03) | (1 << 0x05) | (1 << 0x08) | (1 << 0x0C)},
+    {"OSR_IR", PARAM_U8, offsetof(Params, osr_ir_bits), ADC_OSR_MIN_BITS, ADC_OSR_MAX_BITS, 2},
+    {"OSR_BAT", PARAM_U8, offsetof(Params, osr_battery_bits), ADC_OSR_MIN_BITS, ADC_OSR_MAX_BITS, 3},
+    {"BAUD", PARAM_U32, offsetof(Params, baudrate), 1200, UART_MAX_BAUD, BAUDRATE},
+};
+#define PARAM_COUNT (sizeof(param_table) / sizeof(param_table[0]))
+/*================================================================*/
+
+/*================================================================*/
+// Flash record format, in 16-bit words:
+//   [0] magic, [1] sequence, [2] payload length in words,
+//   [3 .. 3+len) payload (the Params struct), [3+len] CRC-16 of words 1 .. 2+len
+// Records are appended one after the other in the page, the valid
+// record with the highest sequence wins. The page is erased only when it
+// is full, which spreads the wear over PARAM_SLOTS saves per erase.
+#define PARAM_MAGIC 0xA55A
+#define PARAM_PAYLOAD_WORDS ((sizeof(Params) + 1) / 2)
+#define PARAM_RECORD_WORDS (((PARAM_PAYLOAD_WORDS + 4) + 1) & ~1) // even for dword programming
+#define PARAM_SLOTS ((int) (FLASH_PAGE_WORDS / PARAM_RECORD_WORDS))
+
+// Page reserved at link time, never loaded by the programmer
+static const uint16_t __attribute__((space(prog), aligned(FLASH_PAGE_ADDRESSES), noload))
+param_page[FLASH_PAGE_WORDS];
+/*================================================================*/
+
+/*================================================================*/
+Params g_params;
+static uint16_t param_sequence = 0; // sequence of the newest record
+static int param_next_slot = 0; // first erased slot, PARAM_SLOTS if full
+/*================================================================*/
+
+/*================================================================*/
+// CRC-16/CCITT (poly 0x1021) over 16-bit words, MSB first
+/*================================================================*/
+static uint16_t crc16_word(uint16_t crc, uint16_t word) {
+    int i;
+    crc ^= word;
+    for (i = 0; i < 16; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+}
+/*================================================================*/
+
+/*================================================================*/
+static uint32_t param_slot_address(int slot) {
+    return __builtin_tbladdress(param_page) + (uint32_t) slot * PARAM_RECORD_WORDS * 2;
+}
+/*================================================================*/
+
+/*================================================================*/
+static void param_write_field(const ParamInfo *info, long value) {
+    uint8_t *field = (uint8_t *) &g_params + info->offset;
+    switch (info->type) {
+        case PARAM_U8: *(uint8_t *) field = value;
+            break;
+        case PARAM_U16: *(uint16_t *) field = value;
+            break;
+        case PARAM_U32: *(uint32_t *) field = value;
+            break;
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+static long param_read_field(const ParamInfo *info) {
+    const uint8_t *field = (const uint8_t *) &g_params + info->offset;
+    switch (info->type) {
+        case PARAM_U8: return *(const uint8_t *) field;
+        case PARAM_U16: return *(const uint16_t *) field;
+        default: return *(const uint32_t *) field;
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+static const ParamInfo *param_find(const char *name) {
+    unsigned int i;
+    for (i = 0; i < PARAM_COUNT; i++) {
+        if (strcmp(name, param_table[i].name) == 0) return &param_table[i];
+    }
+    return NULL;
+}
+/*================================================================*/
+
+/*================================================================*/
+static int param_valid(const ParamInfo *info, long value) {
+    if (value < info->min || value > info->max) return 0;
+    return info->choices == 0 || (info->choices & (1u << value)) != 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Checks a record and copies its payload into g_params if valid
+/*================================================================*/
+static int param_load_slot(int slot, uint16_t *sequence, int apply) {
+    uint32_t address = param_slot_address(slot);
+    uint16_t payload[PARAM_PAYLOAD_WORDS];
+    uint16_t crc = 0xFFFF;
+    unsigned int i;
+
+    if (flash_read_word(address) != PARAM_MAGIC) return 0;
+    if (flash_read_word(address + 4) != PARAM_PAYLOAD_WORDS) return 0;
+    *sequence = flash_read_word(address + 2);
+    crc = crc16_word(crc, *sequence);
+    crc = crc16_word(crc, PARAM_PAYLOAD_WORDS);
+    for (i = 0; i < PARAM_PAYLOAD_WORDS; i++) {
+        payload[i] = flash_read_word(address + 6 + i * 2);
+        crc = crc16_word(crc, payload[i]);
+    }
+    if (flash_read_word(address + 6 + PARAM_PAYLOAD_WORDS * 2) != crc) return 0;
+
+    if (apply) memcpy(&g_params, payload, sizeof(Params));
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+void params_defaults(void) {
+    unsigned int i;
+    memset(&g_params, 0, sizeof(Params));
+    for (i = 0; i < PARAM_COUNT; i++) {
+        param_write_field(&param_table[i], param_table[i].default_value);
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+void params_init(void) {
+    int slot, newest = -1;
+    uint16_t sequence;
+    unsigned int i;
+
+    params_defaults();
+
+    // Find the newest valid record and the first erased slot
+    param_next_slot = PARAM_SLOTS;
+    for (slot = 0; slot < PARAM_SLOTS; slot++) {
+        if (flash_read_word(param_slot_address(slot)) == 0xFFFF) {
+            param_next_slot = slot;
+            break;
+        }
+        if (param_load_slot(slot, &sequence, 0) &&
+                (newest < 0 || (int16_t) (sequence - param_sequence) > 0)) {
+            newest = slot;
+            param_sequence = sequence;
+        }
+    }
+    if (newest < 0) return;
+    param_load_slot(newest, &sequence, 1);
+
+    // A record written by an older firmware may hold values that are
+    // out of range now: fall back to the default for those
+    for (i = 0; i < PARAM_COUNT; i++) {
+        if (!param_valid(&param_table[i], param_read_field(&param_table[i]))) {
+            param_write_field(&param_table[i], param_table[i].default_value);
+        }
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+int params_get(const char *name, long *value) {
+    const ParamInfo *info = param_find(name);
+    if (info == NULL) return 0;
+    *value = param_read_field(info);
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+int params_set(const char *name, long value) {
+    const ParamInfo *info = param_find(name);
+    if (info == NULL || !param_valid(info, value)) return 0;
+    param_write_field(info, value);
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+int params_save(void) {
+    uint16_t record[PARAM_RECORD_WORDS];
+    uint16_t crc = 0xFFFF;
+    uint32_t address;
+    uint16_t sequence;
+    unsigned int i;
+
+    if (param_next_slot >= PARAM_SLOTS) {
+        flash_erase_page(param_slot_address(0));
+        param_next_slot = 0;
+    }
+
+    // Build the record in RAM
+    memset(record, 0xFF, sizeof(record));
+    record[0] = PARAM_MAGIC;
+    record[1] = param_sequence + 1;
+    record[2] = PARAM_PAYLOAD_WORDS;
+    memcpy(&record[3], &g_params, sizeof(Params));
+    for (i = 1; i < 3 + PARAM_PAYLOAD_WORDS; i++) {
+        crc = crc16_word(crc, record[i]);
+    }
+    record[3 + PARAM_PAYLOAD_WORDS] = crc;
+
+    address = param_slot_address(param_next_slot);
+    for (i = 0; i < PARAM_RECORD_WORDS; i += 2) {
+        flash_write_dword(address + i * 2, record[i], record[i + 1]);
+    }
+
+    // The slot is used even if the read back fails, it is not erased anymore
+    if (!param_load_slot(param_next_slot++, &sequence, 0)) return 0;
+    param_sequence = sequence;
+    return 1;
+}
+/*================================================================*/
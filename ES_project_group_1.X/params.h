@@ -0,0 +1,65 @@
+/* ===============================================================
+ * File: params.h                                                =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Tunable parameters. They live in RAM so the hot paths read a plain
+// struct field; the table in params.c gives them a name, a type and a
+// valid range for $PCPGT/$PCPST, and params_save() persists them in a
+// reserved flash page.
+typedef struct {
+    uint16_t distance_threshold_mm; // emergency distance (default 200 mm)
+    uint16_t emergency_hold_ms; // obstacle-free time to leave emergency (default 5000 ms)
+    uint16_t ttc_brake_ms; // time-to-collision where graded braking starts (default 1500 ms)
+    uint16_t ttc_stop_ms; // time-to-collision triggering the hard stop (default 400 ms)
+    uint16_t avg_window; // samples averaged for $MDIST/$MBATT (1..BUFFER_SIZE)
+    uint16_t pwm_period; // motor PWM period in Fcy cycles, applied at boot
+    uint16_t impact_slope_mg; // collision: x/y change between two raw samples (default 400 mg, 0 = off), applied at boot
+    uint16_t impact_high_mg; // collision: x/y acceleration (default 1200 mg, 0 = off), applied at boot
+    uint16_t stall_ms; // driven without the robot following, stops it (default 200 ms, 0 = off)
+    uint16_t lift_mg; // z away from 1 g by more than this ... (default 300 mg)
+    uint16_t lift_ms; // ... for this long stops the robot (default 200 ms, 0 = off)
+    uint8_t acc_bandwidth; // BMX055 PMU_BW register value, applied at boot
+    uint8_t acc_range; // BMX055 PMU_RANGE register value (3, 5, 8 or 12), applied at boot
+    uint8_t osr_ir_bits; // IR oversampling, 4^bits conversions per output, applied at boot
+    uint8_t osr_battery_bits; // battery oversampling, 4^bits conversions per output, applied at boot
+    uint32_t baudrate; // UART1 baud rate, applied at boot
+} Params;
+
+extern Params g_params;
+
+// Loads the defaults, then the newest valid record from flash if any.
+// Must run before the peripherals are initialized.
+void params_init(void);
+
+// Restores the default values in RAM (flash is left untouched).
+void params_defaults(void);
+
+// Reads a parameter by name.
+// Returns:
+//   1 and the value in *value if the name exists, 0 otherwise
+int params_get(const char *name, long *value);
+
+// Writes a parameter by name after checking its range (and, for a
+// register code such as ACC_RNG, that it is one of the valid codes).
+// Returns:
+//   1 if the value was stored, 0 if the name is unknown or not valid
+int params_set(const char *name, long value);
+
+// Appends the current values as a new record in the parameter page,
+// erasing the page only once it is full.
+// Returns:
+//   1 if the record was written and verified, 0 otherwise
+int params_save(void);
+
+#endif /* PARAMS_H */
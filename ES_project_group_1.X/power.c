@@ -0,0 +1,149 @@
+/* ===============================================================
+ * File: power.c                                                 =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "power.h"
+#include "adc.h"
+#include "spi.h"
+#include "state.h"
+#include "params.h"
+#include "estimator.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "uart.h"
+#include "messages.h"
+/*================================================================*/
+static uint8_t pwr_acc_low_power = 0;
+static int pwr_hold_ms = 0; // time the current conditions asked for a lower rate
+// Accounting since the last report
+static uint32_t pwr_rate_sum = 0;
+static uint16_t pwr_low_power_ticks = 0;
+static uint16_t pwr_ticks = 0;
+/*================================================================*/
+
+/*================================================================*/
+void power_init(void) {
+    // Timers 5-9 (1-4 are used), QEI, motor control PWM (the motors
+    // use output compare), I2C, UART2-4, SPI2, ECAN
+    PMD1bits.T5MD = 1;
+    PMD1bits.QEI1MD = 1;
+    PMD1bits.PWMMD = 1;
+    PMD1bits.I2C1MD = 1;
+    PMD1bits.U2MD = 1;
+    PMD1bits.SPI2MD = 1;
+    PMD1bits.C1MD = 1;
+    PMD1bits.C2MD = 1;
+    // Input captures, and the output compares not driving a motor
+    PMD2bits.IC1MD = 1;
+    PMD2bits.IC2MD = 1;
+    PMD2bits.IC3MD = 1;
+    PMD2bits.IC4MD = 1;
+    PMD2bits.IC5MD = 1;
+    PMD2bits.IC6MD = 1;
+    PMD2bits.IC7MD = 1;
+    PMD2bits.IC8MD = 1;
+    PMD2bits.OC5MD = 1;
+    PMD2bits.OC6MD = 1;
+    PMD2bits.OC7MD = 1;
+    PMD2bits.OC8MD = 1;
+    PMD3bits.T6MD = 1;
+    PMD3bits.T7MD = 1;
+    PMD3bits.T8MD = 1;
+    PMD3bits.T9MD = 1;
+    PMD3bits.CMPMD = 1;
+    PMD3bits.RTCCMD = 1;
+    PMD3bits.PMPMD = 1;
+    PMD3bits.CRCMD = 1;
+    PMD3bits.QEI2MD = 1;
+    PMD3bits.U3MD = 1;
+    PMD3bits.I2C2MD = 1;
+    PMD3bits.AD2MD = 1;
+    PMD4bits.U4MD = 1;
+    PMD4bits.REFOMD = 1;
+    PMD4bits.CTMUMD = 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+// IR result rate wanted right now
+/*================================================================*/
+static unsigned int power_target_rate(int state) {
+    Estimate estimate;
+    int speed;
+
+    if (state != STATE_MOVING) return PWR_IDLE_HZ;
+    if (adc_distance_mm() < 2 * g_params.distance_threshold_mm) return PWR_MAX_HZ;
+    estimator_get(&estimate);
+    speed = (estimate.speed < 0) ? -estimate.speed : estimate.speed;
+    if (adc_closing_speed() > speed) speed = adc_closing_speed();
+    if (speed >= PWR_MAX_SPEED) return PWR_MAX_HZ;
+    if (speed >= PWR_FAST_SPEED) return PWR_FAST_HZ;
+    return PWR_CRUISE_HZ;
+}
+/*================================================================*/
+
+/*================================================================*/
+void power_update(int state) {
+    unsigned int rate = power_target_rate(state);
+    uint8_t low_power = (state == STATE_WAIT_FOR_START);
+
+    // Faster sampling at once, slower only once it is stable
+    if (rate >= adc_sample_rate()) {
+        pwr_hold_ms = 0;
+        adc_set_sample_rate(rate);
+    } else {
+        pwr_hold_ms += 2;
+        if (pwr_hold_ms >= PWR_RATE_HOLD_MS) {
+            pwr_hold_ms = 0;
+            adc_set_sample_rate(rate);
+        }
+    }
+    if (low_power != pwr_acc_low_power) {
+        accelerometer_low_power(low_power);
+        pwr_acc_low_power = low_power;
+    }
+
+    if (pwr_ticks == 0xFFFF) { // no report for two minutes, keep the averages
+        pwr_rate_sum >>= 1;
+        pwr_low_power_ticks >>= 1;
+        pwr_ticks >>= 1;
+    }
+    pwr_rate_sum += adc_sample_rate();
+    pwr_low_power_ticks += pwr_acc_low_power;
+    pwr_ticks++;
+}
+/*================================================================*/
+
+/*================================================================*/
+int power_imu_period_ms(void) {
+    return pwr_acc_low_power ? ACC_LOW_POWER_PERIOD_MS : estimator_period_ms();
+}
+/*================================================================*/
+
+/*================================================================*/
+void power_report(void) {
+    char message[MSG_MPWR_SIZE];
+    unsigned int load = tmr_loop_load();
+    unsigned int rate = pwr_ticks ? pwr_rate_sum / pwr_ticks : adc_sample_rate();
+    unsigned int low_power = pwr_ticks ? (uint32_t) pwr_low_power_ticks * 100 / pwr_ticks : 0;
+    // ADC duty: 2 * 4^OSR_IR conversions per IR result
+    uint32_t conversions = ((uint32_t) 2 * rate) << (2 * g_params.osr_ir_bits);
+    uint32_t adc_duty = conversions * PWR_ADC_CONVERSION_NS / 1000000UL; // per mille
+    uint32_t current = PWR_CPU_IDLE + (uint32_t) (PWR_CPU_RUN - PWR_CPU_IDLE) * load / 1000 +
+            PWR_ADC_ACTIVE * adc_duty / 1000 +
+            PWR_IR_SENSOR +
+            (PWR_ACC_NORMAL * (100 - low_power) + PWR_ACC_LOW * low_power) / 100;
+
+    msg_encode_mpwr(message, load, rate, low_power, current > 0xFFFF ? 0xFFFF : current);
+    telemetry_send(TLM_PWR, message);
+    pwr_rate_sum = 0;
+    pwr_low_power_ticks = 0;
+    pwr_ticks = 0;
+}
+/*================================================================*/
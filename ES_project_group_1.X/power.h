@@ -0,0 +1,57 @@
+/* ===============================================================
+ * File: power.h                                                 =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Sensing schedule per state. Waiting (or in emergency) the IR distance
+// is sampled at PWR_IDLE_HZ and the accelerometer sleeps in low power
+// mode. Moving, the IR rate rises with the faster of the estimated speed
+// and the closing speed, and is maximal near the distance threshold.
+// Rates must divide ADC_SAMPLE_HZ.
+#define PWR_IDLE_HZ 50
+#define PWR_CRUISE_HZ 125
+#define PWR_FAST_HZ 250
+#define PWR_MAX_HZ 500
+#define PWR_FAST_SPEED 150 // mm/s
+#define PWR_MAX_SPEED 350 // mm/s
+// A lower rate is only taken after the conditions held this long
+#define PWR_RATE_HOLD_MS 500
+
+// Typical supply currents used by the accounting (0.1 mA units), from
+// the datasheets at 3.3V. They are estimates, not measurements: the
+// motors are left out and the module currents do not depend on the pins.
+#define PWR_CPU_RUN 600 // dsPIC33EP at 70 MIPS
+#define PWR_CPU_IDLE 250 // Idle mode, peripherals still clocked
+#define PWR_ADC_ACTIVE 50 // while converting
+#define PWR_ADC_CONVERSION_NS 3500 // 16 Tad sampling + 12 Tad conversion
+#define PWR_IR_SENSOR 300 // IR distance sensor, always enabled
+#define PWR_ACC_NORMAL 13 // BMX055 accelerometer, normal mode (130 uA)
+#define PWR_ACC_LOW 1 // low power mode, 50ms sleep phases
+
+// Turns off the clock of every module the firmware does not use.
+// Must run before any peripheral is configured.
+void power_init(void);
+
+// Applies the schedule for the current state, once per main loop tick.
+void power_update(int state);
+
+// Period (ms) at which the accelerometer must be read in this state.
+int power_imu_period_ms(void);
+
+// Sends $MPWR,cpu_load,adc_hz,acc_low_power,current* with the averages
+// since the previous report: main loop load in per mille, mean IR rate,
+// share of the time (percent) with the accelerometer in low power mode,
+// and the estimated supply current in mA.
+void power_report(void);
+
+#endif /* POWER_H */
@@ -9,6 +9,14 @@
 
 /*================================================================*/
 #include "pwm.h"
+#include "params.h"
+#include "control.h"
+/*================================================================*/
+// PWM period in use, read from the parameters once at init_pwm()
+static int pwm_period = PWM_PERIOD;
+// Last duty applied to each motor, also written by the ADC interrupt hard stop
+static volatile int pwm_left = 0;
+static volatile int pwm_right = 0;
 /*================================================================*/
 
 /*================================================================*/
@@ -32,11 +40,12 @@ void init_pwm(void) {
     OC3CON1 = OC3CON2 = 0; // Right Backward
     OC4CON1 = OC4CON2 = 0; // Right Forward
 
-    // Initialize all PWM modules with specified period
-    setup_oc_module(&OC1CON1, &OC1CON2, PWM_PERIOD); // Left Backward
-    setup_oc_module(&OC2CON1, &OC2CON2, PWM_PERIOD); // Left Forward
-    setup_oc_module(&OC3CON1, &OC3CON2, PWM_PERIOD); // Right Backward
-    setup_oc_module(&OC4CON1, &OC4CON2, PWM_PERIOD); // Right Forward
+    // Initialize all PWM modules with the configured period
+    pwm_period = g_params.pwm_period;
+    setup_oc_module(&OC1CON1, &OC1CON2, pwm_period); // Left Backward
+    setup_oc_module(&OC2CON1, &OC2CON2, pwm_period); // Left Forward
+    setup_oc_module(&OC3CON1, &OC3CON2, pwm_period); // Right Backward
+    setup_oc_module(&OC4CON1, &OC4CON2, pwm_period); // Right Forward
 }
 /*================================================================*/
 
@@ -64,9 +73,9 @@ void setup_oc_module(volatile unsigned int* con1, volatile unsigned int* con2, u
 // Set PWM duty cycle for a specific Output Compare module
 /*================================================================*/
 void set_pwm_duty(volatile unsigned int* oc_r, unsigned int duty) {
-    // Limit duty cycle to PWM_PERIOD
-    if (duty > PWM_PERIOD) {
-        duty = PWM_PERIOD;
+    // Limit duty cycle to the PWM period
+    if (duty > (unsigned int) pwm_period) {
+        duty = pwm_period;
     }
     *oc_r = duty;
 }
@@ -76,6 +85,9 @@ void set_pwm_duty(volatile unsigned int* oc_r, unsigned int duty) {
 // Set PWM for both motors
 /*================================================================*/
 void set_motor_pwm(int left_pwm, int right_pwm) {
+    pwm_left = left_pwm;
+    pwm_right = right_pwm;
+
     // Control left motor
     if (left_pwm >= 0) {
         // Forward direction
@@ -106,32 +118,21 @@ we have ensured this value in parsing stage
 */
 /*================================================================*/
 void control_motors(int speed, int yawrate) {
-    // 1. Map speed and yawrate from [-100, 100] to [-PWM_PERIOD, PWM_PERIOD]
-    long speed_pwm = (long) speed * PWM_PERIOD / 100;
-    long yaw_pwm = (long) yawrate * PWM_PERIOD / 100;
-
-    // 2. Mix the speed and yaw signals to get individual motor PWMs
-    // For an anti-clockwise (positive yaw) turn, we want the right motor to go faster
-    // and the left motor to go slower.
-    long left_pwm_raw = speed_pwm - yaw_pwm;
-    long right_pwm_raw = speed_pwm + yaw_pwm;
-
-    // 3. check PWM values to the valid range [-PWM_PERIOD, PWM_PERIOD] if not set it to the limit
-    // to prevent overflow and ensure proper motor driver operation.
-    int left_pwm_final = left_pwm_raw;
-    if (left_pwm_final > PWM_PERIOD) {
-        left_pwm_final = PWM_PERIOD;
-    } else if (left_pwm_final < -PWM_PERIOD) {
-        left_pwm_final = -PWM_PERIOD;
-    }
+    int left_pwm, right_pwm;
 
-    int right_pwm_final = right_pwm_raw;
-    if (right_pwm_final > PWM_PERIOD) {
-        right_pwm_final = PWM_PERIOD;
-    } else if (right_pwm_final < -PWM_PERIOD) {
-        right_pwm_final = -PWM_PERIOD;
-    }
+    // Mix and saturate (control.c), then drive the motors
+    control_mix(speed, yawrate, pwm_period, &left_pwm, &right_pwm);
+    set_motor_pwm(left_pwm, right_pwm);
+}
 
-    // 4. Call the low-level motor control function with the calculated PWM values
-    set_motor_pwm(left_pwm_final, right_pwm_final);
+/*================================================================*/
+void pwm_get_duty(int *left, int *right) {
+    // Snapshot both motors together, the ADC interrupt may stop them
+    __builtin_disi(0x3FFF);
+    int left_pwm = pwm_left;
+    int right_pwm = pwm_right;
+    DISICNT = 0;
+    *left = (long) left_pwm * 1000 / pwm_period;
+    *right = (long) right_pwm * 1000 / pwm_period;
 }
+/*================================================================*/
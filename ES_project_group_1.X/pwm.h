@@ -12,7 +12,7 @@
 
 #include <xc.h>
 
-// PWM period: 10kHz (72MHz / 7200 = 10kHz)
+// Default PWM period: 10kHz (72MHz / 7200 = 10kHz), tunable with the PWM_PER parameter
 #define PWM_PERIOD 7200
 
 // Initialize PWM modules for motor control
@@ -30,4 +30,8 @@ void set_motor_pwm(int left_pwm, int right_pwm);
 // Control motors by sending values between -100 and 100
 void control_motors(int speed, int yawrate);
 
+// Duty cycles last applied to the motors, in per mille of the period
+// (negative backward)
+void pwm_get_duty(int *left, int *right);
+
 #endif /* PWM_H */
@@ -0,0 +1,129 @@
+/* ===============================================================
+ * File: recorder.c                                              =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "recorder.h"
+#include "timer.h"
+#include "uart.h"
+#include "messages.h"
+#include <string.h>
+/*================================================================*/
+
+/*================================================================*/
+// One recorded event (6 bytes)
+typedef struct {
+    uint16_t tick;
+    uint8_t type;
+    uint8_t arg;
+    int16_t value;
+} RecorderEntry;
+/*================================================================*/
+static volatile RecorderEntry rec_ring[REC_SIZE];
+static volatile uint16_t rec_head = 0; // next slot to write
+static volatile uint16_t rec_total = 0; // events logged since boot (wraps)
+// Dump cursor, main loop only. The dump reads the ring as it was at
+// $PCLOG while the writers go on: rec_total tells which of its slots
+// were reused since.
+static uint8_t rec_dumping = 0;
+static uint16_t rec_dump_index = 0;
+static uint16_t rec_dump_count = 0;
+static uint16_t rec_dump_first = 0;
+static uint16_t rec_dump_total = 0; // rec_total at the start of the dump
+static uint16_t rec_dump_lost = 0; // events of the dump overwritten before being sent
+/*================================================================*/
+// Lines sent per tick during a dump, keeps room for the telemetry
+#define REC_DUMP_LINES_PER_TICK 2
+/*================================================================*/
+
+/*================================================================*/
+void recorder_init(void) {
+    rec_head = 0;
+    rec_total = 0;
+    rec_dumping = 0;
+    recorder_log(EV_BOOT, 0, RCON);
+}
+/*================================================================*/
+
+/*================================================================*/
+// The dsPIC has no compare-and-swap nor load-linked/store-conditional,
+// so the slot cannot be claimed lock-free: the reservation is a DISI
+// section of a few instructions (levels 1-6, every profiled source),
+// the event itself is written outside of it.
+/*================================================================*/
+void recorder_log(uint8_t type, uint8_t arg, int16_t value) {
+    uint16_t slot;
+
+    // Reserve the slot: an interrupt between the read and the write of
+    // rec_head would hand out the same slot twice
+    __builtin_disi(0x3FFF);
+    slot = rec_head;
+    rec_head = (slot + 1) & (REC_SIZE - 1);
+    rec_total++;
+    DISICNT = 0;
+
+    rec_ring[slot].tick = tmr_get_ticks();
+    rec_ring[slot].type = type;
+    rec_ring[slot].arg = arg;
+    rec_ring[slot].value = value;
+}
+/*================================================================*/
+
+/*================================================================*/
+void recorder_start_dump(void) {
+    char header[MSG_MLOGS_SIZE];
+
+    __builtin_disi(0x3FFF);
+    rec_dump_total = rec_total;
+    rec_dump_first = rec_head;
+    DISICNT = 0;
+    rec_dump_count = (rec_dump_total < REC_SIZE) ? rec_dump_total : REC_SIZE;
+    rec_dump_first = (rec_dump_first - rec_dump_count) & (REC_SIZE - 1);
+    rec_dump_index = 0;
+    rec_dump_lost = 0;
+    rec_dumping = 1;
+    msg_encode_mlogs(header, rec_dump_count, rec_dump_total);
+    UART_SendString(header);
+}
+/*================================================================*/
+
+/*================================================================*/
+void recorder_dump_step(void) {
+    char line[MSG_MLOG_SIZE]; // also holds $MLOGE
+    int lines = 0;
+
+    if (!rec_dumping) return;
+
+    while (lines < REC_DUMP_LINES_PER_TICK && rec_dump_index < rec_dump_count) {
+        volatile RecorderEntry *entry = &rec_ring[(rec_dump_first + rec_dump_index) & (REC_SIZE - 1)];
+        RecorderEntry copy;
+        copy.tick = entry->tick;
+        copy.type = entry->type;
+        copy.arg = entry->arg;
+        copy.value = entry->value;
+        // The writers first take the REC_SIZE - count free slots, then
+        // the oldest events of the dump. Checked after the copy: a slot
+        // reserved during it may have been half written.
+        if ((uint16_t) (rec_total - rec_dump_total) > REC_SIZE - rec_dump_count + rec_dump_index) {
+            rec_dump_lost++;
+            rec_dump_index++;
+            continue;
+        }
+        msg_encode_mlog(line, rec_dump_index, copy.tick, copy.type, copy.arg, (uint16_t) copy.value);
+        // TX full, retry next tick: not a drop, nothing to log
+        if (UART_TxFree() < strlen(line) || !UART_SendString(line)) return;
+        rec_dump_index++;
+        lines++;
+    }
+
+    if (rec_dump_index >= rec_dump_count && msg_encode_mloge(line, rec_dump_lost) &&
+            UART_TxFree() >= strlen(line) && UART_SendString(line)) {
+        rec_dumping = 0;
+    }
+}
+/*================================================================*/
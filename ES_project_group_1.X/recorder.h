@@ -0,0 +1,68 @@
+/* ===============================================================
+ * File: recorder.h                                              =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Flight recorder: a RAM ring of compact binary events that always holds
+// the most recent REC_SIZE events. $PCLOG,* dumps it over UART as
+//   $MLOGS,count,total*          header (events in the dump, events ever logged)
+//   $MLOG,index,ttttyyaavvvv*    one event: tick, type, arg, value in hex
+//   $MLOGE,lost*                 end of dump (events of the dump overwritten
+//                                before they were sent)
+// tools/recorder_decode.c turns a dump into a readable timeline.
+#define REC_SIZE 128 // must be a power of two
+
+// Event types, keep tools/recorder_decode.c in sync
+typedef enum {
+    EV_BOOT = 0, // value: RCON reset cause
+    EV_STATE, // arg: new state, value: previous state
+    EV_EMRG_ENTER, // arg: cause, value: distance in mm
+    EV_EMRG_EXIT, // value: distance in mm
+    EV_COMMAND, // arg: command type, value: sequence number or -1
+    EV_TX_DROP, // arg: frame length, value: free TX bytes
+    EV_ADC_SAMPLE, // arg: samples from the trigger (signed), value: distance in mm
+    EV_LOOP_OVERRUN, // main loop took longer than its 2ms period
+    EV_RX_OVERFLOW, // arg: REC_RX_QUEUE_FULL or REC_RX_TOO_LONG, value: lines dropped so far
+    EV_COUNT
+} RecorderEvent;
+
+// Emergency causes (arg of EV_EMRG_ENTER), keep tools/recorder_decode.c in sync
+#define REC_CAUSE_DISTANCE 0
+#define REC_CAUSE_TTC 1
+#define REC_CAUSE_COLLISION 2 // slope or high-g event of the accelerometer
+#define REC_CAUSE_STALL 3
+#define REC_CAUSE_LIFT 4
+
+// Reasons a received line is dropped (arg of EV_RX_OVERFLOW)
+#define REC_RX_QUEUE_FULL 0
+#define REC_RX_TOO_LONG 1
+
+// Clears the ring and logs EV_BOOT.
+void recorder_init(void);
+
+// Appends an event stamped with the current system tick.
+// Safe from the main loop and from any interrupt: only the slot
+// reservation runs with interrupts held off (a few instructions under
+// DISI), the event itself is written without any lock.
+void recorder_log(uint8_t type, uint8_t arg, int16_t value);
+
+// Starts a dump of the events logged so far. Recording goes on during
+// the dump: the new events take the free slots, then the oldest events
+// of the dump, which are skipped and counted in $MLOGE if not sent yet.
+void recorder_start_dump(void);
+
+// Sends the next dump lines, as many as fit in the TX buffer (at most a
+// few per call). Called once per main loop tick.
+void recorder_dump_step(void);
+
+#endif /* RECORDER_H */
@@ -8,6 +8,10 @@
  * ===============================================================*/
 /*================================================================*/
 #include "spi.h"
+#include "params.h"
+/*================================================================*/
+// INT_RST_LATCH latch_int value for latched interrupts
+#define ACC_LATCHED 0x0F
 /*================================================================*/
 
 /*================================================================*/
@@ -57,6 +61,43 @@ void spi_setup(void) {
 /*================================================================*/
 
 
+/*================================================================*/
+// Single register write
+/*================================================================*/
+static void accelerometer_write(uint8_t address, uint8_t value) {
+    ACC_CS = 0;
+    spi_write(address);
+    spi_write(value);
+    ACC_CS = 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Range steps above ±2g for the configured PMU_RANGE code: every step
+// doubles the full scale and the weight of one LSB
+/*================================================================*/
+static int accelerometer_range_shift(void) {
+    switch (g_params.acc_range) {
+        case 0x05: return 1; // ±4g
+        case 0x08: return 2; // ±8g
+        case 0x0C: return 3; // ±16g
+        default: return 0; // ±2g
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+// Interrupt engine threshold register for a value in mg. lsb_cmg is the
+// register step in the ±2g range (1/100 mg), doubling with every range
+// step above it. Rounded up, so the sensor never trips below the value.
+/*================================================================*/
+static uint8_t accelerometer_threshold(uint16_t mg, uint16_t lsb_cmg) {
+    uint32_t lsb = (uint32_t) lsb_cmg << accelerometer_range_shift();
+    uint32_t value = ((uint32_t) mg * 100 + lsb - 1) / lsb;
+    return (value > 255) ? 255 : (uint8_t) value;
+}
+/*================================================================*/
+
 /*================================================================*/
 void accelerometer_config(void) {
     // Power on the accelerometer (exit suspend mode)
@@ -65,18 +106,25 @@ void accelerometer_config(void) {
     spi_write(0x00); // Set normal mode 
     ACC_CS = 1; // Disable chip select
 
+    // Low power mode 2 when enabled, so the registers stay readable
+    // during the sleep phases
+    ACC_CS = 0;
+    spi_write(0x12); // PMU_LOW_POWER register
+    spi_write(0x40); // lowpower_mode = 1
+    ACC_CS = 1;
+
     // Configure bandwidth 
     ACC_CS = 0;
     unsigned int address_bandwidth = 0x10; // PMU_BW register (bandwidth and ODR)
     spi_write(address_bandwidth); 
-    spi_write(0x08); // Set 100Hz ODR, 32Hz bandwidth
+    spi_write(g_params.acc_bandwidth); // 0x08 by default: 100Hz ODR, 32Hz bandwidth
     ACC_CS = 1;
 
     // Configure measurement range
     ACC_CS = 0;
     unsigned int address_measurement_range = 0x0F; 
     spi_write(address_measurement_range);
-    spi_write(0x03); // Set ±2g range for best precision (0.98 mg/LSB)
+    spi_write(g_params.acc_range); // 0x03 by default: ±2g range for best precision (0.98 mg/LSB)
     ACC_CS = 1;
 
     // Configure filtering
@@ -85,12 +133,50 @@ void accelerometer_config(void) {
     spi_write(address_filtering);
     spi_write(0b0); // Enable filtering and shadowing
     ACC_CS = 1;
+
+    // Collision detection inside the sensor. The engines run on the
+    // unfiltered data, so a knock lasting a few ms is not averaged away
+    // by the ACC_BW filter of the readings, and they only watch x and y
+    // (z carries gravity). Events stay latched until read.
+    accelerometer_write(0x1E, 0x06); // INT_SRC: unfiltered data for high-g and slope
+    accelerometer_write(0x21, ACC_LATCHED); // INT_RST_LATCH: latched
+    accelerometer_write(0x25, 0x00); // INT_3: high_dur, 2 ms above the threshold
+    accelerometer_write(0x26, accelerometer_threshold(g_params.impact_high_mg, 781)); // INT_4: high_th, 7.81 mg
+    accelerometer_write(0x27, 0x00); // INT_5: slope_dur, a single sample
+    accelerometer_write(0x28, accelerometer_threshold(g_params.impact_slope_mg, 391)); // INT_6: slope_th, 3.91 mg
+    accelerometer_write(0x16, g_params.impact_slope_mg ? 0x03 : 0x00); // INT_EN_0: slope_en_x, slope_en_y
+    accelerometer_write(0x17, g_params.impact_high_mg ? 0x03 : 0x00); // INT_EN_1: high_en_x, high_en_y
+}
+/*================================================================*/
+
+
+/*================================================================*/
+void accelerometer_low_power(int enable) {
+    ACC_CS = 0;
+    spi_write(0x11); // PMU_LPW register (power mode config)
+    spi_write(enable ? ACC_LPW_LOW_POWER : 0x00);
+    ACC_CS = 1;
 }
 /*================================================================*/
 
+/*================================================================*/
+uint8_t accelerometer_events(void) {
+    ACC_CS = 0;
+    spi_write(0x09 | 0x80); // INT_STATUS_0, read
+    uint8_t events = spi_write(0x00) & (ACC_EVENT_HIGH_G | ACC_EVENT_SLOPE);
+    ACC_CS = 1;
+    if (events) {
+        accelerometer_write(0x21, 0x80 | ACC_LATCHED); // reset_int, stay latched
+    }
+    return events;
+}
+/*================================================================*/
 
 /*================================================================*/
 void acquire_accelerometer_data(int *x_acc, int *y_acc, int *z_acc) {
+    // ±2048 LSB, times 8 at most: still within Q15 before the scaling
+    int range_gain = 1 << accelerometer_range_shift();
+
     ACC_CS = 0; 
 
     int acc_first_address = 0x02; // First data register address for accelerometer
@@ -99,23 +185,24 @@ void acquire_accelerometer_data(int *x_acc, int *y_acc, int *z_acc) {
     // Acquire X-axis accelerometer data
     uint8_t x_LSB_byte = spi_write(0x02); // Read X-LSB register
     uint8_t x_MSB_byte = spi_write(0x03); // Read X-MSB register
-    // Process X-axis data: 12-bit value, discard lower 4 bits
-    int x_value = ((x_MSB_byte << 8) | (x_LSB_byte & 0xF8)) / 16;
-    *x_acc = (int) round(0.98 * x_value); // Change unit into mg
+    // Process X-axis data: 12-bit value, discard lower 4 bits. The cast
+    // keeps the sign where int is wider than 16 bits (host simulators)
+    int x_value = (int16_t) ((x_MSB_byte << 8) | (x_LSB_byte & 0xF8)) / 16;
+    *x_acc = dsp_scale_q15(x_value * range_gain, ACC_MG_PER_LSB); // Change unit into mg
 
     // Acquire Y-axis accelerometer data
     uint8_t y_LSB_byte = spi_write(0x04); // Read Y-LSB register
     uint8_t y_MSB_byte = spi_write(0x05); // Read Y-MSB register
     // Process Y-axis data: 12-bit value, discard lower 4 bits
-    int y_value = ((y_MSB_byte << 8) | (y_LSB_byte & 0xF8)) / 16;
-    *y_acc = (int) round(0.98 * y_value); // Change unit into mg
+    int y_value = (int16_t) ((y_MSB_byte << 8) | (y_LSB_byte & 0xF8)) / 16;
+    *y_acc = dsp_scale_q15(y_value * range_gain, ACC_MG_PER_LSB); // Change unit into mg
 
     // Acquire Z-axis accelerometer data
     uint8_t z_LSB_byte = spi_write(0x06); // Read Z-LSB register
     uint8_t z_MSB_byte = spi_write(0x07); // Read Z-MSB register
     // Process Z-axis data: 12-bit value, discard lower 4 bits
-    int z_value = ((z_MSB_byte << 8) | (z_LSB_byte & 0xF8)) / 16;
-    *z_acc = (int) round(0.98 * z_value); // Change unit into mg
+    int z_value = (int16_t) ((z_MSB_byte << 8) | (z_LSB_byte & 0xF8)) / 16;
+    *z_acc = dsp_scale_q15(z_value * range_gain, ACC_MG_PER_LSB); // Change unit into mg
 
     ACC_CS = 1; 
 }
@@ -11,10 +11,13 @@
 #define SPI_H
 
 #include <xc.h>
-#include <math.h>
+#include "dsp.h"
 
 // Define the accelerometer chip selector
 #define ACC_CS LATBbits.LATB3
+// Accelerometer sensitivity in the ±2g range: 0.98 mg/LSB, as a Q15 gain.
+// It doubles with every range step above ±2g (ACC_RNG).
+#define ACC_MG_PER_LSB DSP_Q15(0.98)
 
 // Initializes the SPI peripheral.
 // Sets up necessary SPI registers and pin configuration.
@@ -29,9 +32,31 @@ int spi_write(int addr);
 
 // Configures the BMX055 accelerometer.
 // Sets power mode to normal, bandwidth to 100Hz/32Hz,
-// measurement range to ±4g, and enables filtering.
+// measurement range to ACC_RNG (±2g by default), and enables filtering.
+// Also arms the slope and high-g engines on x and y (IMP_SLOPE,
+// IMP_HIGH) so a collision from any side is latched by the sensor.
 void accelerometer_config(void);
 
+// Collision events latched by the slope and high-g engines
+// (INT_STATUS_0 bits)
+#define ACC_EVENT_HIGH_G 0x02
+#define ACC_EVENT_SLOPE 0x04
+
+// Reads the latched collision events and clears them. No interrupt pin
+// is wired, the main loop polls this every tick (one 2 byte transfer,
+// a second one only when an event is to be cleared).
+// Returns:
+//   the ACC_EVENT_* bits seen since the previous call
+uint8_t accelerometer_events(void);
+
+// PMU_LPW value for low power: lowpower_en with a 50ms sleep phase,
+// the data is refreshed every ACC_LOW_POWER_PERIOD_MS
+#define ACC_LPW_LOW_POWER 0x58
+#define ACC_LOW_POWER_PERIOD_MS 50
+
+// Switches the accelerometer between normal and low power mode.
+void accelerometer_low_power(int enable);
+
 // Reads raw accelerometer data from the BMX055 via SPI.
 // Acquires and processes X, Y, and Z axis data into global variables.
 // Converts 13-bit values by discarding the lowest 3 bits.
@@ -0,0 +1,65 @@
+/* ===============================================================
+ * File: state.c                                                 =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "state.h"
+#include "recorder.h"
+/*================================================================*/
+
+/*================================================================*/
+static volatile RobotState current_state = STATE_WAIT_FOR_START;
+static Setpoint setpoint = {0, 0}; // main loop only
+/*================================================================*/
+
+/*================================================================*/
+void state_init(void) {
+    current_state = STATE_WAIT_FOR_START;
+    state_set_setpoint(0, 0);
+}
+/*================================================================*/
+
+/*================================================================*/
+RobotState state_get(void) {
+    return current_state;
+}
+/*================================================================*/
+
+/*================================================================*/
+int state_transition(unsigned int from, RobotState to) {
+    RobotState previous;
+
+    // Check and update without an interrupt in between
+    STATE_CRITICAL_BEGIN();
+    previous = current_state;
+    if (!(from & STATE_MASK(previous))) {
+        STATE_CRITICAL_END();
+        return 0;
+    }
+    current_state = to;
+    STATE_CRITICAL_END();
+
+    if (previous != to) {
+        recorder_log(EV_STATE, to, previous);
+    }
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+void state_set_setpoint(int speed, int yawrate) {
+    setpoint.speed = speed;
+    setpoint.yawrate = yawrate;
+}
+/*================================================================*/
+
+/*================================================================*/
+void state_get_setpoint(Setpoint *copy) {
+    *copy = setpoint;
+}
+/*================================================================*/
@@ -0,0 +1,65 @@
+/* ===============================================================
+ * File: state.h                                                 =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef STATE_H
+#define STATE_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Robot state machine, shared by the main loop, the UART commands and
+// the interrupts. This is the only definition of the state and of the
+// speed/yawrate setpoint: everybody goes through the functions below.
+// The setpoint is written by the commands and read by the motor control,
+// both in the main loop, so it needs no protection; an interrupt that
+// has to stop the robot does it on the PWM outputs (adc.c).
+typedef enum {
+    STATE_WAIT_FOR_START = 0,
+    STATE_MOVING,
+    STATE_EMERGENCY
+} RobotState;
+
+// Set of states for state_transition()
+#define STATE_MASK(state) (1u << (state))
+#define STATE_ANY (STATE_MASK(STATE_WAIT_FOR_START) | STATE_MASK(STATE_MOVING) | STATE_MASK(STATE_EMERGENCY))
+
+// Critical section for shared state: holds off interrupts of priority
+// 1..6 with DISI for a few instructions, much cheaper than changing IPL.
+// Sections must not nest and must stay short (no function calls).
+#define STATE_CRITICAL_BEGIN() __builtin_disi(0x3FFF)
+#define STATE_CRITICAL_END() (DISICNT = 0)
+
+// Speed/yawrate setpoint, both between -100 and 100
+typedef struct {
+    int speed;
+    int yawrate;
+} Setpoint;
+
+// Starts in STATE_WAIT_FOR_START with a zero setpoint.
+void state_init(void);
+
+// Returns the current state.
+RobotState state_get(void);
+
+// Atomically moves to a new state if the current one is in a given set.
+// The transition is logged in the flight recorder.
+// Parameters:
+//   from - STATE_MASK() set of states the transition is allowed from
+//   to   - new state
+// Returns:
+//   1 if the transition was made, 0 if the current state was not in from
+int state_transition(unsigned int from, RobotState to);
+
+// Sets a new setpoint. Main loop only.
+void state_set_setpoint(int speed, int yawrate);
+
+// Copies the setpoint. Main loop only.
+void state_get_setpoint(Setpoint *setpoint);
+
+#endif /* STATE_H */
@@ -0,0 +1,171 @@
+/* ===============================================================
+ * File: telemetry.c                                             =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "telemetry.h"
+#include "uart.h"
+#include "messages.h"
+/*================================================================*/
+
+/*================================================================*/
+// Static description of a stream
+typedef struct {
+    const char *name;
+    uint8_t max_length; // longest message in bytes, used for the budget
+    uint8_t default_hz;
+} TelemetryInfo;
+
+// Lengths and default rates from the message schema (messages.h)
+static const TelemetryInfo tlm_info[TLM_COUNT] = {
+    {"DIST", MSG_MDIST_MAX_LENGTH, MSG_MDIST_DEFAULT_HZ},
+    {"BATT", MSG_MBATT_MAX_LENGTH, MSG_MBATT_DEFAULT_HZ},
+    {"ACC", MSG_MACC_MAX_LENGTH, MSG_MACC_DEFAULT_HZ},
+    {"TRJ", MSG_MTRJ_MAX_LENGTH, MSG_MTRJ_DEFAULT_HZ},
+    {"EST", MSG_MEST_MAX_LENGTH, MSG_MEST_DEFAULT_HZ},
+    {"PWR", MSG_MPWR_MAX_LENGTH, MSG_MPWR_DEFAULT_HZ},
+    {"LINK", MSG_MLNK_MAX_LENGTH, MSG_MLNK_DEFAULT_HZ},
+    {"STAT", MSG_MTLM_MAX_LENGTH, MSG_MTLM_DEFAULT_HZ},
+};
+/*================================================================*/
+// Runtime schedule, only used from the main loop
+static uint8_t tlm_hz[TLM_COUNT];
+static uint16_t tlm_period[TLM_COUNT]; // in ticks, 0 = off
+static uint16_t tlm_counter[TLM_COUNT];
+static uint8_t tlm_sent[TLM_COUNT]; // messages sent in the current second
+static uint8_t tlm_achieved[TLM_COUNT]; // messages sent in the last second
+static uint16_t tlm_window = 0;
+static uint16_t tlm_drops = 0;
+static uint32_t tlm_baud = 0; // link rate the mix was last budgeted for
+/*================================================================*/
+
+/*================================================================*/
+static void telemetry_set_rate(TelemetryStream stream, int hz) {
+    tlm_hz[stream] = hz;
+    tlm_period[stream] = (hz > 0) ? (TLM_TICK_HZ / hz) : 0;
+    tlm_counter[stream] = 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Bytes per second periodic telemetry may use at the current link rate
+/*================================================================*/
+static long telemetry_budget(void) {
+    return (long) UART_Baud() / 10 * TLM_LINK_SHARE / 100; // 8N1 = 10 bits/byte
+}
+/*================================================================*/
+
+/*================================================================*/
+// Downscales every stream in proportion when the subscribed mix no
+// longer fits the budget, after the link rate went down
+/*================================================================*/
+static void telemetry_rebudget(void) {
+    long budget = telemetry_budget();
+    long used = 0;
+    int i;
+
+    tlm_baud = UART_Baud();
+    for (i = 0; i < TLM_COUNT; i++) {
+        used += (long) tlm_hz[i] * tlm_info[i].max_length;
+    }
+    if (used <= budget) return;
+    for (i = 0; i < TLM_COUNT; i++) {
+        if (tlm_hz[i] != 0) telemetry_set_rate(i, (long) tlm_hz[i] * budget / used);
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+void telemetry_init(void) {
+    int i;
+    for (i = 0; i < TLM_COUNT; i++) {
+        telemetry_set_rate(i, tlm_info[i].default_hz);
+        tlm_sent[i] = 0;
+        tlm_achieved[i] = 0;
+    }
+    tlm_window = 0;
+    tlm_drops = 0;
+    tlm_baud = 0; // budgeted at the first tick
+}
+/*================================================================*/
+
+/*================================================================*/
+void telemetry_tick(void) {
+    int i;
+    if (UART_Baud() != tlm_baud) telemetry_rebudget();
+    for (i = 0; i < TLM_COUNT; i++) {
+        if (tlm_period[i] != 0) tlm_counter[i]++;
+    }
+    // Latch the achieved rates once per second
+    if (++tlm_window == TLM_TICK_HZ) {
+        tlm_window = 0;
+        for (i = 0; i < TLM_COUNT; i++) {
+            tlm_achieved[i] = tlm_sent[i];
+            tlm_sent[i] = 0;
+        }
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+int telemetry_due(TelemetryStream stream) {
+    if (tlm_period[stream] == 0 || tlm_counter[stream] < tlm_period[stream]) return 0;
+    tlm_counter[stream] = 0;
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+void telemetry_send(TelemetryStream stream, const char *message) {
+    if (UART_SendString(message)) {
+        tlm_sent[stream]++;
+    } else {
+        tlm_drops++;
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+int telemetry_subscribe(const char *name, int hz) {
+    long budget = telemetry_budget();
+    long used = 0;
+    int stream = -1;
+    int i;
+
+    for (i = 0; i < TLM_COUNT; i++) {
+        if (strcmp(name, tlm_info[i].name) == 0) stream = i;
+    }
+    if (stream < 0 || hz < 0 || hz > TLM_MAX_HZ) return -1;
+    if (hz == 0) { // turning a stream off always fits
+        telemetry_set_rate(stream, 0);
+        return 0;
+    }
+
+    // Bandwidth already taken by the other streams
+    for (i = 0; i < TLM_COUNT; i++) {
+        if (i != stream) used += (long) tlm_hz[i] * tlm_info[i].max_length;
+    }
+    // Downscale to what is left of the budget
+    if ((long) hz * tlm_info[stream].max_length > budget - used) {
+        hz = (budget > used) ? (budget - used) / tlm_info[stream].max_length : 0;
+        if (hz == 0) return -1;
+    }
+    telemetry_set_rate(stream, hz);
+    return hz;
+}
+/*================================================================*/
+
+/*================================================================*/
+void telemetry_report(void) {
+    char tlm_message[MSG_MTLM_SIZE];
+    msg_encode_mtlm(tlm_message, tlm_achieved[TLM_DIST], tlm_achieved[TLM_BATT], tlm_achieved[TLM_ACC],
+            tlm_achieved[TLM_TRJ], tlm_achieved[TLM_EST], tlm_achieved[TLM_PWR], tlm_achieved[TLM_LINK],
+            tlm_achieved[TLM_STAT], UART_TxPeak(), tlm_drops);
+    telemetry_send(TLM_STAT, tlm_message);
+}
+/*================================================================*/
@@ -0,0 +1,68 @@
+/* ===============================================================
+ * File: telemetry.h                                             =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Periodic messages the robot publishes. Their rates are set at runtime
+// with $PCSUB,name,hz* (hz = 0 turns a stream off).
+typedef enum {
+    TLM_DIST = 0, // $MDIST,distance*
+    TLM_BATT, // $MBATT,v_batt*
+    TLM_ACC, // $MACC,x,y,z*
+    TLM_TRJ, // $MTRJ,depth,underruns*
+    TLM_EST, // $MEST,speed,yawrate,heading,flags,peak_cycles*
+    TLM_PWR, // $MPWR,cpu_load,adc_hz,acc_low_power,current*
+    TLM_LINK, // $MLNK,baud,overruns,framing_errors,parity_errors*
+    TLM_STAT, // $MTLM,dist_hz,batt_hz,acc_hz,trj_hz,est_hz,pwr_hz,link_hz,stat_hz,tx_peak,tx_drops*
+    TLM_COUNT
+} TelemetryStream;
+
+// Main loop rate, the scheduler works in loop ticks
+#define TLM_TICK_HZ 500
+// Highest rate a stream may be given
+#define TLM_MAX_HZ 50
+// Share of the UART line (in percent) that periodic telemetry may use,
+// the rest is kept for acknowledgements and event messages
+#define TLM_LINK_SHARE 80
+
+// Restores the default rates (DIST 10Hz, BATT 1Hz, ACC 10Hz, TRJ 10Hz, EST 5Hz, PWR off, LINK off, STAT off).
+void telemetry_init(void);
+
+// Advances the stream schedules by one main loop tick. After a change
+// of the link rate ($PCBDR, BAUD) the subscribed streams are downscaled
+// in proportion if they no longer fit the budget, a stream scaled below
+// 1Hz is turned off; they are not raised again when the rate goes up.
+void telemetry_tick(void);
+
+// Returns 1 (once) when a message of the stream is due in this tick.
+int telemetry_due(TelemetryStream stream);
+
+// Queues a stream message on the UART and accounts for it in the
+// achieved rate (or in the drop counter if the TX buffer is full).
+void telemetry_send(TelemetryStream stream, const char *message);
+
+// Changes the rate of a stream, downscaling it if the mix of all
+// subscribed streams would not fit in the link budget.
+// Parameters:
+//   name - stream name as used in $PCSUB ("DIST", "BATT", "ACC", "TRJ", "EST", "PWR", "LINK", "STAT")
+//   hz   - requested rate, 0 turns the stream off
+// Returns:
+//   the granted rate, or -1 if the request is invalid or nothing fits
+//   (turning a stream off is always granted)
+int telemetry_subscribe(const char *name, int hz);
+
+// Sends the $MTLM report with the rates every stream achieved over the
+// last second.
+void telemetry_report(void);
+
+#endif /* TELEMETRY_H */
@@ -5,13 +5,25 @@
  * Waleed Elfieky                                                =
  * Yui Momiyama                                                  =
  * Mamoru Ota                                                    =
- * TIMER1: Controls the main loop execution rate at 500 Hz       =
- * TIMER2: Used to process bouncing in interrupt routine for     =
- * pressed button                                                =
+ * TIMER1: System tick, main loop execution rate at 500 Hz       =
+ * TIMER2: Free for blocking delays                              =
+ * TIMER3: Paces the ADC conversions                             =
+ * TIMER4: Free running cycle counter for profiling              =
  * ===============================================================*/
 
 /*================================================================*/
 #include "timer.h"
+#include "interrupt.h"
+/*================================================================*/
+// System tick, advanced by the TIMER1 interrupt
+static volatile uint16_t tmr_ticks = 0;
+// Tick the main loop last waited for
+static uint16_t tmr_waited_tick = 0;
+// TIMER1 counts (1:8) before the tick where the wait stops idling
+#define TMR_IDLE_MARGIN 512
+// Main loop load: TIMER1 counts spent before waiting, summed over loops
+static uint32_t tmr_busy_counts = 0;
+static uint16_t tmr_busy_loops = 0;
 /*================================================================*/
 
 /*================================================================*/
@@ -23,8 +35,8 @@ void tmr_setup_period(int timer, int ms) {
             // TIMER1: Manage main loop period at 500Hz
             T1CONbits.TON = 0; // Disable Timer1 during configuration
             TMR1 = 0; // Reset Timer1 counter register
-            T1CONbits.TCKPS = 3; // Set prescaler to 1:256
-            PR1 = ((FCY / 256) * ms) / 1000 - 1; // Calculate period register value
+            T1CONbits.TCKPS = 1; // Set prescaler to 1:8, periods up to 7ms
+            PR1 = ((FCY / 8) * ms) / 1000 - 1; // Calculate period register value
             IFS0bits.T1IF = 0; // Clear Timer1 interrupt flag
             T1CONbits.TON = 1; // Enable Timer1
             break;
@@ -38,6 +50,16 @@ void tmr_setup_period(int timer, int ms) {
             IFS0bits.T2IF = 0; // Clear Timer2 interrupt flag
             T2CONbits.TON = 1; // Enable Timer2
             break;
+
+        case TIMER3:
+            // TIMER3: ADC conversion trigger, its interrupt is not used
+            T3CONbits.TON = 0; // Disable Timer3 during configuration
+            TMR3 = 0; // Reset Timer3 counter register
+            T3CONbits.TCKPS = 3; // Set prescaler to 1:256
+            PR3 = ((FCY / 256) * ms) / 1000 - 1; // Calculate period register value
+            IFS0bits.T3IF = 0; // Clear Timer3 interrupt flag
+            T3CONbits.TON = 1; // Enable Timer3
+            break;
         default:
             // Invalid timer specified - no action taken
             break;
@@ -45,19 +67,61 @@ void tmr_setup_period(int timer, int ms) {
 }
 /*================================================================*/
 
+/*================================================================*/
+//setup timer period in instruction cycles
+/*================================================================*/
+int tmr_setup_period_cycles(int timer, unsigned long cycles) {
+    static const unsigned int prescalers[4] = {1, 8, 64, 256};
+    int tckps = 0;
+
+    while (tckps < 3 && cycles / prescalers[tckps] > 0x10000UL) tckps++;
+    switch (timer) {
+        case TIMER3:
+            T3CONbits.TON = 0; // Disable Timer3 during configuration
+            TMR3 = 0; // Reset Timer3 counter register
+            T3CONbits.TCKPS = tckps; // Smallest prescaler that fits
+            PR3 = cycles / prescalers[tckps] - 1; // Calculate period register value
+            IFS0bits.T3IF = 0; // Clear Timer3 interrupt flag
+            T3CONbits.TON = 1; // Enable Timer3
+            return prescalers[tckps];
+        default:
+            // Invalid timer specified - no action taken
+            return 0;
+    }
+}
+/*================================================================*/
+
 /*================================================================*/
 //busy wait timer
 /*================================================================*/
-void tmr_wait_period(int timer) {
+int tmr_wait_period(int timer) {
+    int overrun = 0;
     switch (timer) {
         case TIMER1:
-            // TIMER1: Wait for the main loop period to complete
-            while (!IFS0bits.T1IF); // Block until Timer1 period flag is set
-            IFS0bits.T1IF = 0; // Clear the flag for next period
+            // TIMER1: Wait for the next system tick
+            // Time used in this period (a whole period if the tick already came)
+            if (tmr_busy_loops == 0xFFFF) { // nobody read the load, keep the average
+                tmr_busy_counts >>= 1;
+                tmr_busy_loops >>= 1;
+            }
+            tmr_busy_counts += (tmr_ticks == tmr_waited_tick) ? TMR1 : PR1 + 1;
+            tmr_busy_loops++;
+            // Idle until an interrupt wakes the CPU, but spin over the end
+            // of the period: a tick landing between the test and Idle()
+            // would otherwise only be seen at the next interrupt. The tick
+            // count is tested again after reading TMR1, which reads small
+            // right after a tick that came in since the loop test.
+            while (tmr_ticks == tmr_waited_tick) {
+                if (TMR1 < PR1 - TMR_IDLE_MARGIN && tmr_ticks == tmr_waited_tick) Idle();
+            }
+            // More than one tick since the last wait: the loop took too long
+            overrun = (uint16_t) (tmr_ticks - tmr_waited_tick) > 1;
+            tmr_waited_tick = tmr_ticks;
             break;
 
         case TIMER2:
             // TIMER2: Wait for the specified delay to complete
+            overrun = IFS0bits.T2IF;
             while (!IFS0bits.T2IF); // Block until Timer2 period flag is set
             IFS0bits.T2IF = 0; // Clear the flag for next use
             break;
@@ -66,5 +130,55 @@ void tmr_wait_period(int timer) {
             // Invalid timer specified - no action taken
             break;
     }
+    return overrun;
+}
+/*================================================================*/
+
+/*================================================================*/
+//system tick counted in TIMER1 periods
+/*================================================================*/
+uint16_t tmr_get_ticks(void) {
+    return tmr_ticks;
+}
+/*================================================================*/
+
+/*================================================================*/
+//main loop load
+/*================================================================*/
+unsigned int tmr_loop_load(void) {
+    unsigned int load = 0;
+    if (tmr_busy_loops > 0) {
+        // Divisor scaled first: the counts times 1000 would not fit 32 bits
+        load = tmr_busy_counts / ((uint32_t) tmr_busy_loops * (PR1 + 1) / 1000);
+    }
+    tmr_busy_counts = 0;
+    tmr_busy_loops = 0;
+    return load;
+}
+/*================================================================*/
+
+/*================================================================*/
+//free running cycle counter
+/*================================================================*/
+void tmr_start_cycle_counter(void) {
+    T4CONbits.TON = 0;
+    TMR4 = 0;
+    T4CONbits.TCKPS = 0; // 1:1, one count per instruction cycle
+    PR4 = 0xFFFF; // count over the full 16 bits
+    T4CONbits.TON = 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+// System tick interrupt: advances the tick and samples the buttons
+/*================================================================*/
+void __attribute__((__interrupt__, __auto_psv__)) _T1Interrupt(void) {
+    ISR_PROFILE_BEGIN();
+    // The flag was raised when TMR1 restarted from 0 (1:8 prescaler)
+    isr_profile_latency(ISR_TICK, TMR1 << 3);
+    IFS0bits.T1IF = 0;
+    tmr_ticks++;
+    buttons_sample(tmr_ticks);
+    ISR_PROFILE_END(ISR_TICK);
 }
 /*================================================================*/
\ No newline at end of file
@@ -6,27 +6,72 @@
 
 /*================================================================*/
 // Timer usage definitions:
-// TIMER1: Main loop period management at 500 Hz.
-// TIMER2: Used to process bouncing in interrupt routine for pressed button.
+// TIMER1: System tick interrupt (2ms), paces the main loop at 500 Hz and
+//         samples the buttons. 1:8 prescaler, the finest that fits the
+//         tick, so TMR1 also gives the tick latency to 8 cycles.
+// TIMER2: Free for blocking delays (buttons no longer use it).
+// TIMER3: Paces the ADC conversions (each period match starts one conversion).
+// TIMER4: Free running cycle counter (Fcy, wraps every 910us) for profiling.
 #define TIMER1 1
 #define TIMER2 2
+#define TIMER3 3
+#define TIMER4 4
 #define FCY 72000000
+// Current value of the cycle counter
+#define TMR_CYCLES() TMR4
 /*================================================================*/
 
 /*================================================================*/
 // Configures the specified timer to generate a periodic interrupt.
 // Sets the prescaler and period register to match the desired timing.
 // Parameters:
-//   timer - Timer identifier (TIMER1 or TIMER2)
-//   ms    - Desired period in milliseconds
+//   timer - Timer identifier (TIMER1, TIMER2 or TIMER3)
+//   ms    - Desired period in milliseconds (at most 7 for TIMER1)
 void tmr_setup_period(int timer, int ms);
 /*================================================================*/
 
+/*================================================================*/
+// Configures a timer for a period given in instruction cycles, for
+// rates too fast for tmr_setup_period(). The smallest prescaler that
+// fits the period in 16 bits is used.
+// Parameters:
+//   timer  - Timer identifier (TIMER3)
+//   cycles - Desired period in Fcy cycles (up to 256 * 65536)
+// Returns:
+//   the prescaler in use (1, 8, 64 or 256), 0 for an invalid timer
+int tmr_setup_period_cycles(int timer, unsigned long cycles);
+/*================================================================*/
+
 /*================================================================*/
 // Waits until the selected timer completes its current period.
-// Blocks until the timer flag is set, then clears the flag.
+// TIMER1: idles the CPU until the next system tick.
+// TIMER2: blocks until the timer flag is set, then clears the flag.
 // Parameters:
 //   timer - Timer identifier (TIMER1 or TIMER2)
-void tmr_wait_period(int timer);
+// Returns:
+//   1 if the period had already elapsed when called (overrun), 0 otherwise
+int tmr_wait_period(int timer);
+/*================================================================*/
+
+/*================================================================*/
+// Share of the TIMER1 periods the main loop spent working (in per mille)
+// since the previous call; the rest was spent in Idle mode.
+unsigned int tmr_loop_load(void);
+/*================================================================*/
+
+/*================================================================*/
+// Starts TIMER4 as a free running counter at Fcy (see TMR_CYCLES()).
+void tmr_start_cycle_counter(void);
+/*================================================================*/
+
+/*================================================================*/
+// System tick interrupt
+void __attribute__((__interrupt__, __auto_psv__)) _T1Interrupt(void);
+/*================================================================*/
+
+/*================================================================*/
+// Returns the system tick: the number of TIMER1 periods (2ms) since
+// boot, wrapping at 16 bits.
+uint16_t tmr_get_ticks(void);
 /*================================================================*/
 #endif
\ No newline at end of file
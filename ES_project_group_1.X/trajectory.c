@@ -0,0 +1,125 @@
+/* ===============================================================
+ * File: trajectory.c                                            =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "trajectory.h"
+/*================================================================*/
+
+/*================================================================*/
+// One queued motion segment (4 bytes)
+typedef struct {
+    uint16_t duration_ms;
+    int8_t speed;
+    int8_t yawrate;
+} TrajectorySegment;
+/*================================================================*/
+// Segment ring, only touched from the main loop (commands and control
+// are both processed there) so no interrupt protection is needed.
+static TrajectorySegment traj_queue[TRAJ_QUEUE_SIZE];
+static uint8_t traj_head = 0; // next free slot
+static uint8_t traj_tail = 0; // running segment
+static uint8_t traj_count = 0;
+// Time left in the running segment. Can go negative by less than one
+// period; the overshoot is carried into the next segment so the
+// trajectory stays tick-accurate over many segments.
+static long traj_remaining_ms = 0;
+static uint8_t traj_running = 0; // a segment has been loaded
+static uint8_t traj_mode = 0; // trajectory owns the setpoint
+static uint16_t traj_underrun_count = 0;
+/*================================================================*/
+
+/*================================================================*/
+void trajectory_init(void) {
+    trajectory_flush();
+    traj_underrun_count = 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+int trajectory_push(unsigned int duration_ms, int speed, int yawrate) {
+    if (duration_ms == 0 || duration_ms > TRAJ_MAX_DURATION_MS) return 0;
+    if (speed < -100 || speed > 100 || yawrate < -100 || yawrate > 100) return 0;
+    if (traj_count >= TRAJ_QUEUE_SIZE) return 0;
+
+    traj_queue[traj_head].duration_ms = duration_ms;
+    traj_queue[traj_head].speed = speed;
+    traj_queue[traj_head].yawrate = yawrate;
+    traj_head = (traj_head + 1) % TRAJ_QUEUE_SIZE;
+    traj_count++;
+    traj_mode = 1;
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+void trajectory_flush(void) {
+    traj_head = 0;
+    traj_tail = 0;
+    traj_count = 0;
+    traj_remaining_ms = 0;
+    traj_running = 0;
+    traj_mode = 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+int trajectory_step(unsigned int elapsed_ms, int *speed, int *yawrate) {
+    if (!traj_mode) return 0;
+
+    // Load the first segment of a new batch
+    if (!traj_running && traj_count > 0) {
+        traj_remaining_ms = traj_queue[traj_tail].duration_ms;
+        traj_running = 1;
+    }
+
+    if (!traj_running) {
+        // Queue empty: hold the robot still until the PC refills it
+        *speed = 0;
+        *yawrate = 0;
+        return 1;
+    }
+
+    // Output the running segment for this period
+    *speed = traj_queue[traj_tail].speed;
+    *yawrate = traj_queue[traj_tail].yawrate;
+    traj_remaining_ms -= elapsed_ms;
+
+    // Retire every segment that ended during this period
+    while (traj_running && traj_remaining_ms <= 0) {
+        traj_tail = (traj_tail + 1) % TRAJ_QUEUE_SIZE;
+        traj_count--;
+        if (traj_count > 0) {
+            traj_remaining_ms += traj_queue[traj_tail].duration_ms;
+        } else {
+            traj_running = 0;
+            traj_remaining_ms = 0;
+            traj_underrun_count++;
+        }
+    }
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+int trajectory_active(void) {
+    return traj_mode;
+}
+/*================================================================*/
+
+/*================================================================*/
+uint8_t trajectory_depth(void) {
+    return traj_count;
+}
+/*================================================================*/
+
+/*================================================================*/
+uint16_t trajectory_underruns(void) {
+    return traj_underrun_count;
+}
+/*================================================================*/
@@ -0,0 +1,60 @@
+/* ===============================================================
+ * File: trajectory.h                                            =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <xc.h>
+#include <stdint.h>
+
+// Number of (duration, speed, yawrate) segments that can be queued.
+// A segment line "$PCTRJ,60000,-100,-100*" fits in one RX slot, so the
+// PC can keep the ring topped up without waiting for the robot.
+#define TRAJ_QUEUE_SIZE 16
+
+// Longest accepted segment duration in milliseconds
+#define TRAJ_MAX_DURATION_MS 60000u
+
+// Clears the segment queue, the active segment and the statistics.
+void trajectory_init(void);
+
+// Appends a segment to the queue.
+// Parameters:
+//   duration_ms - how long the setpoint is held (1 .. TRAJ_MAX_DURATION_MS)
+//   speed       - speed setpoint between -100 and 100
+//   yawrate     - yawrate setpoint between -100 and 100
+// Returns:
+//   1 if the segment was queued, 0 if it is out of range or the queue is full
+int trajectory_push(unsigned int duration_ms, int speed, int yawrate);
+
+// Drops every queued segment and leaves trajectory mode.
+// Called on emergency, on $PCSTP/$PCTRF and when a $PCREF takes over.
+void trajectory_flush(void);
+
+// Advances the trajectory by one control period.
+// When trajectory mode is active the segment setpoint is written to
+// speed/yawrate, otherwise they are left untouched.
+// Parameters:
+//   elapsed_ms - time since the previous call (the main loop period)
+//   speed      - in/out speed setpoint
+//   yawrate    - in/out yawrate setpoint
+// Returns:
+//   1 if the setpoint comes from the trajectory, 0 otherwise
+int trajectory_step(unsigned int elapsed_ms, int *speed, int *yawrate);
+
+// Returns 1 while a trajectory is being executed (until flushed).
+int trajectory_active(void);
+
+// Returns the number of queued segments, including the running one.
+uint8_t trajectory_depth(void);
+
+// Returns how many times the queue ran dry while a trajectory was active.
+uint16_t trajectory_underruns(void);
+
+#endif /* TRAJECTORY_H */
@@ -10,39 +10,64 @@
 /*========================================================*/
 //include
 #include "uart.h"
-/*========================================================*/
-// External variables
-extern volatile int g_speed;
-extern volatile int g_yawrate;
+#include "trajectory.h"
+#include "ack.h"
+#include "telemetry.h"
+#include "params.h"
+#include "recorder.h"
+#include "state.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "update.h"
+#include "messages.h"
 /*========================================================*/
 // TX Circular Buffer "handling transition"
 static volatile char tx_buffer[TX_BUFFER_SIZE];
-static volatile uint16_t tx_head = 0;
-static volatile uint16_t tx_tail = 0;
-/*========================================================*/
-// Command Buffer to store multiple commands in case of receiving 
-volatile char rxBuffer[RX_BUFFER_COUNT][RX_STRING_LENGTH] = {
-    {0}};
-volatile uint8_t rx_write_index = 0;
-volatile uint8_t rx_read_index = 0;
-volatile char temp_rx_buffer[RX_STRING_LENGTH] = {0};
-volatile uint16_t rx_idx = 0;
-/*========================================================*/
-//extern user defined variables to handle current state
-typedef enum {
-    STATE_WAIT_FOR_START = 0,
-    STATE_MOVING,
-    STATE_EMERGENCY
-} RobotState;
-extern volatile RobotState current_state;
+static volatile uint8_t tx_head = 0;
+static volatile uint8_t tx_tail = 0;
+#define TX_BUFFER_MASK (TX_BUFFER_SIZE - 1)
+static uint16_t tx_peak = 0; // highest occupancy since the last UART_TxPeak()
+// Cycle count when UART_SendString woke up an idle transmitter, whose
+// flag was already set: the entry latency of the next TX interrupt
+static volatile uint16_t tx_request_cycles;
+static volatile uint8_t tx_request_timed = 0;
+/*========================================================*/
+// Command queue: the RX interrupt assembles each line directly after the
+// complete ones in a byte ring, NUL terminated, and publishes it by
+// advancing head past it. A line that does not fit in the free bytes, or
+// that is longer than RX_STRING_LENGTH - 1, is dropped and counted.
+typedef struct {
+    char data[RX_RING_SIZE];
+    volatile uint8_t head; // end of the complete lines, written by the RX interrupt
+    volatile uint8_t tail; // start of the oldest complete line, advanced by the main loop
+    volatile uint16_t dropped; // lines lost since boot
+} CommandQueue;
+#define RX_RING_MASK (RX_RING_SIZE - 1)
+static CommandQueue rx_queue;
+static uint16_t rx_dropped_reported = 0;
+static volatile uint16_t rx_idx = 0; // characters of the line being received
+static volatile uint8_t rx_discard = 0; // drop the rest of a line hit by an RX error
+static volatile uint8_t rx_overflow = 0; // reason the current line is dropped, if rx_discard
+// RX error counters since boot
+static volatile uint16_t rx_overruns = 0;
+static volatile uint16_t rx_framing_errors = 0;
+static volatile uint16_t rx_parity_errors = 0;
 /*========================================================*/
-//user defined variables for uart
+// Baud rate negotiation
 typedef enum {
-    CMD_PCREF,
-    CMD_PCSTP,
-    CMD_PCSTT,
-    CMD_UNKNOWN
-} CommandType;
+    BAUD_IDLE,
+    BAUD_DRAIN, // waiting for the TX buffer to empty before switching
+    BAUD_TRIAL, // new rate in use, waiting for $PCBOK
+    BAUD_REVERT // confirmation missing, draining before switching back
+} BaudPhase;
+static BaudPhase baud_phase = BAUD_IDLE;
+static uint32_t baud_current = BAUDRATE; // rate U1BRG is set for
+static uint32_t baud_committed = BAUDRATE; // rate a failed negotiation returns to
+static uint32_t baud_pending = 0;
+static uint16_t baud_trial_ms = 0;
+/*========================================================*/
+// Command types (MsgCommand) and their parsers come from messages.h
+static int parse_pcref_command(const char *command, int *speed, int *yawrate);
 /*========================================================*/
 //declare uart configuration
 /*========================================================*/
@@ -55,8 +80,12 @@ void UART_Initialize(void) {
     U1MODEbits.STSEL = 0; // 1 Stop bit
     U1MODEbits.PDSEL = 0; // No Parity, 8 data bits
     U1MODEbits.ABAUD = 0; // Auto-Baud Disabled
-    U1MODEbits.BRGH = 0; // Low Speed mode
-    U1BRG = BRGVAL; // BAUD Rate Setting for 9600
+    U1MODEbits.BRGH = 1; // High Speed mode
+    if (UART_BaudBrg(g_params.baudrate) == 0) {
+        g_params.baudrate = BAUDRATE; // a saved rate we cannot generate
+    }
+    U1BRG = UART_BaudBrg(g_params.baudrate); // BAUD Rate Setting (9600 by default)
+    baud_current = baud_committed = g_params.baudrate;
 
     // TX Interrupt is generated when a character is transferred to the shift register
     U1STAbits.UTXISEL0 = 0;
@@ -73,31 +102,159 @@ void UART_Initialize(void) {
 
 /*========================================================*/
 /* handling send string to the buffer applying non 
- * blocking mechanism later*/
+ * blocking mechanism, a message is queued completely or
+ * not at all so a full buffer never emits half a frame */
 /*========================================================*/
-void UART_SendString(const char *str) {
+int UART_SendString(const char *str) {
+    uint16_t length = strlen(str);
+    uint16_t used;
+
+    if (length == 0) return 1;
+    if (length > UART_TxFree()) {
+        recorder_log(EV_TX_DROP, length, UART_TxFree());
+        return 0;
+    }
+
     while (*str) {
         // Circular buffer management
-        uint16_t next_head = (tx_head + 1) % TX_BUFFER_SIZE;
-        if (next_head == tx_tail) break;
         tx_buffer[tx_head] = *str++;
-        tx_head = next_head;
+        tx_head = (tx_head + 1) & TX_BUFFER_MASK;
     }
 
+    used = TX_BUFFER_SIZE - 1 - UART_TxFree();
+    if (used > tx_peak) tx_peak = used;
+
     if (IEC0bits.U1TXIE == 0 && tx_head != tx_tail) {
+        if (IFS0bits.U1TXIF) { // requested from now on
+            tx_request_cycles = TMR_CYCLES();
+            tx_request_timed = 1;
+        }
         IEC0bits.U1TXIE = 1; // Enable the interrupt 
         }
+    return 1;
+}
+/*========================================================*/
+
+/*========================================================*/
+// free space of the TX buffer (one slot stays empty)
+/*========================================================*/
+uint16_t UART_TxFree(void) {
+    uint8_t tail = tx_tail; // read once, the TX ISR moves it
+    return (tail - tx_head - 1) & TX_BUFFER_MASK;
+}
+/*========================================================*/
+
+/*========================================================*/
+// peak TX buffer occupancy since the previous call
+/*========================================================*/
+uint16_t UART_TxPeak(void) {
+    uint16_t peak = tx_peak;
+    tx_peak = 0;
+    return peak;
+}
+/*========================================================*/
+
+/*========================================================*/
+// divider for a baud rate with BRGH = 1, rounded to the nearest
+/*========================================================*/
+uint16_t UART_BaudBrg(uint32_t baud) {
+    uint32_t divider, actual, error;
+    if (baud < 1200 || baud > UART_MAX_BAUD) return 0;
+    divider = (FCY + 2 * baud) / (4 * baud); // U1BRG + 1
+    if (divider < 2 || divider > 0x10000UL) return 0;
+    actual = FCY / (4 * divider);
+    error = (actual > baud) ? actual - baud : baud - actual;
+    if (error * 1000 > (uint32_t) UART_BAUD_MAX_ERROR * baud) return 0;
+    return divider - 1;
+}
+/*========================================================*/
+
+/*========================================================*/
+// TX buffer and shift register both empty
+/*========================================================*/
+int UART_TxIdle(void) {
+    return tx_head == tx_tail && U1STAbits.TRMT;
+}
+/*========================================================*/
+
+/*========================================================*/
+// switch U1BRG, whatever was half received is dropped. The next
+// character starts a new line: the first line at the new rate is the
+// $PCBOK that confirms it.
+/*========================================================*/
+static void UART_SetBaud(uint32_t baud) {
+    IEC0bits.U1RXIE = 0;
+    U1BRG = UART_BaudBrg(baud);
+    baud_current = baud;
+    rx_idx = 0;
+    rx_discard = 0;
+    rx_overflow = 0;
+    IEC0bits.U1RXIE = 1;
+}
+/*========================================================*/
+
+/*========================================================*/
+uint32_t UART_Baud(void) {
+    return baud_current;
+}
+/*========================================================*/
+
+/*========================================================*/
+int UART_RequestBaud(uint32_t baud) {
+    if (baud_phase != BAUD_IDLE || UART_BaudBrg(baud) == 0) return 0;
+    baud_pending = baud;
+    baud_phase = BAUD_DRAIN;
+    return 1;
+}
+/*========================================================*/
+
+/*========================================================*/
+int UART_ConfirmBaud(void) {
+    char baud_message[MSG_MBAUD_SIZE];
+    if (baud_phase != BAUD_TRIAL) return 0;
+    baud_committed = baud_pending;
+    g_params.baudrate = baud_pending; // $PCPSV keeps it for the next boot
+    baud_phase = BAUD_IDLE;
+    msg_encode_mbaud(baud_message, baud_pending, 1);
+    UART_SendString(baud_message);
+    return 1;
 }
 /*========================================================*/
 
 /*========================================================*/
-// static function to handle the received command type
+void UART_BaudTick(void) {
+    char baud_message[MSG_MBAUD_SIZE];
+    switch (baud_phase) {
+        case BAUD_DRAIN:
+            if (UART_TxIdle()) {
+                UART_SetBaud(baud_pending);
+                baud_trial_ms = 0;
+                baud_phase = BAUD_TRIAL;
+            }
+            break;
+        case BAUD_TRIAL:
+            baud_trial_ms += 2;
+            if (baud_trial_ms >= UART_BAUD_CONFIRM_MS) baud_phase = BAUD_REVERT;
+            break;
+        case BAUD_REVERT:
+            if (UART_TxIdle()) {
+                UART_SetBaud(baud_committed);
+                baud_phase = BAUD_IDLE;
+                msg_encode_mbaud(baud_message, baud_committed, 0);
+                UART_SendString(baud_message);
+            }
+            break;
+        default:
+            break;
+    }
+}
+/*========================================================*/
+
 /*========================================================*/
-static CommandType get_command_type(const char *input) {
-    if (strncmp(input, "$PCREF,", 7) == 0) return CMD_PCREF;
-    if (strncmp(input, "$PCSTP,", 7) == 0) return CMD_PCSTP;
-    if (strncmp(input, "$PCSTT,", 7) == 0) return CMD_PCSTT;
-    return CMD_UNKNOWN;
+void UART_ReportLink(void) {
+    char link_message[MSG_MLNK_SIZE];
+    msg_encode_mlnk(link_message, baud_current, rx_overruns, rx_framing_errors, rx_parity_errors);
+    telemetry_send(TLM_LINK, link_message);
 }
 /*========================================================*/
 
@@ -105,35 +262,181 @@ static CommandType get_command_type(const char *input) {
 /* process command for uart and execute corresponding 
  * command based on current state process_pcref_command
  * will only parse the values to be updated later if we enter
- * moving state */
+ * moving state. Commands with a sequence number are
+ * executed once and acknowledged in the per-tick $MACKS
+ * frame, the others are answered right away with $MACK */
 /*========================================================*/
-void process_uart_command(const char *input) {
-    switch (get_command_type(input)) {
-        case CMD_PCREF:
-            process_pcref_command(input);
+static void execute_uart_command(const char *input, int superseded) {
+    uint8_t seq;
+    int has_seq = ack_parse_seq(input, &seq);
+    MsgCommand type = msg_command_type(input);
+    int ok = 0;
+    char message[MSG_ERR_SIZE]; // $ERR or $MACK
+
+    recorder_log(EV_COMMAND, type, has_seq ? seq : -1);
+
+    // A retransmission of an executed command is only re-acknowledged
+    if (has_seq && ack_is_duplicate(seq)) return;
+
+    switch (type) {
+        case MSG_PCREF:
+            if (superseded) {
+                // a newer $PCREF follows, only check this one
+                int speed, yawrate;
+                ok = parse_pcref_command(input, &speed, &yawrate);
+            } else {
+                ok = process_pcref_command(input);
+            }
             break;
-        case CMD_PCSTP:
-            if (current_state != STATE_EMERGENCY) {
-                current_state = STATE_WAIT_FOR_START;
+        case MSG_PCSTP:
+            if (state_transition(STATE_MASK(STATE_WAIT_FOR_START) | STATE_MASK(STATE_MOVING), STATE_WAIT_FOR_START)) {
                 set_motor_pwm(0, 0); // stop motors
-                UART_SendString("$MACK,1*\r\n");
-            } else {
-                UART_SendString("$MACK,0*\r\n");
+                trajectory_flush(); // a stop also discards the planned motion
+                ok = 1;
             }
             break;
-        case CMD_PCSTT:
-            if (current_state != STATE_EMERGENCY) {
-                current_state = STATE_MOVING;
-                UART_SendString("$MACK,1*\r\n");
-            } else {
-                UART_SendString("$MACK,0*\r\n");
+        case MSG_PCSTT:
+            ok = state_transition(STATE_MASK(STATE_WAIT_FOR_START) | STATE_MASK(STATE_MOVING), STATE_MOVING);
+            break;
+        case MSG_PCTRJ:
+            ok = process_pctrj_command(input); // 0 on invalid segment or queue full
+            break;
+        case MSG_PCTRF:
+            trajectory_flush();
+            ok = 1;
+            break;
+        case MSG_PCSYN:
+            // PC (re)started its sequence numbering
+            ack_init();
+            has_seq = 0;
+            ok = 1;
+            break;
+        case MSG_PCSUB:
+            ok = process_pcsub_command(input);
+            break;
+        case MSG_PCPGT:
+        case MSG_PCPST:
+            ok = process_param_command(input);
+            break;
+        case MSG_PCPSV:
+            // Flash programming stalls the CPU, only allowed with the motors stopped
+            if (state_get() == STATE_WAIT_FOR_START) {
+                ok = params_save();
             }
             break;
-        case CMD_UNKNOWN:
-            // we don't have logs at the moment here we must forward it to logs
-            // at moment informing user by uart only.
-            UART_SendString("$ERR,Unknown command*\r\n");
+        case MSG_PCPDF:
+            params_defaults();
+            ok = 1;
+            break;
+        case MSG_PCLOG:
+            recorder_start_dump();
+            ok = 1;
+            break;
+        case MSG_PCISR:
+            isr_profile_report();
+            ok = 1;
+            break;
+        case MSG_PCBDR:
+            ok = process_pcbdr_command(input); // acknowledged at the current rate
+            break;
+        case MSG_PCBOK:
+            ok = UART_ConfirmBaud();
+            break;
+        case MSG_PCUPD:
+            ok = update_request(); // update mode starts once the acknowledgement is out
+            break;
+        case MSG_UNKNOWN:
+            // already in the flight recorder (EV_COMMAND), also tell the user
+            msg_encode_err(message, "Unknown command");
+            UART_SendString(message);
+            if (!has_seq) return;
+            break;
+    }
+
+    if (has_seq) {
+        ack_record(seq, ok);
+    } else {
+        msg_encode_mack(message, ok);
+        UART_SendString(message);
+    }
+}
+/*========================================================*/
+
+/*========================================================*/
+void process_uart_command(const char *input) {
+    execute_uart_command(input, 0);
+}
+/*========================================================*/
+
+/*========================================================*/
+// copies the line starting at start in the RX ring to line, cut to
+// size - 1 characters, and returns where the next line starts
+/*========================================================*/
+static uint8_t rx_ring_line(uint8_t start, char *line, uint8_t size) {
+    uint8_t length = 0;
+    char c;
+
+    while ((c = rx_queue.data[start]) != '\0') {
+        if (length < size - 1) line[length++] = c;
+        start = (start + 1) & RX_RING_MASK;
     }
+    line[length] = '\0';
+    return (start + 1) & RX_RING_MASK;
+}
+/*========================================================*/
+
+/*========================================================*/
+/* a queued $PCREF that will replace the setpoint once executed:
+ * it decodes within its ranges, and it is neither the
+ * retransmission of an executed command nor of the command
+ * just before it (same sequence number) */
+/*========================================================*/
+static int pcref_will_apply(const char *line, const char *previous) {
+    MsgPcref pcref;
+    uint8_t seq, previous_seq;
+
+    if (msg_command_type(line) != MSG_PCREF || !msg_decode_pcref(line, &pcref)) return 0;
+    if (!ack_parse_seq(line, &seq)) return 1;
+    if (ack_was_received(seq)) return 0;
+    return !ack_parse_seq(previous, &previous_seq) || previous_seq != seq;
+}
+/*========================================================*/
+
+/*========================================================*/
+/* run the queued commands in arrival order within the tick
+ * budget; a $PCREF directly followed by another $PCREF that
+ * will be applied is superseded: it is acknowledged but never
+ * applied, so a burst of setpoints costs one update */
+/*========================================================*/
+int UART_ProcessCommands(void) {
+    char dropped_message[MSG_MRXDROP_SIZE];
+    char line[RX_STRING_LENGTH];
+    char following[RX_STRING_LENGTH];
+    uint16_t start = TMR_CYCLES();
+    uint16_t dropped = rx_queue.dropped;
+    int count = 0;
+
+    while (rx_queue.tail != rx_queue.head && count < UART_CMD_MAX_PER_TICK) {
+        uint8_t next = rx_ring_line(rx_queue.tail, line, sizeof(line));
+        int superseded = 0;
+        if (next != rx_queue.head && msg_command_type(line) == MSG_PCREF) {
+            rx_ring_line(next, following, sizeof(following));
+            superseded = pcref_will_apply(following, line);
+        }
+
+        rx_queue.tail = next; // copied, the bytes are free for the interrupt again
+        execute_uart_command(line, superseded);
+        count++;
+        if ((uint16_t) (TMR_CYCLES() - start) >= UART_CMD_BUDGET_CYCLES) break;
+    }
+
+    // Tell the PC that lines were lost, the sequenced ones show up as
+    // missing in $MACKS as well
+    if (dropped != rx_dropped_reported) {
+        msg_encode_mrxdrop(dropped_message, dropped);
+        if (UART_SendString(dropped_message)) rx_dropped_reported = dropped;
+    }
+    return count;
 }
 /*========================================================*/
 
@@ -141,14 +444,92 @@ void process_uart_command(const char *input) {
 /*=============================================================*/
 //function to parse speed and yawrate
 /*============================================================*/
-void process_pcref_command(const char *command) {
+static int parse_pcref_command(const char *command, int *speed, int *yawrate) {
+    MsgPcref pcref;
+    if (!msg_decode_pcref(command, &pcref)) return 0; // ranges checked by the decoder
+    *speed = pcref.speed;
+    *yawrate = pcref.yawrate;
+    return 1;
+}
+
+int process_pcref_command(const char *command) {
     int speed, yawrate;
-    if (sscanf(command, "$PCREF,%d,%d*", &speed, &yawrate) == 2) {
-        if ((speed >= -100 && speed <= 100) && (yawrate >= -100 && yawrate <= 100)) {
-            g_speed = speed;                // this variable is global in main implementation
-            g_yawrate = yawrate;            // this variable is global in main implementation
+    if (parse_pcref_command(command, &speed, &yawrate)) {
+        state_set_setpoint(speed, yawrate); // applied by the main loop in moving state
+        trajectory_flush();             // a direct setpoint takes over from the trajectory
+        return 1;
+    }
+    return 0;
+}
+/*========================================================*/
+
+/*=============================================================*/
+//function to parse a telemetry subscription and report the granted rate
+/*============================================================*/
+int process_pcsub_command(const char *command) {
+    MsgPcsub pcsub;
+    int granted;
+    if (msg_decode_pcsub(command, &pcsub)) {
+        granted = telemetry_subscribe(pcsub.stream, pcsub.hz);
+        if (granted >= 0) {
+            char sub_message[MSG_MSUB_SIZE];
+            msg_encode_msub(sub_message, pcsub.stream, granted);
+            UART_SendString(sub_message);
+            return 1;
         }
     }
+    return 0;
+}
+/*========================================================*/
+
+/*=============================================================*/
+//function to read ($PCPGT,name*) or write ($PCPST,name,value*)
+//a parameter, the resulting value is echoed as $MPRM,name,value*
+/*============================================================*/
+int process_param_command(const char *command) {
+    MsgPcpst pcpst;
+    MsgPcpgt pcpgt;
+    const char *name;
+    long value;
+    if (msg_decode_pcpst(command, &pcpst)) {
+        if (!params_set(pcpst.name, pcpst.value)) return 0;
+        name = pcpst.name;
+    } else if (msg_decode_pcpgt(command, &pcpgt)) {
+        name = pcpgt.name;
+    } else {
+        return 0;
+    }
+    if (params_get(name, &value)) {
+        char prm_message[MSG_MPRM_SIZE];
+        msg_encode_mprm(prm_message, name, value);
+        UART_SendString(prm_message);
+        return 1;
+    }
+    return 0;
+}
+/*========================================================*/
+
+/*=============================================================*/
+//function to parse a baud rate change request
+/*============================================================*/
+int process_pcbdr_command(const char *command) {
+    MsgPcbdr pcbdr;
+    if (msg_decode_pcbdr(command, &pcbdr)) {
+        return UART_RequestBaud(pcbdr.baud);
+    }
+    return 0;
+}
+/*========================================================*/
+
+/*=============================================================*/
+//function to parse and queue one trajectory segment
+/*============================================================*/
+int process_pctrj_command(const char *command) {
+    MsgPctrj pctrj;
+    if (msg_decode_pctrj(command, &pctrj)) {
+        return trajectory_push(pctrj.duration_ms, pctrj.speed, pctrj.yawrate); // queue space checked there
+    }
+    return 0;
 }
 /*========================================================*/
 
@@ -163,16 +544,23 @@ void process_pcref_command(const char *command) {
  * per activation.*/
 /*========================================================*/
 void __attribute__((interrupt, no_auto_psv)) _U1TXInterrupt(void) {
+    ISR_PROFILE_BEGIN();
+    if (tx_request_timed) {
+        isr_profile_latency(ISR_UART_TX, TMR_CYCLES() - tx_request_cycles);
+        tx_request_timed = 0;
+    }
     IFS0bits.U1TXIF = 0;  // clear interrupt flag
 
-    if (tx_head != tx_tail) {
+    // Top up the hardware FIFO, fewer interrupts at high baud rates
+    while (tx_head != tx_tail && !U1STAbits.UTXBF) {
         U1TXREG = tx_buffer[tx_tail];   // this will raise the flag again
-        tx_tail = (tx_tail + 1) % TX_BUFFER_SIZE;  
+        tx_tail = (tx_tail + 1) & TX_BUFFER_MASK;
     }
 
     if (tx_head == tx_tail) {
         IEC0bits.U1TXIE = 0;
     }
+    ISR_PROFILE_END(ISR_UART_TX);
 }
 /*========================================================*/
  
@@ -185,26 +573,64 @@ void __attribute__((interrupt, no_auto_psv)) _U1TXInterrupt(void) {
 */
 /*========================================================*/
 void __attribute__((interrupt, no_auto_psv)) _U1RXInterrupt(void) {
+    ISR_PROFILE_BEGIN();
     IFS0bits.U1RXIF = 0; // Clear the interrupt flag 
-    if (U1STAbits.OERR) U1STAbits.OERR = 0;
 
-    char received = U1RXREG;
+    // Empty the hardware FIFO
+    while (U1STAbits.URXDA) {
+        // FERR/PERR describe the character at the top of the FIFO
+        if (U1STAbits.FERR || U1STAbits.PERR) {
+            if (U1STAbits.FERR) rx_framing_errors++;
+            else rx_parity_errors++;
+            (void) U1RXREG; // drop the character and the line it belongs to
+            rx_idx = 0;
+            rx_discard = 1;
+            rx_overflow = 0;
+            continue;
+        }
 
-    // Command buffer handling
-    if (received == '\r' || received == '\n') {
-        if (rx_idx > 0) {
-            temp_rx_buffer[rx_idx] = '\0';
+        char received = U1RXREG;
 
-            uint8_t next_write = (rx_write_index + 1) % RX_BUFFER_COUNT;
-            if (next_write != rx_read_index) {
-                strncpy((char*) rxBuffer[rx_write_index], (const char*) temp_rx_buffer, RX_STRING_LENGTH);
-                rx_write_index = next_write;
+        // Command queue handling
+        if (received == '\r' || received == '\n') {
+            if (rx_discard && rx_overflow) {
+                rx_queue.dropped++;
+                recorder_log(EV_RX_OVERFLOW, rx_overflow - 1, rx_queue.dropped);
+            } else if (rx_idx > 0 && !rx_discard) {
+                rx_queue.data[(rx_queue.head + rx_idx) & RX_RING_MASK] = '\0';
+                rx_queue.head = (rx_queue.head + rx_idx + 1) & RX_RING_MASK;
             }
             rx_idx = 0;
+            rx_discard = 0;
+            rx_overflow = 0;
+        }
+        else if (rx_discard) {
+            // skip up to the end of the line
+        }
+        else if (((rx_queue.head - rx_queue.tail) & RX_RING_MASK) + rx_idx + 2 > RX_RING_SIZE - 1) {
+            // room for this character and the NUL, one byte stays free:
+            // a full queue drops the new line
+            rx_discard = 1;
+            rx_overflow = REC_RX_QUEUE_FULL + 1;
+        }
+        else if (rx_idx < RX_STRING_LENGTH - 1) {
+            rx_queue.data[(rx_queue.head + rx_idx++) & RX_RING_MASK] = received;
+        }
+        else {
+            // a truncated command could be executed with wrong values
+            rx_discard = 1;
+            rx_overflow = REC_RX_TOO_LONG + 1;
         }
     }
-    else if (rx_idx < RX_STRING_LENGTH - 1) {
-        temp_rx_buffer[rx_idx++] = received;
+    // An overrun lost characters after the FIFO content read above,
+    // clearing OERR resets the FIFO
+    if (U1STAbits.OERR) {
+        rx_overruns++;
+        U1STAbits.OERR = 0;
+        rx_idx = 0;
+        rx_discard = 1;
+        rx_overflow = 0;
     }
+    ISR_PROFILE_END(ISR_UART_RX);
 }
 /*========================================================*/
\ No newline at end of file
@@ -18,24 +18,39 @@
 #include <stdlib.h>
 
 /* Baud Rate Configuration */
+// The link starts at the BAUD parameter (params.h), BAUDRATE is its
+// default value. At runtime the rate only changes through $PCBDR: a
+// new BAUD value takes effect at the next boot. The UART runs in high speed mode
+// (BRGH = 1, 4 clocks per bit) so rates up to UART_MAX_BAUD are
+// reachable; a rate is accepted if the divider error stays within
+// UART_BAUD_MAX_ERROR per mille.
 #define FCY             72000000
 #define BAUDRATE        9600
-#define BRGVAL          ((FCY/BAUDRATE)/16)-1
+#define UART_MAX_BAUD   1000000
+#define UART_BAUD_MAX_ERROR 20
+// Time the PC has to confirm a new rate ($PCBOK) before the robot
+// falls back to the previous one
+#define UART_BAUD_CONFIRM_MS 1000
 
 /* Buffer Sizes */
 
 /* Command Buffer Configuration */
 
-// All these messages are sent by the robot to the PC
-// $MBATT,v_batt* at 1Hz
-// $MDIST,distance* at 10Hz
-// $MACC,x,y,z* at 10Hz
-// $MACK,1* (Acknowledgment of command success)
-// $MACK,0* (Acknowledgment of command failure)
-// $MEMRG,1* (Emergency state)
-// $MEMRG,0* (End Emergency state)
+// Every message exchanged with the PC ($M... sent by the robot, $PC...
+// commands sent to it, each command may end with "#seq" before the '*')
+// is described in tools/messages.schema with its fields, ranges and
+// default rate. messages.h/.c are generated from it by tools/msggen.py.
 // While UART send at 3.2 Mhz
-#define RX_BUFFER_COUNT 8   // Buffer 8 commands
+// Received lines are stored back to back with their NUL in a byte ring,
+// so a short command does not take a whole RX_STRING_LENGTH slot: 7
+// sequenced $PCREF (17 bytes each) or 14 $PCSTP,* fit at the same time.
+#define RX_RING_SIZE 128 // power of two, at most 256
+
+// Per tick command budget: at most UART_CMD_MAX_PER_TICK commands, and
+// no new one once UART_CMD_BUDGET_CYCLES (10% of the 2ms tick) are used.
+// The rest waits in the queue for the next tick.
+#define UART_CMD_MAX_PER_TICK 4
+#define UART_CMD_BUDGET_CYCLES 14400
 
 // We chose 32 bytes for the max string length
 // This is enough for our commands, the longest theoretical command is:
@@ -49,13 +64,40 @@
 // This message is the longest that you can send : $PCREF,-100,-100* 
 // It's 17 characters long, so 128 bytes can hold at least 7 full messages
 // It's more than enough for our needs.
-#define TX_BUFFER_SIZE 128
+#define TX_BUFFER_SIZE 128 // power of two, at most 256
 
 
 /* Public Function Declarations */
 void UART_Initialize(void);
-void UART_SendString(const char *str);
+int UART_SendString(const char *str);
+uint16_t UART_TxFree(void);
+uint16_t UART_TxPeak(void);
+// TX buffer and shift register both empty.
+int UART_TxIdle(void);
+// U1BRG value for a baud rate in high speed mode, 0 if the rate is not
+// supported (out of range or divider error above UART_BAUD_MAX_ERROR).
+uint16_t UART_BaudBrg(uint32_t baud);
+// Rate the link is using now.
+uint32_t UART_Baud(void);
+// Starts a rate change: once the TX buffer has drained (the
+// acknowledgement included) the UART switches to the new rate and waits
+// UART_BAUD_CONFIRM_MS for $PCBOK, otherwise it returns to the old rate.
+// Returns 1 if the rate is supported and no change is in progress.
+int UART_RequestBaud(uint32_t baud);
+// Commits the rate under trial. Returns 0 if no change is in progress.
+int UART_ConfirmBaud(void);
+// Advances the rate change, called once per main loop tick.
+void UART_BaudTick(void);
+// Sends the $MLNK report with the RX error counters since boot.
+void UART_ReportLink(void);
 void process_uart_command(const char *input);
-void process_pcref_command(const char *command);
+// Runs the queued commands within the tick budget, coalescing
+// consecutive $PCREF to the newest one. Returns the number processed.
+int UART_ProcessCommands(void);
+int process_pcref_command(const char *command);
+int process_pctrj_command(const char *command);
+int process_pcsub_command(const char *command);
+int process_param_command(const char *command);
+int process_pcbdr_command(const char *command);
 
 #endif	/* UART_H */
\ No newline at end of file
@@ -0,0 +1,431 @@
+/* ===============================================================
+ * File: update.c                                                =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+/*================================================================*/
+#include "update.h"
+#include "uart.h"
+#include "pwm.h"
+#include "state.h"
+#include "messages.h"
+/*================================================================*/
+
+/*================================================================*/
+// LZSS format, keep tools/fw_update.c in sync: a flag byte announces the
+// next 8 items, LSB first. Flag 1: one literal byte. Flag 0: a match of
+// 2 bytes, offset (12 bits, 1 .. 4095 bytes back) low byte first, then
+// the offset high nibble in bits 7..4 and length - UPD_LZ_MIN_MATCH in bits 3..0.
+#define UPD_LZ_MIN_MATCH 3
+
+#define UPD_BYTE_TIMEOUT_MS 100 // gap inside a frame that drops the frame
+#define UPD_TICK_MS 2 // TIMER1 period, polled while the interrupts are masked
+/*================================================================*/
+
+/*================================================================*/
+// Staging and control pages, reserved at fixed addresses and never
+// loaded by the programmer. The staging area is split in chunks to keep
+// each object below the 32 KB object size limit.
+#define UPD_CHUNK_PAGES 10
+#define UPD_RESERVE_CHUNK(n) \
+    static const uint16_t __attribute__((space(prog), noload, unused, \
+    address(UPD_STAGING_BASE + (uint32_t) (n) * UPD_CHUNK_PAGES * FLASH_PAGE_ADDRESSES))) \
+    upd_staging_##n[UPD_CHUNK_PAGES * FLASH_PAGE_WORDS]
+
+UPD_RESERVE_CHUNK(0);
+UPD_RESERVE_CHUNK(1);
+UPD_RESERVE_CHUNK(2);
+UPD_RESERVE_CHUNK(3); // UPD_MAX_PAGES / UPD_CHUNK_PAGES chunks
+
+static const uint16_t __attribute__((space(prog), noload, unused, address(UPD_CONTROL_BASE)))
+upd_control[FLASH_PAGE_WORDS];
+/*================================================================*/
+
+/*================================================================*/
+static volatile uint8_t update_requested = 0;
+static uint16_t upd_pages = 0; // pages of the image announced by UPD_HELLO, 0 = no session
+static uint16_t upd_image_crc = 0;
+static uint16_t upd_silence_ms = 0; // time since the last byte received
+static uint8_t upd_frame[UPD_MAX_PAYLOAD]; // payload of the last frame
+static uint8_t upd_page[UPD_PAGE_BYTES]; // decompressed page
+/*================================================================*/
+
+/*================================================================*/
+// CRC-16/CCITT (poly 0x1021, init 0xFFFF) over bytes, MSB first
+/*================================================================*/
+static uint16_t upd_crc16(uint16_t crc, uint8_t byte) {
+    int i;
+    crc ^= (uint16_t) byte << 8;
+    for (i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+}
+/*================================================================*/
+
+/*================================================================*/
+static uint32_t upd_control_address(uint16_t word) {
+    return UPD_CONTROL_BASE + (uint32_t) word * 2;
+}
+/*================================================================*/
+
+/*================================================================*/
+static uint32_t upd_staging_address(uint16_t page) {
+    return UPD_STAGING_BASE + (uint32_t) page * FLASH_PAGE_ADDRESSES;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Marker of a staged page: UPD_PAGE_MAGIC, UPD_BLANK_MAGIC or erased
+/*================================================================*/
+static uint16_t upd_page_marker(uint16_t page) {
+    return flash_read_word(upd_control_address(UPD_CTRL_PAGES + 2 * page));
+}
+/*================================================================*/
+
+/*================================================================*/
+static int upd_page_staged(uint16_t page) {
+    uint16_t marker = upd_page_marker(page);
+    return marker == UPD_PAGE_MAGIC || marker == UPD_BLANK_MAGIC;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Polled UART1, the TIMER1 flag keeps the time while interrupts are masked
+/*================================================================*/
+static void upd_poll_time(void) {
+    if (IFS0bits.T1IF) {
+        IFS0bits.T1IF = 0;
+        if (upd_silence_ms < 0xFFFF - UPD_TICK_MS) {
+            upd_silence_ms += UPD_TICK_MS;
+        }
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+// Next received byte, -1 after timeout_ms without any
+/*================================================================*/
+static int upd_read_byte(uint16_t timeout_ms) {
+    upd_silence_ms = 0;
+    while (upd_silence_ms < timeout_ms) {
+        if (U1STAbits.OERR) {
+            U1STAbits.OERR = 0; // the frame CRC catches the lost bytes
+        }
+        if (U1STAbits.URXDA) {
+            return U1RXREG & 0xFF;
+        }
+        upd_poll_time();
+    }
+    return -1;
+}
+/*================================================================*/
+
+/*================================================================*/
+static void upd_write_byte(uint8_t byte) {
+    while (U1STAbits.UTXBF);
+    U1TXREG = byte;
+}
+/*================================================================*/
+
+/*================================================================*/
+static void upd_send_frame(uint8_t type, uint16_t page, const uint8_t *payload, uint16_t length) {
+    uint16_t crc = 0xFFFF;
+    uint8_t header[5];
+    uint16_t i;
+
+    header[0] = type;
+    header[1] = page & 0xFF;
+    header[2] = page >> 8;
+    header[3] = length & 0xFF;
+    header[4] = length >> 8;
+    upd_write_byte(UPD_SYNC);
+    for (i = 0; i < sizeof(header); i++) {
+        crc = upd_crc16(crc, header[i]);
+        upd_write_byte(header[i]);
+    }
+    for (i = 0; i < length; i++) {
+        crc = upd_crc16(crc, payload[i]);
+        upd_write_byte(payload[i]);
+    }
+    upd_write_byte(crc & 0xFF);
+    upd_write_byte(crc >> 8);
+}
+/*================================================================*/
+
+/*================================================================*/
+static void upd_send_ack(uint16_t page, uint8_t status) {
+    upd_send_frame(UPD_ACK, page, &status, 1);
+}
+/*================================================================*/
+
+/*================================================================*/
+// UPD_STATUS: the current session and one bit per staged page
+/*================================================================*/
+static void upd_send_status(void) {
+    uint8_t status[4 + (UPD_MAX_PAGES + 7) / 8];
+    uint16_t page;
+
+    memset(status, 0, sizeof(status));
+    status[0] = upd_pages & 0xFF;
+    status[1] = upd_pages >> 8;
+    status[2] = upd_image_crc & 0xFF;
+    status[3] = upd_image_crc >> 8;
+    for (page = 0; page < upd_pages; page++) {
+        if (upd_page_staged(page)) {
+            status[4 + page / 8] |= 1 << (page % 8);
+        }
+    }
+    upd_send_frame(UPD_STATUS, 0, status, sizeof(status));
+}
+/*================================================================*/
+
+/*================================================================*/
+// Waits for a complete frame. Returns its type, 0 for a corrupted frame
+// or -1 after UPD_TIMEOUT_MS of silence.
+/*================================================================*/
+static int upd_receive_frame(uint16_t *page, uint16_t *length) {
+    uint8_t header[5];
+    uint16_t crc = 0xFFFF;
+    uint16_t i;
+    int byte;
+
+    do {
+        byte = upd_read_byte(UPD_TIMEOUT_MS);
+        if (byte < 0) return -1;
+    } while (byte != UPD_SYNC);
+
+    for (i = 0; i < sizeof(header); i++) {
+        if ((byte = upd_read_byte(UPD_BYTE_TIMEOUT_MS)) < 0) return 0;
+        header[i] = byte;
+        crc = upd_crc16(crc, header[i]);
+    }
+    *page = header[1] | (uint16_t) header[2] << 8;
+    *length = header[3] | (uint16_t) header[4] << 8;
+    if (*length > UPD_MAX_PAYLOAD) return 0;
+
+    for (i = 0; i < *length; i++) {
+        if ((byte = upd_read_byte(UPD_BYTE_TIMEOUT_MS)) < 0) return 0;
+        upd_frame[i] = byte;
+        crc = upd_crc16(crc, upd_frame[i]);
+    }
+    for (i = 0; i < 2; i++) {
+        if ((byte = upd_read_byte(UPD_BYTE_TIMEOUT_MS)) < 0) return 0;
+        crc ^= (uint16_t) byte << (8 * i);
+    }
+    return crc == 0 ? header[0] : 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Expands one LZSS block into upd_page, 1 if it gives exactly one page
+/*================================================================*/
+static int upd_decompress(const uint8_t *in, uint16_t in_length) {
+    uint16_t in_pos = 0;
+    uint16_t out_pos = 0;
+
+    while (in_pos < in_length) {
+        uint8_t flags = in[in_pos++];
+        int item;
+        for (item = 0; item < 8 && in_pos < in_length; item++, flags >>= 1) {
+            if (flags & 1) {
+                if (out_pos >= UPD_PAGE_BYTES) return 0;
+                upd_page[out_pos++] = in[in_pos++];
+            } else {
+                uint16_t offset, count;
+                if (in_pos + 2 > in_length) return 0;
+                offset = in[in_pos] | (uint16_t) (in[in_pos + 1] & 0xF0) << 4;
+                count = (in[in_pos + 1] & 0x0F) + UPD_LZ_MIN_MATCH;
+                in_pos += 2;
+                if (offset == 0 || offset > out_pos || out_pos + count > UPD_PAGE_BYTES) return 0;
+                while (count--) {
+                    upd_page[out_pos] = upd_page[out_pos - offset];
+                    out_pos++;
+                }
+            }
+        }
+    }
+    return out_pos == UPD_PAGE_BYTES;
+}
+/*================================================================*/
+
+/*================================================================*/
+static uint32_t upd_page_instruction(uint16_t index) {
+    const uint8_t *bytes = &upd_page[index * 3];
+    return bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16;
+}
+/*================================================================*/
+
+/*================================================================*/
+// UPD_HELLO: resumes the session of the same image or starts a new one
+/*================================================================*/
+static uint8_t upd_hello(uint16_t length) {
+    uint16_t pages, crc;
+
+    if (length != 4) return UPD_ERR_FRAME;
+    pages = upd_frame[0] | (uint16_t) upd_frame[1] << 8;
+    crc = upd_frame[2] | (uint16_t) upd_frame[3] << 8;
+    if (pages == 0 || pages > UPD_MAX_PAGES) return UPD_ERR_SESSION;
+
+    if (flash_read_word(upd_control_address(UPD_CTRL_SESSION)) != UPD_SESSION_MAGIC ||
+            flash_read_word(upd_control_address(UPD_CTRL_SESSION + 1)) != pages ||
+            flash_read_word(upd_control_address(UPD_CTRL_SESSION + 2)) != crc) {
+        // Another image: forget the staged pages
+        flash_erase_page(UPD_CONTROL_BASE);
+        flash_write_dword(upd_control_address(UPD_CTRL_SESSION), UPD_SESSION_MAGIC, pages);
+        flash_write_dword(upd_control_address(UPD_CTRL_SESSION + 2), crc, ~crc);
+    }
+    upd_pages = pages;
+    upd_image_crc = crc;
+    return UPD_OK;
+}
+/*================================================================*/
+
+/*================================================================*/
+// UPD_BLOCK: decompress, check, program and verify one staging page
+/*================================================================*/
+static uint8_t upd_block(uint16_t page, uint16_t length) {
+    uint16_t expected, crc = 0xFFFF;
+    uint16_t i;
+    int blank = (length == 2);
+    uint32_t address = upd_staging_address(page);
+
+    if (upd_pages == 0 || page >= upd_pages || length < 2) return UPD_ERR_SESSION;
+    if (upd_page_staged(page)) return UPD_OK; // our acknowledgement was lost
+
+    expected = upd_frame[0] | (uint16_t) upd_frame[1] << 8;
+    if (blank) {
+        if (page == 0) return UPD_ERR_DATA; // holds the reset vector
+        memset(upd_page, 0xFF, sizeof(upd_page));
+    } else if (!upd_decompress(&upd_frame[2], length - 2)) {
+        return UPD_ERR_DATA;
+    }
+    for (i = 0; i < UPD_PAGE_BYTES; i++) {
+        crc = upd_crc16(crc, upd_page[i]);
+    }
+    if (crc != expected) return UPD_ERR_DATA;
+
+    if (!blank) {
+        flash_erase_page(address);
+        for (i = 0; i < FLASH_PAGE_WORDS; i += 2) {
+            flash_write_instructions(address + 2 * i, upd_page_instruction(i), upd_page_instruction(i + 1));
+        }
+        for (i = 0; i < FLASH_PAGE_WORDS; i++) {
+            if (flash_read_instruction(address + 2 * i) != upd_page_instruction(i)) return UPD_ERR_FLASH;
+        }
+    }
+    flash_write_dword(upd_control_address(UPD_CTRL_PAGES + 2 * page),
+            blank ? UPD_BLANK_MAGIC : UPD_PAGE_MAGIC, crc);
+    return UPD_OK;
+}
+/*================================================================*/
+
+/*================================================================*/
+// UPD_COMMIT: every page staged and the whole image matches its CRC,
+// then request the swap
+/*================================================================*/
+static uint8_t upd_commit(void) {
+    uint16_t crc = 0xFFFF;
+    uint16_t page, i;
+
+    if (upd_pages == 0) return UPD_ERR_SESSION;
+    for (page = 0; page < upd_pages; page++) {
+        uint32_t address = upd_staging_address(page);
+        int blank;
+        if (!upd_page_staged(page)) return UPD_ERR_MISSING;
+        blank = upd_page_marker(page) == UPD_BLANK_MAGIC;
+        for (i = 0; i < FLASH_PAGE_WORDS; i++) {
+            uint32_t instruction = blank ? 0xFFFFFF : flash_read_instruction(address + 2 * i);
+            crc = upd_crc16(crc, instruction & 0xFF);
+            crc = upd_crc16(crc, (instruction >> 8) & 0xFF);
+            crc = upd_crc16(crc, (instruction >> 16) & 0xFF);
+        }
+    }
+    if (crc != upd_image_crc) return UPD_ERR_MISSING;
+
+    flash_write_dword(upd_control_address(UPD_CTRL_SWAP), UPD_SWAP_MAGIC, upd_image_crc);
+    return UPD_OK;
+}
+/*================================================================*/
+
+/*================================================================*/
+int update_request(void) {
+    if (state_get() != STATE_WAIT_FOR_START) return 0;
+    update_requested = 1;
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+int update_pending(void) {
+    return update_requested;
+}
+/*================================================================*/
+
+/*================================================================*/
+void update_run(void) {
+    uint16_t saved_ipl;
+    int done = 0;
+    char message[MSG_MUPD_SIZE];
+
+    update_requested = 0;
+    set_motor_pwm(0, 0);
+    while (!UART_TxIdle()); // $MACK,1* goes out through the TX interrupt
+
+    // Polled from now on: no interrupt may run while the flash stalls the CPU
+    saved_ipl = SRbits.IPL;
+    SRbits.IPL = 7;
+    upd_pages = 0;
+
+    while (!done) {
+        uint16_t page = 0, length = 0;
+        int type = upd_receive_frame(&page, &length);
+        uint8_t status;
+
+        switch (type) {
+            case -1: // PC gone
+                done = 1;
+                break;
+            case UPD_HELLO:
+                status = upd_hello(length);
+                if (status == UPD_OK) {
+                    upd_send_status();
+                } else {
+                    upd_send_ack(0, status);
+                }
+                break;
+            case UPD_QUERY:
+                upd_send_status();
+                break;
+            case UPD_BLOCK:
+                upd_send_ack(page, upd_block(page, length));
+                break;
+            case UPD_COMMIT:
+                status = upd_commit();
+                upd_send_ack(0, status);
+                if (status == UPD_OK) {
+                    while (!U1STAbits.TRMT);
+                    asm("RESET"); // boot_check() runs the swap
+                }
+                break;
+            case UPD_ABORT:
+                upd_send_ack(0, UPD_OK);
+                done = 1;
+                break;
+            default:
+                upd_send_ack(page, UPD_ERR_FRAME);
+                break;
+        }
+    }
+
+    while (!U1STAbits.TRMT);
+    IFS0bits.U1RXIF = 0;
+    SRbits.IPL = saved_ipl;
+    msg_encode_mupd(message, 0);
+    UART_SendString(message);
+}
+/*================================================================*/
@@ -0,0 +1,106 @@
+/* ===============================================================
+ * File: update.h                                                =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * ===============================================================*/
+
+#ifndef UPDATE_H
+#define UPDATE_H
+
+#include <xc.h>
+#include <stdint.h>
+#include "flash.h"
+
+// Firmware update over UART1, no programmer needed.
+//
+// $PCUPD,* (wait state only) switches the robot into update mode: motors
+// stopped, all interrupts masked, UART1 polled with binary frames
+//   UPD_SYNC, type, page (2 bytes LE), length (2 bytes LE), payload,
+//   CRC-16/CCITT of type .. payload (2 bytes LE)
+// Every frame from the PC is answered before the next one is sent, so
+// the flash operations never lose received bytes.
+//
+// The new image is written to a staging area first, one flash page per
+// UPD_BLOCK frame. A block carries the CRC of the page followed by the
+// page compressed with LZSS (see update.c), a block without data is an
+// erased page. Each verified page is marked in the control page, so a
+// dropped link resumes with the missing pages only (same image CRC).
+// UPD_COMMIT checks the whole staged image and requests the swap, which
+// boot.c runs at the next reset. tools/fw_update.c is the sender.
+// The image CRC covers the staged image, blank pages counted as 0xFFFFFF.
+// It does not describe the application flash after the swap: blank pages
+// are not copied (see below). The swap reads back every copied page.
+//
+// A page that is all 0xFFFFFF in the new image (page 0 excepted) is sent
+// as a blank block: upd_block only marks it and the swap does not touch
+// the application page, which keeps its old contents, stale code
+// included. This is what keeps the saved parameters (params.c) across an
+// update, param_page being noload and so blank in every image.
+// param_page is found through its link address: when the new image moves
+// it, the records at the old address are no longer read and params_init
+// finds no valid record at the new one, so the robot runs on the
+// defaults until the next save (which erases the new page first if it
+// held old code). Set the parameters again after such an update.
+//
+// Flash map (program addresses), the application must fit in the first
+// UPD_MAX_PAGES pages:
+//   0x000000 application            UPD_MAX_PAGES pages
+//   UPD_STAGING_BASE staging        UPD_MAX_PAGES pages
+//   UPD_CONTROL_BASE control page   session, page markers, swap progress
+//   BOOT_BASE resident swap code    never updated (see boot.h)
+#define UPD_MAX_PAGES 40
+#define UPD_STAGING_BASE ((uint32_t) UPD_MAX_PAGES * FLASH_PAGE_ADDRESSES)
+#define UPD_CONTROL_BASE (2 * UPD_STAGING_BASE)
+#define UPD_PAGE_BYTES (FLASH_PAGE_WORDS * 3) // 24-bit instructions, low byte first
+
+// Frame types, keep tools/fw_update.c in sync
+#define UPD_SYNC 0xA5
+#define UPD_HELLO 1 // PC: pages (2), image CRC (2). Robot: UPD_STATUS
+#define UPD_BLOCK 2 // PC: page CRC (2), compressed page. Robot: UPD_ACK
+#define UPD_QUERY 3 // PC: no payload. Robot: UPD_STATUS
+#define UPD_COMMIT 4 // PC: no payload. Robot: UPD_ACK, then resets on success
+#define UPD_ABORT 5 // PC: no payload. Robot: UPD_ACK, back to the application
+#define UPD_ACK 0x81 // Robot: status (1), page field = page concerned
+#define UPD_STATUS 0x82 // Robot: pages (2), image CRC (2), bitmap of the staged pages
+
+// Status of an UPD_ACK
+#define UPD_OK 0
+#define UPD_ERR_FRAME 1 // bad frame CRC or length
+#define UPD_ERR_SESSION 2 // no UPD_HELLO yet, or page out of the image
+#define UPD_ERR_DATA 3 // decompression failed or page CRC mismatch
+#define UPD_ERR_FLASH 4 // read back differs from the page
+#define UPD_ERR_MISSING 5 // commit with pages still missing or bad image CRC
+
+#define UPD_MAX_PAYLOAD (2 + UPD_PAGE_BYTES + UPD_PAGE_BYTES / 8 + 8) // LZSS worst case
+#define UPD_TIMEOUT_MS 30000 // silence after which the robot leaves update mode
+
+// Control page layout, in 16-bit words (lower word of each instruction)
+#define UPD_CTRL_SESSION 0 // magic, pages, image CRC, ~image CRC
+#define UPD_CTRL_PAGES 4 // two words per page: marker, page CRC
+#define UPD_CTRL_SWAP (UPD_CTRL_PAGES + 2 * UPD_MAX_PAGES) // magic, image CRC
+#define UPD_CTRL_STUB (UPD_CTRL_SWAP + 2) // magic, 0: reset vector points to the boot code
+#define UPD_CTRL_COPIED (UPD_CTRL_STUB + 2) // two words per page: magic, page
+#define UPD_SESSION_MAGIC 0xB007
+#define UPD_PAGE_MAGIC 0x5A5A
+#define UPD_BLANK_MAGIC 0x5A00 // erased page, nothing to copy
+#define UPD_SWAP_MAGIC 0x5AFE
+#define UPD_STUB_MAGIC 0x57B0
+#define UPD_COPIED_MAGIC 0xC0DE
+
+// Accepts the update request, only while waiting for start.
+// Returns 0 in any other state.
+int update_request(void);
+
+// Non-zero once an update was requested, checked by the main loop
+// after the acknowledgement has been queued.
+int update_pending(void);
+
+// Runs update mode until the PC aborts or goes silent for
+// UPD_TIMEOUT_MS, then returns to the application with the interrupts
+// restored. Does not return after a successful commit (reset).
+void update_run(void);
+
+#endif /* UPDATE_H */
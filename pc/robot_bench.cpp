@@ -0,0 +1,428 @@
+// ===============================================================
+// File: robot_bench.cpp
+// Author: group 1
+// Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+// Runs robot_client.hpp against a stand-in robot on a pty: a child
+// process that answers like the firmware (500 Hz tick, at most
+// UART_CMD_MAX_PER_TICK commands per tick, one $MACKS per tick,
+// $PCREF/$PCSTT/$PCSTP/$PCSUB/$PCSYN, DIST/BATT/ACC telemetry, an
+// emergency when the distance drops below 20 cm) with the bytes
+// paced at the UART rate and optionally lost.
+//   --check   scripted session, exits non-zero on a wrong result
+//   default   commands per second and latency per operation, one
+//             command at a time and with the window full
+// Build: g++ -std=c++20 -O2 -o robot_bench robot_bench.cpp
+// Usage: robot_bench [--check] [--baud 115200] [--loss 0.05]
+//                    [--count 2000]
+// ===============================================================
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <signal.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+
+#include "robot_client.hpp"
+
+using namespace std::chrono_literals;
+using robot::Clock;
+using robot::Status;
+using robot::Task;
+namespace msg = robot::msg;
+
+namespace {
+
+struct Options {
+    bool check = false;
+    int baud = 115200;
+    double loss = 0.0;
+    int count = 2000;
+    int hold_ms = 500; // the firmware default is 5000 ms (EMRG_HOLD)
+};
+
+// ---------------------------------------------------------------
+// Stand-in robot, mirrors uart.c, ack.c, telemetry.c and main.c
+// ---------------------------------------------------------------
+class StandIn {
+public:
+    StandIn(int fd, const Options &options)
+        : fd_(fd), options_(options), random_(12345),
+          bytes_per_tick_(std::max(1, options.baud / 10 / TICK_HZ)) {}
+
+    void run() {
+        Clock::time_point next = Clock::now();
+        for (;;) {
+            next += std::chrono::microseconds(1000000 / TICK_HZ);
+            if (!receive()) return;
+            process_commands();
+            update_model();
+            flush_acks();
+            send_telemetry();
+            if (!transmit()) return;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+private:
+    static constexpr int TICK_HZ = 500;
+    static constexpr std::size_t QUEUE_BYTES = 127; // RX_RING_SIZE - 1, a line takes its length + 1
+    static constexpr int MAX_PER_TICK = 4;       // UART_CMD_MAX_PER_TICK
+    static constexpr std::size_t TX_BUFFER = 128; // uart.c tx_buffer
+    enum class State { wait, moving, emergency };
+
+    // At most one tick worth of bytes, the rest waits in the pty
+    bool receive() {
+        char buffer[256];
+        ssize_t n = ::read(fd_, buffer, std::min<std::size_t>(sizeof(buffer), bytes_per_tick_));
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) return false;
+        for (ssize_t i = 0; i < n; i++) {
+            char c = buffer[i];
+            if (c == '$') line_.clear();
+            if (c == '\r' || c == '\n') continue;
+            if (line_.size() < 31) line_ += c;
+            if (c != '*') continue;
+            if (lost()) continue; // corrupted on the wire
+            if (queue_bytes_ + line_.size() + 1 <= QUEUE_BYTES) {
+                queue_bytes_ += line_.size() + 1;
+                queue_.push_back(line_);
+            }
+            line_.clear();
+        }
+        return true;
+    }
+
+    void process_commands() {
+        for (int i = 0; i < MAX_PER_TICK && !queue_.empty(); i++) {
+            std::string line = std::move(queue_.front());
+            queue_.pop_front();
+            queue_bytes_ -= line.size() + 1;
+            execute(line);
+        }
+    }
+
+    void execute(const std::string &line) {
+        int seq = -1;
+        std::optional<msg::PcCommand> command = msg::decode_pc(line, &seq);
+        if (seq >= 0 && ack_is_duplicate(seq)) return;
+        bool ok = false;
+        if (!command) {
+            send(msg::Err{"Unknown command"});
+        } else if (std::holds_alternative<msg::Pcref>(*command)) {
+            const auto &pcref = std::get<msg::Pcref>(*command);
+            speed_ = pcref.speed;
+            yawrate_ = pcref.yawrate;
+            ok = true;
+        } else if (std::holds_alternative<msg::Pcstt>(*command)) {
+            ok = state_ != State::emergency;
+            if (ok) state_ = State::moving;
+        } else if (std::holds_alternative<msg::Pcstp>(*command)) {
+            ok = state_ != State::emergency;
+            if (ok) state_ = State::wait;
+        } else if (std::holds_alternative<msg::Pcsyn>(*command)) {
+            ack_seen_ = false;
+            acks_dirty_ = false;
+            seq = -1;
+            ok = true;
+        } else if (std::holds_alternative<msg::Pcsub>(*command)) {
+            const auto &pcsub = std::get<msg::Pcsub>(*command);
+            for (Telemetry &t : telemetry_) {
+                if (pcsub.stream == t.name) {
+                    t.hz = pcsub.hz;
+                    ok = true;
+                }
+            }
+            if (ok) send(msg::Msub{pcsub.stream, pcsub.hz});
+        } else {
+            ok = true;
+        }
+
+        if (seq < 0) {
+            send(msg::Mack{std::uint8_t(ok)});
+            return;
+        }
+        ack_record(seq, ok);
+    }
+
+    // ack.c
+    bool ack_is_duplicate(int seq) {
+        if (!ack_seen_) return false;
+        int diff = std::int8_t(seq - ack_top_);
+        if (diff > 0) return false;
+        if (-diff >= 16 || ((ack_rx_mask_ >> -diff) & 1)) {
+            acks_dirty_ = true; // resent because our $MACKS was lost
+            return true;
+        }
+        return false;
+    }
+
+    void ack_record(int seq, bool ok) {
+        int diff = std::int8_t(seq - ack_top_);
+        if (!ack_seen_) {
+            ack_seen_ = true;
+            ack_top_ = seq;
+            ack_rx_mask_ = ack_ok_mask_ = 0;
+            diff = 0;
+        } else if (diff > 0) {
+            ack_rx_mask_ = diff >= 16 ? 0 : std::uint16_t(ack_rx_mask_ << diff);
+            ack_ok_mask_ = diff >= 16 ? 0 : std::uint16_t(ack_ok_mask_ << diff);
+            ack_top_ = seq;
+            diff = 0;
+        } else if (-diff >= 16) {
+            return;
+        }
+        std::uint16_t bit = std::uint16_t(1u << -diff);
+        ack_rx_mask_ |= bit;
+        ack_ok_mask_ = ok ? (ack_ok_mask_ | bit) : (ack_ok_mask_ & ~bit);
+        acks_dirty_ = true;
+    }
+
+    // Drives towards the obstacle at the commanded speed (100 % = 50 cm/s)
+    void update_model() {
+        ticks_++;
+        if (state_ == State::moving) {
+            distance_ -= speed_ * 0.5 / TICK_HZ;
+            if (distance_ < 20.0) {
+                state_ = State::emergency;
+                emergency_ticks_ = 0;
+                send(msg::Memrg{1});
+            }
+        } else if (state_ == State::emergency && ++emergency_ticks_ >= options_.hold_ms * TICK_HZ / 1000) {
+            state_ = State::wait;
+            distance_ = 150.0; // obstacle removed
+            send(msg::Memrg{0});
+        }
+    }
+
+    void flush_acks() {
+        if (!acks_dirty_) return;
+        acks_dirty_ = false;
+        send(msg::Macks{std::uint16_t(ack_top_), ack_rx_mask_, ack_ok_mask_});
+    }
+
+    void send_telemetry() {
+        for (Telemetry &t : telemetry_) {
+            if (t.hz == 0 || ticks_ % (TICK_HZ / t.hz) != 0) continue;
+            if (t.name == std::string_view("DIST")) {
+                send(msg::Mdist{std::uint16_t(std::clamp(distance_, 0.0, 999.0))});
+            } else if (t.name == std::string_view("BATT")) {
+                send(msg::Mbatt{1180});
+            } else {
+                send(msg::Macc{std::int16_t(speed_ * 2), std::int16_t(yawrate_), -1000});
+            }
+        }
+    }
+
+    // UART_SendString: the message is dropped when tx_buffer is full
+    template <class M>
+    void send(const M &message) {
+        std::string line = msg::to_string(message);
+        if (tx_.size() + line.size() > TX_BUFFER) return;
+        if (!lost()) tx_ += line;
+    }
+
+    // At most one tick worth of bytes, like the UART at options.baud
+    bool transmit() {
+        std::size_t length = std::min(tx_.size(), bytes_per_tick_);
+        if (length == 0) return true;
+        ssize_t n = ::write(fd_, tx_.data(), length);
+        if (n < 0) return errno == EAGAIN || errno == EINTR;
+        tx_.erase(0, std::size_t(n));
+        return true;
+    }
+
+    bool lost() { return options_.loss > 0 && std::uniform_real_distribution<>(0, 1)(random_) < options_.loss; }
+
+    struct Telemetry {
+        const char *name;
+        int hz;
+    };
+
+    int fd_;
+    Options options_;
+    std::mt19937 random_;
+    std::size_t bytes_per_tick_;
+    std::string line_;
+    std::deque<std::string> queue_;
+    std::size_t queue_bytes_ = 0;
+    std::string tx_;
+    bool ack_seen_ = false;
+    std::uint8_t ack_top_ = 0;
+    std::uint16_t ack_rx_mask_ = 0;
+    std::uint16_t ack_ok_mask_ = 0;
+    bool acks_dirty_ = false;
+    State state_ = State::wait;
+    int speed_ = 0;
+    int yawrate_ = 0;
+    double distance_ = 150.0;
+    long ticks_ = 0;
+    int emergency_ticks_ = 0;
+    Telemetry telemetry_[3] = {{"DIST", 10}, {"BATT", 1}, {"ACC", 10}};
+};
+
+// Starts the stand-in on the slave side of a new pty, returns the master
+int spawn_stand_in(const Options &options, pid_t *child) {
+    int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || ::grantpt(master) != 0 || ::unlockpt(master) != 0) return -1;
+    int slave = ::open(::ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0) return -1;
+    termios tio{};
+    ::tcgetattr(slave, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(slave, TCSANOW, &tio);
+
+    *child = ::fork();
+    if (*child == 0) {
+        ::close(master);
+        ::fcntl(slave, F_SETFL, ::fcntl(slave, F_GETFL) | O_NONBLOCK);
+        StandIn(slave, options).run();
+        ::_exit(0);
+    }
+    ::close(slave);
+    return master;
+}
+
+// ---------------------------------------------------------------
+// Scripted session
+// ---------------------------------------------------------------
+int failures = 0;
+
+void expect(bool condition, const char *what) {
+    std::printf("%-48s %s\n", what, condition ? "ok" : "FAILED");
+    if (!condition) failures++;
+}
+
+Task<> check_session(robot::EventLoop &loop, robot::Client &bot) {
+    expect(co_await bot.connect() == Status::ok, "connect ($PCSYN)");
+    expect(co_await bot.setpoint(101, 0) == Status::invalid, "out of range setpoint not sent");
+    expect(co_await bot.subscribe("DIST", 50) == Status::ok, "subscribe DIST at 50 Hz");
+    expect(co_await bot.subscribe("NOPE", 5) == Status::rejected, "unknown stream rejected");
+    expect(co_await bot.subscribe("ACC", 0) == Status::ok, "ACC off");
+
+    bot.acceleration().clear();
+    std::optional<msg::Macc> acc = co_await bot.acceleration().next(300ms);
+    expect(!acc, "no ACC sample once off (timeout)");
+    std::optional<msg::Mbatt> batt = co_await bot.battery().next(1500ms);
+    expect(batt && batt->voltage == 1180, "battery sample");
+
+    expect(co_await bot.setpoint(100, 0) == Status::ok, "setpoint");
+    expect(co_await bot.start() == Status::ok, "start");
+    std::optional<msg::Memrg> emergency = co_await bot.emergency().next(5s);
+    expect(emergency && emergency->active == 1, "emergency in front of the obstacle");
+    expect(bot.distance().latest() && bot.distance().latest()->distance < 30, "distance stream followed it");
+    expect(co_await bot.start() == Status::rejected, "start refused in emergency");
+    emergency = co_await bot.emergency().next(5s);
+    expect(emergency && emergency->active == 0, "emergency left");
+
+    // A burst larger than the window: every command completes once
+    std::vector<Task<Status>> burst;
+    for (int i = 0; i < 40; i++) burst.push_back(bot.setpoint(i % 50, -i % 50));
+    std::vector<Status> results = co_await loop.when_all(std::move(burst));
+    int ok = int(std::count(results.begin(), results.end(), Status::ok));
+    expect(ok == 40, "40 setpoints through a 16 command window");
+    expect(co_await bot.stop() == Status::ok, "stop");
+}
+
+// ---------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------
+struct Latencies {
+    std::vector<double> ms;
+
+    void print(const char *name, Clock::duration total) const {
+        std::vector<double> sorted = ms;
+        std::sort(sorted.begin(), sorted.end());
+        auto at = [&](double q) { return sorted.empty() ? 0.0 : sorted[std::size_t(q * (sorted.size() - 1))]; };
+        double seconds = std::chrono::duration<double>(total).count();
+        std::printf("%-12s %8.0f cmd/s   p50 %6.2f ms   p99 %6.2f ms   max %6.2f ms\n", name,
+                    sorted.size() / seconds, at(0.5), at(0.99), sorted.empty() ? 0.0 : sorted.back());
+    }
+};
+
+Task<Status> timed_setpoint(robot::Client &bot, int i, Latencies &latencies) {
+    Clock::time_point t0 = Clock::now();
+    Status status = co_await bot.setpoint(i % 100, 0);
+    latencies.ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    co_return status;
+}
+
+Task<int> setpoint_worker(robot::Client &bot, int first, int count, Latencies &latencies) {
+    int failed = 0;
+    for (int i = 0; i < count; i++)
+        if (co_await timed_setpoint(bot, first + i, latencies) != Status::ok) failed++;
+    co_return failed;
+}
+
+Task<> bench_session(robot::EventLoop &loop, robot::Client &bot, const Options &options) {
+    if (co_await bot.connect() != Status::ok) {
+        std::printf("stand-in robot not answering\n");
+        failures++;
+        co_return;
+    }
+    for (const char *stream : {"DIST", "BATT", "ACC"}) co_await bot.subscribe(stream, 0);
+    int failed = 0;
+
+    // One command at a time, like blocking serial code waiting for each $MACK
+    Latencies sequential;
+    Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < options.count / 4; i++)
+        if (co_await timed_setpoint(bot, i, sequential) != Status::ok) failed++;
+    sequential.print("sequential", Clock::now() - t0);
+
+    // One worker per window slot keeps the window full
+    Latencies pipelined;
+    std::vector<Task<int>> workers;
+    int window = int(bot.options().window);
+    t0 = Clock::now();
+    for (int w = 0; w < window; w++) workers.push_back(setpoint_worker(bot, w, options.count / window, pipelined));
+    for (int worker_failed : co_await loop.when_all(std::move(workers))) failed += worker_failed;
+    pipelined.print("pipelined", Clock::now() - t0);
+
+    const robot::Client::Stats &stats = bot.stats();
+    std::printf("sent %u  retransmits %u  timeouts %u  failed %d\n", stats.sent, stats.retransmits,
+                stats.timeouts, failed);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--check")) options.check = true;
+        else if (!std::strcmp(argv[i], "--baud") && i + 1 < argc) options.baud = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--loss") && i + 1 < argc) options.loss = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--count") && i + 1 < argc) options.count = std::atoi(argv[++i]);
+        else {
+            std::fprintf(stderr, "usage: %s [--check] [--baud N] [--loss P] [--count N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (options.baud < 1200 || options.count < 4 || options.loss < 0 || options.loss >= 1) {
+        std::fprintf(stderr, "invalid option value\n");
+        return 1;
+    }
+
+    std::setvbuf(stdout, nullptr, _IOLBF, 0);
+    pid_t child;
+    int fd = spawn_stand_in(options, &child);
+    if (fd < 0) {
+        std::perror("pty");
+        return 1;
+    }
+    std::printf("stand-in robot at %d baud, %.0f %% of the lines lost\n", options.baud, options.loss * 100);
+    {
+        robot::EventLoop loop;
+        robot::ClientOptions client_options;
+        client_options.timeout = 3s;
+        robot::Client bot(loop, fd, client_options);
+        if (options.check) loop.run_until(check_session(loop, bot));
+        else loop.run_until(bench_session(loop, bot, options));
+    }
+    ::kill(child, SIGTERM);
+    ::waitpid(child, nullptr, 0);
+    if (options.check) std::printf("%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
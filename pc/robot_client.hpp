@@ -0,0 +1,782 @@
+// ===============================================================
+// File: robot_client.hpp
+// Author: group 1
+// Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+// Header-only C++20 client for the robot protocol, built on the
+// generated robot_messages.hpp.
+//
+// Everything runs on one thread: an EventLoop polls the file
+// descriptors (serial port, pty, socket) and resumes the coroutines
+// waiting on them. Commands are sent with a sequence number (see
+// ack.h) so several can be in flight; each one completes when a
+// $MACKS frame covers it, is resent while unacknowledged and times
+// out otherwise. Periodic messages are queued per stream.
+//
+//   robot::EventLoop loop;
+//   robot::Client bot(loop, robot::Client::open_serial("/dev/ttyUSB0", 115200));
+//   loop.run_until([&]() -> robot::Task<> {
+//       co_await bot.connect();
+//       co_await bot.start();
+//       co_await bot.setpoint(50, 0);
+//       while (auto d = co_await bot.distance().next(500ms))
+//           if (d->distance < 30) break;
+//       co_await bot.stop();
+//   }());
+//
+// Several clients can share one loop. pc/robot_bench.cpp runs the
+// client against a stand-in robot on a pty.
+// ===============================================================
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fcntl.h>
+#include <functional>
+#include <list>
+#include <map>
+#include <optional>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <termios.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "robot_messages.hpp"
+
+namespace robot {
+
+using Clock = std::chrono::steady_clock;
+
+template <class T = void>
+class Task;
+
+namespace detail {
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    // Lazy: the body runs once the task is awaited or spawned
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> done) noexcept {
+            std::coroutine_handle<> next = done.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <class T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+    Task<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+    T take() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    void take() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+} // namespace detail
+
+// Coroutine returning T, started when awaited (or by EventLoop::spawn
+// and EventLoop::run_until)
+template <class T>
+class Task {
+public:
+    using promise_type = detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle handle) : handle_(handle) {}
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    ~Task() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool done() const { return !handle_ || handle_.done(); }
+    Handle handle() const { return handle_; }
+    T take() { return handle_.promise().take(); }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        handle_.promise().continuation = caller;
+        return handle_;
+    }
+    T await_resume() { return take(); }
+
+private:
+    Handle handle_;
+};
+
+template <class T>
+Task<T> detail::Promise<T>::get_return_object() {
+    return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> detail::Promise<void>::get_return_object() {
+    return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+// ---------------------------------------------------------------
+// Single-threaded loop: ready coroutines, timers, then poll()
+// ---------------------------------------------------------------
+class EventLoop {
+public:
+    struct IoHandler {
+        virtual ~IoHandler() = default;
+        virtual void on_readable() = 0;
+        virtual void on_writable() = 0;
+        virtual bool wants_write() const = 0;
+    };
+    using TimerId = std::pair<Clock::time_point, std::uint64_t>;
+
+    void watch(int fd, IoHandler *handler) { handlers_[fd] = handler; }
+    void unwatch(int fd) { handlers_.erase(fd); }
+
+    // fn runs from the loop at (or after) when, unless cancelled first
+    TimerId call_at(Clock::time_point when, std::function<void()> fn) {
+        TimerId id{when, next_timer_++};
+        timers_.emplace(id, std::move(fn));
+        return id;
+    }
+    void cancel(const TimerId &id) { timers_.erase(id); }
+
+    // Resumes handle from the loop, never from the caller's stack
+    void post(std::coroutine_handle<> handle) { ready_.push_back(handle); }
+
+    // co_await loop.sleep(10ms)
+    auto sleep(Clock::duration delay) {
+        struct Awaiter {
+            EventLoop &loop;
+            Clock::duration delay;
+            bool await_ready() const noexcept { return delay <= Clock::duration::zero(); }
+            void await_suspend(std::coroutine_handle<> caller) {
+                loop.call_at(Clock::now() + delay, [loop = &loop, caller] { loop->post(caller); });
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this, delay};
+    }
+
+    // Runs task to completion in the background, run() returns once
+    // every spawned task is done. An exception ends run().
+    void spawn(Task<> task) {
+        post(task.handle());
+        spawned_.push_back(std::move(task));
+    }
+
+    // Runs the loop until task completes and returns its result
+    template <class T>
+    T run_until(Task<T> task) {
+        post(task.handle());
+        while (!task.done()) run_once();
+        return task.take();
+    }
+
+    // Runs until the spawned tasks are done or stop() is called
+    void run() {
+        while (!stopped_ && !spawned_.empty()) run_once();
+    }
+
+    void stop() { stopped_ = true; }
+
+    // Runs the tasks concurrently and completes with their results once
+    // all are done (awaiting them one by one would run them in turn)
+    template <class T>
+    Task<std::vector<T>> when_all(std::vector<Task<T>> tasks) {
+        Join join{tasks.size(), {}, {}};
+        std::vector<std::optional<T>> results(tasks.size());
+        std::vector<Task<>> joins;
+        joins.reserve(tasks.size());
+        for (std::size_t i = 0; i < tasks.size(); i++) {
+            joins.push_back(join_one(tasks[i], results[i], join));
+            post(joins.back().handle());
+        }
+        co_await JoinAwaiter{join};
+        if (join.error) std::rethrow_exception(join.error);
+        std::vector<T> values;
+        values.reserve(results.size());
+        for (std::optional<T> &result : results) values.push_back(std::move(*result));
+        co_return values;
+    }
+
+    // One iteration, waits at most max_wait for I/O or a timer
+    void run_once(Clock::duration max_wait = std::chrono::milliseconds(100)) {
+        drain_ready();
+        fire_timers();
+        drain_ready();
+        reap();
+
+        Clock::duration wait = max_wait;
+        if (!timers_.empty()) wait = std::min(wait, timers_.begin()->first.first - Clock::now());
+        if (!ready_.empty() || wait < Clock::duration::zero()) wait = Clock::duration::zero();
+
+        fds_.clear();
+        for (auto &[fd, handler] : handlers_)
+            fds_.push_back({fd, short(POLLIN | (handler->wants_write() ? POLLOUT : 0)), 0});
+        int timeout_ms = int(std::chrono::ceil<std::chrono::milliseconds>(wait).count());
+        if (::poll(fds_.data(), fds_.size(), timeout_ms) <= 0) return;
+        for (const pollfd &p : fds_) {
+            // a handler may unwatch itself or another descriptor
+            auto it = handlers_.find(p.fd);
+            if (it != handlers_.end() && (p.revents & POLLOUT)) it->second->on_writable();
+            it = handlers_.find(p.fd);
+            if (it != handlers_.end() && (p.revents & (POLLIN | POLLHUP | POLLERR))) it->second->on_readable();
+        }
+    }
+
+private:
+    struct Join {
+        std::size_t left;
+        std::coroutine_handle<> waiter;
+        std::exception_ptr error;
+    };
+
+    struct JoinAwaiter {
+        Join &join;
+        bool await_ready() const noexcept { return join.left == 0; }
+        void await_suspend(std::coroutine_handle<> caller) noexcept { join.waiter = caller; }
+        void await_resume() const noexcept {}
+    };
+
+    template <class T>
+    Task<> join_one(Task<T> &task, std::optional<T> &result, Join &join) {
+        try {
+            result = co_await std::move(task);
+        } catch (...) {
+            join.error = std::current_exception();
+        }
+        if (--join.left == 0 && join.waiter) post(join.waiter);
+    }
+
+    void drain_ready() {
+        while (!ready_.empty()) {
+            std::coroutine_handle<> handle = ready_.front();
+            ready_.pop_front();
+            handle.resume();
+        }
+    }
+
+    void fire_timers() {
+        Clock::time_point now = Clock::now();
+        while (!timers_.empty() && timers_.begin()->first.first <= now) {
+            std::function<void()> fn = std::move(timers_.begin()->second);
+            timers_.erase(timers_.begin());
+            fn();
+        }
+    }
+
+    void reap() {
+        for (auto it = spawned_.begin(); it != spawned_.end();) {
+            if (!it->done()) {
+                ++it;
+                continue;
+            }
+            Task<> task = std::move(*it);
+            it = spawned_.erase(it);
+            task.take(); // rethrows
+        }
+    }
+
+    std::map<int, IoHandler *> handlers_;
+    std::map<TimerId, std::function<void()>> timers_;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::list<Task<>> spawned_;
+    std::vector<pollfd> fds_;
+    std::uint64_t next_timer_ = 0;
+    bool stopped_ = false;
+};
+
+// ---------------------------------------------------------------
+// Queue of received messages of one kind, one consumer at a time
+// ---------------------------------------------------------------
+template <class T>
+class Stream {
+public:
+    explicit Stream(EventLoop &loop, std::size_t capacity = 64) : loop_(loop), capacity_(capacity) {}
+    Stream(const Stream &) = delete;
+    Stream &operator=(const Stream &) = delete;
+    ~Stream() { cancel_timer(); }
+
+    // co_await stream.next(timeout): the oldest queued message, or
+    // nullopt after timeout or once the link is closed
+    auto next(Clock::duration timeout = Clock::duration::max()) {
+        struct Awaiter {
+            Stream &stream;
+            Clock::duration timeout;
+            bool await_ready() const noexcept { return !stream.queue_.empty() || stream.closed_; }
+            void await_suspend(std::coroutine_handle<> caller) {
+                stream.waiter_ = caller;
+                if (timeout == Clock::duration::max()) return;
+                stream.timer_ = stream.loop_.call_at(Clock::now() + timeout, [s = &stream] {
+                    s->has_timer_ = false;
+                    s->wake();
+                });
+                stream.has_timer_ = true;
+            }
+            std::optional<T> await_resume() {
+                stream.cancel_timer();
+                if (stream.queue_.empty()) return std::nullopt;
+                T value = std::move(stream.queue_.front());
+                stream.queue_.pop_front();
+                return value;
+            }
+        };
+        return Awaiter{*this, timeout};
+    }
+
+    // Latest message seen, consumed or not
+    const std::optional<T> &latest() const { return latest_; }
+    std::size_t size() const { return queue_.size(); }
+    // Messages discarded because the queue was full (oldest first)
+    std::uint32_t dropped() const { return dropped_; }
+    void clear() { queue_.clear(); }
+
+    void push(const T &value) {
+        latest_ = value;
+        if (queue_.size() == capacity_) {
+            queue_.pop_front();
+            dropped_++;
+        }
+        queue_.push_back(value);
+        wake();
+    }
+
+    void close() {
+        closed_ = true;
+        wake();
+    }
+
+private:
+    void wake() {
+        if (std::coroutine_handle<> waiter = std::exchange(waiter_, {})) loop_.post(waiter);
+    }
+
+    void cancel_timer() {
+        if (has_timer_) loop_.cancel(timer_);
+        has_timer_ = false;
+    }
+
+    EventLoop &loop_;
+    std::size_t capacity_;
+    std::deque<T> queue_;
+    std::optional<T> latest_;
+    std::uint32_t dropped_ = 0;
+    bool closed_ = false;
+    std::coroutine_handle<> waiter_;
+    EventLoop::TimerId timer_{};
+    bool has_timer_ = false;
+};
+
+// ---------------------------------------------------------------
+// Robot connection
+// ---------------------------------------------------------------
+enum class Status {
+    ok,       // acknowledged, command succeeded
+    rejected, // acknowledged, command failed (wrong state, queue full...)
+    invalid,  // value out of range, not sent
+    timeout,  // no acknowledgement within ClientOptions::timeout
+    closed,   // link closed
+};
+
+inline const char *to_string(Status status) {
+    switch (status) {
+        case Status::ok: return "ok";
+        case Status::rejected: return "rejected";
+        case Status::invalid: return "invalid";
+        case Status::timeout: return "timeout";
+        case Status::closed: return "closed";
+    }
+    return "?";
+}
+
+struct ClientOptions {
+    Clock::duration retry = std::chrono::milliseconds(100);   // resend while unacknowledged
+    Clock::duration timeout = std::chrono::milliseconds(1000); // give up
+    // Commands in flight. At most ACK_WINDOW (16); more than the robot's
+    // command queue (RX_RING_SIZE bytes, 7 sequenced $PCREF, uart.h) only
+    // overflows it when the link is faster than the robot's tick
+    std::size_t window = 7;
+    std::size_t stream_capacity = 64;                          // queued messages per stream
+};
+
+class Client : private EventLoop::IoHandler {
+public:
+    struct Stats {
+        std::uint32_t sent = 0;
+        std::uint32_t retransmits = 0;
+        std::uint32_t timeouts = 0;
+        std::uint32_t lines = 0;
+        std::uint32_t bad_lines = 0; // not a known message, or out of range
+    };
+
+    // Takes ownership of fd (made non-blocking), -1 gives a closed client
+    Client(EventLoop &loop, int fd, ClientOptions options = {})
+        : loop_(loop), fd_(fd), options_(options),
+          distance_(loop, options.stream_capacity), battery_(loop, options.stream_capacity),
+          acceleration_(loop, options.stream_capacity), emergency_(loop, options.stream_capacity),
+          acks_(loop, 4) {
+        if (options_.window == 0 || options_.window > 16) options_.window = 16;
+        if (fd_ < 0) {
+            close_link();
+            return;
+        }
+        ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_NONBLOCK);
+        loop_.watch(fd_, this);
+    }
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+    ~Client() override { close_link(); }
+
+    // Opens a serial port in raw 8N1 mode, -1 on error
+    static int open_serial(const char *path, int baud) {
+        speed_t speed;
+        switch (baud) {
+            case 9600: speed = B9600; break;
+            case 19200: speed = B19200; break;
+            case 38400: speed = B38400; break;
+            case 57600: speed = B57600; break;
+            case 115200: speed = B115200; break;
+            case 230400: speed = B230400; break;
+            case 460800: speed = B460800; break;
+            case 921600: speed = B921600; break;
+            case 1000000: speed = B1000000; break;
+            default: return -1;
+        }
+        int fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (fd < 0) return -1;
+        termios tio{};
+        if (::tcgetattr(fd, &tio) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        ::cfmakeraw(&tio);
+        ::cfsetispeed(&tio, speed);
+        ::cfsetospeed(&tio, speed);
+        tio.c_cflag |= CLOCAL | CREAD;
+        if (::tcsetattr(fd, TCSANOW, &tio) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Restarts the robot's sequence numbering ($PCSYN, unsequenced),
+    // to be awaited before the first command and with none in flight
+    Task<Status> connect() {
+        for (Clock::time_point deadline = Clock::now() + options_.timeout; !closed_;) {
+            acks_.clear();
+            transmit(msg::to_string(msg::Pcsyn{}));
+            Clock::duration left = deadline - Clock::now();
+            if (left <= Clock::duration::zero()) co_return Status::timeout;
+            std::optional<msg::Mack> ack = co_await acks_.next(std::min(left, options_.retry));
+            if (ack) co_return ack->ok ? Status::ok : Status::rejected;
+            if (Clock::now() >= deadline) co_return Status::timeout;
+        }
+        co_return Status::closed;
+    }
+
+    Task<Status> start() { return send(msg::Pcstt{}); }
+    Task<Status> stop() { return send(msg::Pcstp{}); }
+
+    // speed and yawrate in percent, -100..100
+    Task<Status> setpoint(int speed, int yawrate) {
+        msg::Pcref command;
+        command.speed = std::int16_t(speed);
+        command.yawrate = std::int16_t(yawrate);
+        if (command.speed != speed || command.yawrate != yawrate) return finished(Status::invalid);
+        return send(command);
+    }
+
+    Task<Status> trajectory(int duration_ms, int speed, int yawrate) {
+        msg::Pctrj command;
+        command.duration_ms = std::uint16_t(duration_ms);
+        command.speed = std::int16_t(speed);
+        command.yawrate = std::int16_t(yawrate);
+        if (command.duration_ms != duration_ms || command.speed != speed || command.yawrate != yawrate)
+            return finished(Status::invalid);
+        return send(command);
+    }
+
+    // stream is a telemetry stream name (DIST, BATT, ACC...), 0 Hz = off
+    Task<Status> subscribe(std::string_view stream, int hz) {
+        msg::Pcsub command;
+        command.hz = std::uint8_t(hz);
+        if (!command.stream.assign(stream) || command.hz != hz) return finished(Status::invalid);
+        return send(command);
+    }
+
+    // Any PC command, sent with the next sequence number. Completes on
+    // the $MACKS covering it, after resending it every options.retry.
+    template <class M>
+    Task<Status> send(M command) {
+        char line[64];
+        if (msg::encode(command, line, sizeof(line), 255) == 0) co_return Status::invalid;
+        if (closed_) co_return Status::closed;
+
+        Pending pending;
+        pending.seq = co_await SeqSlot{*this, -1, {}};
+        if (pending.seq < 0) co_return Status::closed;
+        pending.line.assign(line, msg::encode(command, line, sizeof(line), pending.seq));
+        pending.deadline = Clock::now() + options_.timeout;
+        co_await Acknowledged{*this, pending};
+        co_return pending.status;
+    }
+
+    Stream<msg::Mdist> &distance() { return distance_; }
+    Stream<msg::Mbatt> &battery() { return battery_; }
+    Stream<msg::Macc> &acceleration() { return acceleration_; }
+    Stream<msg::Memrg> &emergency() { return emergency_; }
+
+    // Every other message from the robot ($MSUB, $MPRM, $MLOG...)
+    std::function<void(const msg::RobotMessage &)> on_message;
+
+    const Stats &stats() const { return stats_; }
+    const ClientOptions &options() const { return options_; }
+    std::size_t in_flight() const { return in_flight_; }
+    bool closed() const { return closed_; }
+
+private:
+    struct Pending {
+        int seq = 0;
+        std::string line;
+        Clock::time_point deadline;
+        Status status = Status::timeout;
+        std::coroutine_handle<> waiter;
+        EventLoop::TimerId retry{};
+    };
+
+    // Waits for a sequence number less than options.window after the
+    // oldest unacknowledged one: ack.c takes anything older for a
+    // duplicate. -1 once the link is closed.
+    struct SeqSlot {
+        Client &client;
+        int seq = -1;
+        std::coroutine_handle<> waiter;
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> caller) {
+            if (client.closed_) return false;
+            if (client.seq_waiters_.empty() && client.seq_free()) {
+                seq = client.take_seq();
+                return false;
+            }
+            waiter = caller;
+            client.seq_waiters_.push_back(this);
+            return true;
+        }
+        int await_resume() const noexcept { return seq; }
+    };
+
+    // Sends the command and waits for its acknowledgement
+    struct Acknowledged {
+        Client &client;
+        Pending &pending;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> caller) {
+            pending.waiter = caller;
+            client.pending_[pending.seq] = &pending;
+            client.stats_.sent++;
+            client.resend(pending);
+        }
+        void await_resume() const noexcept {}
+    };
+
+    static Task<Status> finished(Status status) { co_return status; }
+
+    void arm_retry(Pending &pending) {
+        Clock::time_point when = std::min(Clock::now() + options_.retry, pending.deadline);
+        pending.retry = loop_.call_at(when, [this, &pending] {
+            if (Clock::now() >= pending.deadline) {
+                stats_.timeouts++;
+                complete(pending, Status::timeout, false);
+                return;
+            }
+            stats_.retransmits++; // the robot executes a sequence number only once
+            resend(pending);
+        });
+    }
+
+    void resend(Pending &pending) {
+        sent_order_[pending.seq] = ++transmissions_;
+        transmit(pending.line);
+        arm_retry(pending);
+    }
+
+    void complete(Pending &pending, Status status, bool cancel_retry) {
+        if (cancel_retry) loop_.cancel(pending.retry);
+        pending_[pending.seq] = nullptr;
+        pending.status = status;
+        loop_.post(pending.waiter);
+        busy_[pending.seq] = false;
+        in_flight_--;
+        grant_seqs();
+    }
+
+    bool seq_free() const { return !busy_[(next_seq_ - int(options_.window)) & 0xFF]; }
+
+    int take_seq() {
+        int seq = next_seq_;
+        busy_[seq] = true;
+        in_flight_++;
+        next_seq_ = (next_seq_ + 1) & 0xFF;
+        return seq;
+    }
+
+    void grant_seqs() {
+        while (!seq_waiters_.empty() && (closed_ || seq_free())) {
+            SeqSlot *slot = seq_waiters_.front();
+            seq_waiters_.pop_front();
+            if (!closed_) slot->seq = take_seq();
+            loop_.post(slot->waiter);
+        }
+    }
+
+    void on_acks(const msg::Macks &acks) {
+        for (int i = 0; i < 16; i++) {
+            if (!((acks.rx_mask >> i) & 1)) continue;
+            Pending *pending = pending_[(acks.top - i) & 0xFF];
+            if (pending) complete(*pending, ((acks.ok_mask >> i) & 1) ? Status::ok : Status::rejected, true);
+        }
+        // Lines arrive in order: a missing command sent before the top
+        // one was lost (RX queue full, line error), no need to wait for
+        // options.retry
+        std::uint32_t top_order = sent_order_[acks.top & 0xFF];
+        for (int i = 1; i < 16; i++) {
+            Pending *pending = pending_[(acks.top - i) & 0xFF];
+            if (!pending || sent_order_[pending->seq] >= top_order) continue;
+            loop_.cancel(pending->retry);
+            stats_.retransmits++;
+            resend(*pending);
+        }
+    }
+
+    void on_line(std::string_view line) {
+        stats_.lines++;
+        std::optional<msg::RobotMessage> message = msg::decode_robot(line);
+        if (!message) {
+            stats_.bad_lines++;
+            return;
+        }
+        if (auto *m = std::get_if<msg::Macks>(&*message)) on_acks(*m);
+        else if (auto *m = std::get_if<msg::Mdist>(&*message)) distance_.push(*m);
+        else if (auto *m = std::get_if<msg::Mbatt>(&*message)) battery_.push(*m);
+        else if (auto *m = std::get_if<msg::Macc>(&*message)) acceleration_.push(*m);
+        else if (auto *m = std::get_if<msg::Memrg>(&*message)) emergency_.push(*m);
+        else if (auto *m = std::get_if<msg::Mack>(&*message)) acks_.push(*m);
+        else if (on_message) on_message(*message);
+    }
+
+    void on_readable() override {
+        char buffer[512];
+        ssize_t n = ::read(fd_, buffer, sizeof(buffer));
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+        if (n <= 0) {
+            close_link();
+            return;
+        }
+        rx_.append(buffer, std::size_t(n));
+        std::size_t begin = 0;
+        for (std::size_t end; (end = rx_.find('\n', begin)) != std::string::npos; begin = end + 1) {
+            std::string_view line(rx_.data() + begin, end - begin);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            std::size_t start = line.find('$'); // skip noise before the message
+            if (start != std::string_view::npos) on_line(line.substr(start));
+        }
+        rx_.erase(0, begin);
+        if (rx_.size() > 256) rx_.clear(); // no line that long, resync on the next '\n'
+    }
+
+    void on_writable() override { flush(); }
+    bool wants_write() const override { return !tx_.empty(); }
+
+    void transmit(std::string_view line) {
+        if (closed_) return;
+        tx_.append(line);
+        flush();
+    }
+
+    void flush() {
+        while (!tx_.empty()) {
+            ssize_t n = ::write(fd_, tx_.data(), tx_.size());
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno == EAGAIN) return; // the loop polls for POLLOUT
+            if (n <= 0) {
+                close_link();
+                return;
+            }
+            tx_.erase(0, std::size_t(n));
+        }
+    }
+
+    void close_link() {
+        if (closed_) return;
+        closed_ = true;
+        if (fd_ >= 0) {
+            loop_.unwatch(fd_);
+            ::close(fd_);
+            fd_ = -1;
+        }
+        tx_.clear();
+        for (Pending *&pending : pending_)
+            if (pending) complete(*pending, Status::closed, true);
+        grant_seqs(); // the waiters get -1
+        distance_.close();
+        battery_.close();
+        acceleration_.close();
+        emergency_.close();
+        acks_.close();
+    }
+
+    EventLoop &loop_;
+    int fd_;
+    ClientOptions options_;
+    bool closed_ = false;
+    std::string rx_;
+    std::string tx_;
+    int next_seq_ = 0;
+    std::array<Pending *, 256> pending_{};
+    std::array<bool, 256> busy_{}; // sequence number sent and not acknowledged yet
+    std::size_t in_flight_ = 0;
+    std::uint32_t transmissions_ = 0;
+    std::array<std::uint32_t, 256> sent_order_{}; // transmissions_ at the last (re)send
+    std::deque<SeqSlot *> seq_waiters_;
+    Stats stats_;
+    Stream<msg::Mdist> distance_;
+    Stream<msg::Mbatt> battery_;
+    Stream<msg::Macc> acceleration_;
+    Stream<msg::Memrg> emergency_;
+    Stream<msg::Mack> acks_; // replies to unsequenced commands
+};
+
+} // namespace robot
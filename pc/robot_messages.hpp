@@ -0,0 +1,1713 @@
+// ===============================================================
+// File: robot_messages.hpp
+// Author: group 1
+// Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+// Generated by tools/msggen.py from tools/messages.schema, do not edit.
+// Header-only C++17: one struct per message with its ranges, encode()
+// into a caller buffer and decode() from a line, both allocation-free
+// and rejecting out of range values.
+// ===============================================================
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace robot::msg {
+
+enum class Charset { upper, ident, alnum, text };
+
+// Fixed capacity string, no allocation
+template <std::size_t N>
+struct FixedString {
+    char data[N + 1] = {};
+    std::size_t size = 0;
+
+    FixedString() = default;
+    FixedString(std::string_view text) { assign(text); }
+    FixedString(const char *text) { assign(text); }
+    bool assign(std::string_view text) {
+        if (text.size() > N) return false;
+        std::memcpy(data, text.data(), text.size());
+        size = text.size();
+        data[size] = '\0';
+        return true;
+    }
+    std::string_view view() const { return {data, size}; }
+    bool operator==(std::string_view other) const { return view() == other; }
+};
+
+namespace detail {
+
+inline bool in_set(char c, Charset set) {
+    bool upper = c >= 'A' && c <= 'Z';
+    switch (set) {
+        case Charset::upper: return upper;
+        case Charset::ident: return upper || c == '_';
+        case Charset::alnum: return upper || (c >= '0' && c <= '9');
+        default: return c >= ' ' && c <= '~' && c != ',' && c != '*' && c != '#' && c != '$';
+    }
+}
+
+class Writer {
+public:
+    Writer(char *out, std::size_t size) : p_(out), end_(out + (size ? size - 1 : 0)), ok_(size > 0) {}
+    void put(char c) {
+        if (p_ < end_) *p_++ = c;
+        else ok_ = false;
+    }
+    void put(std::string_view text) {
+        for (char c : text) put(c);
+    }
+    void put_int(std::int64_t value, std::int64_t min, std::int64_t max) {
+        if (value < min || value > max) ok_ = false;
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        put(std::string_view(digits, result.ptr - digits));
+    }
+    void put_fixed(std::int64_t value, std::int64_t min, std::int64_t max, int scale) {
+        if (value < min || value > max) ok_ = false;
+        put_int(value / scale, 0, INT64_MAX);
+        put('.');
+        for (int div = scale / 10; div > 0; div /= 10) put(char('0' + (value / div) % 10));
+    }
+    void put_hex(std::uint32_t value, int digits) {
+        static const char hex[] = "0123456789ABCDEF";
+        if (digits < 8 && (value >> (4 * digits)) != 0) ok_ = false;
+        while (digits-- > 0) put(hex[(value >> (4 * digits)) & 0xF]);
+    }
+    template <std::size_t N>
+    void put_str(const FixedString<N> &text, Charset set) {
+        if (text.size == 0) ok_ = false;
+        for (char c : text.view()) {
+            if (!in_set(c, set)) ok_ = false;
+            put(c);
+        }
+    }
+    // Optional "#seq", then "*\r\n"; returns the length or 0 if anything failed
+    std::size_t finish(char *out, int seq) {
+        if (seq >= 0) {
+            put('#');
+            put_int(seq, 0, INT64_MAX);
+        }
+        put("*\r\n");
+        if (!ok_) return 0;
+        *p_ = '\0';
+        return p_ - out;
+    }
+
+private:
+    char *p_;
+    char *end_;
+    bool ok_;
+};
+
+class Reader {
+public:
+    explicit Reader(std::string_view line) : line_(line) {}
+    bool expect(std::string_view text) {
+        if (line_.substr(pos_, text.size()) != text) return false;
+        pos_ += text.size();
+        return true;
+    }
+    bool get_int(std::int64_t &value, std::int64_t min, std::int64_t max) {
+        const char *begin = line_.data() + pos_;
+        auto result = std::from_chars(begin, line_.data() + line_.size(), value);
+        if (result.ec != std::errc() || value < min || value > max) return false;
+        pos_ += result.ptr - begin;
+        return true;
+    }
+    bool get_fixed(std::int64_t &value, std::int64_t min, std::int64_t max, int scale) {
+        std::int64_t whole, fraction = 0;
+        if (!get_int(whole, 0, INT64_MAX / scale) || !expect(".")) return false;
+        for (int div = scale / 10; div > 0; div /= 10) {
+            if (pos_ >= line_.size() || line_[pos_] < '0' || line_[pos_] > '9') return false;
+            fraction += (line_[pos_++] - '0') * div;
+        }
+        value = whole * scale + fraction;
+        return value >= min && value <= max;
+    }
+    bool get_hex(std::uint32_t &value, int digits) {
+        value = 0;
+        for (int i = 0; i < digits; i++, pos_++) {
+            if (pos_ >= line_.size()) return false;
+            char c = line_[pos_];
+            int nibble = (c >= '0' && c <= '9') ? c - '0' : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (nibble < 0) return false;
+            value = (value << 4) | nibble;
+        }
+        return true;
+    }
+    template <std::size_t N>
+    bool get_str(FixedString<N> &text, Charset set) {
+        std::size_t start = pos_;
+        while (pos_ < line_.size() && in_set(line_[pos_], set)) pos_++;
+        return pos_ > start && text.assign(line_.substr(start, pos_ - start));
+    }
+    // Optional "#seq" (PC commands only), '*', optional "\r\n"
+    bool finish(bool allow_seq, int *seq) {
+        if (seq) *seq = -1;
+        if (allow_seq && expect("#")) {
+            std::int64_t value;
+            if (!get_int(value, 0, 65535)) return false;
+            if (seq) *seq = int(value);
+        }
+        if (!expect("*")) return false;
+        std::string_view rest = line_.substr(pos_);
+        return rest.empty() || rest == "\r\n" || rest == "\n";
+    }
+
+private:
+    std::string_view line_;
+    std::size_t pos_ = 0;
+};
+
+}  // namespace detail
+
+// $MDIST,distance* Average distance
+struct Mdist {
+    static constexpr std::string_view tag = "MDIST";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 13;
+    static constexpr std::string_view stream = "DIST";
+    static constexpr int default_hz = 10;
+    static constexpr std::int64_t distance_min = 0, distance_max = 999;
+    std::uint16_t distance = 0;  // cm
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mdist &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MDIST");
+    w.put(',');
+    w.put_int(m.distance, m.distance_min, m.distance_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mdist &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MDIST")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.distance_min, m.distance_max)) return false;
+    m.distance = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MBATT,voltage* Average battery voltage
+struct Mbatt {
+    static constexpr std::string_view tag = "MBATT";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 15;
+    static constexpr std::string_view stream = "BATT";
+    static constexpr int default_hz = 1;
+    static constexpr std::int64_t voltage_min = 0, voltage_max = 9999;
+    std::uint16_t voltage = 0;  // 1/100 V
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mbatt &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MBATT");
+    w.put(',');
+    w.put_fixed(m.voltage, m.voltage_min, m.voltage_max, 100);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mbatt &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MBATT")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_fixed(value, m.voltage_min, m.voltage_max, 100)) return false;
+    m.voltage = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MACC,x,y,z* Latest accelerometer sample
+struct Macc {
+    static constexpr std::string_view tag = "MACC";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 29;
+    static constexpr std::string_view stream = "ACC";
+    static constexpr int default_hz = 10;
+    static constexpr std::int64_t x_min = -16000, x_max = 16000;
+    static constexpr std::int64_t y_min = -16000, y_max = 16000;
+    static constexpr std::int64_t z_min = -16000, z_max = 16000;
+    std::int16_t x = 0;  // mg
+    std::int16_t y = 0;
+    std::int16_t z = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Macc &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MACC");
+    w.put(',');
+    w.put_int(m.x, m.x_min, m.x_max);
+    w.put(',');
+    w.put_int(m.y, m.y_min, m.y_max);
+    w.put(',');
+    w.put_int(m.z, m.z_min, m.z_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Macc &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MACC")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.x_min, m.x_max)) return false;
+    m.x = static_cast<std::int16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.y_min, m.y_max)) return false;
+    m.y = static_cast<std::int16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.z_min, m.z_max)) return false;
+    m.z = static_cast<std::int16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MTRJ,depth,underruns* Trajectory queue, while a trajectory is active
+struct Mtrj {
+    static constexpr std::string_view tag = "MTRJ";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 17;
+    static constexpr std::string_view stream = "TRJ";
+    static constexpr int default_hz = 10;
+    static constexpr std::int64_t depth_min = 0, depth_max = 16;
+    static constexpr std::int64_t underruns_min = 0, underruns_max = 65535;
+    std::uint8_t depth = 0;
+    std::uint16_t underruns = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mtrj &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MTRJ");
+    w.put(',');
+    w.put_int(m.depth, m.depth_min, m.depth_max);
+    w.put(',');
+    w.put_int(m.underruns, m.underruns_min, m.underruns_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mtrj &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MTRJ")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.depth_min, m.depth_max)) return false;
+    m.depth = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.underruns_min, m.underruns_max)) return false;
+    m.underruns = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MEST,speed,yawrate,heading,flags,peak_cycles* Velocity and heading estimate (estimator.h)
+struct Mest {
+    static constexpr std::string_view tag = "MEST";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 37;
+    static constexpr std::string_view stream = "EST";
+    static constexpr int default_hz = 5;
+    static constexpr std::int64_t speed_min = -32768, speed_max = 32767;
+    static constexpr std::int64_t yawrate_min = -32768, yawrate_max = 32767;
+    static constexpr std::int64_t heading_min = -3142, heading_max = 3142;
+    static constexpr std::int64_t flags_min = 0, flags_max = 15;
+    static constexpr std::int64_t peak_cycles_min = 0, peak_cycles_max = 65535;
+    std::int16_t speed = 0;  // mm/s
+    std::int16_t yawrate = 0;  // mrad/s
+    std::int16_t heading = 0;  // mrad
+    std::uint8_t flags = 0;  // EST_FLAG_*
+    std::uint16_t peak_cycles = 0;  // longest update so far, against EST_CYCLE_BUDGET
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mest &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MEST");
+    w.put(',');
+    w.put_int(m.speed, m.speed_min, m.speed_max);
+    w.put(',');
+    w.put_int(m.yawrate, m.yawrate_min, m.yawrate_max);
+    w.put(',');
+    w.put_int(m.heading, m.heading_min, m.heading_max);
+    w.put(',');
+    w.put_int(m.flags, m.flags_min, m.flags_max);
+    w.put(',');
+    w.put_int(m.peak_cycles, m.peak_cycles_min, m.peak_cycles_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mest &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MEST")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.speed_min, m.speed_max)) return false;
+    m.speed = static_cast<std::int16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.yawrate_min, m.yawrate_max)) return false;
+    m.yawrate = static_cast<std::int16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.heading_min, m.heading_max)) return false;
+    m.heading = static_cast<std::int16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.flags_min, m.flags_max)) return false;
+    m.flags = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.peak_cycles_min, m.peak_cycles_max)) return false;
+    m.peak_cycles = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MPWR,cpu_load,adc_hz,acc_low_power,current* CPU load, sampling rate and estimated current (power.h)
+struct Mpwr {
+    static constexpr std::string_view tag = "MPWR";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 27;
+    static constexpr std::string_view stream = "PWR";
+    static constexpr int default_hz = 0;
+    static constexpr std::int64_t cpu_load_min = 0, cpu_load_max = 1000;
+    static constexpr std::int64_t adc_hz_min = 0, adc_hz_max = 500;
+    static constexpr std::int64_t acc_low_power_min = 0, acc_low_power_max = 100;
+    static constexpr std::int64_t current_min = 0, current_max = 9999;
+    std::uint16_t cpu_load = 0;  // per mille
+    std::uint16_t adc_hz = 0;
+    std::uint8_t acc_low_power = 0;  // percent of the time
+    std::uint16_t current = 0;  // 1/10 mA
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mpwr &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MPWR");
+    w.put(',');
+    w.put_int(m.cpu_load, m.cpu_load_min, m.cpu_load_max);
+    w.put(',');
+    w.put_int(m.adc_hz, m.adc_hz_min, m.adc_hz_max);
+    w.put(',');
+    w.put_int(m.acc_low_power, m.acc_low_power_min, m.acc_low_power_max);
+    w.put(',');
+    w.put_fixed(m.current, m.current_min, m.current_max, 10);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mpwr &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MPWR")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.cpu_load_min, m.cpu_load_max)) return false;
+    m.cpu_load = static_cast<std::uint16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.adc_hz_min, m.adc_hz_max)) return false;
+    m.adc_hz = static_cast<std::uint16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.acc_low_power_min, m.acc_low_power_max)) return false;
+    m.acc_low_power = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_fixed(value, m.current_min, m.current_max, 10)) return false;
+    m.current = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MLNK,baud,overruns,framing_errors,parity_errors* RX error counters since boot
+struct Mlnk {
+    static constexpr std::string_view tag = "MLNK";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 34;
+    static constexpr std::string_view stream = "LINK";
+    static constexpr int default_hz = 0;
+    static constexpr std::int64_t baud_min = 0, baud_max = 1000000;
+    static constexpr std::int64_t overruns_min = 0, overruns_max = 65535;
+    static constexpr std::int64_t framing_errors_min = 0, framing_errors_max = 65535;
+    static constexpr std::int64_t parity_errors_min = 0, parity_errors_max = 65535;
+    std::uint32_t baud = 0;
+    std::uint16_t overruns = 0;
+    std::uint16_t framing_errors = 0;
+    std::uint16_t parity_errors = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mlnk &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MLNK");
+    w.put(',');
+    w.put_int(m.baud, m.baud_min, m.baud_max);
+    w.put(',');
+    w.put_int(m.overruns, m.overruns_min, m.overruns_max);
+    w.put(',');
+    w.put_int(m.framing_errors, m.framing_errors_min, m.framing_errors_max);
+    w.put(',');
+    w.put_int(m.parity_errors, m.parity_errors_min, m.parity_errors_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mlnk &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MLNK")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.baud_min, m.baud_max)) return false;
+    m.baud = static_cast<std::uint32_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.overruns_min, m.overruns_max)) return false;
+    m.overruns = static_cast<std::uint16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.framing_errors_min, m.framing_errors_max)) return false;
+    m.framing_errors = static_cast<std::uint16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.parity_errors_min, m.parity_errors_max)) return false;
+    m.parity_errors = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MTLM,dist_hz,batt_hz,acc_hz,trj_hz,est_hz,pwr_hz,link_hz,stat_hz,tx_peak,tx_drops* Achieved telemetry rates and TX buffer occupancy
+struct Mtlm {
+    static constexpr std::string_view tag = "MTLM";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 42;
+    static constexpr std::string_view stream = "STAT";
+    static constexpr int default_hz = 0;
+    static constexpr std::int64_t dist_hz_min = 0, dist_hz_max = 50;
+    static constexpr std::int64_t batt_hz_min = 0, batt_hz_max = 50;
+    static constexpr std::int64_t acc_hz_min = 0, acc_hz_max = 50;
+    static constexpr std::int64_t trj_hz_min = 0, trj_hz_max = 50;
+    static constexpr std::int64_t est_hz_min = 0, est_hz_max = 50;
+    static constexpr std::int64_t pwr_hz_min = 0, pwr_hz_max = 50;
+    static constexpr std::int64_t link_hz_min = 0, link_hz_max = 50;
+    static constexpr std::int64_t stat_hz_min = 0, stat_hz_max = 50;
+    static constexpr std::int64_t tx_peak_min = 0, tx_peak_max = 128;
+    static constexpr std::int64_t tx_drops_min = 0, tx_drops_max = 65535;
+    std::uint8_t dist_hz = 0;
+    std::uint8_t batt_hz = 0;
+    std::uint8_t acc_hz = 0;
+    std::uint8_t trj_hz = 0;
+    std::uint8_t est_hz = 0;
+    std::uint8_t pwr_hz = 0;
+    std::uint8_t link_hz = 0;
+    std::uint8_t stat_hz = 0;
+    std::uint8_t tx_peak = 0;  // bytes
+    std::uint16_t tx_drops = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mtlm &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MTLM");
+    w.put(',');
+    w.put_int(m.dist_hz, m.dist_hz_min, m.dist_hz_max);
+    w.put(',');
+    w.put_int(m.batt_hz, m.batt_hz_min, m.batt_hz_max);
+    w.put(',');
+    w.put_int(m.acc_hz, m.acc_hz_min, m.acc_hz_max);
+    w.put(',');
+    w.put_int(m.trj_hz, m.trj_hz_min, m.trj_hz_max);
+    w.put(',');
+    w.put_int(m.est_hz, m.est_hz_min, m.est_hz_max);
+    w.put(',');
+    w.put_int(m.pwr_hz, m.pwr_hz_min, m.pwr_hz_max);
+    w.put(',');
+    w.put_int(m.link_hz, m.link_hz_min, m.link_hz_max);
+    w.put(',');
+    w.put_int(m.stat_hz, m.stat_hz_min, m.stat_hz_max);
+    w.put(',');
+    w.put_int(m.tx_peak, m.tx_peak_min, m.tx_peak_max);
+    w.put(',');
+    w.put_int(m.tx_drops, m.tx_drops_min, m.tx_drops_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mtlm &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MTLM")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.dist_hz_min, m.dist_hz_max)) return false;
+    m.dist_hz = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.batt_hz_min, m.batt_hz_max)) return false;
+    m.batt_hz = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.acc_hz_min, m.acc_hz_max)) return false;
+    m.acc_hz = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.trj_hz_min, m.trj_hz_max)) return false;
+    m.trj_hz = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.est_hz_min, m.est_hz_max)) return false;
+    m.est_hz = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.pwr_hz_min, m.pwr_hz_max)) return false;
+    m.pwr_hz = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.link_hz_min, m.link_hz_max)) return false;
+    m.link_hz = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.stat_hz_min, m.stat_hz_max)) return false;
+    m.stat_hz = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.tx_peak_min, m.tx_peak_max)) return false;
+    m.tx_peak = static_cast<std::uint8_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.tx_drops_min, m.tx_drops_max)) return false;
+    m.tx_drops = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MACK,ok* Acknowledgement of an unsequenced command
+struct Mack {
+    static constexpr std::string_view tag = "MACK";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 10;
+    static constexpr std::int64_t ok_min = 0, ok_max = 1;
+    std::uint8_t ok = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mack &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MACK");
+    w.put(',');
+    w.put_int(m.ok, m.ok_min, m.ok_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mack &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MACK")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.ok_min, m.ok_max)) return false;
+    m.ok = static_cast<std::uint8_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MACKS,top,rx_mask,ok_mask* Batched acknowledgement of sequenced commands (ack.h)
+struct Macks {
+    static constexpr std::string_view tag = "MACKS";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 25;
+    static constexpr std::int64_t top_min = 0, top_max = 65535;
+    std::uint16_t top = 0;
+    std::uint16_t rx_mask = 0;
+    std::uint16_t ok_mask = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Macks &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MACKS");
+    w.put(',');
+    w.put_int(m.top, m.top_min, m.top_max);
+    w.put(',');
+    w.put_hex(m.rx_mask, 4);
+    w.put(',');
+    w.put_hex(m.ok_mask, 4);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Macks &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    std::uint32_t hex;
+    if (!r.expect("$MACKS")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.top_min, m.top_max)) return false;
+    m.top = static_cast<std::uint16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_hex(hex, 4)) return false;
+    m.rx_mask = static_cast<std::uint16_t>(hex);
+    if (!r.expect(",")) return false;
+    if (!r.get_hex(hex, 4)) return false;
+    m.ok_mask = static_cast<std::uint16_t>(hex);
+    return r.finish(false, seq);
+}
+
+// $MEMRG,active* Emergency state entered (1) or left (0)
+struct Memrg {
+    static constexpr std::string_view tag = "MEMRG";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 11;
+    static constexpr std::int64_t active_min = 0, active_max = 1;
+    std::uint8_t active = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Memrg &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MEMRG");
+    w.put(',');
+    w.put_int(m.active, m.active_min, m.active_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Memrg &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MEMRG")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.active_min, m.active_max)) return false;
+    m.active = static_cast<std::uint8_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MBTN,button,long_press* Button pressed
+struct Mbtn {
+    static constexpr std::string_view tag = "MBTN";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 13;
+    static constexpr std::int64_t long_press_min = 0, long_press_max = 1;
+    FixedString<2> button;  // T2 or T3
+    std::uint8_t long_press = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mbtn &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MBTN");
+    w.put(',');
+    w.put_str(m.button, Charset::alnum);
+    w.put(',');
+    w.put_int(m.long_press, m.long_press_min, m.long_press_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mbtn &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MBTN")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_str(m.button, Charset::alnum)) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.long_press_min, m.long_press_max)) return false;
+    m.long_press = static_cast<std::uint8_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MSUB,stream,hz* Rate granted to a subscription
+struct Msub {
+    static constexpr std::string_view tag = "MSUB";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 16;
+    static constexpr std::int64_t hz_min = 0, hz_max = 50;
+    FixedString<4> stream;
+    std::uint8_t hz = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Msub &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MSUB");
+    w.put(',');
+    w.put_str(m.stream, Charset::upper);
+    w.put(',');
+    w.put_int(m.hz, m.hz_min, m.hz_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Msub &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MSUB")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_str(m.stream, Charset::upper)) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.hz_min, m.hz_max)) return false;
+    m.hz = static_cast<std::uint8_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MPRM,name,value* Value of a parameter (params.c)
+struct Mprm {
+    static constexpr std::string_view tag = "MPRM";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 32;
+    static constexpr std::int64_t value_min = -2147483647, value_max = 2147483647;
+    FixedString<11> name;
+    std::int32_t value = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mprm &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MPRM");
+    w.put(',');
+    w.put_str(m.name, Charset::ident);
+    w.put(',');
+    w.put_int(m.value, m.value_min, m.value_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mprm &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MPRM")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_str(m.name, Charset::ident)) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.value_min, m.value_max)) return false;
+    m.value = static_cast<std::int32_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MLOGS,count,total* Flight recorder dump header (recorder.h)
+struct Mlogs {
+    static constexpr std::string_view tag = "MLOGS";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 21;
+    static constexpr std::int64_t count_min = 0, count_max = 65535;
+    static constexpr std::int64_t total_min = 0, total_max = 65535;
+    std::uint16_t count = 0;
+    std::uint16_t total = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mlogs &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MLOGS");
+    w.put(',');
+    w.put_int(m.count, m.count_min, m.count_max);
+    w.put(',');
+    w.put_int(m.total, m.total_min, m.total_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mlogs &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MLOGS")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.count_min, m.count_max)) return false;
+    m.count = static_cast<std::uint16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.total_min, m.total_max)) return false;
+    m.total = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MLOG,index,ticktypeargvalue* One flight recorder event
+struct Mlog {
+    static constexpr std::string_view tag = "MLOG";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 27;
+    static constexpr std::int64_t index_min = 0, index_max = 65535;
+    std::uint16_t index = 0;
+    std::uint16_t tick = 0;
+    std::uint8_t type = 0;
+    std::uint8_t arg = 0;
+    std::uint16_t value = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mlog &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MLOG");
+    w.put(',');
+    w.put_int(m.index, m.index_min, m.index_max);
+    w.put(',');
+    w.put_hex(m.tick, 4);
+    w.put_hex(m.type, 2);
+    w.put_hex(m.arg, 2);
+    w.put_hex(m.value, 4);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mlog &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    std::uint32_t hex;
+    if (!r.expect("$MLOG")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.index_min, m.index_max)) return false;
+    m.index = static_cast<std::uint16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_hex(hex, 4)) return false;
+    m.tick = static_cast<std::uint16_t>(hex);
+    if (!r.get_hex(hex, 2)) return false;
+    m.type = static_cast<std::uint8_t>(hex);
+    if (!r.get_hex(hex, 2)) return false;
+    m.arg = static_cast<std::uint8_t>(hex);
+    if (!r.get_hex(hex, 4)) return false;
+    m.value = static_cast<std::uint16_t>(hex);
+    return r.finish(false, seq);
+}
+
+// $MLOGE,lost* End of the flight recorder dump
+struct Mloge {
+    static constexpr std::string_view tag = "MLOGE";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 15;
+    static constexpr std::int64_t lost_min = 0, lost_max = 65535;
+    std::uint16_t lost = 0;  // events overwritten before they were sent
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mloge &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MLOGE");
+    w.put(',');
+    w.put_int(m.lost, m.lost_min, m.lost_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mloge &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MLOGE")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.lost_min, m.lost_max)) return false;
+    m.lost = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MISR,source,max_latency,max_duration,latency_bound* Interrupt timing in cycles (interrupt.h)
+struct Misr {
+    static constexpr std::string_view tag = "MISR";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 31;
+    static constexpr std::int64_t max_latency_min = 0, max_latency_max = 65535;
+    static constexpr std::int64_t max_duration_min = 0, max_duration_max = 65535;
+    static constexpr std::int64_t latency_bound_min = 0, latency_bound_max = 65535;
+    FixedString<4> source;
+    std::uint16_t max_latency = 0;
+    std::uint16_t max_duration = 0;
+    std::uint16_t latency_bound = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Misr &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MISR");
+    w.put(',');
+    w.put_str(m.source, Charset::alnum);
+    w.put(',');
+    w.put_int(m.max_latency, m.max_latency_min, m.max_latency_max);
+    w.put(',');
+    w.put_int(m.max_duration, m.max_duration_min, m.max_duration_max);
+    w.put(',');
+    w.put_int(m.latency_bound, m.latency_bound_min, m.latency_bound_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Misr &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MISR")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_str(m.source, Charset::alnum)) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.max_latency_min, m.max_latency_max)) return false;
+    m.max_latency = static_cast<std::uint16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.max_duration_min, m.max_duration_max)) return false;
+    m.max_duration = static_cast<std::uint16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.latency_bound_min, m.latency_bound_max)) return false;
+    m.latency_bound = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MBAUD,baud,committed* Rate committed (1) or back to the previous one (0)
+struct Mbaud {
+    static constexpr std::string_view tag = "MBAUD";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 19;
+    static constexpr std::int64_t baud_min = 0, baud_max = 1000000;
+    static constexpr std::int64_t committed_min = 0, committed_max = 1;
+    std::uint32_t baud = 0;
+    std::uint8_t committed = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mbaud &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MBAUD");
+    w.put(',');
+    w.put_int(m.baud, m.baud_min, m.baud_max);
+    w.put(',');
+    w.put_int(m.committed, m.committed_min, m.committed_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mbaud &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MBAUD")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.baud_min, m.baud_max)) return false;
+    m.baud = static_cast<std::uint32_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.committed_min, m.committed_max)) return false;
+    m.committed = static_cast<std::uint8_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MRXDROP,total* Received lines dropped: command queue full or line too long
+struct Mrxdrop {
+    static constexpr std::string_view tag = "MRXDROP";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 17;
+    static constexpr std::int64_t total_min = 0, total_max = 65535;
+    std::uint16_t total = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mrxdrop &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MRXDROP");
+    w.put(',');
+    w.put_int(m.total, m.total_min, m.total_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mrxdrop &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MRXDROP")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.total_min, m.total_max)) return false;
+    m.total = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MUPD,committed* Back from update mode without a new image (update.h)
+struct Mupd {
+    static constexpr std::string_view tag = "MUPD";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 10;
+    static constexpr std::int64_t committed_min = 0, committed_max = 1;
+    std::uint8_t committed = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mupd &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MUPD");
+    w.put(',');
+    w.put_int(m.committed, m.committed_min, m.committed_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mupd &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MUPD")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.committed_min, m.committed_max)) return false;
+    m.committed = static_cast<std::uint8_t>(value);
+    return r.finish(false, seq);
+}
+
+// $MDSP,name,cycles* Filter benchmark at boot, DSP_BENCHMARK builds only (dsp.h)
+struct Mdsp {
+    static constexpr std::string_view tag = "MDSP";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 25;
+    static constexpr std::int64_t cycles_min = 0, cycles_max = 65535;
+    FixedString<10> name;
+    std::uint16_t cycles = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Mdsp &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$MDSP");
+    w.put(',');
+    w.put_str(m.name, Charset::text);
+    w.put(',');
+    w.put_int(m.cycles, m.cycles_min, m.cycles_max);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Mdsp &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$MDSP")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_str(m.name, Charset::text)) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.cycles_min, m.cycles_max)) return false;
+    m.cycles = static_cast<std::uint16_t>(value);
+    return r.finish(false, seq);
+}
+
+// $ERR,text* Command not understood
+struct Err {
+    static constexpr std::string_view tag = "ERR";
+    static constexpr bool from_robot = true;
+    static constexpr std::size_t max_length = 28;
+    FixedString<20> text;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Err &m, char *out, std::size_t size, [[maybe_unused]] int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$ERR");
+    w.put(',');
+    w.put_str(m.text, Charset::text);
+    return w.finish(out, -1);
+}
+
+inline bool decode(std::string_view line, Err &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$ERR")) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_str(m.text, Charset::text)) return false;
+    return r.finish(false, seq);
+}
+
+// $PCREF,speed,yawrate* Set speed and yawrate, cancels a running trajectory
+struct Pcref {
+    static constexpr std::string_view tag = "PCREF";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 19;
+    static constexpr std::int64_t speed_min = -100, speed_max = 100;
+    static constexpr std::int64_t yawrate_min = -100, yawrate_max = 100;
+    std::int16_t speed = 0;
+    std::int16_t yawrate = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Pcref &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCREF,");
+    w.put_int(m.speed, m.speed_min, m.speed_max);
+    w.put(',');
+    w.put_int(m.yawrate, m.yawrate_min, m.yawrate_max);
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, Pcref &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$PCREF,")) return false;
+    if (!r.get_int(value, m.speed_min, m.speed_max)) return false;
+    m.speed = static_cast<std::int16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.yawrate_min, m.yawrate_max)) return false;
+    m.yawrate = static_cast<std::int16_t>(value);
+    return r.finish(true, seq);
+}
+
+// $PCSTP,* Stop moving
+struct Pcstp {
+    static constexpr std::string_view tag = "PCSTP";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 10;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode([[maybe_unused]] const Pcstp &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCSTP,");
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, [[maybe_unused]] Pcstp &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCSTP,")) return false;
+    return r.finish(true, seq);
+}
+
+// $PCSTT,* Start moving
+struct Pcstt {
+    static constexpr std::string_view tag = "PCSTT";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 10;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode([[maybe_unused]] const Pcstt &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCSTT,");
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, [[maybe_unused]] Pcstt &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCSTT,")) return false;
+    return r.finish(true, seq);
+}
+
+// $PCTRJ,duration_ms,speed,yawrate* Queue one trajectory segment
+struct Pctrj {
+    static constexpr std::string_view tag = "PCTRJ";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 25;
+    static constexpr std::int64_t duration_ms_min = 1, duration_ms_max = 60000;
+    static constexpr std::int64_t speed_min = -100, speed_max = 100;
+    static constexpr std::int64_t yawrate_min = -100, yawrate_max = 100;
+    std::uint16_t duration_ms = 0;
+    std::int16_t speed = 0;
+    std::int16_t yawrate = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Pctrj &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCTRJ,");
+    w.put_int(m.duration_ms, m.duration_ms_min, m.duration_ms_max);
+    w.put(',');
+    w.put_int(m.speed, m.speed_min, m.speed_max);
+    w.put(',');
+    w.put_int(m.yawrate, m.yawrate_min, m.yawrate_max);
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, Pctrj &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$PCTRJ,")) return false;
+    if (!r.get_int(value, m.duration_ms_min, m.duration_ms_max)) return false;
+    m.duration_ms = static_cast<std::uint16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.speed_min, m.speed_max)) return false;
+    m.speed = static_cast<std::int16_t>(value);
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.yawrate_min, m.yawrate_max)) return false;
+    m.yawrate = static_cast<std::int16_t>(value);
+    return r.finish(true, seq);
+}
+
+// $PCTRF,* Flush the trajectory queue
+struct Pctrf {
+    static constexpr std::string_view tag = "PCTRF";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 10;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode([[maybe_unused]] const Pctrf &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCTRF,");
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, [[maybe_unused]] Pctrf &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCTRF,")) return false;
+    return r.finish(true, seq);
+}
+
+// $PCSYN,* Restart sequence numbering
+struct Pcsyn {
+    static constexpr std::string_view tag = "PCSYN";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 10;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode([[maybe_unused]] const Pcsyn &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCSYN,");
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, [[maybe_unused]] Pcsyn &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCSYN,")) return false;
+    return r.finish(true, seq);
+}
+
+// $PCSUB,stream,hz* Set a telemetry stream rate, 0 = off
+struct Pcsub {
+    static constexpr std::string_view tag = "PCSUB";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 17;
+    static constexpr std::int64_t hz_min = 0, hz_max = 50;
+    FixedString<4> stream;
+    std::uint8_t hz = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Pcsub &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCSUB,");
+    w.put_str(m.stream, Charset::upper);
+    w.put(',');
+    w.put_int(m.hz, m.hz_min, m.hz_max);
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, Pcsub &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$PCSUB,")) return false;
+    if (!r.get_str(m.stream, Charset::upper)) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.hz_min, m.hz_max)) return false;
+    m.hz = static_cast<std::uint8_t>(value);
+    return r.finish(true, seq);
+}
+
+// $PCPGT,name* Read a parameter
+struct Pcpgt {
+    static constexpr std::string_view tag = "PCPGT";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 21;
+    FixedString<11> name;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Pcpgt &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCPGT,");
+    w.put_str(m.name, Charset::ident);
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, Pcpgt &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCPGT,")) return false;
+    if (!r.get_str(m.name, Charset::ident)) return false;
+    return r.finish(true, seq);
+}
+
+// $PCPST,name,value* Write a parameter
+struct Pcpst {
+    static constexpr std::string_view tag = "PCPST";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 33;
+    static constexpr std::int64_t value_min = -2147483647, value_max = 2147483647;
+    FixedString<11> name;
+    std::int32_t value = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Pcpst &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCPST,");
+    w.put_str(m.name, Charset::ident);
+    w.put(',');
+    w.put_int(m.value, m.value_min, m.value_max);
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, Pcpst &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$PCPST,")) return false;
+    if (!r.get_str(m.name, Charset::ident)) return false;
+    if (!r.expect(",")) return false;
+    if (!r.get_int(value, m.value_min, m.value_max)) return false;
+    m.value = static_cast<std::int32_t>(value);
+    return r.finish(true, seq);
+}
+
+// $PCPSV,* Save the parameters to flash, only in wait state
+struct Pcpsv {
+    static constexpr std::string_view tag = "PCPSV";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 10;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode([[maybe_unused]] const Pcpsv &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCPSV,");
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, [[maybe_unused]] Pcpsv &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCPSV,")) return false;
+    return r.finish(true, seq);
+}
+
+// $PCPDF,* Restore the default parameters in RAM
+struct Pcpdf {
+    static constexpr std::string_view tag = "PCPDF";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 10;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode([[maybe_unused]] const Pcpdf &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCPDF,");
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, [[maybe_unused]] Pcpdf &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCPDF,")) return false;
+    return r.finish(true, seq);
+}
+
+// $PCLOG,* Dump the flight recorder
+struct Pclog {
+    static constexpr std::string_view tag = "PCLOG";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 10;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode([[maybe_unused]] const Pclog &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCLOG,");
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, [[maybe_unused]] Pclog &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCLOG,")) return false;
+    return r.finish(true, seq);
+}
+
+// $PCISR,* Report and restart the interrupt timing measurement
+struct Pcisr {
+    static constexpr std::string_view tag = "PCISR";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 10;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode([[maybe_unused]] const Pcisr &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCISR,");
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, [[maybe_unused]] Pcisr &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCISR,")) return false;
+    return r.finish(true, seq);
+}
+
+// $PCBDR,baud* Switch to a new rate once acknowledged
+struct Pcbdr {
+    static constexpr std::string_view tag = "PCBDR";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 17;
+    static constexpr std::int64_t baud_min = 1200, baud_max = 1000000;
+    std::uint32_t baud = 0;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode(const Pcbdr &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCBDR,");
+    w.put_int(m.baud, m.baud_min, m.baud_max);
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, Pcbdr &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    std::int64_t value;
+    if (!r.expect("$PCBDR,")) return false;
+    if (!r.get_int(value, m.baud_min, m.baud_max)) return false;
+    m.baud = static_cast<std::uint32_t>(value);
+    return r.finish(true, seq);
+}
+
+// $PCBOK,* Sent at the new rate to confirm it
+struct Pcbok {
+    static constexpr std::string_view tag = "PCBOK";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 10;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode([[maybe_unused]] const Pcbok &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCBOK,");
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, [[maybe_unused]] Pcbok &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCBOK,")) return false;
+    return r.finish(true, seq);
+}
+
+// $PCUPD,* Enter firmware update mode, only in wait state (update.h)
+struct Pcupd {
+    static constexpr std::string_view tag = "PCUPD";
+    static constexpr bool from_robot = false;
+    static constexpr std::size_t max_length = 10;
+};
+
+// Returns the length written to out (NUL terminated), 0 if a value is
+// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).
+inline std::size_t encode([[maybe_unused]] const Pcupd &m, char *out, std::size_t size, int seq = -1) {
+    detail::Writer w(out, size);
+    w.put("$PCUPD,");
+    return w.finish(out, seq);
+}
+
+inline bool decode(std::string_view line, [[maybe_unused]] Pcupd &m, int *seq = nullptr) {
+    detail::Reader r(line);
+    if (!r.expect("$PCUPD,")) return false;
+    return r.finish(true, seq);
+}
+
+using RobotMessage = std::variant<Mdist, Mbatt, Macc, Mtrj, Mest, Mpwr, Mlnk, Mtlm, Mack, Macks, Memrg, Mbtn, Msub, Mprm, Mlogs, Mlog, Mloge, Misr, Mbaud, Mrxdrop, Mupd, Mdsp, Err>;
+
+// Any robot message, by its tag
+inline std::optional<RobotMessage> decode_robot(std::string_view line, int *seq = nullptr) {
+    std::size_t end = line.find_first_of(",*");
+    if (line.empty() || line[0] != '$' || end == std::string_view::npos) return std::nullopt;
+    std::string_view tag = line.substr(1, end - 1);
+    if (tag == Mdist::tag) {
+        Mdist m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mbatt::tag) {
+        Mbatt m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Macc::tag) {
+        Macc m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mtrj::tag) {
+        Mtrj m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mest::tag) {
+        Mest m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mpwr::tag) {
+        Mpwr m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mlnk::tag) {
+        Mlnk m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mtlm::tag) {
+        Mtlm m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mack::tag) {
+        Mack m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Macks::tag) {
+        Macks m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Memrg::tag) {
+        Memrg m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mbtn::tag) {
+        Mbtn m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Msub::tag) {
+        Msub m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mprm::tag) {
+        Mprm m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mlogs::tag) {
+        Mlogs m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mlog::tag) {
+        Mlog m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mloge::tag) {
+        Mloge m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Misr::tag) {
+        Misr m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mbaud::tag) {
+        Mbaud m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mrxdrop::tag) {
+        Mrxdrop m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mupd::tag) {
+        Mupd m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Mdsp::tag) {
+        Mdsp m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Err::tag) {
+        Err m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    return std::nullopt;
+}
+
+using PcCommand = std::variant<Pcref, Pcstp, Pcstt, Pctrj, Pctrf, Pcsyn, Pcsub, Pcpgt, Pcpst, Pcpsv, Pcpdf, Pclog, Pcisr, Pcbdr, Pcbok, Pcupd>;
+
+// Any PC message, by its tag
+inline std::optional<PcCommand> decode_pc(std::string_view line, int *seq = nullptr) {
+    std::size_t end = line.find_first_of(",*");
+    if (line.empty() || line[0] != '$' || end == std::string_view::npos) return std::nullopt;
+    std::string_view tag = line.substr(1, end - 1);
+    if (tag == Pcref::tag) {
+        Pcref m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcstp::tag) {
+        Pcstp m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcstt::tag) {
+        Pcstt m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pctrj::tag) {
+        Pctrj m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pctrf::tag) {
+        Pctrf m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcsyn::tag) {
+        Pcsyn m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcsub::tag) {
+        Pcsub m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcpgt::tag) {
+        Pcpgt m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcpst::tag) {
+        Pcpst m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcpsv::tag) {
+        Pcpsv m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcpdf::tag) {
+        Pcpdf m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pclog::tag) {
+        Pclog m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcisr::tag) {
+        Pcisr m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcbdr::tag) {
+        Pcbdr m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcbok::tag) {
+        Pcbok m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    if (tag == Pcupd::tag) {
+        Pcupd m;
+        if (decode(line, m, seq)) return m;
+        return std::nullopt;
+    }
+    return std::nullopt;
+}
+
+// Message as a std::string, empty if it cannot be encoded
+template <class M>
+std::string to_string(const M &m, int seq = -1) {
+    char buffer[M::max_length + 8];  // + "#65535"
+    return std::string(buffer, encode(m, buffer, sizeof(buffer), seq));
+}
+
+}  // namespace robot::msg
@@ -0,0 +1,288 @@
+// ===============================================================
+// File: dsp_test.cpp
+// Author: group 1
+// Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+// Host test of the portable C path of dsp.c (make sim-test). Two
+// checks per filter:
+//   golden     the outputs for a fixed input (a noisy triangle with a
+//              full-scale square burst that drives the biquad into
+//              saturation) must match, bit for bit, vectors computed
+//              with exact integer arithmetic from the DSP engine rules
+//              dsp.h documents: fractional multiply, 1.31 saturation
+//              after every MAC, conventional rounding and saturation
+//              on the store. The engine build must give the same.
+//   reference  4000 samples of the triangle without the burst against
+//              a double-precision model of the same filter, within
+//              the rounding the fixed-point path is allowed: half an
+//              LSB for FIR and decimator, the rounding noise through
+//              the feedback for the biquad, the exact rounded mean
+//              for the moving average and the oversampler.
+// Fails (exit status 1) when an output is off.
+// Build: gcc -O2 -c ../ES_project_group_1.X/dsp.c
+//        g++ -std=c++20 -O2 -I../ES_project_group_1.X
+//            -o dsp_test dsp_test.cpp dsp.o
+// Usage: dsp_test
+// ===============================================================
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+extern "C" {
+#include "dsp.h"
+}
+
+namespace {
+
+// 16-tap low-pass, DC gain 1.10 (so the full-scale FIR case saturates)
+const q15_t FIR_COEFFS[] = {-220, -410, -260, 620, 2240, 4160, 5680, 6290,
+                            6290, 5680, 4160, 2240, 620, -260, -410, -220};
+constexpr int FIR_TAPS = sizeof(FIR_COEFFS) / sizeof(FIR_COEFFS[0]);
+// Low-pass biquad of dsp_benchmark(), halved coefficients
+constexpr q15_t BQ_B0 = 1106, BQ_B1 = 2210, BQ_B2 = 1106, BQ_A1 = -18727, BQ_A2 = 6763;
+constexpr int DECIMATION = 4;
+constexpr int AVG_LENGTH = 5; // AVG_WIN default
+constexpr int AVG_LONG = 16;
+constexpr int OSR_BITS = 2;
+constexpr int GOLDEN_SAMPLES = 96;
+constexpr int REFERENCE_SAMPLES = 4000;
+
+// Outputs for input(GOLDEN_SAMPLES, true)
+const q15_t EXPECTED_FIR[GOLDEN_SAMPLES] = {
+    153, 426, 559, 69, -1505, -4296, -7901, -11505, -14549, -16505, -16785, -15407,
+    -12922, -9985, -7108, -4579, -2334, -150, 2020, 4239, 6470, 8607, 10657, 12707,
+    14774, 16709, 18288, 19235, 19389, 18601, 16870, 14627, 12223, 9873, 7610, 5382,
+    3188, 1064, -1052, -3340, -5797, -8283, -10737, -13058, -15269, -17266, -18749, -19412,
+    -19436, -18944, -17744, -15211, -10612, -3799, 4923, 14322, 23050, 29046, 29816, 24308,
+    13286, -461, -14080, -24480, -28320, -24480, -13920, -1, 13919, 24479, 28319, 24479,
+    14139, 653, -12920, -24017, -30101, -30731, -27048, -21538, -16184, -12177, -10388, -10552,
+    -12195, -14468, -16506, -17917, -18604, -18726, -18185, -16897, -14904, -12211, -9025, -5642};
+const q15_t EXPECTED_BIQUAD[GOLDEN_SAMPLES] = {
+    -1536, -6244, -12039, -16109, -17894, -17297, -14505, -10924, -7836, -5421, -3710, -2083,
+    213, 2731, 4930, 6924, 8652, 10105, 11632, 13330, 15537, 17843, 18813, 18498,
+    17532, 15633, 13040, 10298, 7785, 5994, 4645, 2759, 313, -1976, -4034, -5844,
+    -7656, -10028, -12623, -14805, -16462, -17710, -18456, -18487, -17381, -15187, -12883, -11006,
+    -6835, 2758, 14817, 24641, 30892, 32767, 29121, 15340, -3331, -18983, -29167, -32768,
+    -29834, -16155, 2693, 18590, 28981, 32767, 29910, 16242, -2626, -18550, -28963, -32768,
+    -32126, -25643, -17194, -11037, -8004, -7714, -8981, -10876, -12967, -15001, -16673, -17651,
+    -17843, -17106, -15524, -13522, -11106, -8058, -4566, -1042, 2126, 4667, 6227, 7125};
+const q15_t EXPECTED_DECIMATOR[GOLDEN_SAMPLES / DECIMATION] = {
+    69, -11505, -15407, -4579, 4239, 12707, 19235, 14627, 5382, -3340, -13058, -19412,
+    -15211, 14322, 24308, -24480, -1, 24479, -24017, -21538, -10552, -17917, -16897, -5642};
+const q15_t EXPECTED_MOVAVG[GOLDEN_SAMPLES] = {
+    -22759, -21886, -20346, -19622, -18457, -15251, -11883, -9815, -6685, -4706, -3658, -1685,
+    871, 2577, 5117, 7712, 8437, 10354, 11797, 13838, 16276, 17701, 17621, 18451,
+    16720, 13798, 11950, 9719, 7245, 6103, 4276, 1710, 462, -2156, -4545, -6208,
+    -8098, -10857, -12718, -14743, -16838, -17627, -17863, -17729, -15844, -14417, -12322, -10648,
+    -894, 7261, 16159, 24423, 32767, 32767, 19660, 6553, -6554, -19661, -32768, -32768,
+    -19661, -6554, 6553, 19660, 32767, 32767, 19660, 6553, -6554, -19661, -32768, -32768,
+    -26201, -20376, -15772, -10429, -6873, -8933, -11393, -12267, -14795, -15336, -16938, -17099,
+    -17413, -15899, -14664, -12599, -9881, -6699, -3754, -415, 2621, 4667, 5588, 7255};
+
+int failures = 0;
+
+void check(bool condition, const char *filter, const char *what) {
+    if (condition) return;
+    std::printf("FAIL  %s: %s\n", filter, what);
+    failures++;
+}
+
+// Triangle of +-20000 (period 40) plus uniform noise of +-4096 from a
+// fixed LCG; with burst, samples 48..71 are a full-scale square
+std::vector<q15_t> input(int samples, bool burst) {
+    std::vector<q15_t> x(samples);
+    uint32_t state = 12345;
+    for (int i = 0; i < samples; i++) {
+        state = state * 1664525u + 1013904223u;
+        int noise = (int) ((state >> 16) & 0x1FFF) - 4096;
+        int phase = i % 40;
+        int triangle = (phase < 20) ? phase * 2000 - 20000 : 60000 - phase * 2000;
+        x[i] = (q15_t) (triangle + noise);
+        if (burst && i >= 48 && i < 72) x[i] = ((i / 6) % 2 == 0) ? 32767 : -32768;
+    }
+    return x;
+}
+
+template <size_t N>
+void check_golden(const char *filter, const std::vector<q15_t> &y, const q15_t (&expected)[N]) {
+    size_t first = N;
+    for (size_t i = 0; i < N && first == N; i++) {
+        if (i >= y.size() || y[i] != expected[i]) first = i;
+    }
+    char what[96];
+    std::snprintf(what, sizeof(what), "golden output %zu is %d, expected %d", first,
+                  first < y.size() ? y[first] : 0, first < N ? expected[first] : 0);
+    check(first == N && y.size() == N, filter, what);
+}
+
+void check_reference(const char *filter, const std::vector<q15_t> &y, const std::vector<double> &reference,
+                     double bound) {
+    double worst = 0;
+    for (size_t i = 0; i < y.size(); i++) worst = std::max(worst, std::fabs(y[i] - reference[i]));
+    char what[96];
+    std::snprintf(what, sizeof(what), "%.3f LSB away from the double model, bound %.3f", worst, bound);
+    check(worst <= bound, filter, what);
+    std::printf("%-8s reference max error %.3f LSB (bound %.3f)\n", filter, worst, bound);
+}
+
+std::vector<q15_t> run_fir(const std::vector<q15_t> &x) {
+    q15_t delay[FIR_TAPS];
+    DspFir fir;
+    dsp_fir_init(&fir, FIR_COEFFS, delay, FIR_TAPS);
+    std::vector<q15_t> y;
+    for (q15_t sample : x) y.push_back(dsp_fir(&fir, sample));
+    return y;
+}
+
+std::vector<q15_t> run_biquad(const std::vector<q15_t> &x) {
+    DspBiquad biquad;
+    dsp_biquad_init(&biquad, BQ_B0, BQ_B1, BQ_B2, BQ_A1, BQ_A2);
+    std::vector<q15_t> y;
+    for (q15_t sample : x) y.push_back(dsp_biquad(&biquad, sample));
+    return y;
+}
+
+std::vector<q15_t> run_decimator(const std::vector<q15_t> &x) {
+    q15_t delay[FIR_TAPS];
+    DspDecimator decimator;
+    dsp_decimator_init(&decimator, FIR_COEFFS, delay, FIR_TAPS, DECIMATION);
+    std::vector<q15_t> y;
+    for (q15_t sample : x) {
+        q15_t output;
+        if (dsp_decimate(&decimator, sample, &output)) y.push_back(output);
+    }
+    return y;
+}
+
+std::vector<q15_t> run_movavg(const std::vector<q15_t> &x, int length) {
+    std::vector<q15_t> buffer(length);
+    DspMovingAverage average;
+    dsp_movavg_init(&average, buffer.data(), length);
+    std::vector<q15_t> y;
+    for (q15_t sample : x) {
+        dsp_movavg_push(&average, sample);
+        y.push_back(dsp_movavg_output(&average));
+    }
+    return y;
+}
+
+// Double model of the FIR, x[n-k] = 0 before the first sample
+std::vector<double> fir_model(const std::vector<q15_t> &x) {
+    std::vector<double> y(x.size());
+    for (size_t n = 0; n < x.size(); n++) {
+        double sum = 0;
+        for (int k = 0; k < FIR_TAPS && k <= (int) n; k++) sum += FIR_COEFFS[k] / 32768.0 * x[n - k];
+        y[n] = sum;
+    }
+    return y;
+}
+
+void test_fir() {
+    std::vector<q15_t> golden = input(GOLDEN_SAMPLES, true);
+    check_golden("FIR16", run_fir(golden), EXPECTED_FIR);
+
+    // Full scale through a DC gain above 1: the accumulator saturates
+    // at the 11th tap, the three last (negative) taps are then taken off
+    // 1.31 full scale; a plain clip of the exact sum would give +-32767
+    std::vector<q15_t> high(2 * FIR_TAPS, 32767), low(2 * FIR_TAPS, -32768);
+    check(run_fir(high).back() == 31878 && run_fir(low).back() == -31878, "FIR16",
+          "accumulator not saturated after every MAC");
+
+    std::vector<q15_t> x = input(REFERENCE_SAMPLES, false);
+    check_reference("FIR16", run_fir(x), fir_model(x), 0.5);
+}
+
+void test_biquad() {
+    check_golden("BIQUAD", run_biquad(input(GOLDEN_SAMPLES, true)), EXPECTED_BIQUAD);
+
+    // Same quantised coefficients, undone halving
+    const double b0 = 2 * BQ_B0 / 32768.0, b1 = 2 * BQ_B1 / 32768.0, b2 = 2 * BQ_B2 / 32768.0;
+    const double a1 = 2 * BQ_A1 / 32768.0, a2 = 2 * BQ_A2 / 32768.0;
+    std::vector<q15_t> x = input(REFERENCE_SAMPLES, false);
+    std::vector<double> reference(x.size());
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    for (size_t n = 0; n < x.size(); n++) {
+        double y = b0 * x[n] + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1, x1 = x[n], y2 = y1, y1 = y;
+        reference[n] = y;
+    }
+    // Each stored output is off by at most half an LSB, an error that
+    // the recursion feeds back: bounded by 0.5 * sum |h| of 1/A(z)
+    double h1 = 0, h2 = 0, gain = 0;
+    for (int n = 0; n < 1000; n++) {
+        double h = (n == 0 ? 1.0 : 0.0) - a1 * h1 - a2 * h2;
+        h2 = h1, h1 = h;
+        gain += std::fabs(h);
+    }
+    check_reference("BIQUAD", run_biquad(x), reference, 0.5 * gain);
+}
+
+void test_decimator() {
+    check_golden("DECIM16/4", run_decimator(input(GOLDEN_SAMPLES, true)), EXPECTED_DECIMATOR);
+
+    std::vector<q15_t> x = input(REFERENCE_SAMPLES, false);
+    std::vector<q15_t> y = run_decimator(x), full = run_fir(x);
+    std::vector<double> model = fir_model(x), reference;
+    bool same = y.size() == x.size() / DECIMATION;
+    for (size_t i = 0; same && i < y.size(); i++) {
+        same = y[i] == full[DECIMATION * i + DECIMATION - 1];
+        reference.push_back(model[DECIMATION * i + DECIMATION - 1]);
+    }
+    check(same, "DECIM16/4", "not every 4th output of the same FIR");
+    if (same) check_reference("DECIM16/4", y, reference, 0.5);
+}
+
+void test_movavg() {
+    check_golden("MAVG5", run_movavg(input(GOLDEN_SAMPLES, true), AVG_LENGTH), EXPECTED_MOVAVG);
+
+    std::vector<q15_t> x = input(REFERENCE_SAMPLES, false);
+    for (int length : {AVG_LENGTH, AVG_LONG}) {
+        std::vector<q15_t> y = run_movavg(x, length);
+        std::vector<double> reference(x.size());
+        bool rounded = true;
+        for (size_t n = 0; n < x.size(); n++) {
+            double sum = 0;
+            size_t count = std::min<size_t>(n + 1, length);
+            for (size_t k = 0; k < count; k++) sum += x[n - k];
+            reference[n] = sum / count;
+            rounded = rounded && y[n] == std::lround(reference[n]); // ties away from zero
+        }
+        const char *filter = (length == AVG_LENGTH) ? "MAVG5" : "MAVG16";
+        check(rounded, filter, "mean not rounded half away from zero");
+        check_reference(filter, y, reference, 0.5);
+    }
+}
+
+void test_oversampler() {
+    DspOversampler oversampler;
+    dsp_oversample_init(&oversampler, OSR_BITS);
+    std::vector<q15_t> x = input(REFERENCE_SAMPLES, false);
+    uint32_t sum = 0;
+    int count = 0;
+    bool exact = true;
+    for (q15_t sample : x) {
+        uint16_t reading = (uint16_t) (sample + 32768) >> 4; // 12-bit ADC codes
+        uint16_t y;
+        sum += reading;
+        if (dsp_oversample(&oversampler, reading, &y)) {
+            exact = exact && y == (uint16_t) std::floor(sum / double(1 << OSR_BITS) + 0.5);
+            sum = 0;
+        }
+        count++;
+    }
+    check(exact, "OSR2", "decimated value not the rounded sum / 2^bits");
+    std::printf("%-8s %d samples exact\n", "OSR2", count);
+}
+
+} // namespace
+
+int main() {
+    test_fir();
+    test_biquad();
+    test_decimator();
+    test_movavg();
+    test_oversampler();
+    if (failures == 0) std::printf("all outputs as expected\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,616 @@
+// ===============================================================
+// File: estop_sim.cpp
+// Author: group 1
+// Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+// Closed-loop Monte-Carlo simulator for tuning the emergency stop.
+// The obstacle guard, emergency hold and motor mixer are the firmware
+// code itself (control.c), fed by the IR oversampler of dsp.c; around
+// them it mirrors the ADC interrupt, the STATE_MOVING and
+// STATE_EMERGENCY blocks of main.c and the IR rate policy of power.c.
+// The IR sensor is the inverse of the calibration curve with gaussian
+// noise, glitches, 10-bit quantisation and the fold-back below its
+// minimum range; the robot is a differential drive with first-order
+// motors. Randomised scenarios (wall, approaching obstacle, crossing
+// obstacle, open space) run for every combination of the parameter
+// lists on all cores (work_pool.hpp); a scenario uses the same seed
+// for every parameter set so the sets are compared on identical runs.
+// Per set and scenario it reports triggers, false triggers (path
+// still longer than DIST_THR and time-to-collision above TTC_BRAKE),
+// collisions, the clearance left once stopped and the time spent in
+// emergency before EMRG_HOLD let the robot go.
+// Build: gcc -O2 -c ../ES_project_group_1.X/control.c
+//            ../ES_project_group_1.X/dsp.c
+//        g++ -std=c++20 -O2 -pthread -I../ES_project_group_1.X
+//            -o estop_sim estop_sim.cpp control.o dsp.o
+// Usage: estop_sim [--runs 2000] [--threads N] [--seed 1]
+//                  [--dist 200,...] [--hold 5000,...]
+//                  [--ttc-stop 400,...] [--ttc-brake 1500,...]
+//                  [--osr 2,...] [--ir-hz 0 (power.c policy)]
+//                  [--noise 0.5] [--glitch 0.0005] [--vmax 0.5]
+//                  [--tau 0.08] [--duration 12]
+//                  [--scenario wall,approach,crossing,open]
+// ===============================================================
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "control.h"
+#include "dsp.h"
+}
+#include "work_pool.hpp"
+
+namespace {
+
+constexpr int TICK_HZ = 500; // main loop, TIMER1
+constexpr double TICK_S = 1.0 / TICK_HZ;
+constexpr int ADC_SAMPLE_HZ = 500; // adc.h
+constexpr int PWM_PERIOD = 7200; // PWM_PERIOD parameter default
+// IR rate policy (power.h)
+constexpr unsigned PWR_IDLE_HZ = 50;
+constexpr unsigned PWR_CRUISE_HZ = 125;
+constexpr unsigned PWR_FAST_HZ = 250;
+constexpr unsigned PWR_MAX_HZ = 500;
+constexpr int PWR_FAST_SPEED = 150; // mm/s
+constexpr int PWR_MAX_SPEED = 350; // mm/s
+constexpr int PWR_RATE_HOLD_MS = 500;
+// Robot body
+constexpr double ROBOT_RADIUS = 0.10; // m, the IR sensor sits on the front
+constexpr double TRACK = 0.20; // m between the wheels
+constexpr double REST_SPEED = 0.005; // m/s, stopped below this
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+enum Scenario { WALL, APPROACH, CROSSING, OPEN, SCENARIOS };
+const char *const SCENARIO_NAMES[SCENARIOS] = {"wall", "approach", "crossing", "open"};
+
+struct ParamSet {
+    int distance_threshold_mm, emergency_hold_ms, ttc_stop_ms, ttc_brake_ms, osr_bits;
+};
+
+struct Options {
+    int runs = 2000; // per parameter set
+    unsigned threads = 0;
+    std::uint64_t seed = 1;
+    std::vector<int> dist{200}, hold{5000}, ttc_stop{400}, ttc_brake{1500}, osr{2};
+    unsigned ir_hz = 0; // 0: rate chosen like power.c
+    double noise = 0.5; // LSB rms per conversion
+    double glitch = 0.0005; // probability of a random code per conversion
+    double vmax = 0.5; // m/s at full duty cycle
+    double tau = 0.08; // s, motor time constant
+    double duration = 12.0; // s, longest run
+    std::vector<int> scenarios{WALL, APPROACH, CROSSING, OPEN};
+};
+
+// ---------------------------------------------------------------
+// IR sensor: ADC code for a distance, inverse of the calibration
+// polynomial behind the control.c table
+// ---------------------------------------------------------------
+class IrSensor {
+public:
+    IrSensor() {
+        // The curve decreases up to its minimum, the closest distance
+        // the sensor can tell; closer than that the output falls again
+        peak_volts_ = 0;
+        for (double v = 0; v <= 3.3; v += 0.0005) {
+            if (curve(v) < curve(peak_volts_)) peak_volts_ = v;
+        }
+        min_mm_ = curve(peak_volts_) * 1000;
+        for (int mm = 0; mm < TABLE_MM; mm++) table_[mm] = solve(mm);
+    }
+
+    double min_range_mm() const { return min_mm_; }
+
+    // Noise-free ADC code (fractional) for a distance in m
+    double code(double metres) const {
+        double mm = metres * 1000;
+        if (!(mm < TABLE_MM - 1)) return table_[TABLE_MM - 1];
+        int i = (int) mm;
+        return table_[i] + (table_[i + 1] - table_[i]) * (mm - i);
+    }
+
+private:
+    static constexpr int TABLE_MM = 2400;
+
+    static double curve(double v) {
+        return 2.34 + v * (-4.74 + v * (4.06 + v * (-1.60 + v * 0.24)));
+    }
+
+    double solve(int mm) const {
+        double volts;
+        if (mm < min_mm_) {
+            volts = peak_volts_ * mm / min_mm_; // fold-back
+        } else {
+            double low = 0, high = peak_volts_;
+            for (int i = 0; i < 50; i++) {
+                double middle = (low + high) / 2;
+                if (curve(middle) * 1000 > mm) low = middle;
+                else high = middle;
+            }
+            volts = (low + high) / 2;
+        }
+        return volts * 1023 / 3.3;
+    }
+
+    double peak_volts_, min_mm_;
+    double table_[TABLE_MM];
+};
+
+// ---------------------------------------------------------------
+// World: one robot and at most one obstacle
+// ---------------------------------------------------------------
+struct Obstacle {
+    enum Kind { NONE, WALL_X, DISC } kind = NONE;
+    double x = 0, y = 0, radius = 0; // wall: plane x = x
+    double vx = 0, vy = 0, stop_time = INF;
+};
+
+struct Robot {
+    double x = 0, y = 0, heading = 0;
+    double left = 0, right = 0; // wheel speeds, m/s
+    double speed() const { return (left + right) / 2; }
+};
+
+// Distance from the IR sensor to the obstacle along its beam
+double ray_distance(const Robot &robot, const Obstacle &obstacle) {
+    double dx = std::cos(robot.heading), dy = std::sin(robot.heading);
+    double sx = robot.x + ROBOT_RADIUS * dx, sy = robot.y + ROBOT_RADIUS * dy;
+    switch (obstacle.kind) {
+    case Obstacle::WALL_X:
+        if (dx < 1e-6) return INF;
+        return std::max(0.0, (obstacle.x - sx) / dx);
+    case Obstacle::DISC: {
+        double fx = sx - obstacle.x, fy = sy - obstacle.y;
+        double b = fx * dx + fy * dy;
+        double c = fx * fx + fy * fy - obstacle.radius * obstacle.radius;
+        double discriminant = b * b - c;
+        if (c <= 0) return 0; // sensor inside
+        if (discriminant < 0 || b > 0) return INF;
+        return -b - std::sqrt(discriminant);
+    }
+    default:
+        return INF;
+    }
+}
+
+// Gap between the robot body and the obstacle, collision at 0
+double clearance(const Robot &robot, const Obstacle &obstacle) {
+    switch (obstacle.kind) {
+    case Obstacle::WALL_X:
+        return obstacle.x - robot.x - ROBOT_RADIUS;
+    case Obstacle::DISC:
+        return std::hypot(obstacle.x - robot.x, obstacle.y - robot.y) - ROBOT_RADIUS - obstacle.radius;
+    default:
+        return INF;
+    }
+}
+
+struct ScenarioSetup {
+    Robot robot;
+    Obstacle obstacle;
+    int speed = 0, yawrate = 0; // $PCREF setpoint
+};
+
+ScenarioSetup make_scenario(int scenario, std::mt19937_64 &random) {
+    auto uniform = [&](double low, double high) {
+        return std::uniform_real_distribution<double>(low, high)(random);
+    };
+    ScenarioSetup setup;
+    Obstacle &o = setup.obstacle;
+    switch (scenario) {
+    case WALL: // straight or slightly curved run into a wall
+        setup.robot.heading = uniform(-0.2, 0.2);
+        setup.speed = (int) uniform(30, 100);
+        setup.yawrate = (int) uniform(-2, 2);
+        o.kind = Obstacle::WALL_X;
+        o.x = ROBOT_RADIUS + uniform(0.6, 1.6);
+        break;
+    case APPROACH: // something coming the other way, stopping at some point
+        setup.speed = (int) uniform(20, 80);
+        o.kind = Obstacle::DISC;
+        o.radius = uniform(0.05, 0.15);
+        o.x = uniform(1.6, 2.3);
+        o.y = uniform(-0.03, 0.03);
+        o.vx = -uniform(0.1, 0.4);
+        o.stop_time = uniform(0.5, 4.0);
+        break;
+    case CROSSING: { // something crossing the path, then gone
+        setup.speed = (int) uniform(30, 100);
+        o.kind = Obstacle::DISC;
+        o.radius = uniform(0.05, 0.15);
+        double side = (random() & 1) ? 1.0 : -1.0;
+        double crossing_speed = uniform(0.2, 0.6);
+        o.x = uniform(0.5, 1.6);
+        o.y = side * uniform(0.4, 1.2);
+        o.vy = -side * crossing_speed;
+        break;
+    }
+    default: // open space, only sensor noise and glitches
+        setup.speed = (int) uniform(30, 100);
+        setup.yawrate = (int) uniform(-30, 30);
+        break;
+    }
+    return setup;
+}
+
+// ---------------------------------------------------------------
+// One closed-loop run
+// ---------------------------------------------------------------
+struct RunResult {
+    bool triggered = false;
+    bool false_trigger = false;
+    bool collided = false;
+    bool collided_moving = false; // the robot still driving into it
+    bool cleared = false; // EMRG_HOLD elapsed, back to waiting
+    double stop_clearance = INF; // m, once at rest after the trigger
+    double emergency_s = 0;
+};
+
+class FirmwareRun {
+public:
+    FirmwareRun(const Options &options, const ParamSet &set, const IrSensor &sensor, std::uint64_t seed)
+        : options_(options), sensor_(sensor), random_(seed) {
+        limits_ = ControlLimits{(uint16_t) set.distance_threshold_mm, (uint16_t) set.emergency_hold_ms,
+                                (uint16_t) set.ttc_brake_ms, (uint16_t) set.ttc_stop_ms};
+        control_guard_init(&guard_);
+        dsp_oversample_init(&oversampler_, set.osr_bits);
+        osr_bits_ = set.osr_bits;
+    }
+
+    RunResult run(const ScenarioSetup &setup) {
+        RunResult result;
+        robot_ = setup.robot;
+        obstacle_ = setup.obstacle;
+        // Already cruising when the run starts
+        int left, right;
+        control_mix(setup.speed, setup.yawrate, PWM_PERIOD, &left, &right);
+        robot_.left = wheel_speed(left);
+        robot_.right = wheel_speed(right);
+
+        double previous_ray = ray_distance(robot_, obstacle_);
+        double trigger_time = 0;
+        int ticks = (int) (options_.duration * TICK_HZ);
+        for (int tick = 0; tick < ticks; tick++) {
+            double now = tick * TICK_S;
+            step_world(now);
+            double ray = ray_distance(robot_, obstacle_);
+            double gap = clearance(robot_, obstacle_);
+            if (gap <= 0) {
+                result.collided = true;
+                result.collided_moving = std::fabs(robot_.speed()) > REST_SPEED;
+                break;
+            }
+
+            // ADC interrupt at the IR result rate
+            if (--ticks_to_result_ <= 0) {
+                ticks_to_result_ = TICK_HZ / ir_hz_;
+                adc_interrupt(ray);
+            }
+
+            // Main loop, STATE_MOVING and STATE_EMERGENCY blocks
+            int distance_mm = guard_.distance_mm;
+            if (state_ == MOVING) {
+                int speed = control_brake_speed(setup.speed, guard_.brake_percent);
+                if (stop_request_) {
+                    stop_request_ = false;
+                    state_ = EMERGENCY;
+                    clear_ms_ = 0;
+                    left_pwm_ = right_pwm_ = 0;
+                    result.triggered = true;
+                    trigger_time = now;
+                    // Judged on the true geometry when the stop happened
+                    double closing = (previous_ray - ray) / TICK_S;
+                    double ttc = (closing > 0.01) ? ray / closing : INF;
+                    result.false_trigger = ray * 1000 >= limits_.distance_threshold_mm
+                            && ttc * 1000 >= limits_.ttc_brake_ms;
+                } else {
+                    armed_ = true;
+                    control_mix(speed, setup.yawrate, PWM_PERIOD, &left_pwm_, &right_pwm_);
+                }
+            } else {
+                armed_ = false;
+            }
+            if (state_ == EMERGENCY) {
+                if (control_hold_step(&clear_ms_, distance_mm, 1000 / TICK_HZ, &limits_)) {
+                    state_ = WAITING;
+                    result.cleared = true;
+                    result.emergency_s = now - trigger_time;
+                    break;
+                }
+                if (result.stop_clearance == INF && std::fabs(robot_.speed()) < REST_SPEED) {
+                    result.stop_clearance = gap;
+                }
+            }
+            power_update();
+            previous_ray = ray;
+        }
+        if (result.triggered && !result.cleared && !result.collided) {
+            result.emergency_s = options_.duration - trigger_time;
+        }
+        return result;
+    }
+
+private:
+    enum State { WAITING, MOVING, EMERGENCY };
+
+    double wheel_speed(int pwm) const { return options_.vmax * pwm / PWM_PERIOD; }
+
+    void step_world(double now) {
+        double alpha = 1 - std::exp(-TICK_S / options_.tau);
+        robot_.left += (wheel_speed(left_pwm_) - robot_.left) * alpha;
+        robot_.right += (wheel_speed(right_pwm_) - robot_.right) * alpha;
+        double v = robot_.speed(), w = (robot_.right - robot_.left) / TRACK;
+        robot_.x += v * std::cos(robot_.heading) * TICK_S;
+        robot_.y += v * std::sin(robot_.heading) * TICK_S;
+        robot_.heading += w * TICK_S;
+        if (now < obstacle_.stop_time) {
+            obstacle_.x += obstacle_.vx * TICK_S;
+            obstacle_.y += obstacle_.vy * TICK_S;
+        }
+    }
+
+    // adc.c _AD1Interrupt for one IR result: 4^OSR_IR conversions
+    void adc_interrupt(double ray) {
+        std::normal_distribution<double> noise(0.0, options_.noise);
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        double code = sensor_.code(ray);
+        uint16_t value = 0;
+        int conversions = 1 << (2 * osr_bits_);
+        for (int i = 0; i < conversions; i++) {
+            double sample = (chance(random_) < options_.glitch) ? chance(random_) * 1023 : code + noise(random_);
+            uint16_t adc = (uint16_t) std::clamp(std::lround(sample), 0L, 1023L);
+            dsp_oversample(&oversampler_, adc, &value);
+        }
+        int distance_mm = control_adc_to_mm(value << (CONTROL_ADC_BITS - 10 - osr_bits_));
+        ControlStop stop = control_guard_update(&guard_, distance_mm, time_step_, &limits_);
+        if (armed_ && stop != CONTROL_CLEAR) {
+            left_pwm_ = right_pwm_ = 0;
+            armed_ = false;
+            stop_request_ = true;
+        }
+    }
+
+    // power.c power_update, the estimator speed taken as exact
+    void power_update() {
+        unsigned rate = options_.ir_hz;
+        if (!rate) {
+            int speed = (int) std::lround(std::fabs(robot_.speed()) * 1000);
+            speed = std::max(speed, guard_.closing_mm_s);
+            if (state_ != MOVING) rate = PWR_IDLE_HZ;
+            else if (guard_.distance_mm < 2 * limits_.distance_threshold_mm) rate = PWR_MAX_HZ;
+            else if (speed >= PWR_MAX_SPEED) rate = PWR_MAX_HZ;
+            else if (speed >= PWR_FAST_SPEED) rate = PWR_FAST_HZ;
+            else rate = PWR_CRUISE_HZ;
+        }
+        if (rate >= ir_hz_) {
+            rate_hold_ms_ = 0;
+            set_rate(rate);
+        } else {
+            rate_hold_ms_ += 1000 / TICK_HZ;
+            if (rate_hold_ms_ >= PWR_RATE_HOLD_MS) {
+                rate_hold_ms_ = 0;
+                set_rate(rate);
+            }
+        }
+    }
+
+    void set_rate(unsigned hz) {
+        if (hz == ir_hz_) return;
+        ir_hz_ = hz;
+        time_step_ = ADC_SAMPLE_HZ / hz;
+        ticks_to_result_ = std::min(ticks_to_result_, (int) (TICK_HZ / hz));
+    }
+
+    const Options &options_;
+    const IrSensor &sensor_;
+    std::mt19937_64 random_;
+    ControlLimits limits_;
+    ControlGuard guard_;
+    DspOversampler oversampler_;
+    int osr_bits_;
+    Robot robot_;
+    Obstacle obstacle_;
+    State state_ = MOVING;
+    bool armed_ = false, stop_request_ = false;
+    uint16_t clear_ms_ = 0;
+    int left_pwm_ = 0, right_pwm_ = 0;
+    // Started from waiting, so at the idle rate until the first update
+    unsigned ir_hz_ = PWR_IDLE_HZ;
+    uint16_t time_step_ = ADC_SAMPLE_HZ / PWR_IDLE_HZ;
+    int ticks_to_result_ = 1;
+    int rate_hold_ms_ = 0;
+};
+
+// ---------------------------------------------------------------
+// Statistics per parameter set and scenario
+// ---------------------------------------------------------------
+struct Stats {
+    int runs = 0, triggers = 0, false_triggers = 0;
+    int collisions = 0, collisions_moving = 0, collisions_untriggered = 0;
+    int cleared = 0;
+    double emergency_s = 0;
+    std::vector<float> stop_mm;
+
+    void add(const RunResult &r) {
+        runs++;
+        triggers += r.triggered;
+        false_triggers += r.false_trigger;
+        collisions += r.collided;
+        collisions_moving += r.collided_moving;
+        collisions_untriggered += r.collided && !r.triggered;
+        if (r.cleared) {
+            cleared++;
+            emergency_s += r.emergency_s;
+        }
+        if (r.stop_clearance != INF) stop_mm.push_back((float) (r.stop_clearance * 1000));
+    }
+
+    void merge(const Stats &other) {
+        runs += other.runs;
+        triggers += other.triggers;
+        false_triggers += other.false_triggers;
+        collisions += other.collisions;
+        collisions_moving += other.collisions_moving;
+        collisions_untriggered += other.collisions_untriggered;
+        cleared += other.cleared;
+        emergency_s += other.emergency_s;
+        stop_mm.insert(stop_mm.end(), other.stop_mm.begin(), other.stop_mm.end());
+    }
+};
+
+std::uint64_t mix_seed(std::uint64_t x) {
+    // splitmix64 finaliser
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+void print_stats(const char *name, Stats &s) {
+    std::printf("  %-9s %6d %6d %6d %5d %6d %6d", name, s.runs, s.triggers, s.false_triggers,
+                s.collisions, s.collisions_moving, s.collisions_untriggered);
+    if (s.stop_mm.empty()) {
+        std::printf(" %6s %6s %6s", "-", "-", "-");
+    } else {
+        std::sort(s.stop_mm.begin(), s.stop_mm.end());
+        double sum = 0;
+        for (float v : s.stop_mm) sum += v;
+        std::printf(" %6.0f %6.0f %6.0f", sum / s.stop_mm.size(), s.stop_mm[s.stop_mm.size() / 20], s.stop_mm.front());
+    }
+    if (s.cleared) std::printf(" %6d %7.2f\n", s.cleared, s.emergency_s / s.cleared);
+    else std::printf(" %6d %7s\n", 0, "-");
+}
+
+std::vector<int> parse_list(const char *text) {
+    std::vector<int> values;
+    for (const char *p = text; *p;) {
+        values.push_back(std::atoi(p));
+        p = std::strchr(p, ',');
+        if (!p) break;
+        p++;
+    }
+    return values;
+}
+
+bool parse_scenarios(const char *text, std::vector<int> &scenarios) {
+    scenarios.clear();
+    std::string list(text);
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        std::size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        std::string name = list.substr(start, end - start);
+        int found = -1;
+        for (int i = 0; i < SCENARIOS; i++) {
+            if (name == SCENARIO_NAMES[i]) found = i;
+        }
+        if (found < 0) return false;
+        scenarios.push_back(found);
+        start = end + 1;
+    }
+    return !scenarios.empty();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (!std::strcmp(arg, "--runs") && ok) options.runs = std::atoi(value);
+        else if (!std::strcmp(arg, "--threads") && ok) options.threads = std::atoi(value);
+        else if (!std::strcmp(arg, "--seed") && ok) options.seed = std::strtoull(value, nullptr, 0);
+        else if (!std::strcmp(arg, "--dist") && ok) options.dist = parse_list(value);
+        else if (!std::strcmp(arg, "--hold") && ok) options.hold = parse_list(value);
+        else if (!std::strcmp(arg, "--ttc-stop") && ok) options.ttc_stop = parse_list(value);
+        else if (!std::strcmp(arg, "--ttc-brake") && ok) options.ttc_brake = parse_list(value);
+        else if (!std::strcmp(arg, "--osr") && ok) options.osr = parse_list(value);
+        else if (!std::strcmp(arg, "--ir-hz") && ok) options.ir_hz = std::atoi(value);
+        else if (!std::strcmp(arg, "--noise") && ok) options.noise = std::atof(value);
+        else if (!std::strcmp(arg, "--glitch") && ok) options.glitch = std::atof(value);
+        else if (!std::strcmp(arg, "--vmax") && ok) options.vmax = std::atof(value);
+        else if (!std::strcmp(arg, "--tau") && ok) options.tau = std::atof(value);
+        else if (!std::strcmp(arg, "--duration") && ok) options.duration = std::atof(value);
+        else if (!std::strcmp(arg, "--scenario") && ok && parse_scenarios(value, options.scenarios)) {}
+        else ok = false;
+        if (!ok) {
+            std::fprintf(stderr,
+                         "usage: %s [--runs N] [--threads N] [--seed N] [--dist MM,..] [--hold MS,..]\n"
+                         "       [--ttc-stop MS,..] [--ttc-brake MS,..] [--osr BITS,..] [--ir-hz HZ]\n"
+                         "       [--noise LSB] [--glitch P] [--vmax M/S] [--tau S] [--duration S]\n"
+                         "       [--scenario wall,approach,crossing,open]\n",
+                         argv[0]);
+            return 2;
+        }
+        i++;
+    }
+    if (options.ir_hz && (options.ir_hz > PWR_MAX_HZ || ADC_SAMPLE_HZ % options.ir_hz)) {
+        std::fprintf(stderr, "--ir-hz must divide %d\n", ADC_SAMPLE_HZ);
+        return 2;
+    }
+
+    std::vector<ParamSet> sets;
+    for (int dist : options.dist)
+        for (int hold : options.hold)
+            for (int stop : options.ttc_stop)
+                for (int brake : options.ttc_brake)
+                    for (int osr : options.osr) {
+                        if (osr < 1 || osr > 3 || brake <= stop) {
+                            std::fprintf(stderr, "skipping OSR %d TTC_STOP %d TTC_BRAKE %d\n", osr, stop, brake);
+                            continue;
+                        }
+                        sets.push_back({dist, hold, stop, brake, osr});
+                    }
+    if (sets.empty() || options.runs <= 0) return 2;
+
+    IrSensor sensor;
+    sim::WorkPool pool(options.threads ? options.threads : std::thread::hardware_concurrency());
+
+    // Per worker accumulators, merged once all runs are done
+    std::size_t cells = sets.size() * SCENARIOS;
+    std::vector<std::vector<Stats>> worker_stats(pool.size(), std::vector<Stats>(cells));
+    std::size_t jobs = sets.size() * (std::size_t) options.runs;
+    auto start = std::chrono::steady_clock::now();
+    pool.parallel_for(jobs, 16, [&](unsigned worker, std::size_t job) {
+        std::size_t set = job / options.runs, run = job % options.runs;
+        int scenario = options.scenarios[run % options.scenarios.size()];
+        std::uint64_t seed = mix_seed(options.seed * 0x100000001B3ull + run);
+        std::mt19937_64 random(seed);
+        ScenarioSetup setup = make_scenario(scenario, random);
+        FirmwareRun firmware(options, sets[set], sensor, mix_seed(seed));
+        worker_stats[worker][set * SCENARIOS + scenario].add(firmware.run(setup));
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%zu parameter sets x %d runs, %u threads, %.2f s (%.0f runs/s, %llu steals)\n",
+                sets.size(), options.runs, pool.size(), seconds, jobs / seconds,
+                (unsigned long long) pool.steals());
+    std::printf("IR sensor minimum range %.0f mm, noise %.2f LSB, glitches %.4f, vmax %.2f m/s\n",
+                sensor.min_range_mm(), options.noise, options.glitch, options.vmax);
+    for (std::size_t i = 0; i < sets.size(); i++) {
+        const ParamSet &p = sets[i];
+        std::printf("\nDIST_THR %d  EMRG_HOLD %d  TTC_STOP %d  TTC_BRAKE %d  OSR_IR %d\n",
+                    p.distance_threshold_mm, p.emergency_hold_ms, p.ttc_stop_ms, p.ttc_brake_ms, p.osr_bits);
+        std::printf("  %-9s %6s %6s %6s %5s %6s %6s %6s %6s %6s %6s %7s\n", "scenario", "runs", "trig", "false",
+                    "coll", "moving", "unseen", "stop", "p5", "min", "clear", "emrg_s");
+        Stats all;
+        for (int scenario = 0; scenario < SCENARIOS; scenario++) {
+            Stats merged;
+            for (auto &stats : worker_stats) merged.merge(stats[i * SCENARIOS + scenario]);
+            if (!merged.runs) continue;
+            all.merge(merged);
+            print_stats(SCENARIO_NAMES[scenario], merged);
+        }
+        print_stats("all", all);
+    }
+    return 0;
+}
@@ -0,0 +1,602 @@
+#!/usr/bin/env python3
+# ===============================================================
+# File: fw_tests.py
+# Author: group 1
+# Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+# Scripted tests of the whole firmware on the host (make sim-test).
+# Builds the firmware against sim/xc.h together with fw_trace.cpp,
+# replays every scenario and checks its --log timeline (lines sent on
+# UART1, OC1-OC4 duty cycles) and the report. Also builds and runs
+# dsp_test.cpp, the golden vectors of the dsp.c filters. Scenarios:
+#   approach_*  obstacle distance profiles (--profile) against the
+#               emergency path of the ADC interrupt: no braking at a
+#               distance, graded braking, TTC stop, DIST_THR stop and
+#               an obstacle cutting in
+#   preempt_*   the ADC interrupt moved (--adc-delay) so that it
+#               preempts the main loop at every point of its motor
+#               update, against the invariants shared by both
+#   flood_*     command bursts at 1 Mbaud against the per-tick command
+#               budget, the setpoint coalescing and the drop reporting
+#   link_*      telemetry subscriptions against the link budget when
+#               the rate goes down
+#   isr_*       the $MISR interrupt timing report
+#   recorder_*  flight recorder dumps ($PCLOG) and the events logged
+#               while a dump is in progress
+#   incident_*  accelerometer incidents (--impact, --stuck, --lift)
+#               against the collision, stall and lift stops, and a
+#               full-speed start and stop that must not trigger them
+#   dsp_*       sim/dsp_test.cpp
+# The distance profile is replayed, it does not follow the robot.
+# Fails (exit status 1) when an expectation is not met.
+# Usage: python3 sim/fw_tests.py [--build DIR] [--cc gcc] [--cxx g++]
+#            [NAME...]
+# ===============================================================
+
+import argparse
+import concurrent.futures
+import glob
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+SIM = os.path.dirname(os.path.abspath(__file__))
+FIRMWARE = os.path.join(SIM, '..', 'ES_project_group_1.X')
+
+# Defaults of the parameter table (params.c)
+DIST_THR_MM = 200
+TTC_STOP_MS = 400
+STALL_MS = 200
+LIFT_MS = 200
+
+# Drive at 50 % with T2, as the default fw_trace script
+DRIVE = ['--rx', '10:$PCREF,50,0*', '--press', 'T2:50']
+DRIVING_MS = 150  # the motors are running after this
+
+
+class Failure(Exception):
+    pass
+
+
+def expect(condition, message):
+    if not condition:
+        raise Failure(message)
+
+
+# ---------------------------------------------------------------
+# Build
+# ---------------------------------------------------------------
+def build(directory, cc, cxx):
+    """Compiles the firmware objects, links fw_trace and dsp_test, returns the fw_trace path."""
+    sources = sorted(glob.glob(os.path.join(FIRMWARE, '*.c')))
+
+    def compile_c(source):
+        obj = os.path.join(directory, os.path.basename(source)[:-2] + '.o')
+        subprocess.run([cc, '-std=gnu99', '-O1', '-c', '-Wall', '-Wno-attributes', '-finstrument-functions',
+                        '-Dmain=firmware_main', '-I' + SIM, '-I' + FIRMWARE, '-o', obj, source], check=True)
+        return obj
+
+    with concurrent.futures.ThreadPoolExecutor() as pool:
+        objects = list(pool.map(compile_c, sources))
+    program = os.path.join(directory, 'fw_trace')
+    subprocess.run([cxx, '-std=c++20', '-O2', '-Wall', '-I' + SIM, '-o', program, os.path.join(SIM, 'fw_trace.cpp')]
+                   + objects + ['-Wl,--wrap=tmr_wait_period'], check=True)
+
+    # dsp.c alone, without the instrumentation of fw_trace
+    dsp = os.path.join(directory, 'dsp_host.o')
+    subprocess.run([cc, '-O2', '-c', '-Wall', '-o', dsp, os.path.join(FIRMWARE, 'dsp.c')], check=True)
+    subprocess.run([cxx, '-std=c++20', '-O2', '-Wall', '-I' + FIRMWARE, '-o', os.path.join(directory, 'dsp_test'),
+                    os.path.join(SIM, 'dsp_test.cpp'), dsp], check=True)
+    return program
+
+
+# ---------------------------------------------------------------
+# Runs
+# ---------------------------------------------------------------
+class Run:
+    """Report and --log timeline of one fw_trace run."""
+
+    def __init__(self, report, log_path):
+        self.report = report
+        self.tx = []  # (ms, line)
+        self.duties = []  # (ms, (oc1, oc2, oc3, oc4), context)
+        with open(log_path) as lines:
+            for line in lines:
+                ms, kind, rest = line.rstrip('\n').split(' ', 2)
+                if kind == 'tx':
+                    self.tx.append((float(ms), rest))
+                elif kind == 'oc':
+                    fields = rest.split()
+                    self.duties.append((float(ms), tuple(int(d) for d in fields[:4]), fields[4]))
+        # The four registers are written one after the other: keep the
+        # values that held for more than a few instructions, and every
+        # write in writes
+        self.writes = self.duties
+        self.duties = [d for d, after in zip(self.writes, self.writes[1:] + [(float('inf'), None)])
+                       if after[0] - d[0] > 0.005]
+
+    def forward(self, start_ms=0, end_ms=float('inf')):
+        """(ms, forward duty) of the changes in [start_ms, end_ms), with the value at start_ms first."""
+        result = [(start_ms, self.forward_at(start_ms))]
+        for ms, (lf, lb, rf, rb), _ in self.duties:
+            if start_ms < ms < end_ms:
+                result.append((ms, (lf - lb + rf - rb) / 2))
+        return result
+
+    def cruise(self):
+        """Forward duty of the first drive, before anything slows it down."""
+        return next((duty for _, duty in self.forward()[1:] if duty > 0), 0)
+
+    def forward_at(self, at_ms):
+        value = 0
+        for ms, (lf, lb, rf, rb), _ in self.duties:
+            if ms > at_ms:
+                break
+            value = (lf - lb + rf - rb) / 2
+        return value
+
+    def stopped_at(self, after_ms=0):
+        """First time all four duty cycles are 0 from after_ms on, None if never."""
+        stop = self.stop(after_ms)
+        return stop and stop[0]
+
+    def stop(self, after_ms=0):
+        """(ms, context) of the first stop from after_ms on, None if never."""
+        for ms, duty, context in self.duties:
+            if ms >= after_ms and not any(duty):
+                return ms, context
+        return None
+
+
+def simulate(program, directory, name, arguments):
+    log_path = os.path.join(directory, name + '.log')
+    completed = subprocess.run([program] + arguments + ['--log', log_path], capture_output=True, text=True)
+    if completed.returncode != 0:
+        raise Failure('fw_trace failed: ' + completed.stderr.strip())
+    return Run(completed.stdout, log_path)
+
+
+def profile_argument(points):
+    return ','.join('%g:%g' % point for point in points)
+
+
+def distance(points, ms):
+    """Obstacle distance of a profile at ms, as fw_trace computes it."""
+    if ms <= points[0][0]:
+        return points[0][1]
+    for (ms0, mm0), (ms1, mm1) in zip(points, points[1:]):
+        if ms < ms1:
+            return mm0 + (mm1 - mm0) * (ms - ms0) / (ms1 - ms0)
+    return points[-1][1]
+
+
+def approach(context, points, ms, extra=()):
+    return simulate(context.program, context.directory, context.name,
+                    ['--ms', str(ms), '--profile', profile_argument(points)] + DRIVE + list(extra))
+
+
+# ---------------------------------------------------------------
+# Approach profiles
+# ---------------------------------------------------------------
+def test_approach_clear(context):
+    """Obstacle far away and not closing in: full speed, no braking."""
+    run = approach(context, [(0, 2000)], 1500)
+    cruise = run.cruise()
+    expect(cruise > 0, 'not driving')
+    lowest = min(duty for _, duty in run.forward(DRIVING_MS))
+    expect(lowest >= 0.9 * cruise, 'slowed down to %.0f (cruise %.0f) without an obstacle' % (lowest, cruise))
+
+
+def test_approach_graded(context):
+    """Closing in at 1 m/s down to 0.8 s from the obstacle, then backing
+    off: slows down below TTC_BRAKE without stopping, then recovers."""
+    points = [(0, 1500), (700, 800), (1400, 1500)]
+    run = approach(context, points, 2000)
+    cruise = run.cruise()
+    expect(run.stopped_at(DRIVING_MS) is None, 'stopped at %s ms with TTC >= 800 ms' % run.stopped_at(DRIVING_MS))
+    lowest = min(duty for _, duty in run.forward(DRIVING_MS, 1000))
+    expect(0 < lowest < 0.8 * cruise, 'lowest duty %.0f while braking (cruise %.0f)' % (lowest, cruise))
+    final = run.forward_at(1900)
+    expect(final >= 0.9 * cruise, 'duty %.0f after backing off (cruise %.0f)' % (final, cruise))
+
+
+def test_approach_ttc_stop(context):
+    """Closing in at 1 m/s until contact: braking first, then the hard
+    stop on TTC_STOP, before the distance gets under DIST_THR."""
+    closing_mm_s = 1000
+    points = [(0, 1500), (1300, 200)]
+    run = approach(context, points, 2000)
+    stop = run.stopped_at(DRIVING_MS)
+    expect(stop is not None, 'motors not stopped')
+    stop_mm = distance(points, stop)
+    expect(stop_mm > DIST_THR_MM, 'stopped at %.0f mm, not ahead of DIST_THR' % stop_mm)
+    expect(stop_mm < 2 * TTC_STOP_MS * closing_mm_s / 1000, 'stopped at %.0f mm, far ahead of TTC_STOP' % stop_mm)
+    braked = [duty for _, duty in run.forward(DRIVING_MS, stop) if 0 < duty]
+    expect(min(braked) < 0.5 * max(braked), 'no graded braking before the stop')
+    expect(run.forward(stop)[-1][1] == 0, 'motors restarted after the emergency stop')
+
+
+def test_approach_distance_stop(context):
+    """Closing in at 0.1 m/s: the TTC stays above TTC_BRAKE, the
+    DIST_THR crossing stops the robot at full speed."""
+    points = [(0, 600), (5000, 100)]
+    run = approach(context, points, 4500)
+    cruise = run.cruise()
+    crossing = 4000  # DIST_THR_MM reached
+    stop = run.stopped_at(DRIVING_MS)
+    expect(stop is not None, 'motors not stopped')
+    expect(crossing <= stop <= crossing + 20, 'stopped at %.1f ms, DIST_THR crossed at %d ms' % (stop, crossing))
+    lowest = min(duty for _, duty in run.forward(DRIVING_MS, stop))
+    expect(lowest >= 0.9 * cruise, 'braked to %.0f with TTC above TTC_BRAKE' % lowest)
+
+
+def test_approach_cut_in(context):
+    """An obstacle appears at 150 mm: the ADC interrupt itself stops the
+    motors within a few IR results, the main loop does not wait for it."""
+    step_ms = 301
+    run = approach(context, [(0, 2000), (step_ms - 1, 2000), (step_ms, 150)], 600)
+    stop = run.stop(DRIVING_MS)
+    expect(stop is not None, 'motors not stopped')
+    expect(stop[1] == 'AD1', 'motors stopped by %s, not by the ADC interrupt' % stop[1])
+    expect(step_ms <= stop[0] <= step_ms + 5, 'stopped %.3f ms after the obstacle appeared' % (stop[0] - step_ms))
+
+
+# ---------------------------------------------------------------
+# Preemption
+# ---------------------------------------------------------------
+LOOP_PERIOD_MS = 2.0  # timer.h, main loop tick
+
+
+def test_preempt_hard_stop(context):
+    """The ADC interrupt stops the motors while the main loop is
+    updating them: the stop is never overwritten by the loop.
+
+    A first run finds when the loop writes the duty cycles and when the
+    interrupt stops the motors. The next runs delay the ADC so that the
+    stopping interrupt lands from 15 us before to 5 us after the loop
+    writes, one run per us."""
+    step_ms = 301
+    points = [(0, 2000), (step_ms - 1, 2000), (step_ms, 150)]
+    reference = approach(context, points, 320)
+    stop = reference.stop(DRIVING_MS)
+    expect(stop is not None and stop[1] == 'AD1', 'reference run not stopped by the ADC interrupt')
+    loop_writes = [ms for ms, _, writer in reference.duties if writer == 'main' and ms < stop[0]]
+    expect(loop_writes, 'no motor update from the main loop before the stop')
+    aligned_us = ((loop_writes[-1] - stop[0]) % LOOP_PERIOD_MS) * 1000
+
+    for offset_us in range(-15, 6):
+        delay_us = (aligned_us + offset_us) % (LOOP_PERIOD_MS * 1000)
+        run = approach(context, points, 320, ['--adc-delay', '%.3f' % delay_us])
+        stop = run.stop(DRIVING_MS)
+        where = 'ADC delayed by %.3f us' % delay_us
+        expect(stop is not None, 'motors not stopped, ' + where)
+        expect(stop[0] <= step_ms + 5, 'stopped %.3f ms after the obstacle appeared, %s' % (stop[0] - step_ms, where))
+        restarts = [(ms, writer) for ms, duty, writer in run.writes if ms > stop[0] and any(duty)]
+        expect(not restarts, 'stop at %.3f ms overwritten by %s at %.3f ms, %s'
+               % (stop[0], restarts[0][1] if restarts else '', restarts[0][0] if restarts else 0, where))
+
+
+# ---------------------------------------------------------------
+# Command floods
+# ---------------------------------------------------------------
+PWM_DUTY_PER_PERCENT = 72  # pwm.h, PWM_PERIOD / 100
+LINK = ['--rx', '10:$PCBDR,1000000*', '--rx', '300:$PCBOK,*']  # uart.h, UART_MAX_BAUD
+
+
+def acknowledged(run):
+    """Sequence numbers reported received and succeeded in the $MACKS frames."""
+    received, succeeded = set(), set()
+    for _, line in run.tx:
+        frame = re.match(r'\$MACKS,(\d+),([0-9A-F]+),([0-9A-F]+)\*', line)
+        if not frame:
+            continue
+        top, rx_mask, ok_mask = int(frame.group(1)), int(frame.group(2), 16), int(frame.group(3), 16)
+        for i in range(16):
+            if rx_mask >> i & 1:
+                received.add((top - i) & 0xFF)
+            if ok_mask >> i & 1:
+                succeeded.add((top - i) & 0xFF)
+    return received, succeeded
+
+
+def loop_report(run):
+    """(overruns, busy max in us, UART RX overruns) from the report."""
+    overruns = re.search(r'main loop .* (\d+) overruns', run.report)
+    busy = re.search(r'busy [\d.]+%, [\d.]+ us mean, ([\d.]+) us max', run.report)
+    uart = re.search(r'RX \d+ bytes, line [\d.]+%, (\d+) overruns', run.report)
+    expect(overruns and busy and uart, 'report not understood')
+    return int(overruns.group(1)), float(busy.group(1)), int(uart.group(1))
+
+
+def test_flood_setpoints(context):
+    """120 sequenced $PCREF back to back at 1 Mbaud, then a valid one
+    followed by a resent and an out-of-range one in the same tick.
+
+    The loop keeps its period, every line is either acknowledged or
+    counted in $MRXDROP (the UART itself never overruns), and the motors
+    end on the last setpoint that was received valid and new."""
+    flood = [(seq, 10 + seq % 60) for seq in range(120)]
+    rx = []
+    for seq, speed in flood:
+        rx += ['--rx', '400:$PCREF,%d,0#%d*' % (speed, seq)]
+    rx += ['--rx', '700:$PCREF,37,0#120*',  # applied
+           '--rx', '700:$PCREF,90,0#118*',  # resent, already executed
+           '--rx', '700:$PCREF,500,0#121*']  # out of range, rejected
+    run = simulate(context.program, context.directory, context.name,
+                   ['--ms', '900', '--distance', '3000', '--approach', '0', '--press', 'T2:50'] + LINK + rx)
+
+    overruns, busy_us, uart_overruns = loop_report(run)
+    expect(overruns == 0, '%d main loop overruns' % overruns)
+    expect(busy_us < LOOP_PERIOD_MS * 1000 / 2, 'main loop busy up to %.1f us' % busy_us)
+    expect(uart_overruns == 0, '%d UART RX overruns, lines lost without a count' % uart_overruns)
+
+    received, succeeded = acknowledged(run)
+    drops = [int(line.split(',')[1].rstrip('*')) for _, line in run.tx if line.startswith('$MRXDROP,')]
+    dropped = drops[-1] if drops else 0
+    flooded = {seq for seq, _ in flood}
+    expect(dropped > 0, 'the flood did not fill the command queue')
+    expect(len(flooded - received) == dropped,
+           '%d flood lines not acknowledged, %d reported dropped' % (len(flooded - received), dropped))
+    expect(received & flooded <= succeeded, 'valid setpoints acknowledged as failed')
+
+    last = max(received & flooded)
+    expect(run.forward_at(690) == dict(flood)[last] * PWM_DUTY_PER_PERCENT,
+           'duty %.0f after the flood, last setpoint received %d%%' % (run.forward_at(690), dict(flood)[last]))
+    expect({120, 121} <= received and 120 in succeeded and 121 not in succeeded,
+           'tail not acknowledged as expected')
+    final = run.forward_at(900)
+    expect(final == 37 * PWM_DUTY_PER_PERCENT, 'duty %.0f at the end, last valid setpoint 37%%' % final)
+
+
+# ---------------------------------------------------------------
+# Link budget
+# ---------------------------------------------------------------
+TLM_LINK_SHARE = 80  # telemetry.h, percent of the line
+PERIODIC = ('$MDIST,', '$MBATT,', '$MACC,', '$MTRJ,', '$MEST,', '$MPWR,', '$MLNK,', '$MTLM,')
+
+
+def periodic_bytes(run, start_ms, end_ms):
+    """Bytes of periodic telemetry sent in [start_ms, end_ms), with CR LF."""
+    return sum(len(line) + 2 for ms, line in run.tx if start_ms <= ms < end_ms and line.startswith(PERIODIC))
+
+
+def test_link_rebudget(context):
+    """Streams subscribed up to the budget at 9600 baud, then the link
+    goes down to 2400 baud: the mix is downscaled to the new budget,
+    and a stream can still be turned off."""
+    baud = 2400
+    run = simulate(context.program, context.directory, context.name,
+                   ['--ms', '4000', '--distance', '3000',
+                    '--rx', '10:$PCSUB,ACC,50*', '--rx', '20:$PCSUB,EST,50*',
+                    '--rx', '1000:$PCBDR,%d*' % baud, '--rx', '1400:$PCBOK,*',
+                    '--rx', '3000:$PCSUB,DIST,0*'])
+    budget = baud // 10 * TLM_LINK_SHARE // 100
+    expect(any(line == '$MBAUD,%d,1*' % baud for _, line in run.tx), 'rate not committed')
+    before = periodic_bytes(run, 0, 1000)
+    expect(before > budget, 'only %d bytes/s at 9600 baud, the scenario does not exceed the new budget' % before)
+    after = periodic_bytes(run, 2000, 3000)
+    expect(after <= budget, '%d bytes/s of telemetry at %d baud, budget %d' % (after, baud, budget))
+    expect(any(line == '$MSUB,DIST,0*' for _, line in run.tx), 'DIST not turned off')
+    late = [ms for ms, line in run.tx if ms > 3200 and line.startswith('$MDIST,')]
+    expect(not late, '$MDIST still sent at %.1f ms' % (late[0] if late else 0))
+
+
+# ---------------------------------------------------------------
+# Interrupt profiling
+# ---------------------------------------------------------------
+def test_isr_report(context):
+    """$PCISR while driving: one $MISR line per source, measured
+    latencies where the request time is known (not for U1RX) and a
+    computed bound in its own field."""
+    run = simulate(context.program, context.directory, context.name,
+                   ['--ms', '1200', '--distance', '3000'] + DRIVE + ['--rx', '1000:$PCISR,*'])
+    report = {}
+    for _, line in run.tx:
+        frame = re.match(r'\$MISR,(\w+),(\d+),(\d+),(\d+)\*', line)
+        if frame:
+            report[frame.group(1)] = tuple(int(value) for value in frame.group(2, 3, 4))
+    expect(sorted(report) == ['ADC', 'T1', 'U1RX', 'U1TX'], 'sources reported: %s' % sorted(report))
+    for source in ('ADC', 'T1', 'U1TX'):
+        expect(report[source][0] > 0, '%s latency not measured' % source)
+    expect(report['U1RX'][0] == 0, 'U1RX latency %d reported as measured' % report['U1RX'][0])
+    expect(all(duration > 0 for _, duration, _ in report.values()), 'duration missing: %s' % report)
+    durations = {source: values[1] for source, values in report.items()}
+    expect(report['U1TX'][2] == durations['ADC'] + durations['U1RX'] + durations['T1'],
+           'U1TX bound %d, durations %s' % (report['U1TX'][2], durations))
+
+
+# ---------------------------------------------------------------
+# Flight recorder
+# ---------------------------------------------------------------
+EV_EMRG_ENTER = 2  # recorder.h
+TICK_MS = 2
+
+
+def dumps(run):
+    """(start ms, end ms, count, [(index, tick, type, arg, value)], lost) per $PCLOG dump."""
+    result = []
+    for ms, line in run.tx:
+        header = re.match(r'\$MLOGS,(\d+),(\d+)\*', line)
+        event = re.match(r'\$MLOG,(\d+),([0-9A-F]{4})([0-9A-F]{2})([0-9A-F]{2})([0-9A-F]{4})\*', line)
+        end = re.match(r'\$MLOGE,(\d+)\*', line)
+        if header:
+            result.append([ms, None, int(header.group(1)), [], None])
+        elif event and result:
+            result[-1][3].append((int(event.group(1)),) + tuple(int(field, 16) for field in event.group(2, 3, 4, 5)))
+        elif end and result:
+            result[-1][1] = ms
+            result[-1][4] = int(end.group(1))
+    return result
+
+
+def test_recorder_dump_logging(context):
+    """An obstacle cuts in while a dump of about 80 events is being sent
+    at 1 Mbaud (2 lines per tick): the dump completes, and the emergency
+    is in the next dump."""
+    step_ms = 540
+    rx = []
+    for seq in range(80):  # fills the ring with commands
+        rx += ['--rx', '400:$PCREF,50,0#%d*' % seq]
+    run = approach(context, [(0, 2000), (step_ms - 1, 2000), (step_ms, 150)], 1500,
+                   LINK + rx + ['--rx', '500:$PCLOG,*', '--rx', '900:$PCLOG,*'])
+    found = dumps(run)
+    expect(len(found) == 2 and all(dump[1] is not None for dump in found), 'dumps not completed')
+    start, end, count, events, lost = found[0]
+    stop = run.stopped_at(DRIVING_MS)
+    expect(stop is not None and start < stop < end - 20,
+           'emergency at %s ms, first dump from %.1f to %.1f ms' % (stop, start, end))
+    expect(lost == 0 and [event[0] for event in events] == list(range(count)), 'first dump incomplete')
+    emergencies = [event for event in found[1][3] if event[2] == EV_EMRG_ENTER]
+    expect(emergencies, 'emergency during the first dump not recorded')
+    expect(abs(emergencies[0][1] * TICK_MS - stop) <= TICK_MS,
+           'emergency recorded at tick %d, motors stopped at %.1f ms' % (emergencies[0][1], stop))
+
+
+# ---------------------------------------------------------------
+# Accelerometer incidents
+# ---------------------------------------------------------------
+CRUISE_MS = 800  # the body speed has settled at 50 %
+IMPACT_MG = 2500
+# The main loop polls the sensor interrupt status once per tick
+IMPACT_STOP_MS = 2 * LOOP_PERIOD_MS + 1
+STUCK_STOP_MS = 200  # fw_trace.cpp, the body comes to rest in this time
+EST_PERIOD_MS = 64  # estimator.c, estimator_period_ms() at the default ACC_BW
+
+
+def incident(context, arguments, ms=1500):
+    return simulate(context.program, context.directory, context.name,
+                    ['--ms', str(ms), '--distance', '3000'] + DRIVE + arguments)
+
+
+def expect_emergency_stop(run, at_ms, bound_ms, what):
+    stop = run.stop(DRIVING_MS)
+    expect(stop is not None, '%s: motors not stopped' % what)
+    expect(at_ms <= stop[0] <= at_ms + bound_ms,
+           '%s: motors off %.3f ms after the incident, bound %g ms' % (what, stop[0] - at_ms, bound_ms))
+    expect(any(line == '$MEMRG,1*' for ms, line in run.tx if ms >= stop[0]), '%s: no emergency reported' % what)
+    expect(run.forward(stop[0])[-1][1] == 0, '%s: motors restarted after the stop' % what)
+    return stop[0] - at_ms
+
+
+def impact_latencies(context, x_mg, y_mg):
+    """Knocks at four phases of the main loop period."""
+    latencies = []
+    for phase_ms in (0, 0.5, 1, 1.5):
+        at_ms = CRUISE_MS + phase_ms
+        run = incident(context, ['--impact', '%g:%d,%d' % (at_ms, x_mg, y_mg)], 1000)
+        latencies.append(expect_emergency_stop(run, at_ms, IMPACT_STOP_MS,
+                                               'impact %d,%d mg at %g ms' % (x_mg, y_mg, at_ms)))
+    return latencies
+
+
+def test_incident_impact_front(context):
+    """Head-on and rear knocks stop the motors within two loop periods."""
+    impact_latencies(context, -IMPACT_MG, 0)
+    impact_latencies(context, IMPACT_MG, 0)
+
+
+def test_incident_impact_side(context):
+    """Knocks from either side stop the motors as fast as head-on ones."""
+    impact_latencies(context, 0, IMPACT_MG)
+    impact_latencies(context, 0, -IMPACT_MG)
+
+
+def test_incident_stuck(context):
+    """The body comes to rest while the wheels keep turning: the stall
+    stop once the estimate has been below half the model for STALL_MS."""
+    run = incident(context, ['--stuck', str(CRUISE_MS)])
+    expect_emergency_stop(run, CRUISE_MS, STUCK_STOP_MS + STALL_MS, 'stuck')
+
+
+def test_incident_lift(context):
+    """Picked up, then tilted: the lift stop once z has been away from
+    1 g for LIFT_MS. The estimator counts whole steps and the 7.81 Hz
+    sensor bandwidth delays the threshold crossing: one step each."""
+    run = incident(context, ['--lift', str(CRUISE_MS)])
+    expect_emergency_stop(run, CRUISE_MS, LIFT_MS + 2 * EST_PERIOD_MS, 'lift')
+
+
+def test_incident_full_speed(context):
+    """Full speed forward from rest, stop, full speed backward, stop:
+    the accelerations of the robot itself trigger nothing."""
+    full = 100 * PWM_DUTY_PER_PERCENT
+    run = simulate(context.program, context.directory, context.name,
+                   ['--ms', '2000', '--distance', '3000', '--press', 'T2:50',
+                    '--rx', '10:$PCREF,100,0*', '--rx', '800:$PCREF,0,0*',
+                    '--rx', '1200:$PCREF,-100,0*', '--rx', '1600:$PCREF,0,0*'])
+    emergencies = [ms for ms, line in run.tx if line == '$MEMRG,1*']
+    expect(not emergencies, 'emergency at %.1f ms' % (emergencies[0] if emergencies else 0))
+    for at_ms, duty in ((700, full), (1100, 0), (1500, -full), (1900, 0)):
+        expect(run.forward_at(at_ms) == duty, 'duty %.0f at %d ms, commanded %d' % (run.forward_at(at_ms), at_ms, duty))
+
+
+# ---------------------------------------------------------------
+# Filters
+# ---------------------------------------------------------------
+def test_dsp_reference(context):
+    """dsp_test: golden Q15 vectors and the double-precision models."""
+    completed = subprocess.run([os.path.join(context.directory, 'dsp_test')], capture_output=True, text=True)
+    failures = [line for line in completed.stdout.splitlines() if line.startswith('FAIL')]
+    expect(completed.returncode == 0, '; '.join(failures) or 'dsp_test failed')
+
+
+TESTS = [
+    test_approach_clear,
+    test_approach_graded,
+    test_approach_ttc_stop,
+    test_approach_distance_stop,
+    test_approach_cut_in,
+    test_preempt_hard_stop,
+    test_flood_setpoints,
+    test_link_rebudget,
+    test_isr_report,
+    test_recorder_dump_logging,
+    test_incident_impact_front,
+    test_incident_impact_side,
+    test_incident_stuck,
+    test_incident_lift,
+    test_incident_full_speed,
+    test_dsp_reference,
+]
+
+
+# ---------------------------------------------------------------
+# Main
+# ---------------------------------------------------------------
+class Context:
+    def __init__(self, program, directory):
+        self.program = program
+        self.directory = directory
+        self.name = None
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Scripted host tests of the firmware')
+    parser.add_argument('--build', help='build directory (default: a temporary one)')
+    parser.add_argument('--cc', default='gcc')
+    parser.add_argument('--cxx', default='g++')
+    parser.add_argument('names', nargs='*', help='tests to run, by name or prefix (default: all)')
+    args = parser.parse_args()
+
+    directory = args.build or tempfile.mkdtemp(prefix='fw_tests.')
+    os.makedirs(directory, exist_ok=True)
+    context = Context(build(directory, args.cc, args.cxx), directory)
+
+    failed = 0
+    selected = [test for test in TESTS
+                if not args.names or any(test.__name__[5:].startswith(name) for name in args.names)]
+    for test in selected:
+        context.name = test.__name__[5:]
+        try:
+            test(context)
+            print('PASS  %s' % context.name)
+        except Failure as failure:
+            failed += 1
+            print('FAIL  %s: %s' % (context.name, failure))
+    print('%d of %d tests passed' % (len(selected) - failed, len(selected)))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,1281 @@
+// ===============================================================
+// File: fw_trace.cpp
+// Author: group 1
+// Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+// Runs the whole firmware on Linux against models of the peripherals
+// it drives and records them on one cycle-stamped timeline: TIMER1
+// periods, the main loop, interrupt routine entry and exit, UART1 TX
+// and RX lines, SPI1 transfers with ACC_CS, OC1-OC4 duty cycles, the
+// LEDs and flash operations. The trace is kept compact in memory
+// (trace.hpp), optionally exported as VCD for GTKWave, and summarised:
+// loop period, tick-to-loop latency and load, interrupt latency and
+// duration, SPI bus busy time and UART line utilisation.
+//
+// Time model: the firmware is built against the host xc.h, so every
+// register access goes through sim_sfr(), and with
+// -finstrument-functions every firmware function call reaches the
+// simulator too. Each access costs --access-cycles and each call
+// --call-cycles, interrupts are taken at those points and Idle()
+// jumps to the next peripheral event. Cycle counts are therefore an
+// estimate of the code cost, while everything the peripherals do
+// (timer periods, bit times, SPI clock, ADC pacing, flash erase) is
+// timed exactly. int is 32 bits here, so arithmetic relying on the
+// 16-bit int of XC16 may differ. --adc-delay holds TIMER3 back when the
+// firmware starts it, which moves the ADC conversions and interrupts
+// against the main loop tick: sweeping it lets the ADC interrupt
+// preempt the loop at any point (fw_tests.py).
+//
+// Inputs: lines sent on UART1 (--rx; lines given the same time go out
+// back to back, in order), T2/T3 presses (--press), the
+// obstacle distance seen by the IR sensor (--distance, closing at
+// --approach, or a --profile of MS:MM points joined by straight
+// lines), the battery voltage and the acceleration read over SPI.
+// Without --rx or --press the script is a $PCREF at 10 ms and a T2
+// press at 50 ms, so the robot drives towards the obstacle until the
+// emergency stop.
+//
+// Acceleration: --acc is the static part (gravity, mounting), the body
+// adds the forward acceleration of a robot following the wheel duty
+// cycles with the motor model of estimator.h. Scripted incidents are
+// replayed on top: --impact (a half-sine knock of X,Y mg), --stuck (the
+// body comes to rest while the wheels keep turning) and --lift (picked
+// up, then held tilted). The sensor samples every 0.5 ms; the slope and
+// high-g engines see the raw samples, the data registers the ACC_BW
+// low-pass. For every incident the report gives the time until all four
+// OC duty cycles are 0, the reaction latency of the firmware.
+//
+// --log writes the behaviour seen from outside as text, one event per
+// line with its time in ms: "tx LINE" for every line sent on UART1 and
+// "oc D1 D2 D3 D4 CONTEXT" for every OC1-OC4 duty cycle change, written
+// by the main loop ("main") or an interrupt routine ("AD1", ...). The
+// scripted tests (fw_tests.py) check their expectations on it.
+// Build: gcc -std=gnu99 -O1 -c -Wno-attributes -finstrument-functions
+//            -Dmain=firmware_main -I. ../ES_project_group_1.X/*.c
+//        g++ -std=c++20 -O2 -I. -o fw_trace fw_trace.cpp *.o
+//            -Wl,--wrap=tmr_wait_period
+// Usage: fw_trace [--ms 4000] [--vcd trace.vcd] [--rx MS:LINE]...
+//                 [--press T2|T3:MS[:HOLD_MS]]... [--distance 1000]
+//                 [--approach 250] [--profile MS:MM,MS:MM...]
+//                 [--battery 7800] [--acc 0,0,1000]
+//                 [--impact MS:X,Y[:DURATION_MS]]... [--stuck MS] [--lift MS]
+//                 [--access-cycles 4] [--call-cycles 16] [--adc-delay 0]
+//                 [--log FILE]
+// ===============================================================
+#define SIM_PERIPHERALS
+#include "xc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "trace.hpp"
+
+extern "C" {
+int firmware_main(void);
+void _T1Interrupt(void);
+void _U1RXInterrupt(void);
+void _U1TXInterrupt(void);
+void _AD1Interrupt(void);
+int __real_tmr_wait_period(int timer);
+}
+
+volatile unsigned int sim_sfr_file[SIM_SFR_COUNT];
+
+namespace {
+
+constexpr double FCY = 72e6; // timer.h
+constexpr double CYCLE_NS = 1e9 / FCY;
+constexpr uint64_t NEVER = UINT64_MAX;
+// Held in data registers between accesses: the firmware never writes
+// it, so any other content is a new character to send
+constexpr unsigned SENTINEL = 0xA5A5A5A5u;
+constexpr int TIMER1 = 1; // timer.h
+constexpr unsigned PRESCALE[4] = {1, 8, 64, 256};
+constexpr int UART_FIFO = 4;
+constexpr int ISR_ENTRY_CYCLES = 10; // vectoring and context save
+constexpr int ISR_EXIT_CYCLES = 6; // RETFIE
+constexpr double PAGE_ERASE_MS = 19.5;
+constexpr double DWORD_PROGRAM_US = 47;
+constexpr int ADC_CONVERSION_TAD = 14; // 12 Tad conversion plus sampling end
+constexpr double ACC_SAMPLE_MS = 0.5; // 2 kHz unfiltered data
+constexpr double WHEEL_MAX_MM_S = 500; // estimator.h EST_WHEEL_MAX_MM_S
+constexpr double MOTOR_TAU_MS = 150; // estimator.h EST_MOTOR_TAU_MS
+constexpr double STUCK_STOP_MS = 200; // --stuck: body at rest after this
+constexpr double LIFT_MG = 400; // --lift: upward acceleration while picked up
+constexpr double LIFT_UP_MS = 300; // --lift: then tilted to 45 deg within LIFT_TILT_MS
+constexpr double LIFT_TILT_MS = 200;
+// IFS0 bits
+constexpr int T1IF = 3, T2IF = 7, T3IF = 8, SPI1IF = 10, U1RXIF = 11, U1TXIF = 12, AD1IF = 13;
+
+struct Options {
+    double ms = 4000;
+    const char *vcd = nullptr;
+    std::vector<std::pair<double, std::string>> rx;
+    struct Press {
+        int button; // 0 = T2, 1 = T3
+        double ms, hold_ms;
+    };
+    std::vector<Press> presses;
+    double distance_mm = 1000;
+    double approach_mm_s = 250;
+    std::vector<std::pair<double, double>> profile; // (ms, mm), replaces distance and approach
+    double battery_mv = 7800;
+    double acc_mg[3] = {0, 0, 1000};
+    struct Impact {
+        double ms, x_mg, y_mg, duration_ms;
+    };
+    std::vector<Impact> impacts;
+    double stuck_ms = -1; // < 0: never
+    double lift_ms = -1;
+    int access_cycles = 4;
+    int call_cycles = 16;
+    double adc_delay_us = 0;
+    const char *log = nullptr;
+};
+
+// Interrupt sources enabled by the firmware, in natural order
+struct Source {
+    const char *name;
+    int flag; // IFS0 / IEC0 bit
+    SimSfr ipc;
+    int shift;
+    void (*handler)(void);
+};
+constexpr Source SOURCES[] = {
+    {"T1", T1IF, SIM_IPC0, 12, _T1Interrupt},
+    {"U1RX", U1RXIF, SIM_IPC2, 8, _U1RXInterrupt},
+    {"U1TX", U1TXIF, SIM_IPC3, 0, _U1TXInterrupt},
+    {"AD1", AD1IF, SIM_IPC3, 4, _AD1Interrupt},
+};
+constexpr int SOURCE_COUNT = sizeof(SOURCES) / sizeof(SOURCES[0]);
+
+// IR sensor: ADC code of a distance, inverse of the calibration
+// polynomial behind the control.c table, on its decreasing part
+double ir_code(double mm) {
+    auto curve = [](double v) { return 2.34 + v * (-4.74 + v * (4.06 + v * (-1.60 + v * 0.24))); };
+    double low = 0, high = 2.05;
+    for (int i = 0; i < 40; i++) {
+        double middle = (low + high) / 2;
+        if (curve(middle) * 1000 > mm) low = middle;
+        else high = middle;
+    }
+    return (low + high) / 2 * 1023 / 3.3;
+}
+
+// BMX055 accelerometer on SPI1: register reads with auto-increment,
+// register writes, data registers loaded when selected. sample() feeds
+// one raw sample: the data registers follow it through the ACC_BW
+// low-pass, the slope and high-g engines (x, y, z enables, threshold,
+// duration) see it unfiltered, whatever INT_SRC says, and latch
+// INT_STATUS_0 until INT_RST_LATCH reset_int.
+class Accelerometer {
+public:
+    Accelerometer() {
+        std::memset(registers_, 0, sizeof(registers_));
+        registers_[0x00] = 0xFA; // chip id
+        registers_[0x0F] = 0x03; // +-2g
+        registers_[0x10] = 0x0F; // 1000 Hz bandwidth
+    }
+
+    void sample(const double mg[3]) {
+        double full_scale = 2000.0 * scale();
+        double bandwidth_hz = 7.81 * std::pow(2.0, std::clamp(registers_[0x10], (uint8_t) 0x08, (uint8_t) 0x0F) - 0x08);
+        double alpha = 1 - std::exp(-2 * M_PI * bandwidth_hz * ACC_SAMPLE_MS / 1000);
+        int high_samples = (int) ((registers_[0x25] + 1) * 2 / ACC_SAMPLE_MS);
+        bool slope = false, high = false;
+        for (int axis = 0; axis < 3; axis++) {
+            double raw = std::clamp(mg[axis], -full_scale, full_scale);
+            if (primed_) {
+                bool over = std::fabs(raw - raw_[axis]) > registers_[0x28] * 3.91 * scale();
+                slope_count_[axis] = over ? slope_count_[axis] + 1 : 0;
+                if ((registers_[0x16] >> axis & 1) && slope_count_[axis] > (registers_[0x27] & 3)) slope = true;
+                filtered_[axis] += alpha * (raw - filtered_[axis]);
+            } else {
+                filtered_[axis] = raw;
+            }
+            raw_[axis] = raw;
+            high_count_[axis] = std::fabs(raw) > registers_[0x26] * 7.81 * scale() ? high_count_[axis] + 1 : 0;
+            if ((registers_[0x17] >> axis & 1) && high_count_[axis] >= high_samples) high = true;
+
+            int code = std::clamp((int) std::lround(filtered_[axis] / (0.98 * scale())), -2048, 2047);
+            data_[2 * axis] = (uint8_t) (((code & 0xF) << 4) | 1); // new data
+            data_[2 * axis + 1] = (uint8_t) (code >> 4);
+        }
+        primed_ = true;
+        if (slope) registers_[0x09] |= 0x04;
+        if (high) registers_[0x09] |= 0x02;
+    }
+
+    uint8_t status() const { return registers_[0x09]; }
+
+    void select() {
+        first_ = true;
+        std::memcpy(&registers_[0x02], data_, sizeof(data_));
+    }
+
+    uint8_t exchange(uint8_t mosi) {
+        if (first_) {
+            first_ = false;
+            address_ = mosi & 0x3F;
+            reading_ = mosi & 0x80;
+            return 0xFF;
+        }
+        uint8_t miso = 0xFF;
+        if (reading_) {
+            miso = registers_[address_];
+        } else if (address_ == 0x21) {
+            if (mosi & 0x80) registers_[0x09] = 0; // reset_int
+            registers_[address_] = mosi & 0x7F;
+        } else {
+            registers_[address_] = mosi;
+        }
+        address_ = (address_ + 1) & 0x3F;
+        return miso;
+    }
+
+private:
+    // 1 at +-2g, doubling with every range step
+    double scale() const {
+        uint8_t range = registers_[0x0F];
+        return range >= 0x0C ? 8 : range >= 0x08 ? 4 : range >= 0x05 ? 2 : 1;
+    }
+
+    uint8_t registers_[64];
+    uint8_t data_[6] = {1, 0, 1, 0, 1, 0};
+    double raw_[3] = {}, filtered_[3] = {};
+    int slope_count_[3] = {}, high_count_[3] = {};
+    bool primed_ = false;
+    bool first_ = true, reading_ = false;
+    uint8_t address_ = 0;
+};
+
+struct Stats {
+    uint64_t count = 0, total = 0, max = 0, latency_total = 0, latency_max = 0;
+};
+
+class Machine {
+public:
+    Machine(const Options &options) : options_(options), noise_(1) {
+        end_ = (uint64_t) (options.ms * FCY / 1000);
+        for (auto &press : options.presses) {
+            buttons_.push_back({(uint64_t) (press.ms * FCY / 1000), press.button, true});
+            buttons_.push_back({(uint64_t) ((press.ms + press.hold_ms) * FCY / 1000), press.button, false});
+        }
+        std::stable_sort(buttons_.begin(), buttons_.end(), [](auto &a, auto &b) { return a.cycle < b.cycle; });
+        for (auto &line : options.rx) rx_lines_.push_back({(uint64_t) (line.first * FCY / 1000), line.second + "\r\n"});
+        std::stable_sort(rx_lines_.begin(), rx_lines_.end(), [](auto &a, auto &b) { return a.cycle < b.cycle; });
+        for (auto &impact : options.impacts) incidents_.push_back({"impact", impact.ms});
+        if (options.stuck_ms >= 0) incidents_.push_back({"stuck", options.stuck_ms});
+        if (options.lift_ms >= 0) incidents_.push_back({"lift", options.lift_ms});
+        define_signals();
+        reset();
+    }
+
+    uint64_t now() const { return now_; }
+    jmp_buf &end_jump() { return end_jump_; }
+
+    // ------------------------------------------------------------
+    // Entry points from the firmware
+    // ------------------------------------------------------------
+    volatile unsigned int *access(SimSfr sfr) {
+        step(options_.access_cycles);
+        refresh(sfr);
+        last_access_ = sfr;
+        return &sim_sfr_file[sfr];
+    }
+
+    void call() { step(options_.call_cycles); }
+
+    void idle() {
+        flush();
+        uint64_t entered = isr_entries_;
+        while (isr_entries_ == entered) {
+            advance(std::max(next_event(), now_ + 1));
+            deliver();
+        }
+    }
+
+    void disi(unsigned cycles) {
+        step(1);
+        disi_end_ = now_ + cycles + 1;
+        hw_set(SIM_DISICNT, cycles & 0x3FFF);
+    }
+
+    void write_nvm() {
+        step(1);
+        unsigned nvmcon = reg(SIM_NVMCON);
+        uint32_t address = ((uint32_t) reg(SIM_NVMADRU) << 16) | reg(SIM_NVMADR);
+        double duration_us = 0;
+        if ((nvmcon & 0xF) == 0x3) { // page erase
+            uint32_t page = address & ~(uint32_t) 2047;
+            for (uint32_t a = page; a < page + 2048; a += 2) flash_.erase(a);
+            duration_us = PAGE_ERASE_MS * 1000;
+        } else if ((nvmcon & 0xF) == 0x1) { // double word
+            flash_[address & ~3u] = latch_[0];
+            flash_[(address & ~3u) + 2] = latch_[1];
+            duration_us = DWORD_PROGRAM_US;
+        }
+        nvm_operations_++;
+        nvm_end_ = now_ + (uint64_t) (duration_us * FCY / 1e6);
+        hw_set(SIM_NVMCON, nvmcon | 0x8000);
+        trace_.record(now_, sig_nvm_, 1);
+    }
+
+    unsigned table_read(unsigned offset, bool high) {
+        step(1);
+        uint32_t address = ((uint32_t) reg(SIM_TBLPAG) << 16) | (offset & 0xFFFE);
+        auto found = flash_.find(address);
+        uint32_t word = found == flash_.end() ? 0xFFFFFF : found->second;
+        return high ? (word >> 16) & 0xFF : word & 0xFFFF;
+    }
+
+    void table_write(unsigned offset, unsigned value, bool high) {
+        step(1);
+        if (reg(SIM_TBLPAG) != 0xFA) return; // only the write latches
+        uint32_t &word = latch_[(offset >> 1) & 1];
+        word = high ? (word & 0xFFFF) | ((uint32_t) (value & 0xFF) << 16) : (word & 0xFF0000) | (value & 0xFFFF);
+    }
+
+    unsigned long table_address(const volatile void *object) {
+        // Program memory objects get addresses above the application
+        auto found = program_objects_.find(object);
+        if (found != program_objects_.end()) return found->second;
+        unsigned long address = 0x40000 + 0x800 * program_objects_.size();
+        program_objects_[object] = address;
+        return address;
+    }
+
+    [[noreturn]] void reset_instruction() {
+        flush();
+        firmware_reset_ = true;
+        std::longjmp(end_jump_, 1);
+    }
+
+    int wait_period(int timer) {
+        if (timer != TIMER1) return __real_tmr_wait_period(timer);
+        flush();
+        if (loop_start_) loop_busy_.push_back((uint32_t) (now_ - loop_start_));
+        trace_.record(now_, sig_loop_, 0);
+        int overrun = __real_tmr_wait_period(timer);
+        flush();
+        if (loop_start_) loop_periods_.push_back((uint32_t) (now_ - loop_start_));
+        loop_latency_.push_back((uint32_t) (now_ - last_tick_));
+        loop_overruns_ += overrun;
+        loop_start_ = now_;
+        trace_.record(now_, sig_loop_, 1);
+        return overrun;
+    }
+
+    // ------------------------------------------------------------
+    // Report
+    // ------------------------------------------------------------
+    void report(double host_seconds) {
+        double ms = now_ / FCY * 1000;
+        auto us = [](double cycles) { return cycles / FCY * 1e6; };
+        std::printf("%.0f ms simulated (%llu cycles) in %.2f s%s\n", ms, (unsigned long long) now_, host_seconds,
+                    firmware_reset_ ? ", ended by a firmware RESET" : "");
+
+        if (!loop_periods_.empty()) {
+            auto [low, high] = std::minmax_element(loop_periods_.begin(), loop_periods_.end());
+            double busy = 0, busy_max = 0, period = 0;
+            for (uint32_t b : loop_busy_) busy += b, busy_max = std::max<double>(busy_max, b);
+            for (uint32_t p : loop_periods_) period += p;
+            std::printf("main loop    %zu periods, %.3f ms mean (%.3f .. %.3f), %llu overruns\n",
+                        loop_periods_.size(), us(period / loop_periods_.size()) / 1000, us(*low) / 1000,
+                        us(*high) / 1000, (unsigned long long) loop_overruns_);
+            std::printf("             busy %.1f%%, %.1f us mean, %.1f us max\n", 100 * busy / period,
+                        us(busy / loop_busy_.size()), us(busy_max));
+            std::vector<uint32_t> latency = loop_latency_;
+            std::sort(latency.begin(), latency.end());
+            double mean = 0, square = 0;
+            for (uint32_t l : latency) mean += l;
+            mean /= latency.size();
+            for (uint32_t l : latency) square += (l - mean) * (l - mean);
+            std::printf("tick->loop   %.2f us mean, %.2f us p99, %.2f us max, jitter %.2f us rms\n", us(mean),
+                        us(latency[latency.size() * 99 / 100]), us(latency.back()),
+                        us(std::sqrt(square / latency.size())));
+        }
+
+        std::printf("interrupts   %-5s %8s %9s %9s %7s %11s\n", "", "count", "mean us", "max us", "cpu %",
+                    "latency max");
+        for (int i = 0; i < SOURCE_COUNT; i++) {
+            const Stats &s = isr_stats_[i];
+            if (!s.count) continue;
+            std::printf("             %-5s %8llu %9.2f %9.2f %7.2f %8.2f us\n", SOURCES[i].name,
+                        (unsigned long long) s.count, us((double) s.total / s.count), us(s.max),
+                        100.0 * s.total / now_, us(s.latency_max));
+        }
+        std::printf("SPI1         %llu transfers, bus busy %.3f%%, ACC_CS low %.3f%%\n",
+                    (unsigned long long) spi_transfers_, 100.0 * spi_busy_cycles_ / now_,
+                    100.0 * (cs_low_cycles_ + (cs_low_ ? now_ - cs_low_since_ : 0)) / now_);
+        std::printf("UART1        TX %llu bytes, line %.1f%%, %llu dropped; RX %llu bytes, line %.1f%%, "
+                    "%llu overruns\n",
+                    (unsigned long long) tx_bytes_, 100.0 * tx_line_cycles_ / now_,
+                    (unsigned long long) tx_dropped_, (unsigned long long) rx_bytes_,
+                    100.0 * rx_line_cycles_ / now_, (unsigned long long) rx_overruns_);
+        std::printf("OC1-OC4      %llu duty changes; flash %llu operations\n", (unsigned long long) oc_changes_,
+                    (unsigned long long) nvm_operations_);
+        for (const Incident &incident : incidents_) {
+            std::printf("incident     %-6s at %.1f ms: ", incident.name, incident.ms);
+            if (incident.motors_off_ms >= 0) {
+                std::printf("motors off after %.3f ms\n", incident.motors_off_ms - incident.ms);
+            } else {
+                std::printf("motors not stopped\n");
+            }
+        }
+        std::printf("trace        %zu events, %zu bytes (%.2f bytes/event)\n", trace_.events(), trace_.bytes(),
+                    trace_.events() ? (double) trace_.bytes() / trace_.events() : 0.0);
+    }
+
+    bool write_vcd(const char *path) { return trace_.write_vcd(path, CYCLE_NS); }
+
+    bool write_log(const char *path) {
+        FILE *file = std::fopen(path, "w");
+        if (!file) return false;
+        std::fputs(log_.c_str(), file);
+        return std::fclose(file) == 0;
+    }
+
+private:
+    struct ButtonEdge {
+        uint64_t cycle;
+        int button;
+        bool pressed;
+    };
+    struct RxLine {
+        uint64_t cycle;
+        std::string text;
+    };
+    struct Incident {
+        const char *name;
+        double ms;
+        double motors_off_ms = -1; // first time all duty cycles are 0 after it
+    };
+    struct Timer {
+        SimSfr tmr, pr, con;
+        int flag; // IFS0 bit, -1 if not modelled
+        bool on = false;
+        unsigned prescale = 1;
+        int64_t base = 0; // cycle at which the count was 0
+        uint64_t wrap = NEVER;
+    };
+
+    // ------------------------------------------------------------
+    // Registers
+    // ------------------------------------------------------------
+    template <typename... Args> void log(const char *format, Args... args) {
+        if (!options_.log) return;
+        char line[160];
+        std::snprintf(line, sizeof(line), format, args...);
+        char stamp[24];
+        std::snprintf(stamp, sizeof(stamp), "%.3f ", now_ / FCY * 1000);
+        log_ += stamp;
+        log_ += line;
+        log_ += '\n';
+    }
+
+    static unsigned reg(SimSfr sfr) { return sim_sfr_file[sfr] & 0xFFFF; }
+
+    // Hardware side update, not seen as a firmware write
+    void hw_set(SimSfr sfr, unsigned value) { sim_sfr_file[sfr] = seen_[sfr] = value; }
+    void hw_bit(SimSfr sfr, int bit, bool on) {
+        hw_set(sfr, on ? reg(sfr) | (1u << bit) : reg(sfr) & ~(1u << bit));
+    }
+    static bool bit(SimSfr sfr, int n) { return (reg(sfr) >> n) & 1; }
+
+    void set_flag(int flag) {
+        if (!bit(SIM_IFS0, flag)) flag_time_[flag] = now_;
+        hw_bit(SIM_IFS0, flag, true);
+    }
+
+    void reset() {
+        for (int i = 0; i < SIM_SFR_COUNT; i++) sim_sfr_file[i] = 0;
+        for (SimSfr ipc : {SIM_IPC0, SIM_IPC2, SIM_IPC3}) sim_sfr_file[ipc] = 0x4444;
+        for (SimSfr pr : {SIM_PR1, SIM_PR2, SIM_PR3, SIM_PR4}) sim_sfr_file[pr] = 0xFFFF;
+        sim_sfr_file[SIM_U1STA] = 0x0110; // TRMT, RIDLE
+        for (SimSfr data : {SIM_U1TXREG, SIM_SPI1BUF}) sim_sfr_file[data] = SENTINEL;
+        sim_sfr_file[SIM_INTCON2] = 0x8000; // GIE
+        sim_sfr_file[SIM_PORTE] = 0x0300; // buttons released
+        for (SimSfr tris : {SIM_TRISA, SIM_TRISB, SIM_TRISD, SIM_TRISE, SIM_TRISF}) sim_sfr_file[tris] = 0xFFFF;
+        for (int i = 0; i < SIM_SFR_COUNT; i++) seen_[i] = sim_sfr_file[i];
+    }
+
+    // Applies what the firmware wrote since the previous access
+    void flush() {
+        for (int i = 0; i < SIM_SFR_COUNT; i++) {
+            if (sim_sfr_file[i] == seen_[i]) continue;
+            unsigned old = seen_[i], value = sim_sfr_file[i];
+            seen_[i] = value;
+            written((SimSfr) i, old, value);
+        }
+        // A data register read last time is back to "nothing written"
+        if (last_access_ == SIM_SPI1BUF && sim_sfr_file[SIM_SPI1BUF] != SENTINEL) hw_set(SIM_SPI1BUF, SENTINEL);
+        last_access_ = SIM_SFR_COUNT;
+    }
+
+    void written(SimSfr sfr, unsigned old, unsigned value) {
+        switch (sfr) {
+        case SIM_SR:
+            cpu_ipl_ = (value >> 5) & 7;
+            break;
+        case SIM_DISICNT:
+            disi_end_ = now_ + (value & 0x3FFF);
+            break;
+        case SIM_T1CON: case SIM_PR1: timer_written(timers_[0], false); break;
+        case SIM_TMR1: timer_written(timers_[0], true); break;
+        case SIM_T2CON: case SIM_PR2: timer_written(timers_[1], false); break;
+        case SIM_TMR2: timer_written(timers_[1], true); break;
+        case SIM_T3CON: case SIM_PR3: timer_written(timers_[2], false); break;
+        case SIM_TMR3: timer_written(timers_[2], true); break;
+        case SIM_T4CON: case SIM_PR4: timer_written(timers_[3], false); break;
+        case SIM_TMR4: timer_written(timers_[3], true); break;
+        case SIM_IFS0:
+        case SIM_IEC0:
+            // Latency counts from the moment the request could be taken
+            for (int flag = 0; flag < 16; flag++) {
+                if (((value & ~old) >> flag) & 1) flag_time_[flag] = now_;
+            }
+            break;
+        case SIM_U1STA:
+            if ((old & 0x2) && !(value & 0x2)) rx_fifo_.clear(); // OERR cleared
+            if (!(old & 0x0400) && (value & 0x0400)) set_flag(U1TXIF); // UTXEN, buffer empty
+            refresh(SIM_U1STA);
+            break;
+        case SIM_U1TXREG:
+            if (value != SENTINEL) uart_write(value & 0x1FF);
+            hw_set(SIM_U1TXREG, SENTINEL);
+            break;
+        case SIM_SPI1BUF:
+            if (value != SENTINEL) spi_write(value & 0xFFFF);
+            hw_set(SIM_SPI1BUF, SENTINEL);
+            break;
+        case SIM_SPI1STAT:
+            refresh(SIM_SPI1STAT);
+            break;
+        case SIM_AD1CON2:
+            refresh(SIM_AD1CON2);
+            break;
+        case SIM_AD1CON1:
+            if (!((value >> 15) & 1)) adc_pending_ = false;
+            break;
+        case SIM_OC1R: case SIM_OC2R: case SIM_OC3R: case SIM_OC4R: {
+            int oc = (sfr - SIM_OC1R) / (SIM_OC2R - SIM_OC1R);
+            trace_.record(now_, sig_oc_[oc], value & 0xFFFF);
+            oc_changes_++;
+            log("oc %u %u %u %u %s", reg(SIM_OC1R), reg(SIM_OC2R), reg(SIM_OC3R), reg(SIM_OC4R),
+                isr_active_ < 0 ? "main" : SOURCES[isr_active_].name);
+            motors_written();
+            break;
+        }
+        case SIM_LATA: pins_written(0, old, value); break;
+        case SIM_LATB: pins_written(1, old, value); break;
+        case SIM_LATF: pins_written(2, old, value); break;
+        case SIM_PORTE:
+            refresh(SIM_PORTE);
+            break;
+        case SIM_NVMCON:
+            if (now_ < nvm_end_) hw_bit(SIM_NVMCON, 15, true);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Values the firmware is about to read
+    void refresh(SimSfr sfr) {
+        switch (sfr) {
+        case SIM_TMR1: case SIM_TMR2: case SIM_TMR3: case SIM_TMR4: {
+            Timer &t = timers_[(sfr - SIM_TMR1) / (SIM_TMR2 - SIM_TMR1)];
+            if (t.on) hw_set(sfr, (unsigned) (std::max<int64_t>(0, (int64_t) now_ - t.base) / t.prescale) & 0xFFFF);
+            break;
+        }
+        case SIM_U1STA: {
+            unsigned sta = reg(SIM_U1STA) & ~0x0311u;
+            if (!rx_fifo_.empty()) sta |= 0x0001; // URXDA
+            if (!rx_active_) sta |= 0x0010; // RIDLE
+            if (!tx_busy_ && tx_fifo_.empty()) sta |= 0x0100; // TRMT
+            if ((int) tx_fifo_.size() == UART_FIFO) sta |= 0x0200; // UTXBF
+            hw_set(SIM_U1STA, sta);
+            break;
+        }
+        case SIM_U1RXREG:
+            if (!rx_fifo_.empty()) {
+                hw_set(SIM_U1RXREG, rx_fifo_.front());
+                rx_fifo_.pop_front();
+            }
+            break;
+        case SIM_U1TXREG:
+            hw_set(SIM_U1TXREG, SENTINEL);
+            break;
+        case SIM_SPI1STAT: {
+            unsigned stat = reg(SIM_SPI1STAT) & ~0x0043u;
+            if (spi_full_) stat |= 0x0001; // SPIRBF
+            if (spi_queued_) stat |= 0x0002; // SPITBF
+            if (spi_overflow_) stat |= 0x0040; // SPIROV
+            hw_set(SIM_SPI1STAT, stat);
+            break;
+        }
+        case SIM_SPI1BUF:
+            if (spi_full_) {
+                spi_full_ = false;
+                hw_set(SIM_SPI1BUF, spi_received_);
+            } else {
+                hw_set(SIM_SPI1BUF, SENTINEL);
+            }
+            break;
+        case SIM_AD1CON2:
+            hw_set(SIM_AD1CON2, (reg(SIM_AD1CON2) & ~0x80u) | (adc_half_ << 7));
+            break;
+        case SIM_DISICNT:
+            hw_set(SIM_DISICNT, now_ < disi_end_ ? (unsigned) (disi_end_ - now_) & 0x3FFF : 0);
+            break;
+        case SIM_PORTE:
+            hw_set(SIM_PORTE, (reg(SIM_PORTE) & ~0x0300u) | (!pressed_[0] << 8) | (!pressed_[1] << 9));
+            break;
+        default:
+            break;
+        }
+    }
+
+    void pins_written(int port, unsigned old, unsigned value) {
+        for (const Pin &pin : pins_) {
+            if (pin.port != port || !(((old ^ value) >> pin.bit) & 1)) continue;
+            bool level = (value >> pin.bit) & 1;
+            trace_.record(now_, pin.signal, level);
+            if (pin.signal == sig_acc_cs_) {
+                if (!level) {
+                    acceleration_catch_up();
+                    accelerometer_.select();
+                    cs_low_ = true;
+                    cs_low_since_ = now_;
+                } else if (cs_low_) {
+                    cs_low_ = false;
+                    cs_low_cycles_ += now_ - cs_low_since_;
+                }
+            }
+        }
+    }
+
+    // ------------------------------------------------------------
+    // Time
+    // ------------------------------------------------------------
+    void step(int cycles) {
+        flush();
+        advance(now_ + cycles);
+        deliver();
+    }
+
+    void advance(uint64_t to) {
+        for (;;) {
+            uint64_t next = next_event();
+            if (next > to || next >= end_) break;
+            now_ = std::max(now_, next);
+            process_events();
+        }
+        if (to >= end_) {
+            now_ = end_;
+            std::longjmp(end_jump_, 1);
+        }
+        now_ = std::max(now_, to);
+    }
+
+    uint64_t next_event() const {
+        uint64_t next = end_;
+        for (const Timer &t : timers_) next = std::min(next, t.wrap);
+        if (tx_busy_) next = std::min(next, tx_end_);
+        if (rx_active_) next = std::min(next, rx_end_);
+        else if (!rx_queue_.empty()) next = std::min(next, now_);
+        if (rx_line_ < rx_lines_.size()) next = std::min(next, rx_lines_[rx_line_].cycle);
+        if (spi_busy_) next = std::min(next, spi_end_);
+        if (adc_pending_) next = std::min(next, adc_done_);
+        if (nvm_end_ > now_ && bit(SIM_NVMCON, 15)) next = std::min(next, nvm_end_);
+        if (button_edge_ < buttons_.size()) next = std::min(next, buttons_[button_edge_].cycle);
+        return next;
+    }
+
+    void process_events() {
+        for (Timer &t : timers_) {
+            while (t.wrap <= now_) timer_period(t);
+        }
+        if (tx_busy_ && tx_end_ <= now_) {
+            tx_busy_ = false;
+            if (!tx_fifo_.empty()) uart_shift(tx_end_);
+        }
+        while (rx_line_ < rx_lines_.size() && rx_lines_[rx_line_].cycle <= now_) {
+            for (char c : rx_lines_[rx_line_].text) rx_queue_.push_back((uint8_t) c);
+            rx_line_++;
+        }
+        if (rx_active_ && rx_end_ <= now_) uart_received();
+        if (!rx_active_ && !rx_queue_.empty()) uart_receive_start();
+        if (spi_busy_ && spi_end_ <= now_) spi_done();
+        if (adc_pending_ && adc_done_ <= now_) adc_done();
+        if (nvm_end_ <= now_ && bit(SIM_NVMCON, 15)) {
+            hw_bit(SIM_NVMCON, 15, false);
+            trace_.record(nvm_end_, sig_nvm_, 0);
+        }
+        while (button_edge_ < buttons_.size() && buttons_[button_edge_].cycle <= now_) {
+            const ButtonEdge &edge = buttons_[button_edge_++];
+            pressed_[edge.button] = edge.pressed;
+            trace_.record(now_, sig_button_[edge.button], edge.pressed);
+        }
+    }
+
+    // ------------------------------------------------------------
+    // Interrupts
+    // ------------------------------------------------------------
+    void deliver() {
+        for (;;) {
+            if (!bit(SIM_INTCON2, 15)) return; // GIE
+            if (isr_depth_ > 0 && bit(SIM_INTCON1, 15)) return; // NSTDIS
+            bool disi = now_ < disi_end_;
+            int chosen = -1, chosen_ipl = 0;
+            for (int i = 0; i < SOURCE_COUNT; i++) {
+                const Source &s = SOURCES[i];
+                int ipl = (reg(s.ipc) >> s.shift) & 7;
+                if (!bit(SIM_IFS0, s.flag) || !bit(SIM_IEC0, s.flag)) continue;
+                if (ipl <= cpu_ipl_ || (disi && ipl < 7) || ipl <= chosen_ipl) continue;
+                chosen = i;
+                chosen_ipl = ipl;
+            }
+            if (chosen < 0) return;
+            run_isr(chosen, chosen_ipl);
+        }
+    }
+
+    void run_isr(int index, int ipl) {
+        const Source &s = SOURCES[index];
+        Stats &stats = isr_stats_[index];
+        uint64_t latency = now_ - flag_time_[s.flag];
+        uint64_t entry = now_;
+        int saved_ipl = cpu_ipl_, saved_active = isr_active_;
+
+        isr_entries_++;
+        trace_.record(now_, sig_isr_[index], 1);
+        isr_depth_++;
+        isr_active_ = index;
+        set_ipl(ipl);
+        advance(now_ + ISR_ENTRY_CYCLES);
+        s.handler();
+        flush();
+        advance(now_ + ISR_EXIT_CYCLES);
+        set_ipl(saved_ipl);
+        isr_active_ = saved_active;
+        isr_depth_--;
+        trace_.record(now_, sig_isr_[index], 0);
+
+        stats.count++;
+        stats.total += now_ - entry;
+        stats.max = std::max<uint64_t>(stats.max, now_ - entry);
+        stats.latency_total += latency;
+        stats.latency_max = std::max(stats.latency_max, latency);
+    }
+
+    void set_ipl(int ipl) {
+        cpu_ipl_ = ipl;
+        hw_set(SIM_SR, (reg(SIM_SR) & ~0xE0u) | (ipl << 5));
+        trace_.record(now_, sig_ipl_, ipl);
+    }
+
+    // ------------------------------------------------------------
+    // Timers and ADC
+    // ------------------------------------------------------------
+    void timer_written(Timer &t, bool count_written) {
+        unsigned con = reg(t.con);
+        bool on = (con >> 15) & 1;
+        unsigned prescale = PRESCALE[(con >> 4) & 3];
+        uint64_t period = reg(t.pr) + 1;
+        uint64_t count;
+        if (count_written || !t.on) count = reg(t.tmr);
+        else count = std::max<int64_t>(0, (int64_t) now_ - t.base) / t.prescale;
+        if (count >= period) count = 0;
+        bool started = on && !t.on;
+        t.on = on;
+        t.prescale = prescale;
+        t.base = (int64_t) now_ - (int64_t) (count * prescale);
+        if (&t == &timers_[2] && started) t.base += (int64_t) (options_.adc_delay_us * FCY / 1e6);
+        t.wrap = on ? (uint64_t) (t.base + (int64_t) (period * prescale)) : NEVER;
+        if (!on) hw_set(t.tmr, (unsigned) count);
+    }
+
+    void timer_period(Timer &t) {
+        t.base = (int64_t) t.wrap;
+        t.wrap += (uint64_t) (reg(t.pr) + 1) * t.prescale;
+        uint64_t at = now_;
+        now_ = (uint64_t) t.base; // stamp the period end itself
+        if (t.flag >= 0) set_flag(t.flag);
+        if (&t == &timers_[0]) {
+            last_tick_ = now_;
+            tick_level_ ^= 1;
+            trace_.record(now_, sig_tick_, tick_level_);
+        }
+        if (&t == &timers_[2] && bit(SIM_AD1CON1, 15) && ((reg(SIM_AD1CON1) >> 5) & 7) == 2 && !adc_pending_) {
+            unsigned tad = (reg(SIM_AD1CON3) & 0xFF) + 1;
+            adc_pending_ = true;
+            adc_done_ = now_ + ADC_CONVERSION_TAD * tad;
+        }
+        now_ = at;
+    }
+
+    double obstacle_mm() const {
+        const auto &profile = options_.profile;
+        double ms = now_ / FCY * 1000;
+        if (profile.empty()) return options_.distance_mm - options_.approach_mm_s * ms / 1000;
+        if (ms <= profile.front().first) return profile.front().second;
+        for (std::size_t i = 1; i < profile.size(); i++) {
+            auto [ms0, mm0] = profile[i - 1];
+            auto [ms1, mm1] = profile[i];
+            if (ms < ms1) return mm0 + (mm1 - mm0) * (ms - ms0) / (ms1 - ms0);
+        }
+        return profile.back().second;
+    }
+
+    void adc_done() {
+        adc_pending_ = false;
+        // Scanned inputs in ascending order
+        std::vector<int> scan;
+        for (int an = 0; an < 16; an++) {
+            if ((reg(SIM_AD1CSSL) >> an) & 1) scan.push_back(an);
+        }
+        int channel = scan.empty() ? 0 : scan[adc_scan_ % scan.size()];
+        adc_scan_++;
+        double code;
+        if (channel == 11) {
+            code = options_.battery_mv / 9900 * 1023;
+        } else {
+            code = ir_code(std::max(obstacle_mm(), 150.0)) + std::normal_distribution<double>(0, 0.5)(noise_);
+        }
+        unsigned value = (unsigned) std::clamp(std::lround(code), 0L, 1023L);
+        hw_set((SimSfr) (SIM_ADC1BUF0 + 8 * adc_half_ + adc_count_), value);
+        int per_interrupt = ((reg(SIM_AD1CON2) >> 2) & 0x1F) + 1;
+        if (++adc_count_ >= std::min(per_interrupt, 8)) {
+            adc_count_ = 0;
+            set_flag(AD1IF);
+            if (bit(SIM_AD1CON2, 1)) adc_half_ ^= 1; // BUFM
+            refresh(SIM_AD1CON2);
+        }
+    }
+
+    // ------------------------------------------------------------
+    // UART1
+    // ------------------------------------------------------------
+    uint64_t bit_cycles() const {
+        return (uint64_t) (bit(SIM_U1MODE, 3) ? 4 : 16) * (reg(SIM_U1BRG) + 1);
+    }
+
+    void uart_write(unsigned character) {
+        if (!bit(SIM_U1MODE, 15) || !bit(SIM_U1STA, 10)) return;
+        if ((int) tx_fifo_.size() == UART_FIFO) {
+            tx_dropped_++;
+            return;
+        }
+        tx_fifo_.push_back((uint16_t) character);
+        if (!tx_busy_) uart_shift(now_);
+        refresh(SIM_U1STA);
+    }
+
+    // Next character into the shift register, which raises U1TXIF
+    void uart_shift(uint64_t at) {
+        uint16_t character = tx_fifo_.front();
+        tx_fifo_.pop_front();
+        uint64_t bits = bit_cycles();
+        tx_busy_ = true;
+        tx_end_ = at + 10 * bits;
+        tx_bytes_++;
+        tx_line_cycles_ += 10 * bits;
+        trace_.record(at, sig_u1tx_, (character & 0xFF) | (uint32_t) (std::min<uint64_t>(bits, 0xFFFF) << 16));
+        set_flag(U1TXIF);
+        if ((character & 0xFF) == '\n') {
+            log("tx %s", tx_line_.c_str());
+            tx_line_.clear();
+        } else if ((character & 0xFF) != '\r') {
+            tx_line_ += (char) character;
+        }
+    }
+
+    void uart_receive_start() {
+        uint64_t bits = bit_cycles();
+        rx_character_ = rx_queue_.front();
+        rx_queue_.pop_front();
+        rx_active_ = true;
+        rx_end_ = now_ + 10 * bits;
+        rx_line_cycles_ += 10 * bits;
+        trace_.record(now_, sig_u1rx_, rx_character_ | (uint32_t) (std::min<uint64_t>(bits, 0xFFFF) << 16));
+    }
+
+    void uart_received() {
+        rx_active_ = false;
+        uint64_t at = now_;
+        now_ = rx_end_;
+        if (bit(SIM_U1MODE, 15)) {
+            rx_bytes_++;
+            if ((int) rx_fifo_.size() < UART_FIFO) {
+                rx_fifo_.push_back(rx_character_);
+            } else {
+                rx_overruns_++;
+                hw_bit(SIM_U1STA, 1, true); // OERR
+            }
+            set_flag(U1RXIF);
+        }
+        if (!rx_queue_.empty()) uart_receive_start();
+        now_ = at;
+    }
+
+    // ------------------------------------------------------------
+    // SPI1
+    // ------------------------------------------------------------
+    void spi_write(unsigned value) {
+        if (!bit(SIM_SPI1STAT, 15)) return;
+        if (spi_busy_) {
+            spi_queued_ = true;
+            spi_next_ = value;
+        } else {
+            spi_start(value);
+        }
+    }
+
+    void spi_start(unsigned value) {
+        static const unsigned primary[4] = {64, 16, 4, 1};
+        unsigned con = reg(SIM_SPI1CON1);
+        unsigned divider = primary[con & 3] * (8 - ((con >> 2) & 7));
+        int bits = ((con >> 10) & 1) ? 16 : 8;
+        spi_busy_ = true;
+        spi_end_ = now_ + (uint64_t) bits * divider;
+        spi_busy_cycles_ += (uint64_t) bits * divider;
+        spi_transfers_++;
+        uint8_t status = accelerometer_.status();
+        spi_pending_rx_ = cs_low_ ? accelerometer_.exchange((uint8_t) value) : 0xFF;
+        if (accelerometer_.status() != status) trace_.record(now_, sig_acc_int_, accelerometer_.status());
+        trace_.record(now_, sig_spi_busy_, 1);
+        trace_.record(now_, sig_mosi_, value & 0xFF);
+    }
+
+    void spi_done() {
+        uint64_t at = now_;
+        now_ = spi_end_;
+        spi_busy_ = false;
+        if (spi_full_) spi_overflow_ = true;
+        spi_full_ = true;
+        spi_received_ = spi_pending_rx_;
+        trace_.record(now_, sig_spi_busy_, 0);
+        trace_.record(now_, sig_miso_, spi_received_);
+        set_flag(SPI1IF);
+        if (spi_queued_) {
+            spi_queued_ = false;
+            spi_start(spi_next_);
+        }
+        now_ = at;
+    }
+
+    // ------------------------------------------------------------
+    // Robot body and incidents
+    // ------------------------------------------------------------
+    double duty(int oc) const {
+        SimSfr r = (SimSfr) (SIM_OC1R + oc * (SIM_OC2R - SIM_OC1R));
+        unsigned period = reg((SimSfr) (r - 1)); // OCxRS
+        return period ? std::min(1.0, (double) reg(r) / period) : 0;
+    }
+
+    void motors_written() {
+        if (duty(0) || duty(1) || duty(2) || duty(3)) return;
+        double ms = now_ / FCY * 1000;
+        for (Incident &incident : incidents_) {
+            if (incident.motors_off_ms < 0 && ms >= incident.ms) incident.motors_off_ms = ms;
+        }
+    }
+
+    // Feeds the accelerometer every sample up to now
+    void acceleration_catch_up() {
+        const uint64_t step = (uint64_t) (ACC_SAMPLE_MS * FCY / 1000);
+        const double dt_s = ACC_SAMPLE_MS / 1000;
+        while (acc_sampled_ + step <= now_) {
+            acc_sampled_ += step;
+            double ms = acc_sampled_ / FCY * 1000;
+            double mg[3] = {options_.acc_mg[0], options_.acc_mg[1], options_.acc_mg[2]};
+
+            // Forward speed: the motor model, or slowing to rest once stuck or lifted
+            double speed = body_speed_mm_s_;
+            double held_ms = std::max(options_.stuck_ms, options_.lift_ms);
+            if (held_ms >= 0 && ms >= held_ms) {
+                if (stop_rate_ == 0) stop_rate_ = std::max(std::fabs(speed), 1.0) / (STUCK_STOP_MS / 1000);
+                speed = speed > 0 ? std::max(0.0, speed - stop_rate_ * dt_s) : std::min(0.0, speed + stop_rate_ * dt_s);
+            } else {
+                double target = (duty(0) - duty(1) + duty(2) - duty(3)) / 2 * WHEEL_MAX_MM_S;
+                speed += (target - speed) * ACC_SAMPLE_MS / MOTOR_TAU_MS;
+            }
+            mg[0] += (speed - body_speed_mm_s_) / dt_s / 9.81; // mm/s^2 to mg
+            body_speed_mm_s_ = speed;
+
+            for (const Options::Impact &impact : options_.impacts) {
+                double t = ms - impact.ms;
+                if (t < 0 || t > impact.duration_ms) continue;
+                double shape = std::sin(M_PI * t / impact.duration_ms);
+                mg[0] += impact.x_mg * shape;
+                mg[1] += impact.y_mg * shape;
+            }
+            if (options_.lift_ms >= 0 && ms >= options_.lift_ms) {
+                double t = ms - options_.lift_ms;
+                if (t < LIFT_UP_MS) {
+                    mg[2] += LIFT_MG;
+                } else {
+                    double tilt = M_PI / 4 * std::min(1.0, (t - LIFT_UP_MS) / LIFT_TILT_MS);
+                    mg[0] += 1000 * std::sin(tilt);
+                    mg[2] -= 1000 * (1 - std::cos(tilt));
+                }
+            }
+
+            uint8_t before = accelerometer_.status();
+            accelerometer_.sample(mg);
+            if (accelerometer_.status() != before) trace_.record(acc_sampled_, sig_acc_int_, accelerometer_.status());
+        }
+    }
+
+    // ------------------------------------------------------------
+    // Signals
+    // ------------------------------------------------------------
+    struct Pin {
+        int port, bit, signal;
+    };
+
+    void define_signals() {
+        using sim::SignalKind;
+        sig_tick_ = trace_.add_signal("tmr1_period", SignalKind::wire);
+        sig_loop_ = trace_.add_signal("main_loop_busy", SignalKind::wire);
+        sig_ipl_ = trace_.add_signal("cpu_ipl", SignalKind::vector, 3);
+        for (int i = 0; i < SOURCE_COUNT; i++) {
+            sig_isr_[i] = trace_.add_signal(std::string("isr_") + SOURCES[i].name, SignalKind::wire);
+        }
+        sig_u1tx_ = trace_.add_signal("u1tx", SignalKind::serial);
+        sig_u1rx_ = trace_.add_signal("u1rx", SignalKind::serial);
+        sig_acc_cs_ = trace_.add_signal("acc_cs", SignalKind::wire, 1, 1);
+        sig_spi_busy_ = trace_.add_signal("spi1_busy", SignalKind::wire);
+        sig_mosi_ = trace_.add_signal("spi1_mosi", SignalKind::vector, 8);
+        sig_miso_ = trace_.add_signal("spi1_miso", SignalKind::vector, 8);
+        sig_acc_int_ = trace_.add_signal("acc_int_status", SignalKind::vector, 8);
+        const char *oc_names[4] = {"oc1_left_forward", "oc2_left_backward", "oc3_right_forward", "oc4_right_backward"};
+        for (int i = 0; i < 4; i++) sig_oc_[i] = trace_.add_signal(oc_names[i], SignalKind::vector, 16);
+        pins_ = {
+            {0, 0, trace_.add_signal("led1", SignalKind::wire)},
+            {1, 3, sig_acc_cs_},
+            {1, 4, trace_.add_signal("ir_enable", SignalKind::wire)},
+            {1, 8, trace_.add_signal("turn_r", SignalKind::wire)},
+            {2, 1, trace_.add_signal("turn_l", SignalKind::wire)},
+        };
+        sig_button_[0] = trace_.add_signal("t2_pressed", SignalKind::wire);
+        sig_button_[1] = trace_.add_signal("t3_pressed", SignalKind::wire);
+        sig_nvm_ = trace_.add_signal("nvm_busy", SignalKind::wire);
+    }
+
+    const Options &options_;
+    jmp_buf end_jump_;
+    uint64_t now_ = 0, end_;
+    unsigned seen_[SIM_SFR_COUNT];
+    SimSfr last_access_ = SIM_SFR_COUNT;
+    sim::Trace trace_;
+
+    // Core and interrupts
+    int cpu_ipl_ = 0, isr_depth_ = 0, isr_active_ = -1; // SOURCES index of the running routine
+    uint64_t disi_end_ = 0, isr_entries_ = 0;
+    uint64_t flag_time_[16] = {};
+    Stats isr_stats_[SOURCE_COUNT];
+    bool firmware_reset_ = false;
+
+    // Timers: system tick, free, ADC pacing, cycle counter
+    Timer timers_[4] = {
+        {SIM_TMR1, SIM_PR1, SIM_T1CON, T1IF},
+        {SIM_TMR2, SIM_PR2, SIM_T2CON, T2IF},
+        {SIM_TMR3, SIM_PR3, SIM_T3CON, T3IF},
+        {SIM_TMR4, SIM_PR4, SIM_T4CON, -1},
+    };
+    uint64_t last_tick_ = 0;
+    int tick_level_ = 0;
+
+    // Main loop
+    uint64_t loop_start_ = 0, loop_overruns_ = 0;
+    std::vector<uint32_t> loop_busy_, loop_periods_, loop_latency_;
+
+    // ADC
+    bool adc_pending_ = false;
+    uint64_t adc_done_ = 0;
+    unsigned adc_half_ = 0, adc_scan_ = 0;
+    int adc_count_ = 0;
+    std::mt19937 noise_;
+
+    // UART1
+    std::deque<uint16_t> tx_fifo_;
+    bool tx_busy_ = false;
+    uint64_t tx_end_ = 0, tx_bytes_ = 0, tx_line_cycles_ = 0, tx_dropped_ = 0;
+    std::string tx_line_;
+    std::vector<RxLine> rx_lines_;
+    std::size_t rx_line_ = 0;
+    std::deque<uint8_t> rx_queue_; // sent by the PC, not on the line yet
+    std::deque<uint16_t> rx_fifo_;
+    bool rx_active_ = false;
+    uint8_t rx_character_ = 0;
+    uint64_t rx_end_ = 0, rx_bytes_ = 0, rx_line_cycles_ = 0, rx_overruns_ = 0;
+
+    // SPI1 and the accelerometer
+    Accelerometer accelerometer_;
+    bool spi_busy_ = false, spi_full_ = false, spi_queued_ = false, spi_overflow_ = false;
+    unsigned spi_next_ = 0, spi_received_ = 0, spi_pending_rx_ = 0;
+    uint64_t spi_end_ = 0, spi_busy_cycles_ = 0, spi_transfers_ = 0;
+    bool cs_low_ = false;
+    uint64_t cs_low_since_ = 0, cs_low_cycles_ = 0;
+    uint64_t acc_sampled_ = 0;
+    double body_speed_mm_s_ = 0, stop_rate_ = 0; // mm/s, mm/s^2
+    std::vector<Incident> incidents_;
+
+    // Buttons, output compare, flash
+    std::vector<ButtonEdge> buttons_;
+    std::size_t button_edge_ = 0;
+    bool pressed_[2] = {false, false};
+    uint64_t oc_changes_ = 0;
+    std::map<uint32_t, uint32_t> flash_; // program address -> 24-bit word, absent = erased
+    uint32_t latch_[2] = {0xFFFFFF, 0xFFFFFF};
+    std::map<const volatile void *, unsigned long> program_objects_;
+    uint64_t nvm_end_ = 0, nvm_operations_ = 0;
+
+    // Trace signal numbers
+    int sig_tick_, sig_loop_, sig_ipl_, sig_isr_[SOURCE_COUNT], sig_u1tx_, sig_u1rx_;
+    int sig_acc_cs_, sig_spi_busy_, sig_mosi_, sig_miso_, sig_acc_int_, sig_oc_[4], sig_button_[2], sig_nvm_;
+    std::vector<Pin> pins_;
+    std::string log_;
+};
+
+Machine *machine = nullptr;
+
+bool parse_profile(const char *text, std::vector<std::pair<double, double>> &profile) {
+    profile.clear();
+    while (*text) {
+        double ms, mm;
+        int used = 0;
+        if (std::sscanf(text, "%lf:%lf%n", &ms, &mm, &used) != 2) return false;
+        if (!profile.empty() && ms <= profile.back().first) return false;
+        profile.push_back({ms, mm});
+        text += used;
+        if (*text == ',') text++;
+    }
+    return !profile.empty();
+}
+
+bool parse_press(const char *text, Options::Press &press) {
+    if ((text[0] != 'T' && text[0] != 't') || (text[1] != '2' && text[1] != '3') || text[2] != ':') return false;
+    press.button = text[1] - '2';
+    press.hold_ms = 100;
+    return std::sscanf(text + 3, "%lf:%lf", &press.ms, &press.hold_ms) >= 1;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------
+// Hooks called by the firmware built against the host xc.h
+// ---------------------------------------------------------------
+extern "C" {
+
+volatile unsigned int *sim_sfr(SimSfr sfr) { return machine->access(sfr); }
+void sim_disi(unsigned int cycles) { machine->disi(cycles); }
+void sim_idle(void) { machine->idle(); }
+void sim_write_nvm(void) { machine->write_nvm(); }
+unsigned int sim_tblrdl(unsigned int offset) { return machine->table_read(offset, false); }
+unsigned int sim_tblrdh(unsigned int offset) { return machine->table_read(offset, true); }
+void sim_tblwtl(unsigned int offset, unsigned int value) { machine->table_write(offset, value, false); }
+void sim_tblwth(unsigned int offset, unsigned int value) { machine->table_write(offset, value, true); }
+unsigned long sim_tbladdress(const volatile void *object) { return machine->table_address(object); }
+
+void sim_asm(const char *instruction) {
+    if (!std::strcmp(instruction, "RESET")) machine->reset_instruction();
+}
+
+int __wrap_tmr_wait_period(int timer) { return machine->wait_period(timer); }
+
+// -finstrument-functions: every firmware call costs cycles and may be
+// interrupted
+void __cyg_profile_func_enter(void *, void *) {
+    if (machine) machine->call();
+}
+void __cyg_profile_func_exit(void *, void *) {}
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    bool scripted = false;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (!std::strcmp(arg, "--ms") && ok) options.ms = std::atof(value);
+        else if (!std::strcmp(arg, "--vcd") && ok) options.vcd = value;
+        else if (!std::strcmp(arg, "--rx") && ok && std::strchr(value, ':')) {
+            options.rx.push_back({std::atof(value), std::strchr(value, ':') + 1});
+            scripted = true;
+        } else if (!std::strcmp(arg, "--press") && ok) {
+            Options::Press press;
+            ok = parse_press(value, press);
+            options.presses.push_back(press);
+            scripted = true;
+        } else if (!std::strcmp(arg, "--distance") && ok) options.distance_mm = std::atof(value);
+        else if (!std::strcmp(arg, "--approach") && ok) options.approach_mm_s = std::atof(value);
+        else if (!std::strcmp(arg, "--profile") && ok) ok = parse_profile(value, options.profile);
+        else if (!std::strcmp(arg, "--battery") && ok) options.battery_mv = std::atof(value);
+        else if (!std::strcmp(arg, "--acc") && ok) {
+            ok = std::sscanf(value, "%lf,%lf,%lf", &options.acc_mg[0], &options.acc_mg[1], &options.acc_mg[2]) == 3;
+        } else if (!std::strcmp(arg, "--impact") && ok) {
+            Options::Impact impact = {0, 0, 0, 5};
+            ok = std::sscanf(value, "%lf:%lf,%lf:%lf", &impact.ms, &impact.x_mg, &impact.y_mg, &impact.duration_ms) >= 3 &&
+                 impact.duration_ms > 0;
+            options.impacts.push_back(impact);
+        } else if (!std::strcmp(arg, "--stuck") && ok) options.stuck_ms = std::atof(value);
+        else if (!std::strcmp(arg, "--lift") && ok) options.lift_ms = std::atof(value);
+        else if (!std::strcmp(arg, "--access-cycles") && ok) options.access_cycles = std::atoi(value);
+        else if (!std::strcmp(arg, "--call-cycles") && ok) options.call_cycles = std::atoi(value);
+        else if (!std::strcmp(arg, "--log") && ok) options.log = value;
+        else if (!std::strcmp(arg, "--adc-delay") && ok) options.adc_delay_us = std::atof(value);
+        else ok = false;
+        if (!ok) {
+            std::fprintf(stderr,
+                         "usage: %s [--ms N] [--vcd FILE] [--rx MS:LINE]... [--press T2|T3:MS[:HOLD_MS]]...\n"
+                         "       [--distance MM] [--approach MM/S] [--profile MS:MM,...] [--battery MV]\n"
+                         "       [--acc X,Y,Z] [--impact MS:X,Y[:DURATION_MS]]... [--stuck MS] [--lift MS]\n"
+                         "       [--access-cycles N] [--call-cycles N] [--adc-delay US] [--log FILE]\n",
+                         argv[0]);
+            return 2;
+        }
+        i++;
+    }
+    if (!scripted) {
+        options.rx.push_back({10, "$PCREF,50,0*"});
+        options.presses.push_back({0, 50, 100});
+    }
+
+    Machine simulated(options);
+    machine = &simulated;
+    auto start = std::chrono::steady_clock::now();
+    if (setjmp(simulated.end_jump()) == 0) {
+        firmware_main();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    machine = nullptr; // no more firmware calls to account
+
+    simulated.report(seconds);
+    if (options.vcd) {
+        if (!simulated.write_vcd(options.vcd)) {
+            std::fprintf(stderr, "cannot write %s\n", options.vcd);
+            return 1;
+        }
+        std::printf("VCD written to %s\n", options.vcd);
+    }
+    if (options.log && !simulated.write_log(options.log)) {
+        std::fprintf(stderr, "cannot write %s\n", options.log);
+        return 1;
+    }
+    return 0;
+}
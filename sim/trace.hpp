@@ -0,0 +1,176 @@
+// ===============================================================
+// File: trace.hpp
+// Author: group 1
+// Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+// Compact in-memory signal trace for the host simulators, exported
+// as a VCD file for GTKWave. Each change is stored as the cycle delta
+// since the previous change (LEB128), the signal number (one byte)
+// and the new value (LEB128), so a pin toggle usually takes 3 bytes.
+// Serial signals store one change per character, with the bit time,
+// and are expanded to start, data and stop bits on export.
+// ===============================================================
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+enum class SignalKind {
+    wire,   // one bit
+    vector, // width bits
+    serial, // value = character | cycles per bit << 16, 8N1 idle high
+};
+
+class Trace {
+public:
+    // Returns the signal number to pass to record()
+    int add_signal(std::string name, SignalKind kind, int width = 1, uint32_t initial = 0) {
+        if (kind == SignalKind::serial) {
+            width = 1;
+            initial = 1;
+        }
+        signals_.push_back({std::move(name), kind, kind == SignalKind::vector ? width : 1, initial});
+        return (int) signals_.size() - 1;
+    }
+
+    // Changes are expected in cycle order, an earlier one is stamped
+    // with the cycle of the last change.
+    void record(uint64_t cycle, int signal, uint32_t value) {
+        uint64_t delta = cycle > last_cycle_ ? cycle - last_cycle_ : 0;
+        last_cycle_ += delta;
+        put(delta);
+        data_.push_back((uint8_t) signal);
+        put(value);
+        events_++;
+    }
+
+    std::size_t events() const { return events_; }
+    std::size_t bytes() const { return data_.size(); }
+
+    // Calls f(cycle, signal, value) for every change in order
+    template <class F>
+    void for_each(F f) const {
+        std::size_t at = 0;
+        uint64_t cycle = 0;
+        while (at < data_.size()) {
+            cycle += get(at);
+            int signal = data_[at++];
+            f(cycle, signal, (uint32_t) get(at));
+        }
+    }
+
+    // cycle_ns: duration of one cycle, times are written in ns
+    bool write_vcd(const char *path, double cycle_ns) const {
+        struct Change {
+            uint64_t ns;
+            int signal;
+            uint32_t value;
+        };
+        std::vector<Change> changes;
+        changes.reserve(events_);
+        auto to_ns = [cycle_ns](uint64_t cycle) { return (uint64_t) std::llround(cycle * cycle_ns); };
+        for_each([&](uint64_t cycle, int signal, uint32_t value) {
+            if (signals_[signal].kind != SignalKind::serial) {
+                changes.push_back({to_ns(cycle), signal, value});
+                return;
+            }
+            // Start bit, 8 data bits LSB first, stop bit
+            uint32_t bit_cycles = value >> 16;
+            for (int bit = 0; bit < 10; bit++) {
+                uint32_t level = bit == 0 ? 0 : bit == 9 ? 1 : (value >> (bit - 1)) & 1;
+                changes.push_back({to_ns(cycle + (uint64_t) bit * bit_cycles), signal, level});
+            }
+        });
+        std::stable_sort(changes.begin(), changes.end(),
+                         [](const Change &a, const Change &b) { return a.ns < b.ns; });
+
+        FILE *file = std::fopen(path, "w");
+        if (!file) return false;
+        std::fprintf(file, "$timescale 1ns $end\n$scope module firmware $end\n");
+        for (std::size_t i = 0; i < signals_.size(); i++) {
+            std::fprintf(file, "$var wire %d %s %s $end\n", signals_[i].width, id(i).c_str(),
+                         signals_[i].name.c_str());
+        }
+        std::fprintf(file, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+        std::vector<uint32_t> current(signals_.size());
+        for (std::size_t i = 0; i < signals_.size(); i++) {
+            current[i] = signals_[i].initial;
+            write_value(file, (int) i, current[i]);
+        }
+        std::fprintf(file, "$end\n");
+        uint64_t time = 0;
+        for (const Change &change : changes) {
+            if (current[change.signal] == change.value) continue;
+            if (change.ns != time) {
+                time = change.ns;
+                std::fprintf(file, "#%" PRIu64 "\n", time);
+            }
+            current[change.signal] = change.value;
+            write_value(file, change.signal, change.value);
+        }
+        return std::fclose(file) == 0;
+    }
+
+private:
+    struct Signal {
+        std::string name;
+        SignalKind kind;
+        int width;
+        uint32_t initial;
+    };
+
+    void put(uint64_t value) {
+        do {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            data_.push_back(value ? byte | 0x80 : byte);
+        } while (value);
+    }
+
+    uint64_t get(std::size_t &at) const {
+        uint64_t value = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            byte = data_[at++];
+            value |= (uint64_t) (byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return value;
+    }
+
+    // VCD identifiers from the printable characters
+    static std::string id(std::size_t index) {
+        std::string text;
+        do {
+            text += (char) ('!' + index % 94);
+            index /= 94;
+        } while (index);
+        return text;
+    }
+
+    void write_value(FILE *file, int signal, uint32_t value) const {
+        if (signals_[signal].width == 1) {
+            std::fprintf(file, "%u%s\n", value & 1, id(signal).c_str());
+            return;
+        }
+        char bits[33];
+        int n = 0;
+        for (int bit = signals_[signal].width - 1; bit >= 0; bit--) bits[n++] = '0' + ((value >> bit) & 1);
+        bits[n] = 0;
+        std::fprintf(file, "b%s %s\n", bits, id(signal).c_str());
+    }
+
+    std::vector<Signal> signals_;
+    std::vector<uint8_t> data_;
+    uint64_t last_cycle_ = 0;
+    std::size_t events_ = 0;
+};
+
+} // namespace sim
@@ -0,0 +1,125 @@
+// ===============================================================
+// File: work_pool.hpp
+// Author: group 1
+// Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+// Work-stealing parallel loop for the host simulators. Every worker
+// owns a deque of index ranges: it splits its range in halves down to
+// the grain, keeps working on the front half and pushes the rest on
+// its own deque (last in, first out), while idle workers steal the
+// oldest, largest ranges from the other end of a random victim. Runs
+// of very different length (a collision ends a scenario early, a
+// cleared emergency runs to the end) so still keep all cores busy.
+// ===============================================================
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace sim {
+
+class WorkPool {
+public:
+    explicit WorkPool(unsigned threads = std::thread::hardware_concurrency())
+        : threads_(threads ? threads : 1) {}
+
+    unsigned size() const { return threads_; }
+
+    // Ranges taken from another worker during the last run
+    std::uint64_t steals() const { return steals_; }
+
+    // Calls body(worker, index) once for every index in [0, count),
+    // worker in [0, size()) so callers can keep per-worker state.
+    template <class Body>
+    void parallel_for(std::size_t count, std::size_t grain, Body &&body) {
+        if (grain == 0) grain = 1;
+        queues_.clear();
+        for (unsigned i = 0; i < threads_; i++) queues_.push_back(std::make_unique<Queue>());
+        // One contiguous share per worker to start with
+        for (unsigned i = 0; i < threads_; i++) {
+            Range range{count * i / threads_, count * (i + 1) / threads_};
+            if (range.begin < range.end) queues_[i]->ranges.push_back(range);
+        }
+        remaining_.store(count);
+        steal_count_.store(0);
+
+        std::vector<std::jthread> workers;
+        for (unsigned i = 1; i < threads_; i++) {
+            workers.emplace_back([this, i, grain, &body] { work(i, grain, body); });
+        }
+        work(0, grain, body);
+        workers.clear(); // joins
+        steals_ = steal_count_.load();
+    }
+
+private:
+    struct Range {
+        std::size_t begin, end;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+    };
+
+    template <class Body>
+    void work(unsigned id, std::size_t grain, Body &body) {
+        std::minstd_rand random(id + 1);
+        Range range;
+        while (remaining_.load(std::memory_order_acquire) > 0) {
+            if (!pop(id, range) && !steal(id, random, range)) {
+                std::this_thread::yield();
+                continue;
+            }
+            while (range.end - range.begin > grain) {
+                std::size_t middle = range.begin + (range.end - range.begin) / 2;
+                push(id, {middle, range.end});
+                range.end = middle;
+            }
+            for (std::size_t i = range.begin; i < range.end; i++) body(id, i);
+            remaining_.fetch_sub(range.end - range.begin, std::memory_order_release);
+        }
+    }
+
+    void push(unsigned id, Range range) {
+        std::lock_guard lock(queues_[id]->mutex);
+        queues_[id]->ranges.push_back(range);
+    }
+
+    bool pop(unsigned id, Range &range) {
+        std::lock_guard lock(queues_[id]->mutex);
+        if (queues_[id]->ranges.empty()) return false;
+        range = queues_[id]->ranges.back();
+        queues_[id]->ranges.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned id, std::minstd_rand &random, Range &range) {
+        unsigned start = random() % threads_;
+        for (unsigned i = 0; i < threads_; i++) {
+            unsigned victim = (start + i) % threads_;
+            if (victim == id) continue;
+            std::lock_guard lock(queues_[victim]->mutex);
+            if (queues_[victim]->ranges.empty()) continue;
+            range = queues_[victim]->ranges.front();
+            queues_[victim]->ranges.pop_front();
+            steal_count_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    unsigned threads_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::atomic<std::size_t> remaining_{0};
+    std::atomic<std::uint64_t> steal_count_{0};
+    std::uint64_t steals_ = 0;
+};
+
+} // namespace sim
@@ -0,0 +1,293 @@
+/* ===============================================================
+ * File: xc.h (host)                                             =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * Stands in for the XC16 device header when the firmware is     =
+ * built for Linux by fw_trace.cpp. Every special function       =
+ * register the firmware uses is a slot of sim_sfr_file, reached =
+ * through sim_sfr(): the simulator advances the cycle counter,  =
+ * applies what the firmware wrote since the previous access,    =
+ * runs due interrupt routines and refreshes the status bits     =
+ * before handing out the register. The bit layouts follow the   =
+ * dsPIC33EP512MU810 data sheet for the fields the firmware uses. =
+ * ===============================================================*/
+
+#ifndef SIM_XC_H
+#define SIM_XC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*================================================================*/
+// Registers in data memory order where the firmware relies on it:
+// OCxRS follows OCxCON2 and ADC1BUF0-F are consecutive.
+#define SIM_SFR_LIST(X) \
+    X(SR) X(CORCON) X(DISICNT) X(TBLPAG) X(RCON) \
+    X(TMR1) X(PR1) X(T1CON) X(TMR2) X(PR2) X(T2CON) \
+    X(TMR3) X(PR3) X(T3CON) X(TMR4) X(PR4) X(T4CON) \
+    X(INTCON1) X(INTCON2) X(IFS0) X(IEC0) X(IPC0) X(IPC2) X(IPC3) \
+    X(U1MODE) X(U1STA) X(U1TXREG) X(U1RXREG) X(U1BRG) \
+    X(SPI1STAT) X(SPI1CON1) X(SPI1BUF) \
+    X(OC1CON1) X(OC1CON2) X(OC1RS) X(OC1R) X(OC1TMR) \
+    X(OC2CON1) X(OC2CON2) X(OC2RS) X(OC2R) X(OC2TMR) \
+    X(OC3CON1) X(OC3CON2) X(OC3RS) X(OC3R) X(OC3TMR) \
+    X(OC4CON1) X(OC4CON2) X(OC4RS) X(OC4R) X(OC4TMR) \
+    X(ADC1BUF0) X(ADC1BUF1) X(ADC1BUF2) X(ADC1BUF3) \
+    X(ADC1BUF4) X(ADC1BUF5) X(ADC1BUF6) X(ADC1BUF7) \
+    X(ADC1BUF8) X(ADC1BUF9) X(ADC1BUFA) X(ADC1BUFB) \
+    X(ADC1BUFC) X(ADC1BUFD) X(ADC1BUFE) X(ADC1BUFF) \
+    X(AD1CON1) X(AD1CON2) X(AD1CON3) X(AD1CSSL) \
+    X(NVMCON) X(NVMADR) X(NVMADRU) X(NVMKEY) \
+    X(PMD1) X(PMD2) X(PMD3) X(PMD4) \
+    X(RPINR18) X(RPINR20) X(RPOR0) X(RPOR1) X(RPOR2) X(RPOR11) X(RPOR12) \
+    X(ANSELA) X(ANSELB) X(ANSELC) X(ANSELD) X(ANSELE) X(ANSELG) \
+    X(TRISA) X(TRISB) X(TRISD) X(TRISE) X(TRISF) \
+    X(PORTE) X(LATA) X(LATB) X(LATF)
+
+#define SIM_SFR_ID(name) SIM_##name,
+typedef enum { SIM_SFR_LIST(SIM_SFR_ID) SIM_SFR_COUNT } SimSfr;
+#undef SIM_SFR_ID
+
+// Register slots, unsigned int like the pointers the firmware takes
+extern volatile unsigned int sim_sfr_file[SIM_SFR_COUNT];
+volatile unsigned int *sim_sfr(SimSfr sfr);
+
+#define SIM_REG(name) (*sim_sfr(SIM_##name))
+#define SIM_BITS(name) (*(volatile name##BITS *) sim_sfr(SIM_##name))
+/*================================================================*/
+
+/*================================================================*/
+// Core
+typedef struct {
+    unsigned C:1, Z:1, OV:1, N:1, RA:1, IPL:3, DC:1, DA:1, SAB:1, OAB:1, SB:1, SA:1, OB:1, OA:1;
+} SRBITS;
+typedef struct {
+    unsigned IF:1, RND:1, SFA:1, IPL3:1, ACCSAT:1, SATDW:1, SATB:1, SATA:1, DL:3, :1, US:2, :1, VAR:1;
+} CORCONBITS;
+typedef struct {
+    unsigned NVMOP:4, :2, ERASE:1, :6, WRERR:1, WREN:1, WR:1;
+} NVMCONBITS;
+
+// Timers
+typedef struct {
+    unsigned :1, TCS:1, TSYNC:1, :1, TCKPS:2, TGATE:1, :6, TSIDL:1, :1, TON:1;
+} TxCONBITS;
+typedef TxCONBITS T1CONBITS, T2CONBITS, T3CONBITS, T4CONBITS;
+
+// Interrupt controller
+typedef struct { unsigned :15, NSTDIS:1; } INTCON1BITS;
+typedef struct { unsigned INT0EP:1, INT1EP:1, INT2EP:1, :5, DISI:1, :4, SWTRAP:1, :1, GIE:1; } INTCON2BITS;
+typedef struct {
+    unsigned INT0IF:1, IC1IF:1, OC1IF:1, T1IF:1, DMA0IF:1, IC2IF:1, OC2IF:1, T2IF:1,
+             T3IF:1, SPI1EIF:1, SPI1IF:1, U1RXIF:1, U1TXIF:1, AD1IF:1, DMA1IF:1, NVMIF:1;
+} IFS0BITS;
+typedef struct {
+    unsigned INT0IE:1, IC1IE:1, OC1IE:1, T1IE:1, DMA0IE:1, IC2IE:1, OC2IE:1, T2IE:1,
+             T3IE:1, SPI1EIE:1, SPI1IE:1, U1RXIE:1, U1TXIE:1, AD1IE:1, DMA1IE:1, NVMIE:1;
+} IEC0BITS;
+typedef struct { unsigned INT0IP:3, :1, IC1IP:3, :1, OC1IP:3, :1, T1IP:3, :1; } IPC0BITS;
+typedef struct { unsigned SPI1EIP:3, :1, SPI1IP:3, :1, U1RXIP:3, :1, T3IP:3, :1; } IPC2BITS;
+typedef struct { unsigned U1TXIP:3, :1, AD1IP:3, :1, DMA1IP:3, :1, NVMIP:3, :1; } IPC3BITS;
+
+// UART1
+typedef struct {
+    unsigned STSEL:1, PDSEL:2, BRGH:1, URXINV:1, ABAUD:1, LPBACK:1, WAKE:1,
+             UEN:2, :1, RTSMD:1, IREN:1, USIDL:1, :1, UARTEN:1;
+} U1MODEBITS;
+typedef struct {
+    unsigned URXDA:1, OERR:1, FERR:1, PERR:1, RIDLE:1, ADDEN:1, URXISEL:2,
+             TRMT:1, UTXBF:1, UTXEN:1, UTXBRK:1, :1, UTXISEL0:1, UTXINV:1, UTXISEL1:1;
+} U1STABITS;
+
+// SPI1
+typedef struct {
+    unsigned SPIRBF:1, SPITBF:1, SISEL:3, SRXMPT:1, SPIROV:1, SRMPT:1, SPIBEC:3, :2, SPISIDL:1, :1, SPIEN:1;
+} SPI1STATBITS;
+typedef struct {
+    unsigned PPRE:2, SPRE:3, MSTEN:1, CKP:1, SSEN:1, CKE:1, SMP:1, MODE16:1, DISSDO:1, DISSCK:1, :3;
+} SPI1CON1BITS;
+
+// ADC1
+typedef struct {
+    unsigned DONE:1, SAMP:1, ASAM:1, SIMSAM:1, SSRCG:1, SSRC:3, FORM:2, AD12B:1, :1,
+             ADDMABM:1, ADSIDL:1, :1, ADON:1;
+} AD1CON1BITS;
+typedef struct { unsigned ALTS:1, BUFM:1, SMPI:5, BUFS:1, CHPS:2, CSCNA:1, :2, VCFG:3; } AD1CON2BITS;
+typedef struct { unsigned ADCS:8, SAMC:5, :2, ADRC:1; } AD1CON3BITS;
+typedef struct {
+    unsigned CSS0:1, CSS1:1, CSS2:1, CSS3:1, CSS4:1, CSS5:1, CSS6:1, CSS7:1,
+             CSS8:1, CSS9:1, CSS10:1, CSS11:1, CSS12:1, CSS13:1, CSS14:1, CSS15:1;
+} AD1CSSLBITS;
+
+// Peripheral module disable
+typedef struct {
+    unsigned AD1MD:1, C1MD:1, C2MD:1, SPI1MD:1, SPI2MD:1, U1MD:1, U2MD:1, I2C1MD:1,
+             :1, PWMMD:1, QEI1MD:1, T1MD:1, T2MD:1, T3MD:1, T4MD:1, T5MD:1;
+} PMD1BITS;
+typedef struct {
+    unsigned OC1MD:1, OC2MD:1, OC3MD:1, OC4MD:1, OC5MD:1, OC6MD:1, OC7MD:1, OC8MD:1,
+             IC1MD:1, IC2MD:1, IC3MD:1, IC4MD:1, IC5MD:1, IC6MD:1, IC7MD:1, IC8MD:1;
+} PMD2BITS;
+typedef struct {
+    unsigned AD2MD:1, I2C2MD:1, :1, U3MD:1, QEI2MD:1, :2, CRCMD:1, PMPMD:1, RTCCMD:1, CMPMD:1,
+             :1, T6MD:1, T7MD:1, T8MD:1, T9MD:1;
+} PMD3BITS;
+typedef struct { unsigned :2, CTMUMD:1, REFOMD:1, :1, U4MD:1, :10; } PMD4BITS;
+
+// Peripheral pin select
+typedef struct { unsigned U1RXR:7, :9; } RPINR18BITS;
+typedef struct { unsigned SDI1R:7, :9; } RPINR20BITS;
+typedef struct { unsigned RP64R:6, :2, RP65R:6, :2; } RPOR0BITS;
+typedef struct { unsigned RP66R:6, :2, RP67R:6, :2; } RPOR1BITS;
+typedef struct { unsigned RP68R:6, :2, RP69R:6, :2; } RPOR2BITS;
+typedef struct { unsigned :8, RP108R:6, :2; } RPOR11BITS;
+typedef struct { unsigned RP109R:6, :2, RP112R:6, :2; } RPOR12BITS;
+
+// Ports
+typedef struct { unsigned ANSB0:1, :10, ANSB11:1, :3, ANSB15:1; } ANSELBBITS;
+typedef struct { unsigned TRISA0:1, TRISA1:1, :14; } TRISABITS;
+typedef struct { unsigned :3, TRISB3:1, TRISB4:1, :3, TRISB8:1, :2, TRISB11:1, :3, TRISB15:1; } TRISBBITS;
+typedef struct { unsigned :1, TRISD1:1, TRISD2:1, TRISD3:1, TRISD4:1, :11; } TRISDBITS;
+typedef struct { unsigned :8, TRISE8:1, TRISE9:1, :6; } TRISEBITS;
+typedef struct { unsigned :1, TRISF1:1, :10, TRISF12:1, TRISF13:1, :2; } TRISFBITS;
+typedef struct { unsigned :8, RE8:1, RE9:1, :6; } PORTEBITS;
+typedef struct { unsigned LATA0:1, :15; } LATABITS;
+typedef struct { unsigned :3, LATB3:1, LATB4:1, :3, LATB8:1, :7; } LATBBITS;
+typedef struct { unsigned :1, LATF1:1, :14; } LATFBITS;
+/*================================================================*/
+
+// The simulator itself only wants the types above
+#ifndef SIM_PERIPHERALS
+/*================================================================*/
+#define SR SIM_REG(SR)
+#define SRbits SIM_BITS(SR)
+#define CORCON SIM_REG(CORCON)
+#define CORCONbits SIM_BITS(CORCON)
+#define DISICNT SIM_REG(DISICNT)
+#define TBLPAG SIM_REG(TBLPAG)
+#define RCON SIM_REG(RCON)
+#define TMR1 SIM_REG(TMR1)
+#define PR1 SIM_REG(PR1)
+#define T1CONbits SIM_BITS(T1CON)
+#define TMR2 SIM_REG(TMR2)
+#define PR2 SIM_REG(PR2)
+#define T2CONbits SIM_BITS(T2CON)
+#define TMR3 SIM_REG(TMR3)
+#define PR3 SIM_REG(PR3)
+#define T3CONbits SIM_BITS(T3CON)
+#define TMR4 SIM_REG(TMR4)
+#define PR4 SIM_REG(PR4)
+#define T4CONbits SIM_BITS(T4CON)
+#define INTCON1bits SIM_BITS(INTCON1)
+#define INTCON2bits SIM_BITS(INTCON2)
+#define IFS0bits SIM_BITS(IFS0)
+#define IEC0bits SIM_BITS(IEC0)
+#define IPC0bits SIM_BITS(IPC0)
+#define IPC2bits SIM_BITS(IPC2)
+#define IPC3bits SIM_BITS(IPC3)
+#define U1MODEbits SIM_BITS(U1MODE)
+#define U1STAbits SIM_BITS(U1STA)
+#define U1TXREG SIM_REG(U1TXREG)
+#define U1RXREG SIM_REG(U1RXREG)
+#define U1BRG SIM_REG(U1BRG)
+#define SPI1STATbits SIM_BITS(SPI1STAT)
+#define SPI1CON1bits SIM_BITS(SPI1CON1)
+#define SPI1BUF SIM_REG(SPI1BUF)
+#define OC1CON1 SIM_REG(OC1CON1)
+#define OC1CON2 SIM_REG(OC1CON2)
+#define OC1RS SIM_REG(OC1RS)
+#define OC1R SIM_REG(OC1R)
+#define OC2CON1 SIM_REG(OC2CON1)
+#define OC2CON2 SIM_REG(OC2CON2)
+#define OC2RS SIM_REG(OC2RS)
+#define OC2R SIM_REG(OC2R)
+#define OC3CON1 SIM_REG(OC3CON1)
+#define OC3CON2 SIM_REG(OC3CON2)
+#define OC3RS SIM_REG(OC3RS)
+#define OC3R SIM_REG(OC3R)
+#define OC4CON1 SIM_REG(OC4CON1)
+#define OC4CON2 SIM_REG(OC4CON2)
+#define OC4RS SIM_REG(OC4RS)
+#define OC4R SIM_REG(OC4R)
+#define ADC1BUF0 SIM_REG(ADC1BUF0)
+#define ADC1BUF8 SIM_REG(ADC1BUF8)
+#define AD1CON1bits SIM_BITS(AD1CON1)
+#define AD1CON2bits SIM_BITS(AD1CON2)
+#define AD1CON3bits SIM_BITS(AD1CON3)
+#define AD1CSSLbits SIM_BITS(AD1CSSL)
+#define NVMCON SIM_REG(NVMCON)
+#define NVMCONbits SIM_BITS(NVMCON)
+#define NVMADR SIM_REG(NVMADR)
+#define NVMADRU SIM_REG(NVMADRU)
+#define PMD1bits SIM_BITS(PMD1)
+#define PMD2bits SIM_BITS(PMD2)
+#define PMD3bits SIM_BITS(PMD3)
+#define PMD4bits SIM_BITS(PMD4)
+#define RPINR18bits SIM_BITS(RPINR18)
+#define RPINR20bits SIM_BITS(RPINR20)
+#define RPOR0bits SIM_BITS(RPOR0)
+#define RPOR1bits SIM_BITS(RPOR1)
+#define RPOR2bits SIM_BITS(RPOR2)
+#define RPOR11bits SIM_BITS(RPOR11)
+#define RPOR12bits SIM_BITS(RPOR12)
+#define ANSELA SIM_REG(ANSELA)
+#define ANSELB SIM_REG(ANSELB)
+#define ANSELBbits SIM_BITS(ANSELB)
+#define ANSELC SIM_REG(ANSELC)
+#define ANSELD SIM_REG(ANSELD)
+#define ANSELE SIM_REG(ANSELE)
+#define ANSELG SIM_REG(ANSELG)
+#define TRISAbits SIM_BITS(TRISA)
+#define TRISBbits SIM_BITS(TRISB)
+#define TRISDbits SIM_BITS(TRISD)
+#define TRISEbits SIM_BITS(TRISE)
+#define TRISFbits SIM_BITS(TRISF)
+#define PORTEbits SIM_BITS(PORTE)
+#define LATAbits SIM_BITS(LATA)
+#define LATBbits SIM_BITS(LATB)
+#define LATFbits SIM_BITS(LATF)
+/*================================================================*/
+
+/*================================================================*/
+// Builtins and instructions, all handled by the simulator
+void sim_disi(unsigned int cycles);
+void sim_idle(void);
+void sim_write_nvm(void);
+unsigned int sim_tblrdl(unsigned int offset);
+unsigned int sim_tblrdh(unsigned int offset);
+void sim_tblwtl(unsigned int offset, unsigned int value);
+void sim_tblwth(unsigned int offset, unsigned int value);
+unsigned long sim_tbladdress(const volatile void *object);
+void sim_asm(const char *instruction);
+
+#define __builtin_disi(cycles) sim_disi(cycles)
+#define __builtin_write_NVM() sim_write_nvm()
+#define __builtin_tblrdl(offset) sim_tblrdl(offset)
+#define __builtin_tblrdh(offset) sim_tblrdh(offset)
+#define __builtin_tblwtl(offset, value) sim_tblwtl((offset), (value))
+#define __builtin_tblwth(offset, value) sim_tblwth((offset), (value))
+#define __builtin_tbladdress(object) sim_tbladdress(object)
+#define Idle() sim_idle()
+#define Nop() ((void) 0)
+#define ClrWdt() ((void) 0)
+#define asm(instruction) sim_asm(instruction)
+
+// The simulator calls the interrupt routines itself
+#define __interrupt__ __unused__
+#define __auto_psv__ __unused__
+#define interrupt __unused__
+#define no_auto_psv __unused__
+/*================================================================*/
+#endif /* SIM_PERIPHERALS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_XC_H */
@@ -0,0 +1,135 @@
+/* ===============================================================
+ * File: adc_noise_model.c                                       =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * Host tool: runs the firmware oversampling decimator (dsp.c)   =
+ * on a synthetic IR input (10-bit ADC with gaussian noise) and  =
+ * reports the noise, effective bits and distance resolution     =
+ * around the emergency threshold for each OSR_IR setting.       =
+ * Build: gcc -I../ES_project_group_1.X -o adc_noise_model       =
+ *            adc_noise_model.c ../ES_project_group_1.X/dsp.c -lm =
+ * Usage: adc_noise_model [noise_lsb] [threshold_mm]             =
+ *        (defaults 0.5 LSB rms and 200 mm)                      =
+ * ===============================================================*/
+
+/*================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "dsp.h"
+/*================================================================*/
+
+/*================================================================*/
+#define ADC_BITS 10
+#define ADC_MAX 1023
+#define VREF 3.3
+#define MIN_OSR_BITS 0
+#define MAX_OSR_BITS 3
+#define RAMP_POINTS 200 // input levels across one ADC code range of 8 LSB
+#define OUTPUTS_PER_POINT 64
+/*================================================================*/
+
+/*================================================================*/
+// IR calibration polynomial used by setup_adc() (volts to metres)
+/*================================================================*/
+static double ir_distance(double voltage) {
+    return 2.34 + voltage * (-4.74 + voltage * (4.06 + voltage * (-1.60 + voltage * 0.24)));
+}
+/*================================================================*/
+
+/*================================================================*/
+// ADC code (fractional) giving the distance, found by bisection on the
+// decreasing part of the curve
+/*================================================================*/
+static double code_for_distance(double metres) {
+    double low = 0.0, high = ADC_MAX;
+    int i;
+    for (i = 0; i < 60; i++) {
+        double middle = (low + high) / 2;
+        if (ir_distance(middle * VREF / ADC_MAX) > metres) low = middle;
+        else high = middle;
+    }
+    return (low + high) / 2;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Deterministic gaussian noise (xorshift32 + Box-Muller)
+/*================================================================*/
+static uint32_t rng_state = 0x12345678u;
+
+static double uniform(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (rng_state + 1.0) / 4294967297.0;
+}
+
+static double gaussian(void) {
+    return sqrt(-2.0 * log(uniform())) * cos(2.0 * M_PI * uniform());
+}
+/*================================================================*/
+
+/*================================================================*/
+// One conversion of the synthetic input
+/*================================================================*/
+static uint16_t convert(double code, double noise_lsb) {
+    long value = lround(code + noise_lsb * gaussian());
+    if (value < 0) value = 0;
+    if (value > ADC_MAX) value = ADC_MAX;
+    return (uint16_t) value;
+}
+/*================================================================*/
+
+/*================================================================*/
+int main(int argc, char **argv) {
+    double noise_lsb = (argc > 1) ? atof(argv[1]) : 0.5;
+    double threshold_mm = (argc > 2) ? atof(argv[2]) : 200.0;
+    double center = code_for_distance(threshold_mm / 1000.0);
+    // Slope of the curve at the threshold, in mm per 10-bit LSB
+    double slope = (ir_distance((center + 0.5) * VREF / ADC_MAX) -
+            ir_distance((center - 0.5) * VREF / ADC_MAX)) * 1000.0;
+    int bits;
+
+    printf("threshold %.0f mm at code %.2f, %.2f mm/LSB, input noise %.2f LSB rms\n",
+            threshold_mm, center, fabs(slope), noise_lsb);
+    printf("osr  bits   adc/s  noise_lsb  enob   step_mm  noise_mm  max_err_mm\n");
+
+    for (bits = MIN_OSR_BITS; bits <= MAX_OSR_BITS; bits++) {
+        DspOversampler oversampler;
+        double sum_square = 0.0, max_error = 0.0;
+        long count = 0;
+        int point;
+
+        dsp_oversample_init(&oversampler, bits);
+        for (point = 0; point < RAMP_POINTS; point++) {
+            // Slow ramp across 8 LSB around the threshold code
+            double code = center - 4.0 + 8.0 * point / RAMP_POINTS;
+            int outputs = 0;
+            while (outputs < OUTPUTS_PER_POINT) {
+                uint16_t y;
+                if (dsp_oversample(&oversampler, convert(code, noise_lsb), &y)) {
+                    double error = y / (double) (1 << bits) - code; // in 10-bit LSB
+                    sum_square += error * error;
+                    if (fabs(error) > max_error) max_error = fabs(error);
+                    count++;
+                    outputs++;
+                }
+            }
+        }
+        {
+            double rms = sqrt(sum_square / count);
+            // An ideal N-bit converter has 1/sqrt(12) LSB rms quantization error
+            double enob = ADC_BITS - log2(rms * sqrt(12.0));
+            printf("%3d  %4d  %6d  %9.3f  %5.2f  %7.2f  %8.2f  %10.2f\n",
+                    1 << (2 * bits), ADC_BITS + bits, 1000 << (2 * bits), rms, enob,
+                    fabs(slope) / (1 << bits), rms * fabs(slope), max_error * fabs(slope));
+        }
+    }
+    return 0;
+}
+/*================================================================*/
@@ -0,0 +1,720 @@
+/* ===============================================================
+ * File: fw_update.c                                             =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * Host tool: sends a firmware image (XC16 Intel HEX) to the     =
+ * robot over UART1, see update.h for the protocol. Each page is =
+ * compressed with LZSS and sent with its CRC, pages already     =
+ * staged by an interrupted update are skipped.                  =
+ * --simulate runs the same sender against a simulated robot     =
+ * with flash timings, cuts the link once half way to check the  =
+ * resume, and prints the update time per image size.            =
+ * Build: gcc -O2 -o fw_update fw_update.c                       =
+ * Usage: fw_update image.hex /dev/ttyUSB0 [baud]                =
+ *        fw_update --simulate image.hex [baud]                  =
+ *        (default baud 115200, must be the robot's current rate)=
+ * ===============================================================*/
+
+/*================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+/*================================================================*/
+
+/*================================================================*/
+// Must follow update.h and update.c in the firmware
+#define FLASH_PAGE_WORDS 1024
+#define FLASH_PAGE_ADDRESSES (FLASH_PAGE_WORDS * 2)
+#define UPD_MAX_PAGES 40
+#define UPD_STAGING_BASE ((uint32_t) UPD_MAX_PAGES * FLASH_PAGE_ADDRESSES)
+#define UPD_CONTROL_BASE (2 * UPD_STAGING_BASE)
+#define BOOT_BASE (UPD_CONTROL_BASE + FLASH_PAGE_ADDRESSES)
+#define BOOT_CODE_ADDRESSES 0x400 // boot.h
+#define UPD_PAGE_BYTES (FLASH_PAGE_WORDS * 3)
+#define UPD_SYNC 0xA5
+#define UPD_HELLO 1
+#define UPD_BLOCK 2
+#define UPD_QUERY 3
+#define UPD_COMMIT 4
+#define UPD_ABORT 5
+#define UPD_ACK 0x81
+#define UPD_STATUS 0x82
+#define UPD_OK 0
+#define UPD_ERR_DATA 3
+#define UPD_MAX_PAYLOAD (2 + UPD_PAGE_BYTES + UPD_PAGE_BYTES / 8 + 8)
+#define UPD_LZ_MIN_MATCH 3
+#define UPD_LZ_MAX_MATCH (UPD_LZ_MIN_MATCH + 15)
+#define UPD_LZ_WINDOW 4095
+
+// Configuration words at the end of the flash, never part of an update
+#define CONFIG_BASE 0x557EC
+
+#define REPLY_TIMEOUT_MS 2000 // page erase and programming included
+#define BLOCK_RETRIES 5
+
+// Simulated robot: flash timings from the dsPIC33EP datasheet (typical
+// page erase and double word programming) and the USB-serial turnaround
+#define SIM_PAGE_ERASE_US 20000.0
+#define SIM_DWORD_PROGRAM_US 47.0
+#define SIM_CRC_US_PER_BYTE 1.2 // bitwise CRC-16 at 72 MIPS
+#define SIM_TURNAROUND_US 1000.0
+/*================================================================*/
+
+/*================================================================*/
+typedef struct {
+    uint8_t type;
+    uint16_t page;
+    uint16_t length;
+    uint8_t payload[UPD_MAX_PAYLOAD];
+} Frame;
+
+typedef struct {
+    uint8_t pages[UPD_MAX_PAGES][UPD_PAGE_BYTES]; // decompressed page per block
+    uint8_t compressed[UPD_MAX_PAGES][UPD_MAX_PAYLOAD];
+    uint16_t compressed_length[UPD_MAX_PAGES]; // 0 for a blank page
+    uint16_t page_crc[UPD_MAX_PAGES];
+    uint16_t count; // pages in the image
+    uint16_t crc; // CRC of the whole image
+} Image;
+
+// The robot side of update.c, with staging flash kept across link drops
+typedef struct {
+    uint8_t staging[UPD_MAX_PAGES][UPD_PAGE_BYTES];
+    uint16_t marker[UPD_MAX_PAGES]; // 1 staged, 2 blank
+    uint16_t session_pages, session_crc; // in the control page
+    int in_session; // HELLO received since entering update mode
+    int committed;
+    double time_us; // link and flash time so far
+    uint32_t baud;
+    int drop_after_blocks; // link lost after that many blocks, -1 never
+    int blocks;
+    double swap_us; // time of the swap at the next boot
+} SimRobot;
+
+typedef struct {
+    int fd; // serial port, -1 when simulated
+    SimRobot *sim;
+} Link;
+/*================================================================*/
+
+/*================================================================*/
+static uint16_t crc16(uint16_t crc, const uint8_t *data, size_t length) {
+    size_t i;
+    int bit;
+    for (i = 0; i < length; i++) {
+        crc ^= (uint16_t) data[i] << 8;
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Greedy LZSS, see update.c for the format
+/*================================================================*/
+static uint16_t lzss_compress(const uint8_t *in, uint16_t length, uint8_t *out) {
+    uint16_t in_pos = 0, out_pos = 0;
+
+    while (in_pos < length) {
+        uint16_t flag_pos = out_pos++;
+        int item;
+        out[flag_pos] = 0;
+        for (item = 0; item < 8 && in_pos < length; item++) {
+            uint16_t best_length = 0, best_offset = 0;
+            uint16_t start = in_pos > UPD_LZ_WINDOW ? in_pos - UPD_LZ_WINDOW : 0;
+            uint16_t candidate;
+            for (candidate = start; candidate < in_pos; candidate++) {
+                uint16_t n = 0;
+                while (n < UPD_LZ_MAX_MATCH && in_pos + n < length && in[candidate + n] == in[in_pos + n]) {
+                    n++;
+                }
+                if (n > best_length) {
+                    best_length = n;
+                    best_offset = in_pos - candidate;
+                }
+            }
+            if (best_length >= UPD_LZ_MIN_MATCH) {
+                out[out_pos++] = best_offset & 0xFF;
+                out[out_pos++] = ((best_offset >> 4) & 0xF0) | (best_length - UPD_LZ_MIN_MATCH);
+                in_pos += best_length;
+            } else {
+                out[flag_pos] |= 1 << item;
+                out[out_pos++] = in[in_pos++];
+            }
+        }
+    }
+    return out_pos;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Same checks as upd_decompress() in update.c
+/*================================================================*/
+static int lzss_decompress(const uint8_t *in, uint16_t in_length, uint8_t *out) {
+    uint16_t in_pos = 0, out_pos = 0;
+
+    while (in_pos < in_length) {
+        uint8_t flags = in[in_pos++];
+        int item;
+        for (item = 0; item < 8 && in_pos < in_length; item++, flags >>= 1) {
+            if (flags & 1) {
+                if (out_pos >= UPD_PAGE_BYTES) return 0;
+                out[out_pos++] = in[in_pos++];
+            } else {
+                uint16_t offset, count;
+                if (in_pos + 2 > in_length) return 0;
+                offset = in[in_pos] | (uint16_t) (in[in_pos + 1] & 0xF0) << 4;
+                count = (in[in_pos + 1] & 0x0F) + UPD_LZ_MIN_MATCH;
+                in_pos += 2;
+                if (offset == 0 || offset > out_pos || out_pos + count > UPD_PAGE_BYTES) return 0;
+                while (count--) {
+                    out[out_pos] = out[out_pos - offset];
+                    out_pos++;
+                }
+            }
+        }
+    }
+    return out_pos == UPD_PAGE_BYTES;
+}
+/*================================================================*/
+
+/*================================================================*/
+static int hex_byte(const char *text) {
+    int value;
+    if (sscanf(text, "%2x", &value) != 1) return -1;
+    return value;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Reads the XC16 HEX file: byte address = 2 x program address, 4 bytes
+// per instruction (low, middle, upper, phantom). Fills image->pages.
+/*================================================================*/
+static int load_hex(const char *path, Image *image) {
+    FILE *file = fopen(path, "r");
+    char line[600];
+    uint32_t base = 0;
+    int line_number = 0;
+    int page;
+
+    if (!file) {
+        perror(path);
+        return 0;
+    }
+    memset(image, 0, sizeof(*image));
+    memset(image->pages, 0xFF, sizeof(image->pages));
+
+    while (fgets(line, sizeof(line), file)) {
+        int count, type, i;
+        uint32_t offset;
+        line_number++;
+        if (line[0] != ':') continue;
+        count = hex_byte(line + 1);
+        offset = (uint32_t) hex_byte(line + 3) << 8 | hex_byte(line + 5);
+        type = hex_byte(line + 7);
+        if (count < 0 || type < 0) {
+            fprintf(stderr, "%s:%d: bad record\n", path, line_number);
+            fclose(file);
+            return 0;
+        }
+        if (type == 1) break;
+        if (type == 4) {
+            base = (uint32_t) hex_byte(line + 9) << 24 | (uint32_t) hex_byte(line + 11) << 16;
+            continue;
+        }
+        if (type != 0) continue;
+        for (i = 0; i < count; i++) {
+            uint32_t byte_address = base + offset + i;
+            uint32_t address = (byte_address / 4) * 2; // program address of the instruction
+            int lane = byte_address % 4;
+            int value = hex_byte(line + 9 + 2 * i);
+            if (lane == 3) continue; // phantom byte
+            if (address >= CONFIG_BASE) continue;
+            if (address >= BOOT_BASE && address < BOOT_BASE + BOOT_CODE_ADDRESSES) continue; // resident
+            if (address >= BOOT_BASE && address < BOOT_BASE + FLASH_PAGE_ADDRESSES) {
+                fprintf(stderr, "%s:%d: data at 0x%06X, in the reserved part of the boot page\n",
+                        path, line_number, (unsigned) address);
+                fclose(file);
+                return 0;
+            }
+            if (address >= UPD_STAGING_BASE) {
+                fprintf(stderr, "%s:%d: data at 0x%06X, outside the application region (%d pages)\n",
+                        path, line_number, (unsigned) address, UPD_MAX_PAGES);
+                fclose(file);
+                return 0;
+            }
+            page = address / FLASH_PAGE_ADDRESSES;
+            image->pages[page][(address % FLASH_PAGE_ADDRESSES) / 2 * 3 + lane] = value;
+            if (page + 1 > image->count) image->count = page + 1;
+        }
+    }
+    fclose(file);
+    if (image->count == 0) {
+        fprintf(stderr, "%s: no program data\n", path);
+        return 0;
+    }
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+static int page_blank(const uint8_t *page) {
+    int i;
+    for (i = 0; i < UPD_PAGE_BYTES; i++) {
+        if (page[i] != 0xFF) return 0;
+    }
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+static void prepare_image(Image *image) {
+    int page;
+    image->crc = 0xFFFF;
+    for (page = 0; page < image->count; page++) {
+        image->page_crc[page] = crc16(0xFFFF, image->pages[page], UPD_PAGE_BYTES);
+        image->crc = crc16(image->crc, image->pages[page], UPD_PAGE_BYTES);
+        image->compressed_length[page] = (page > 0 && page_blank(image->pages[page])) ? 0 :
+                lzss_compress(image->pages[page], UPD_PAGE_BYTES, image->compressed[page]);
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+static size_t encode_frame(const Frame *frame, uint8_t *out) {
+    uint16_t crc;
+    size_t n = 0;
+    out[n++] = UPD_SYNC;
+    out[n++] = frame->type;
+    out[n++] = frame->page & 0xFF;
+    out[n++] = frame->page >> 8;
+    out[n++] = frame->length & 0xFF;
+    out[n++] = frame->length >> 8;
+    memcpy(&out[n], frame->payload, frame->length);
+    n += frame->length;
+    crc = crc16(0xFFFF, out + 1, n - 1);
+    out[n++] = crc & 0xFF;
+    out[n++] = crc >> 8;
+    return n;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Simulated robot, mirrors update_run()
+/*================================================================*/
+static void sim_reply_ack(Frame *reply, uint16_t page, uint8_t status) {
+    reply->type = UPD_ACK;
+    reply->page = page;
+    reply->length = 1;
+    reply->payload[0] = status;
+}
+/*================================================================*/
+
+/*================================================================*/
+static void sim_reply_status(SimRobot *sim, Frame *reply) {
+    int page;
+    reply->type = UPD_STATUS;
+    reply->page = 0;
+    reply->length = 4 + (UPD_MAX_PAGES + 7) / 8;
+    memset(reply->payload, 0, reply->length);
+    reply->payload[0] = sim->session_pages & 0xFF;
+    reply->payload[1] = sim->session_pages >> 8;
+    reply->payload[2] = sim->session_crc & 0xFF;
+    reply->payload[3] = sim->session_crc >> 8;
+    for (page = 0; page < sim->session_pages; page++) {
+        if (sim->marker[page]) reply->payload[4 + page / 8] |= 1 << (page % 8);
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+static int sim_transfer(SimRobot *sim, const Frame *request, Frame *reply) {
+    static uint8_t wire[UPD_MAX_PAYLOAD + 16];
+    size_t sent = encode_frame(request, wire);
+    uint8_t page[UPD_PAGE_BYTES];
+
+    sim->time_us += sent * 10e6 / sim->baud + SIM_TURNAROUND_US;
+    if (request->type == UPD_BLOCK && sim->drop_after_blocks >= 0 &&
+            sim->blocks++ == sim->drop_after_blocks) {
+        sim->in_session = 0; // robot times out back to the application, the flash stays
+        sim->time_us += REPLY_TIMEOUT_MS * 1000.0;
+        return 0;
+    }
+
+    switch (request->type) {
+        case UPD_HELLO: {
+            uint16_t pages = request->payload[0] | request->payload[1] << 8;
+            uint16_t crc = request->payload[2] | request->payload[3] << 8;
+            if (pages != sim->session_pages || crc != sim->session_crc) {
+                sim->time_us += SIM_PAGE_ERASE_US + 2 * SIM_DWORD_PROGRAM_US;
+                memset(sim->marker, 0, sizeof(sim->marker));
+                sim->session_pages = pages;
+                sim->session_crc = crc;
+            }
+            sim->in_session = 1;
+            sim_reply_status(sim, reply);
+            break;
+        }
+        case UPD_QUERY:
+            sim_reply_status(sim, reply);
+            break;
+        case UPD_BLOCK: {
+            uint16_t expected = request->payload[0] | request->payload[1] << 8;
+            int blank = request->length == 2;
+            if (!sim->in_session || request->page >= sim->session_pages) {
+                sim_reply_ack(reply, request->page, 2);
+                break;
+            }
+            if (blank) {
+                memset(page, 0xFF, sizeof(page));
+            } else if (!lzss_decompress(&request->payload[2], request->length - 2, page)) {
+                sim_reply_ack(reply, request->page, UPD_ERR_DATA);
+                break;
+            }
+            sim->time_us += UPD_PAGE_BYTES * SIM_CRC_US_PER_BYTE;
+            if (crc16(0xFFFF, page, sizeof(page)) != expected) {
+                sim_reply_ack(reply, request->page, UPD_ERR_DATA);
+                break;
+            }
+            if (!blank && !sim->marker[request->page]) {
+                sim->time_us += SIM_PAGE_ERASE_US + FLASH_PAGE_WORDS / 2 * SIM_DWORD_PROGRAM_US;
+                memcpy(sim->staging[request->page], page, sizeof(page));
+            }
+            if (!sim->marker[request->page]) {
+                sim->time_us += SIM_DWORD_PROGRAM_US;
+                sim->marker[request->page] = blank ? 2 : 1;
+            }
+            sim_reply_ack(reply, request->page, UPD_OK);
+            break;
+        }
+        case UPD_COMMIT: {
+            uint16_t crc = 0xFFFF;
+            int page_index, status = UPD_OK;
+            double swap_us = 0;
+            for (page_index = 0; page_index < sim->session_pages; page_index++) {
+                if (!sim->marker[page_index]) status = 5;
+                if (sim->marker[page_index] == 2) {
+                    memset(page, 0xFF, sizeof(page));
+                    crc = crc16(crc, page, sizeof(page));
+                } else {
+                    crc = crc16(crc, sim->staging[page_index], UPD_PAGE_BYTES);
+                    swap_us += SIM_PAGE_ERASE_US + FLASH_PAGE_WORDS / 2 * SIM_DWORD_PROGRAM_US;
+                }
+                sim->time_us += UPD_PAGE_BYTES * SIM_CRC_US_PER_BYTE;
+            }
+            if (crc != sim->session_crc) status = 5;
+            if (status == UPD_OK) {
+                sim->committed = 1;
+                sim->swap_us = swap_us + 2 * SIM_PAGE_ERASE_US; // reset stub and control page
+            }
+            sim_reply_ack(reply, 0, status);
+            break;
+        }
+        default:
+            sim_reply_ack(reply, request->page, UPD_OK);
+            break;
+    }
+    sim->time_us += (encode_frame(reply, wire)) * 10e6 / sim->baud;
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Serial port
+/*================================================================*/
+static speed_t baud_constant(uint32_t baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+#ifdef B460800
+        case 460800: return B460800;
+#endif
+#ifdef B500000
+        case 500000: return B500000;
+#endif
+#ifdef B1000000
+        case 1000000: return B1000000;
+#endif
+        default: return 0;
+    }
+}
+/*================================================================*/
+
+/*================================================================*/
+static int serial_open(const char *path, uint32_t baud) {
+    struct termios tty;
+    speed_t speed = baud_constant(baud);
+    int fd;
+
+    if (!speed) {
+        fprintf(stderr, "unsupported baud rate %u\n", (unsigned) baud);
+        return -1;
+    }
+    fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0 || tcgetattr(fd, &tty) != 0) {
+        perror(path);
+        return -1;
+    }
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+/*================================================================*/
+
+/*================================================================*/
+// One byte within timeout_ms, -1 otherwise
+/*================================================================*/
+static int serial_read_byte(int fd, int timeout_ms) {
+    fd_set set;
+    struct timeval timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    uint8_t byte;
+
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    if (select(fd + 1, &set, NULL, NULL, &timeout) <= 0) return -1;
+    if (read(fd, &byte, 1) != 1) return -1;
+    return byte;
+}
+/*================================================================*/
+
+/*================================================================*/
+static int serial_write(int fd, const uint8_t *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n <= 0) return 0;
+        data += n;
+        length -= n;
+    }
+    tcdrain(fd);
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+static int serial_transfer(int fd, const Frame *request, Frame *reply) {
+    static uint8_t wire[UPD_MAX_PAYLOAD + 16];
+    uint8_t header[5];
+    uint16_t crc;
+    int byte, i;
+
+    if (!serial_write(fd, wire, encode_frame(request, wire))) return 0;
+    do {
+        if ((byte = serial_read_byte(fd, REPLY_TIMEOUT_MS)) < 0) return 0;
+    } while (byte != UPD_SYNC);
+    for (i = 0; i < 5; i++) {
+        if ((byte = serial_read_byte(fd, 100)) < 0) return 0;
+        header[i] = byte;
+    }
+    reply->type = header[0];
+    reply->page = header[1] | header[2] << 8;
+    reply->length = header[3] | header[4] << 8;
+    if (reply->length > UPD_MAX_PAYLOAD) return 0;
+    for (i = 0; i < reply->length + 2; i++) {
+        if ((byte = serial_read_byte(fd, 100)) < 0) return 0;
+        if (i < reply->length) reply->payload[i] = byte;
+        else wire[i - reply->length] = byte;
+    }
+    crc = crc16(0xFFFF, header, sizeof(header));
+    crc = crc16(crc, reply->payload, reply->length);
+    return crc == (wire[0] | wire[1] << 8);
+}
+/*================================================================*/
+
+/*================================================================*/
+// Text command switching the robot into update mode, waits for $MACK,1*
+/*================================================================*/
+static int serial_enter_update(int fd) {
+    const char *command = "$PCUPD,*\r\n";
+    const char *expected = "$MACK,1*";
+    size_t matched = 0;
+    int byte;
+
+    if (!serial_write(fd, (const uint8_t *) command, strlen(command))) return 0;
+    while ((byte = serial_read_byte(fd, REPLY_TIMEOUT_MS)) >= 0) {
+        matched = (byte == expected[matched]) ? matched + 1 : (byte == expected[0]);
+        if (expected[matched] == '\0') return 1;
+    }
+    return 0;
+}
+/*================================================================*/
+
+/*================================================================*/
+static int transfer(Link *link, const Frame *request, Frame *reply) {
+    return link->sim ? sim_transfer(link->sim, request, reply) : serial_transfer(link->fd, request, reply);
+}
+/*================================================================*/
+
+/*================================================================*/
+// HELLO (or QUERY) and the bitmap of the staged pages
+/*================================================================*/
+static int fetch_status(Link *link, const Image *image, uint8_t type, uint8_t *staged) {
+    static Frame request, reply;
+    int page;
+
+    request.type = type;
+    request.page = 0;
+    request.length = type == UPD_HELLO ? 4 : 0;
+    request.payload[0] = image->count & 0xFF;
+    request.payload[1] = image->count >> 8;
+    request.payload[2] = image->crc & 0xFF;
+    request.payload[3] = image->crc >> 8;
+    if (!transfer(link, &request, &reply) || reply.type != UPD_STATUS || reply.length < 4) return 0;
+    if ((reply.payload[0] | reply.payload[1] << 8) != image->count ||
+            (reply.payload[2] | reply.payload[3] << 8) != image->crc) return 0;
+    for (page = 0; page < image->count; page++) {
+        staged[page] = (reply.payload[4 + page / 8] >> (page % 8)) & 1;
+    }
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Sends the missing pages and commits. Returns 0 if the link was lost
+// (run again to resume).
+/*================================================================*/
+static int send_image(Link *link, const Image *image) {
+    static Frame request, reply;
+    uint8_t staged[UPD_MAX_PAGES];
+    int page, retry, skipped = 0;
+
+    if (!fetch_status(link, image, UPD_HELLO, staged)) {
+        fprintf(stderr, "no answer to HELLO\n");
+        return 0;
+    }
+    for (page = 0; page < image->count; page++) {
+        if (staged[page]) {
+            skipped++;
+            continue;
+        }
+        request.type = UPD_BLOCK;
+        request.page = page;
+        request.length = 2 + image->compressed_length[page];
+        request.payload[0] = image->page_crc[page] & 0xFF;
+        request.payload[1] = image->page_crc[page] >> 8;
+        memcpy(&request.payload[2], image->compressed[page], image->compressed_length[page]);
+        for (retry = 0; retry < BLOCK_RETRIES; retry++) {
+            if (transfer(link, &request, &reply) && reply.type == UPD_ACK && reply.page == page &&
+                    reply.payload[0] == UPD_OK) break;
+        }
+        if (retry == BLOCK_RETRIES) {
+            if (!link->sim) fprintf(stderr, "page %d: no acknowledgement, link lost\n", page);
+            return 0;
+        }
+        if (!link->sim) fprintf(stderr, "\rpage %d/%d", page + 1, image->count);
+    }
+    if (!link->sim) fprintf(stderr, "\n%d pages already staged\n", skipped);
+
+    request.type = UPD_COMMIT;
+    request.page = 0;
+    request.length = 0;
+    if (!transfer(link, &request, &reply) || reply.type != UPD_ACK || reply.payload[0] != UPD_OK) {
+        fprintf(stderr, "commit refused\n");
+        return 0;
+    }
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+// Update time of the first `pages` pages, with one link drop half way
+/*================================================================*/
+static int simulate(const Image *full, uint32_t baud, int pages, int drop) {
+    static Image image;
+    static SimRobot sim;
+    Link link = {-1, &sim};
+    size_t raw = 0, sent = 0;
+    int page, attempts = 0;
+
+    image = *full;
+    image.count = pages;
+    prepare_image(&image);
+    memset(&sim, 0, sizeof(sim));
+    sim.baud = baud;
+    sim.drop_after_blocks = drop ? pages / 2 : -1;
+
+    while (!send_image(&link, &image)) {
+        if (++attempts > 3) return 0;
+    }
+    for (page = 0; page < image.count; page++) {
+        if (sim.marker[page] == 1 && memcmp(sim.staging[page], image.pages[page], UPD_PAGE_BYTES)) {
+            fprintf(stderr, "page %d differs after the update\n", page);
+            return 0;
+        }
+        raw += UPD_PAGE_BYTES;
+        sent += 2 + image.compressed_length[page];
+    }
+    printf("%5d %7zu %7zu %6.2f %8s %9.2f %7.2f\n", pages, raw, sent, (double) sent / raw,
+            drop ? "yes" : "no", sim.time_us / 1e6, sim.swap_us / 1e6);
+    return 1;
+}
+/*================================================================*/
+
+/*================================================================*/
+int main(int argc, char **argv) {
+    static Image image;
+    uint32_t baud = 115200;
+
+    if (argc >= 3 && strcmp(argv[1], "--simulate") == 0) {
+        int pages;
+        if (argc >= 4) baud = strtoul(argv[3], NULL, 10);
+        if (!load_hex(argv[2], &image)) return 1;
+        printf("# image %d pages, %u baud, times in s (link + flash, swap at boot)\n",
+                image.count, (unsigned) baud);
+        printf("pages raw_B   sent_B  ratio  dropped  update_s  swap_s\n");
+        for (pages = 1; pages < image.count; pages *= 2) {
+            if (!simulate(&image, baud, pages, 0)) return 1;
+        }
+        if (!simulate(&image, baud, image.count, 0)) return 1;
+        if (!simulate(&image, baud, image.count, 1)) return 1;
+        return 0;
+    }
+
+    if (argc >= 3) {
+        Link link = {-1, NULL};
+        if (argc >= 4) baud = strtoul(argv[3], NULL, 10);
+        if (!load_hex(argv[1], &image)) return 1;
+        prepare_image(&image);
+        if ((link.fd = serial_open(argv[2], baud)) < 0) return 1;
+        if (!serial_enter_update(link.fd)) {
+            // Either still in update mode after a lost link, or refused
+            fprintf(stderr, "no $MACK,1* to $PCUPD, trying the update protocol directly\n");
+        }
+        if (!send_image(&link, &image)) {
+            fprintf(stderr, "update interrupted, run again to resume\n");
+            return 1;
+        }
+        printf("image committed (%d pages, CRC %04X), the robot swaps it and restarts\n",
+                image.count, image.crc);
+        close(link.fd);
+        return 0;
+    }
+
+    fprintf(stderr, "usage: %s image.hex /dev/ttyUSB0 [baud]\n"
+            "       %s --simulate image.hex [baud]\n", argv[0], argv[0]);
+    return 1;
+}
+/*================================================================*/
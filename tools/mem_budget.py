@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+# ===============================================================
+# File: mem_budget.py
+# Author: group 1
+# Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+# RAM, flash and stack budget of the firmware image (make budget):
+#   - static RAM and flash per module from the linker map
+#     (.map written next to the .elf by the MPLAB X project),
+#   - worst-case stack from the call graph of the disassembly
+#     (xc16-objdump -d): every function costs its LNK frame and the
+#     registers it pushes, every call 4 bytes of return address.
+#     The main loop nests under every interrupt routine, and the
+#     routines all have their own priority (interrupt.h), so each of
+#     them can be active at once on top of the deepest main path.
+# Flash is counted in program memory address units (2 per 24-bit
+# instruction word), as in the map and the update layout (update.h).
+# Fails (exit status 1) when a total is over its budget.
+# Usage: python3 tools/mem_budget.py --map image.map --elf image.elf
+#            [--objdump xc16-objdump | --disassembly image.lst]
+#            [--ram BYTES] [--flash UNITS] [--stack BYTES]
+# ===============================================================
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+# Output sections holding RAM, everything else allocated is program memory
+RAM_SECTION = re.compile(r'^\.[npxy]?(bss|data)\b')
+# Not part of the image: debug information, fuses, tool records
+IGNORED_SECTION = re.compile(r'^(\.debug|\.comment|\.stab|\.info|\.config|__|\.heap$|\.stack$)')
+CALL_RETURN_BYTES = 4  # PC pushed by CALL/RCALL
+INTERRUPT_ENTRY_BYTES = 4  # PC, SR and IPL3 pushed by the exception processing
+
+
+class Module:
+    def __init__(self, name):
+        self.name = name
+        self.ram = 0
+        self.flash = 0
+        self.functions = []
+
+
+def module_name(path):
+    path = path.strip()
+    library = re.match(r'(.*)\((.*)\)$', path)
+    if library:
+        # Archive members grouped by library, libpic30-elf.a(crt0.o) -> libpic30-elf.a
+        return os.path.basename(library.group(1))
+    return os.path.basename(path)
+
+
+def parse_map(path):
+    """Returns {module: Module} from the memory map part of a GNU ld map."""
+    modules = {}
+    output_section = None
+    pending_name = None  # input section name wrapped on its own line
+    current = None
+    in_map = False
+    with open(path, errors='replace') as lines:
+        for line in lines:
+            line = line.rstrip('\n')
+            if line.startswith('Linker script and memory map'):
+                in_map = True
+                continue
+            if not in_map:
+                continue
+            top = re.match(r'^(\.?[\w.$]+)\s+0x[0-9a-fA-F]+\s+0x[0-9a-fA-F]+', line)
+            if top and not line[0].isspace():
+                output_section = top.group(1)
+                current = None
+                continue
+            name = re.match(r'^ (\.?[\w.$]+)\s*$', line)
+            if name:
+                pending_name = name.group(1)
+                continue
+            entry = re.match(r'^ (\.?[\w.$]+)?\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$', line)
+            if entry and (entry.group(1) or pending_name):
+                pending_name = None
+                current = None
+                if output_section is None or IGNORED_SECTION.match(output_section):
+                    continue
+                size = int(entry.group(3), 16)
+                module = modules.setdefault(module_name(entry.group(4)), Module(module_name(entry.group(4))))
+                if RAM_SECTION.match(output_section):
+                    module.ram += size
+                else:
+                    module.flash += size
+                current = module
+                continue
+            pending_name = None
+            symbol = re.match(r'^\s+0x[0-9a-fA-F]+\s+([A-Za-z_][\w.$]*)\s*$', line)
+            if symbol and current is not None:
+                current.functions.append(symbol.group(1))
+    return modules
+
+
+class Function:
+    def __init__(self, name):
+        self.name = name
+        self.frame = 0
+        self.calls = set()
+        self.indirect = False
+
+
+def parse_disassembly(text):
+    """Returns {symbol: Function} from objdump -d output of a dsPIC33 image."""
+    functions = {}
+    current = None
+    for line in text.splitlines():
+        header = re.match(r'^[0-9a-fA-F]+ <([^>]+)>:\s*$', line)
+        if header:
+            current = functions.setdefault(header.group(1), Function(header.group(1)))
+            continue
+        instruction = re.match(r'^\s+[0-9a-fA-F]+:\s+(?:[0-9a-fA-F]{2} )+\s*([a-zA-Z][\w.]*)\s*(.*)$', line)
+        if not instruction or current is None:
+            continue
+        mnemonic = instruction.group(1).lower()
+        operands = instruction.group(2).lower().split(';')[0].strip()
+        if mnemonic == 'lnk':
+            current.frame += 2 + int(operands.lstrip('#'), 0)  # W14 and the locals
+        elif mnemonic == 'push':
+            current.frame += 2
+        elif mnemonic == 'push.d':
+            current.frame += 4
+        elif mnemonic.startswith('mov') and re.search(r',\s*\[w15\+\+\]$', operands):
+            current.frame += 4 if mnemonic == 'mov.d' else 2
+        elif mnemonic == 'add' and re.match(r'^#?(0x[0-9a-f]+|\d+),\s*w15$', operands):
+            current.frame += int(operands.split(',')[0].lstrip('#'), 0)
+        elif mnemonic in ('call', 'rcall', 'call.l', 'goto'):
+            target = re.search(r'<([^>+]+)(\+0x[0-9a-f]+)?>', instruction.group(2))
+            if target:
+                if target.group(1) != current.name:
+                    current.calls.add(target.group(1))
+            elif mnemonic != 'goto':
+                current.indirect = True  # through a register, target unknown
+    return functions
+
+
+def worst_stack(functions, root, memo, active, notes):
+    """Deepest stack below root (its own frame included) and the path to it."""
+    if root in memo:
+        return memo[root]
+    function = functions.get(root)
+    if function is None:
+        notes.add('no code for %s, counted as 0' % root)
+        return 0, [root]
+    if root in active:
+        notes.add('recursion through %s, not bounded' % root)
+        return 0, [root]
+    if function.indirect:
+        notes.add('indirect call in %s, not followed' % root)
+    active.add(root)
+    deepest, path = 0, []
+    for callee in sorted(function.calls):
+        depth, callee_path = worst_stack(functions, callee, memo, active, notes)
+        if CALL_RETURN_BYTES + depth > deepest:
+            deepest, path = CALL_RETURN_BYTES + depth, callee_path
+    active.discard(root)
+    memo[root] = (function.frame + deepest, [root] + path)
+    return memo[root]
+
+
+def interrupt_routines(functions):
+    return sorted(name for name in functions
+                  if re.match(r'^_+\w+Interrupt$', name) and 'Default' not in name)
+
+
+def pretty(symbol):
+    return symbol[1:] if symbol.startswith('_') else symbol
+
+
+def main():
+    parser = argparse.ArgumentParser(description='RAM, flash and stack budget of the firmware image')
+    parser.add_argument('--map', required=True, help='linker map file')
+    parser.add_argument('--elf', help='image to disassemble')
+    parser.add_argument('--objdump', default='xc16-objdump', help='disassembler (default xc16-objdump)')
+    parser.add_argument('--disassembly', help='objdump -d output instead of running the disassembler')
+    parser.add_argument('--ram', type=int, help='static RAM budget, bytes')
+    parser.add_argument('--flash', type=int, help='program memory budget, address units')
+    parser.add_argument('--stack', type=int, help='worst-case stack budget, bytes')
+    args = parser.parse_args()
+
+    try:
+        modules = parse_map(args.map)
+    except OSError as error:
+        sys.exit('cannot read the map: %s' % error)
+    if not modules:
+        sys.exit('%s: no memory map found' % args.map)
+
+    if args.disassembly:
+        with open(args.disassembly, errors='replace') as listing:
+            text = listing.read()
+    elif args.elf:
+        try:
+            text = subprocess.run([args.objdump, '-d', args.elf], check=True,
+                                  capture_output=True, text=True).stdout
+        except (OSError, subprocess.CalledProcessError) as error:
+            sys.exit('cannot disassemble %s: %s' % (args.elf, error))
+    else:
+        text = ''
+    functions = parse_disassembly(text)
+
+    # Stack: per module the deepest of its functions, in total the main
+    # path plus every interrupt routine
+    memo, notes = {}, set()
+    stack = {}
+    for module in modules.values():
+        depths = [worst_stack(functions, f, memo, set(), notes)[0] for f in module.functions if f in functions]
+        stack[module.name] = max(depths) if depths else 0
+    total_stack = None
+    lines = []
+    if functions:
+        main_depth, main_path = worst_stack(functions, '_main', memo, set(), notes)
+        total_stack = CALL_RETURN_BYTES + main_depth
+        lines.append('  main %5d  %s' % (total_stack, ' > '.join(pretty(f) for f in main_path)))
+        for routine in interrupt_routines(functions):
+            depth, path = worst_stack(functions, routine, memo, set(), notes)
+            total_stack += INTERRUPT_ENTRY_BYTES + depth
+            lines.append('  %-4s %5d  %s' % ('isr', INTERRUPT_ENTRY_BYTES + depth,
+                                              ' > '.join(pretty(f) for f in path)))
+
+    print('%-28s %8s %8s %8s' % ('module', 'ram', 'flash', 'stack'))
+    ordered = sorted(modules.values(), key=lambda m: (-m.ram, -m.flash, m.name))
+    for module in ordered:
+        if module.ram or module.flash:
+            print('%-28s %8d %8d %8s' % (module.name, module.ram, module.flash, stack[module.name] or '-'))
+    total_ram = sum(m.ram for m in modules.values())
+    total_flash = sum(m.flash for m in modules.values())
+    print('%-28s %8d %8d %8s' % ('total', total_ram, total_flash,
+                                 total_stack if total_stack is not None else '?'))
+    if lines:
+        print('worst-case stack (bytes, deepest path):')
+        print('\n'.join(lines))
+    for note in sorted(notes):
+        print('note:', note)
+
+    over = []
+    for name, used, budget in (('ram', total_ram, args.ram), ('flash', total_flash, args.flash),
+                               ('stack', total_stack, args.stack)):
+        if budget is None:
+            continue
+        if used is None:
+            over.append('%s unknown, no disassembly' % name)
+        elif used > budget:
+            over.append('%s %d > %d' % (name, used, budget))
+        else:
+            print('%-5s %d of %d (%d%%)' % (name, used, budget, 100 * used // budget))
+    if over:
+        sys.exit('over budget: ' + ', '.join(over))
+
+
+if __name__ == '__main__':
+    main()
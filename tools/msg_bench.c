@@ -0,0 +1,130 @@
+/* ===============================================================
+ * File: msg_bench.c                                             =
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * Host tool: compares the generated message code (messages.c,   =
+ * see tools/messages.schema) with the sprintf/sscanf code it    =
+ * replaced, in ns per message. Host timings only: the ratio is  =
+ * what matters, XC16's printf family is slower still.           =
+ * Build: gcc -O2 -I../ES_project_group_1.X -o msg_bench         =
+ *        msg_bench.c ../ES_project_group_1.X/messages.c         =
+ * Usage: msg_bench [iterations]                                 =
+ * ===============================================================*/
+
+/*================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "messages.h"
+/*================================================================*/
+
+/*================================================================*/
+static volatile int sink; // keeps the loops from being optimised away
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+/*================================================================*/
+
+/*================================================================*/
+// The legacy formats, as they were in main.c and uart.c
+static int legacy_macc(char *out, int x, int y, int z) {
+    return sprintf(out, "$MACC,%d,%d,%d*", x, y, z);
+}
+
+static int legacy_mest(char *out, int speed, int yawrate, int heading, int flags, unsigned peak) {
+    return sprintf(out, "$MEST,%d,%d,%d,%d,%u*", speed, yawrate, heading, flags, peak);
+}
+
+static int legacy_pcref(const char *line, int *speed, int *yawrate) {
+    return sscanf(line, "$PCREF,%d,%d", speed, yawrate) == 2;
+}
+
+static int legacy_pctrj(const char *line, unsigned *duration, int *speed, int *yawrate) {
+    return sscanf(line, "$PCTRJ,%u,%d,%d", duration, speed, yawrate) == 3;
+}
+
+static int legacy_pcpst(const char *line, char *name, long *value) {
+    return sscanf(line, "$PCPST,%11[^,],%ld", name, value) == 2;
+}
+/*================================================================*/
+
+/*================================================================*/
+static void report(const char *name, double legacy, double generated, long n) {
+    printf("%-6s %9.1f ns %9.1f ns %6.1fx\n", name, legacy / n, generated / n,
+           generated > 0 ? legacy / generated : 0.0);
+}
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+    char out[64];
+    char name[12];
+    long value;
+    int a, b;
+    unsigned u;
+    long i;
+    double t0, t1, t2;
+    MsgPcref pcref;
+    MsgPctrj pctrj;
+    MsgPcpst pcpst;
+
+    if (n <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+    printf("%-6s %12s %12s %7s\n", "msg", "sprintf", "generated", "gain");
+
+    t0 = now_ns();
+    for (i = 0; i < n; i++)
+        sink += legacy_macc(out, (int) (i & 0x3FFF) - 8000, -981, 15);
+    t1 = now_ns();
+    for (i = 0; i < n; i++)
+        sink += msg_encode_macc(out, (int16_t) ((i & 0x3FFF) - 8000), -981, 15);
+    t2 = now_ns();
+    report("MACC", t1 - t0, t2 - t1, n);
+
+    t0 = now_ns();
+    for (i = 0; i < n; i++)
+        sink += legacy_mest(out, (int) (i & 0x3FF), -120, 1571, 3, 1840);
+    t1 = now_ns();
+    for (i = 0; i < n; i++)
+        sink += msg_encode_mest(out, (int16_t) (i & 0x3FF), -120, 1571, 3, 1840);
+    t2 = now_ns();
+    report("MEST", t1 - t0, t2 - t1, n);
+
+    t0 = now_ns();
+    for (i = 0; i < n; i++)
+        sink += legacy_pcref("$PCREF,-45,100#12*", &a, &b) + a;
+    t1 = now_ns();
+    for (i = 0; i < n; i++)
+        sink += msg_decode_pcref("$PCREF,-45,100#12*", &pcref) + pcref.speed;
+    t2 = now_ns();
+    report("PCREF", t1 - t0, t2 - t1, n);
+
+    t0 = now_ns();
+    for (i = 0; i < n; i++)
+        sink += legacy_pctrj("$PCTRJ,1500,80,-20*", &u, &a, &b) + a;
+    t1 = now_ns();
+    for (i = 0; i < n; i++)
+        sink += msg_decode_pctrj("$PCTRJ,1500,80,-20*", &pctrj) + pctrj.speed;
+    t2 = now_ns();
+    report("PCTRJ", t1 - t0, t2 - t1, n);
+
+    t0 = now_ns();
+    for (i = 0; i < n; i++)
+        sink += legacy_pcpst("$PCPST,DIST_THR,200*", name, &value) + (int) value;
+    t1 = now_ns();
+    for (i = 0; i < n; i++)
+        sink += msg_decode_pcpst("$PCPST,DIST_THR,200*", &pcpst) + (int) pcpst.value;
+    t2 = now_ns();
+    report("PCPST", t1 - t0, t2 - t1, n);
+
+    return 0;
+}
+/*================================================================*/
@@ -0,0 +1,803 @@
+#!/usr/bin/env python3
+# ===============================================================
+# File: msggen.py
+# Author: group 1
+# Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+# Generates the message encoders and decoders from messages.schema:
+#   ES_project_group_1.X/messages.h/.c   firmware (C, no allocation,
+#                                        16-bit arithmetic where the
+#                                        range allows it)
+#   pc/robot_messages.hpp                PC (header-only C++17)
+# Usage: python3 tools/msggen.py           regenerate the outputs
+#        python3 tools/msggen.py --check   fail if they are out of date
+# ===============================================================
+
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SCHEMA = os.path.join(ROOT, 'tools', 'messages.schema')
+FIRMWARE_DIR = os.path.join(ROOT, 'ES_project_group_1.X')
+PC_DIR = os.path.join(ROOT, 'pc')
+
+INT_TYPES = {
+    'u8': ('uint8_t', 0, 0xFF),
+    'u16': ('uint16_t', 0, 0xFFFF),
+    'u32': ('uint32_t', 0, 0xFFFFFFFF),
+    'i16': ('int16_t', -0x8000, 0x7FFF),
+    'i32': ('int32_t', -0x80000000, 0x7FFFFFFF),
+}
+HEX_TYPES = {'x8': ('uint8_t', 2), 'x16': ('uint16_t', 4)}
+CHARSETS = ('upper', 'ident', 'alnum', 'text')
+
+
+class SchemaError(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, name, spec, value_range, glue, comment):
+        self.name = name
+        self.glue = glue
+        self.comment = comment
+        self.scale = 1
+        self.digits = 0
+        self.length = 0
+        self.charset = None
+        match = re.fullmatch(r'(u8|u16|u32|i16|i32)(?:/(10|100))?', spec)
+        if match:
+            self.kind = 'fixed' if match.group(2) else 'int'
+            self.base = match.group(1)
+            self.ctype, type_min, type_max = INT_TYPES[self.base]
+            if match.group(2):
+                self.scale = int(match.group(2))
+                if self.base[0] != 'u':
+                    raise SchemaError('fixed point fields are unsigned: %s' % name)
+            if value_range is None:
+                raise SchemaError('range required for %s' % name)
+            self.min, self.max = value_range
+            if self.min < type_min or self.max > type_max or self.min > self.max:
+                raise SchemaError('range of %s does not fit %s' % (name, self.base))
+            if self.max > 0x7FFFFFFF or self.min < -0x7FFFFFFF:
+                raise SchemaError('%s: values are parsed as 32-bit signed' % name)
+            self.type_min, self.type_max = type_min, type_max
+            return
+        if spec in HEX_TYPES:
+            self.kind = 'hex'
+            self.ctype, self.digits = HEX_TYPES[spec]
+            self.min, self.max = 0, (1 << (4 * self.digits)) - 1
+            self.type_min, self.type_max = self.min, self.max
+            return
+        match = re.fullmatch(r'str<(\d+)>:(\w+)', spec)
+        if match and match.group(2) in CHARSETS:
+            self.kind = 'str'
+            self.length = int(match.group(1))
+            self.charset = match.group(2)
+            self.ctype = 'char'
+            return
+        raise SchemaError('unknown type %s of %s' % (spec, name))
+
+    def width(self):
+        """Characters the field takes at most."""
+        if self.kind == 'int':
+            return max(len(str(self.min)), len(str(self.max)))
+        if self.kind == 'fixed':
+            decimals = len(str(self.scale)) - 1
+            return len(str(self.max // self.scale)) + 1 + decimals
+        if self.kind == 'hex':
+            return self.digits
+        return self.length
+
+
+class Message:
+    def __init__(self, tag, direction, stream, hz, doc):
+        self.tag = tag
+        self.direction = direction
+        self.stream = stream
+        self.hz = hz
+        self.doc = doc
+        self.fields = []
+
+    @property
+    def from_robot(self):
+        return self.direction == 'robot'
+
+    def lower(self):
+        return self.tag.lower()
+
+    def prefix(self):
+        """Text before the first field: PC commands always have the comma."""
+        return '$' + self.tag + ('' if self.from_robot else ',')
+
+    def max_length(self):
+        length = len(self.prefix())
+        for index, field in enumerate(self.fields):
+            separator = not field.glue and (self.from_robot or index > 0)
+            length += separator + field.width()
+        return length + 3  # "*\r\n"
+
+    def synopsis(self):
+        text = self.prefix()
+        for index, field in enumerate(self.fields):
+            if not field.glue and (self.from_robot or index > 0):
+                text += ','
+            text += field.name
+        return text + '*'
+
+
+def parse_schema(path):
+    messages = []
+    with open(path) as schema:
+        for number, raw in enumerate(schema, 1):
+            line = raw.rstrip('\n')
+            code, _, comment = line.partition('#')
+            if not code.strip():
+                continue
+            try:
+                if not line[0].isspace():
+                    match = re.fullmatch(r'(\w+)\s+(robot|pc)((?:\s+\w+=\w+)*)\s*(?:"([^"]*)")?\s*', code)
+                    if not match:
+                        raise SchemaError('bad message line')
+                    options = dict(item.split('=') for item in match.group(3).split())
+                    if set(options) - {'stream', 'hz'}:
+                        raise SchemaError('unknown option')
+                    if any(m.tag == match.group(1) for m in messages):
+                        raise SchemaError('duplicate message')
+                    if match.group(2) == 'pc' and not re.fullmatch(r'PC[A-Z]{3}', match.group(1)):
+                        raise SchemaError('PC commands are $PC + 3 letters')
+                    messages.append(Message(match.group(1), match.group(2), options.get('stream'),
+                                            int(options.get('hz', 0)), match.group(4) or ''))
+                else:
+                    if not messages:
+                        raise SchemaError('field outside a message')
+                    words = code.split()
+                    value_range = None
+                    glue = False
+                    for word in words[2:]:
+                        if word == 'glue':
+                            glue = True
+                        elif re.fullmatch(r'-?\d+\.\.-?\d+', word):
+                            low, high = word.split('..')
+                            value_range = (int(low), int(high))
+                        else:
+                            raise SchemaError('unexpected %s' % word)
+                    if len(words) < 2:
+                        raise SchemaError('field needs a name and a type')
+                    messages[-1].fields.append(Field(words[0], words[1], value_range, glue, comment.strip()))
+            except SchemaError as error:
+                raise SchemaError('%s:%d: %s' % (path, number, error))
+    return messages
+
+
+# ---------------------------------------------------------------
+# Firmware (C)
+# ---------------------------------------------------------------
+BANNER = '''/* ===============================================================
+ * File: %s%s=
+ * Author: group 1                                               =
+ * Paul Pham Dang                                                =
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * Generated by tools/msggen.py from tools/messages.schema,      =
+ * do not edit.                                                  =
+ * ===============================================================*/
+'''
+
+SEPARATOR = '/*================================================================*/'
+
+
+def banner(name):
+    return BANNER % (name, ' ' * (56 - len(name)))
+
+
+def c_param(field):
+    if field.kind == 'str':
+        return 'const char *%s' % field.name
+    return '%s %s' % (field.ctype, field.name)
+
+
+def c_clamped(field):
+    """Expression of the field clamped to its range."""
+    low = field.min > field.type_min
+    high = field.max < field.type_max
+    name = field.name
+    if low and high:
+        return '(%s < %d ? %d : %s > %d ? %d : %s)' % (name, field.min, field.min, name, field.max, field.max, name)
+    if low:
+        return '(%s < %d ? %d : %s)' % (name, field.min, field.min, name)
+    if high:
+        return '(%s > %d ? %d : %s)' % (name, field.max, field.max, name)
+    return name
+
+
+def c_range_check(field, value):
+    checks = []
+    if field.min > -0x7FFFFFFF:
+        checks.append('%s < %dL' % (value, field.min))
+    if field.max < 0x7FFFFFFF:
+        checks.append('%s > %dL' % (value, field.max))
+    return checks
+
+
+def c_put(field, used):
+    if field.kind == 'str':
+        used.add('put_str')
+        return 'p = msg_put_str(p, %s, %d);' % (field.name, field.length)
+    if field.kind == 'hex':
+        used.add('put_hex')
+        return 'p = msg_put_hex(p, %s, %d);' % (field.name, field.digits)
+    clamped = c_clamped(field)
+    if field.kind == 'fixed':
+        used.add('put_u16')
+        used.add('put_fixed')
+        if field.max > 0xFFFF:
+            raise SchemaError('%s: fixed point values are 16-bit on the robot' % field.name)
+        return 'p = msg_put_fixed(p, %s, %d);' % (clamped, field.scale)
+    if field.min < 0:
+        helper = 'put_i16' if field.min >= -0x8000 and field.max <= 0x7FFF else 'put_i32'
+    else:
+        helper = 'put_u16' if field.max <= 0xFFFF else 'put_u32'
+    used.update([helper, 'put_u16'])
+    if helper == 'put_i32':
+        used.add('put_u32')
+    return 'p = msg_%s(p, %s);' % (helper, clamped)
+
+
+def c_get(field, target, used):
+    lines = []
+    if field.kind == 'str':
+        used.add('get_str')
+        lines.append('if (!msg_get_str(&p, %s, %d, MSG_SET_%s)) return 0;'
+                     % (target, field.length, field.charset.upper()))
+        return lines
+    if field.kind != 'int':
+        raise SchemaError('%s: the robot only decodes integers and strings' % field.name)
+    used.add('get_int')
+    checks = c_range_check(field, 'value')
+    lines.append('if (!msg_get_int(&p, &value)%s) return 0;' % ''.join(' || ' + c for c in checks))
+    lines.append('%s = value;' % target)
+    return lines
+
+
+C_HELPERS = {
+    'put_u16': '''// Decimal digits of a 16-bit value, hardware division only
+static char *msg_put_u16(char *p, uint16_t value) {
+    char digits[5];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    while (count > 0) *p++ = digits[--count];
+    return p;
+}''',
+    'put_i16': '''static char *msg_put_i16(char *p, int16_t value) {
+    if (value < 0) {
+        *p++ = '-';
+        return msg_put_u16(p, (uint16_t) -(int32_t) value);
+    }
+    return msg_put_u16(p, (uint16_t) value);
+}''',
+    'put_u32': '''// 32-bit division (library call) only above 65535
+static char *msg_put_u32(char *p, uint32_t value) {
+    char digits[10];
+    int count = 0;
+    if (value <= 0xFFFF) return msg_put_u16(p, (uint16_t) value);
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    while (count > 0) *p++ = digits[--count];
+    return p;
+}''',
+    'put_i32': '''static char *msg_put_i32(char *p, int32_t value) {
+    if (value < 0) {
+        *p++ = '-';
+        return msg_put_u32(p, (uint32_t) -value);
+    }
+    return msg_put_u32(p, (uint32_t) value);
+}''',
+    'put_fixed': '''// value / scale with log10(scale) decimals
+static char *msg_put_fixed(char *p, uint16_t value, uint16_t scale) {
+    uint16_t fraction = value % scale;
+    p = msg_put_u16(p, value / scale);
+    *p++ = '.';
+    for (scale /= 10; scale > 0; scale /= 10) {
+        *p++ = '0' + (fraction / scale) % 10;
+    }
+    return p;
+}''',
+    'put_hex': '''static char *msg_put_hex(char *p, uint16_t value, int digits) {
+    static const char hex[] = "0123456789ABCDEF";
+    while (digits-- > 0) *p++ = hex[(value >> (4 * digits)) & 0xF];
+    return p;
+}''',
+    'put_str': '''static char *msg_put_str(char *p, const char *text, int max_length) {
+    while (max_length-- > 0 && *text != '\\0') *p++ = *text++;
+    return p;
+}''',
+    'get_int': '''// Optional '-' and at least one digit, stops at the first other character
+static int msg_get_int(const char **text, int32_t *value) {
+    const char *p = *text;
+    uint32_t magnitude = 0;
+    int negative = (*p == '-');
+    int digits = 0;
+    if (negative) p++;
+    while (*p >= '0' && *p <= '9') {
+        uint8_t digit = *p++ - '0';
+        // above 2147483647, constant compares only (no 32-bit division)
+        if (magnitude >= 214748364UL && (magnitude > 214748364UL || digit > 7)) return 0;
+        magnitude = magnitude * 10 + digit;
+        digits++;
+    }
+    if (digits == 0) return 0;
+    *value = negative ? -(int32_t) magnitude : (int32_t) magnitude;
+    *text = p;
+    return 1;
+}''',
+    'get_str': '''static int msg_in_set(char c, MsgCharset set) {
+    int upper = (c >= 'A' && c <= 'Z');
+    switch (set) {
+        case MSG_SET_UPPER: return upper;
+        case MSG_SET_IDENT: return upper || c == '_';
+        case MSG_SET_ALNUM: return upper || (c >= '0' && c <= '9');
+        default: return c >= ' ' && c <= '~' && c != ',' && c != '*' && c != '#' && c != '$';
+    }
+}
+
+// 1 to max_length characters of the set, NUL terminated into out
+static int msg_get_str(const char **text, char *out, int max_length, MsgCharset set) {
+    const char *p = *text;
+    int length = 0;
+    while (msg_in_set(*p, set)) {
+        if (length == max_length) return 0;
+        out[length++] = *p++;
+    }
+    out[length] = '\\0';
+    *text = p;
+    return length > 0;
+}''',
+}
+C_HELPER_ORDER = ['put_u16', 'put_i16', 'put_u32', 'put_i32', 'put_fixed', 'put_hex', 'put_str',
+                  'get_int', 'get_str']
+
+
+def command_matcher(commands):
+    """Switch on the 4th character then compare the rest: a few compares per line."""
+    lines = ['MsgCommand msg_command_type(const char *line) {',
+             "    if (line[0] != '$' || line[1] != 'P' || line[2] != 'C') return MSG_UNKNOWN;",
+             '    switch (line[3]) {']
+    groups = {}
+    for message in commands:
+        groups.setdefault(message.tag[2], []).append(message)
+    for letter in sorted(groups):
+        lines.append("        case '%s':" % letter)
+        for message in groups[letter]:
+            lines.append("            if (line[4] == '%s' && line[5] == '%s' && line[6] == ',') return MSG_%s;"
+                         % (message.tag[3], message.tag[4], message.tag))
+        lines.append('            break;')
+    lines += ['    }', '    return MSG_UNKNOWN;', '}']
+    return lines
+
+
+def generate_c(messages):
+    robot = [m for m in messages if m.from_robot]
+    commands = [m for m in messages if not m.from_robot]
+    used = set()
+
+    h = [banner('messages.h'), '#ifndef MESSAGES_H', '#define MESSAGES_H', '', '#include <stdint.h>', '']
+    h += ['// Robot -> PC. msg_encode_<tag>() writes the message, "\\r\\n" and a',
+          '// terminating NUL to out (MSG_<TAG>_SIZE bytes), clamping every value',
+          '// to its range, and returns the length. MSG_<TAG>_MAX_LENGTH is the',
+          '// longest message on the wire, used for the telemetry budget.', '']
+    c = [banner('messages.c'), SEPARATOR, '#include <string.h>', '#include "messages.h"', SEPARATOR, '']
+    bodies = []
+
+    for message in robot:
+        upper = message.tag
+        h.append('// %s %s' % (message.synopsis(), message.doc))
+        for field in message.fields:
+            if field.comment:
+                h.append('//   %s: %s' % (field.name, field.comment))
+        h.append('#define MSG_%s_MAX_LENGTH %d' % (upper, message.max_length()))
+        h.append('#define MSG_%s_SIZE (MSG_%s_MAX_LENGTH + 1)' % (upper, upper))
+        if message.stream:
+            h.append('#define MSG_%s_DEFAULT_HZ %d // stream %s' % (upper, message.hz, message.stream))
+        params = ', '.join(['char *out'] + [c_param(f) for f in message.fields])
+        prototype = 'int msg_encode_%s(%s)' % (message.lower(), params)
+        h.append(prototype + ';')
+        h.append('')
+
+        body = [SEPARATOR, prototype + ' {', '    char *p = out;',
+                '    memcpy(p, "%s", %d);' % (message.prefix(), len(message.prefix())),
+                '    p += %d;' % len(message.prefix())]
+        for field in message.fields:
+            if not field.glue:
+                body.append("    *p++ = ',';")
+            body.append('    ' + c_put(field, used))
+        body += ['    return msg_finish(out, p);', '}', SEPARATOR, '']
+        bodies.append(body)
+
+    h += ['// Buffer size that holds any of the messages above',
+          '#define MSG_MAX_SIZE %d' % (max(m.max_length() for m in robot) + 1), '']
+    h += ['// PC -> robot, in the order of the flight recorder command type.',
+          '// A line may end with "#seq" before the \'*\' (see ack.h).', 'typedef enum {']
+    for index, message in enumerate(commands):
+        h.append('    MSG_%s%s, // %s %s' % (message.tag, ' = 0' if index == 0 else '',
+                                           message.synopsis(), message.doc))
+    h += ['    MSG_UNKNOWN', '} MsgCommand;', '',
+          '// Command of a received line, MSG_UNKNOWN if it is none of the above.',
+          'MsgCommand msg_command_type(const char *line);', '',
+          '// msg_decode_<tag>() fills msg from a received line. Returns 0 if the',
+          '// line is another command, a field is malformed or out of range.', '']
+    for message in commands:
+        if not message.fields:
+            continue
+        upper = message.tag
+        struct = 'Msg%s' % upper.capitalize()
+        h.append('typedef struct {')
+        for field in message.fields:
+            comment = ' // %d..%d' % (field.min, field.max) if field.kind == 'int' else ''
+            if field.kind == 'str':
+                h.append('    char %s[%d];' % (field.name, field.length + 1))
+            else:
+                h.append('    %s %s;%s' % (field.ctype, field.name, comment))
+        h.append('} %s;' % struct)
+        prototype = 'int msg_decode_%s(const char *line, %s *msg)' % (message.lower(), struct)
+        h += [prototype + ';', '']
+
+        body = [SEPARATOR, prototype + ' {',
+                '    const char *p = line + %d;' % len(message.prefix())]
+        if any(f.kind == 'int' for f in message.fields):
+            body.append('    int32_t value;')
+        body += ['', '    if (msg_command_type(line) != MSG_%s) return 0;' % upper]
+        for index, field in enumerate(message.fields):
+            if index > 0 and not field.glue:
+                body.append("    if (*p++ != ',') return 0;")
+            target = 'msg->' + field.name
+            body += ['    ' + line for line in c_get(field, target, used)]
+        body += ["    return *p == '*' || *p == '#';", '}', SEPARATOR, '']
+        bodies.append(body)
+    h += ['#endif /* MESSAGES_H */', '']
+
+    c.append(SEPARATOR)
+    if 'get_str' in used:
+        c += ['typedef enum {', '    MSG_SET_UPPER,', '    MSG_SET_IDENT,', '    MSG_SET_ALNUM,',
+              '    MSG_SET_TEXT', '} MsgCharset;', '']
+    for helper in C_HELPER_ORDER:
+        if helper in used:
+            c += [C_HELPERS[helper], '']
+    c += ['// "*\\r\\n" and the NUL, returns the message length',
+          'static int msg_finish(char *out, char *p) {',
+          "    *p++ = '*';", "    *p++ = '\\r';", "    *p++ = '\\n';", "    *p = '\\0';",
+          '    return p - out;', '}', SEPARATOR, '', SEPARATOR]
+    c += command_matcher(commands)
+    c += [SEPARATOR, '']
+    for body in bodies:
+        c += body
+    return '\n'.join(h), '\n'.join(c).rstrip('\n') + '\n'
+
+
+# ---------------------------------------------------------------
+# PC (C++)
+# ---------------------------------------------------------------
+CPP_PROLOGUE = '''// ===============================================================
+// File: robot_messages.hpp
+// Author: group 1
+// Paul Pham Dang / Waleed Elfieky / Yui Momiyama / Mamoru Ota
+// Generated by tools/msggen.py from tools/messages.schema, do not edit.
+// Header-only C++17: one struct per message with its ranges, encode()
+// into a caller buffer and decode() from a line, both allocation-free
+// and rejecting out of range values.
+// ===============================================================
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace robot::msg {
+
+enum class Charset { upper, ident, alnum, text };
+
+// Fixed capacity string, no allocation
+template <std::size_t N>
+struct FixedString {
+    char data[N + 1] = {};
+    std::size_t size = 0;
+
+    FixedString() = default;
+    FixedString(std::string_view text) { assign(text); }
+    FixedString(const char *text) { assign(text); }
+    bool assign(std::string_view text) {
+        if (text.size() > N) return false;
+        std::memcpy(data, text.data(), text.size());
+        size = text.size();
+        data[size] = '\\0';
+        return true;
+    }
+    std::string_view view() const { return {data, size}; }
+    bool operator==(std::string_view other) const { return view() == other; }
+};
+
+namespace detail {
+
+inline bool in_set(char c, Charset set) {
+    bool upper = c >= 'A' && c <= 'Z';
+    switch (set) {
+        case Charset::upper: return upper;
+        case Charset::ident: return upper || c == '_';
+        case Charset::alnum: return upper || (c >= '0' && c <= '9');
+        default: return c >= ' ' && c <= '~' && c != ',' && c != '*' && c != '#' && c != '$';
+    }
+}
+
+class Writer {
+public:
+    Writer(char *out, std::size_t size) : p_(out), end_(out + (size ? size - 1 : 0)), ok_(size > 0) {}
+    void put(char c) {
+        if (p_ < end_) *p_++ = c;
+        else ok_ = false;
+    }
+    void put(std::string_view text) {
+        for (char c : text) put(c);
+    }
+    void put_int(std::int64_t value, std::int64_t min, std::int64_t max) {
+        if (value < min || value > max) ok_ = false;
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        put(std::string_view(digits, result.ptr - digits));
+    }
+    void put_fixed(std::int64_t value, std::int64_t min, std::int64_t max, int scale) {
+        if (value < min || value > max) ok_ = false;
+        put_int(value / scale, 0, INT64_MAX);
+        put('.');
+        for (int div = scale / 10; div > 0; div /= 10) put(char('0' + (value / div) % 10));
+    }
+    void put_hex(std::uint32_t value, int digits) {
+        static const char hex[] = "0123456789ABCDEF";
+        if (digits < 8 && (value >> (4 * digits)) != 0) ok_ = false;
+        while (digits-- > 0) put(hex[(value >> (4 * digits)) & 0xF]);
+    }
+    template <std::size_t N>
+    void put_str(const FixedString<N> &text, Charset set) {
+        if (text.size == 0) ok_ = false;
+        for (char c : text.view()) {
+            if (!in_set(c, set)) ok_ = false;
+            put(c);
+        }
+    }
+    // Optional "#seq", then "*\\r\\n"; returns the length or 0 if anything failed
+    std::size_t finish(char *out, int seq) {
+        if (seq >= 0) {
+            put('#');
+            put_int(seq, 0, INT64_MAX);
+        }
+        put("*\\r\\n");
+        if (!ok_) return 0;
+        *p_ = '\\0';
+        return p_ - out;
+    }
+
+private:
+    char *p_;
+    char *end_;
+    bool ok_;
+};
+
+class Reader {
+public:
+    explicit Reader(std::string_view line) : line_(line) {}
+    bool expect(std::string_view text) {
+        if (line_.substr(pos_, text.size()) != text) return false;
+        pos_ += text.size();
+        return true;
+    }
+    bool get_int(std::int64_t &value, std::int64_t min, std::int64_t max) {
+        const char *begin = line_.data() + pos_;
+        auto result = std::from_chars(begin, line_.data() + line_.size(), value);
+        if (result.ec != std::errc() || value < min || value > max) return false;
+        pos_ += result.ptr - begin;
+        return true;
+    }
+    bool get_fixed(std::int64_t &value, std::int64_t min, std::int64_t max, int scale) {
+        std::int64_t whole, fraction = 0;
+        if (!get_int(whole, 0, INT64_MAX / scale) || !expect(".")) return false;
+        for (int div = scale / 10; div > 0; div /= 10) {
+            if (pos_ >= line_.size() || line_[pos_] < '0' || line_[pos_] > '9') return false;
+            fraction += (line_[pos_++] - '0') * div;
+        }
+        value = whole * scale + fraction;
+        return value >= min && value <= max;
+    }
+    bool get_hex(std::uint32_t &value, int digits) {
+        value = 0;
+        for (int i = 0; i < digits; i++, pos_++) {
+            if (pos_ >= line_.size()) return false;
+            char c = line_[pos_];
+            int nibble = (c >= '0' && c <= '9') ? c - '0' : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (nibble < 0) return false;
+            value = (value << 4) | nibble;
+        }
+        return true;
+    }
+    template <std::size_t N>
+    bool get_str(FixedString<N> &text, Charset set) {
+        std::size_t start = pos_;
+        while (pos_ < line_.size() && in_set(line_[pos_], set)) pos_++;
+        return pos_ > start && text.assign(line_.substr(start, pos_ - start));
+    }
+    // Optional "#seq" (PC commands only), '*', optional "\\r\\n"
+    bool finish(bool allow_seq, int *seq) {
+        if (seq) *seq = -1;
+        if (allow_seq && expect("#")) {
+            std::int64_t value;
+            if (!get_int(value, 0, 65535)) return false;
+            if (seq) *seq = int(value);
+        }
+        if (!expect("*")) return false;
+        std::string_view rest = line_.substr(pos_);
+        return rest.empty() || rest == "\\r\\n" || rest == "\\n";
+    }
+
+private:
+    std::string_view line_;
+    std::size_t pos_ = 0;
+};
+
+}  // namespace detail
+'''
+
+
+def cpp_type(field):
+    if field.kind == 'str':
+        return 'FixedString<%d>' % field.length
+    return 'std::' + field.ctype
+
+
+def cpp_struct_name(message):
+    return message.tag.capitalize()
+
+
+def generate_cpp(messages):
+    out = [CPP_PROLOGUE]
+    for message in messages:
+        name = cpp_struct_name(message)
+        out.append('// %s %s' % (message.synopsis(), message.doc))
+        out.append('struct %s {' % name)
+        out.append('    static constexpr std::string_view tag = "%s";' % message.tag)
+        out.append('    static constexpr bool from_robot = %s;' % ('true' if message.from_robot else 'false'))
+        out.append('    static constexpr std::size_t max_length = %d;' % message.max_length())
+        if message.stream:
+            out.append('    static constexpr std::string_view stream = "%s";' % message.stream)
+            out.append('    static constexpr int default_hz = %d;' % message.hz)
+        for field in message.fields:
+            if field.kind in ('int', 'fixed'):
+                out.append('    static constexpr std::int64_t %s_min = %d, %s_max = %d;'
+                           % (field.name, field.min, field.name, field.max))
+        for field in message.fields:
+            comment = '  // ' + field.comment if field.comment else ''
+            init = '' if field.kind == 'str' else ' = 0'
+            out.append('    %s %s%s;%s' % (cpp_type(field), field.name, init, comment))
+        out.append('};')
+        out.append('')
+
+        # encode
+        unused = '' if message.fields else '[[maybe_unused]] '
+        out.append('// Returns the length written to out (NUL terminated), 0 if a value is')
+        out.append('// out of range or out is too small. seq >= 0 appends "#seq" (PC commands).')
+        out.append('inline std::size_t encode(%sconst %s &m, char *out, std::size_t size, %sint seq = -1) {'
+                   % (unused, name, '[[maybe_unused]] ' if message.from_robot else ''))
+        out.append('    detail::Writer w(out, size);')
+        out.append('    w.put("%s");' % message.prefix())
+        for index, field in enumerate(message.fields):
+            if not field.glue and (message.from_robot or index > 0):
+                out.append("    w.put(',');")
+            if field.kind == 'int':
+                out.append('    w.put_int(m.%s, m.%s_min, m.%s_max);' % (field.name, field.name, field.name))
+            elif field.kind == 'fixed':
+                out.append('    w.put_fixed(m.%s, m.%s_min, m.%s_max, %d);'
+                           % (field.name, field.name, field.name, field.scale))
+            elif field.kind == 'hex':
+                out.append('    w.put_hex(m.%s, %d);' % (field.name, field.digits))
+            else:
+                out.append('    w.put_str(m.%s, Charset::%s);' % (field.name, field.charset))
+        out.append('    return w.finish(out, %s);' % ('-1' if message.from_robot else 'seq'))
+        out.append('}')
+        out.append('')
+
+        # decode
+        out.append('inline bool decode(std::string_view line, %s%s &m, int *seq = nullptr) {' % (unused, name))
+        out.append('    detail::Reader r(line);')
+        if any(f.kind in ('int', 'fixed') for f in message.fields):
+            out.append('    std::int64_t value;')
+        if any(f.kind == 'hex' for f in message.fields):
+            out.append('    std::uint32_t hex;')
+        out.append('    if (!r.expect("%s")) return false;' % message.prefix())
+        for index, field in enumerate(message.fields):
+            if not field.glue and (message.from_robot or index > 0):
+                out.append("    if (!r.expect(\",\")) return false;")
+            if field.kind == 'int':
+                out.append('    if (!r.get_int(value, m.%s_min, m.%s_max)) return false;' % (field.name, field.name))
+                out.append('    m.%s = static_cast<std::%s>(value);' % (field.name, field.ctype))
+            elif field.kind == 'fixed':
+                out.append('    if (!r.get_fixed(value, m.%s_min, m.%s_max, %d)) return false;'
+                           % (field.name, field.name, field.scale))
+                out.append('    m.%s = static_cast<std::%s>(value);' % (field.name, field.ctype))
+            elif field.kind == 'hex':
+                out.append('    if (!r.get_hex(hex, %d)) return false;' % field.digits)
+                out.append('    m.%s = static_cast<std::%s>(hex);' % (field.name, field.ctype))
+            else:
+                out.append('    if (!r.get_str(m.%s, Charset::%s)) return false;' % (field.name, field.charset))
+        out.append('    return r.finish(%s, seq);' % ('false' if message.from_robot else 'true'))
+        out.append('}')
+        out.append('')
+
+    for group, from_robot in (('RobotMessage', True), ('PcCommand', False)):
+        names = [cpp_struct_name(m) for m in messages if m.from_robot == from_robot]
+        out.append('using %s = std::variant<%s>;' % (group, ', '.join(names)))
+        out.append('')
+        function = 'decode_robot' if from_robot else 'decode_pc'
+        out.append('// Any %s message, by its tag' % ('robot' if from_robot else 'PC'))
+        out.append('inline std::optional<%s> %s(std::string_view line, int *seq = nullptr) {' % (group, function))
+        out.append("    std::size_t end = line.find_first_of(\",*\");")
+        out.append("    if (line.empty() || line[0] != '$' || end == std::string_view::npos) return std::nullopt;")
+        out.append('    std::string_view tag = line.substr(1, end - 1);')
+        for name in names:
+            out.append('    if (tag == %s::tag) {' % name)
+            out.append('        %s m;' % name)
+            out.append('        if (decode(line, m, seq)) return m;')
+            out.append('        return std::nullopt;')
+            out.append('    }')
+        out.append('    return std::nullopt;')
+        out.append('}')
+        out.append('')
+
+    out.append('// Message as a std::string, empty if it cannot be encoded')
+    out.append('template <class M>')
+    out.append('std::string to_string(const M &m, int seq = -1) {')
+    out.append('    char buffer[M::max_length + 8];  // + "#65535"')
+    out.append('    return std::string(buffer, encode(m, buffer, sizeof(buffer), seq));')
+    out.append('}')
+    out.append('')
+    out.append('}  // namespace robot::msg')
+    return '\n'.join(out) + '\n'
+
+
+def main():
+    check = '--check' in sys.argv[1:]
+    try:
+        messages = parse_schema(SCHEMA)
+    except SchemaError as error:
+        sys.exit(str(error))
+    header, source = generate_c(messages)
+    outputs = {
+        os.path.join(FIRMWARE_DIR, 'messages.h'): header,
+        os.path.join(FIRMWARE_DIR, 'messages.c'): source,
+        os.path.join(PC_DIR, 'robot_messages.hpp'): generate_cpp(messages),
+    }
+    stale = []
+    for path, text in outputs.items():
+        current = open(path).read() if os.path.exists(path) else None
+        if current == text:
+            continue
+        if check:
+            stale.append(os.path.relpath(path, ROOT))
+        else:
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            with open(path, 'w') as output:
+                output.write(text)
+            print('wrote', os.path.relpath(path, ROOT))
+    if stale:
+        sys.exit('out of date, run tools/msggen.py: ' + ', '.join(stale))
+
+
+if __name__ == '__main__':
+    main()
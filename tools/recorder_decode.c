@@ -0,0 +1,138 @@
+/* ===============================================================
+ * File: recorder_decode.c                                       =
+ * Author: group 1                                               =   
+ * Paul Pham Dang                                                =   
+ * Waleed Elfieky                                                =
+ * Yui Momiyama                                                  =
+ * Mamoru Ota                                                    =
+ * Host tool: turns a flight recorder dump ($PCLOG) captured     =
+ * from the robot UART into a readable timeline.                 =
+ * Build: gcc -o recorder_decode recorder_decode.c               =
+ * Usage: recorder_decode [dump.txt]   (stdin by default)        =
+ * ===============================================================*/
+
+/*================================================================*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+/*================================================================*/
+
+/*================================================================*/
+// Must follow RecorderEvent in ES_project_group_1.X/recorder.h
+static const char *event_names[] = {
+    "BOOT", "STATE", "EMRG_ENTER", "EMRG_EXIT", "COMMAND", "TX_DROP", "ADC_SAMPLE", "LOOP_OVERRUN",
+    "RX_OVERFLOW"
+};
+#define EVENT_COUNT (sizeof(event_names) / sizeof(event_names[0]))
+
+// Must follow RobotState and CommandType in the firmware
+static const char *state_names[] = {"WAIT_FOR_START", "MOVING", "EMERGENCY"};
+// Must follow the REC_CAUSE_* values in ES_project_group_1.X/recorder.h
+static const char *cause_names[] = {"DISTANCE", "TTC", "COLLISION", "STALL", "LIFT"};
+static const char *command_names[] = {
+    "PCREF", "PCSTP", "PCSTT", "PCTRJ", "PCTRF", "PCSYN", "PCSUB",
+    "PCPGT", "PCPST", "PCPSV", "PCPDF", "PCLOG", "PCISR", "PCBDR", "PCBOK", "PCUPD", "UNKNOWN"
+};
+#define TICK_MS 2
+/*================================================================*/
+
+/*================================================================*/
+static const char *name_of(const char **names, unsigned int count, unsigned int index) {
+    return index < count ? names[index] : "?";
+}
+/*================================================================*/
+
+/*================================================================*/
+// An event line carries exactly 12 hex digits, anything else is a
+// corrupted line and is skipped
+/*================================================================*/
+static int has_event_field(const char *frame) {
+    const char *field = strchr(frame + 6, ',');
+    return field != NULL && strspn(field + 1, "0123456789ABCDEFabcdef") == 12 && field[13] == '*';
+}
+/*================================================================*/
+
+/*================================================================*/
+static void print_event(unsigned long ms, unsigned int type, unsigned int arg, int value) {
+    printf("%8lu.%03lu  %-12s ", ms / 1000, ms % 1000, name_of(event_names, EVENT_COUNT, type));
+    switch (type) {
+        case 0:
+            printf("reset cause RCON=0x%04X", (uint16_t) value);
+            break;
+        case 1:
+            printf("%s -> %s", name_of(state_names, 3, value), name_of(state_names, 3, arg));
+            break;
+        case 2:
+            printf("cause %s, distance %d mm",
+                    name_of(cause_names, sizeof(cause_names) / sizeof(cause_names[0]), arg), value);
+            break;
+        case 3:
+            printf("distance %d mm", value);
+            break;
+        case 4:
+            printf("%s", name_of(command_names, sizeof(command_names) / sizeof(command_names[0]), arg));
+            if (value >= 0) printf(" #%d", value);
+            break;
+        case 5:
+            printf("%u byte frame, %d bytes free", arg, value);
+            break;
+        case 6:
+            printf("sample %+d: %d mm", (int8_t) arg, value);
+            break;
+        default:
+            printf("arg %u value %d", arg, value);
+            break;
+    }
+    printf("\n");
+}
+/*================================================================*/
+
+/*================================================================*/
+int main(int argc, char **argv) {
+    FILE *in = stdin;
+    char line[256];
+    unsigned int index, tick, type, arg, value;
+    unsigned long ms = 0;
+    int have_previous = 0;
+    unsigned int previous_tick = 0;
+    unsigned int count = 0, total = 0, decoded = 0, lost = 0;
+
+    if (argc > 1 && (in = fopen(argv[1], "r")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        char *frame = strstr(line, "$MLOG");
+        if (frame == NULL) continue;
+
+        if (sscanf(frame, "$MLOGS,%u,%u*", &count, &total) == 2) {
+            printf("dump of %u events (%u logged since boot", count, total);
+            if (total > count) printf(", %u oldest overwritten", total - count);
+            printf(")\n");
+            have_previous = 0;
+            ms = 0;
+        } else if (sscanf(frame, "$MLOG,%u,%4x%2x%2x%4x*", &index, &tick, &type, &arg, &value) == 5 &&
+                has_event_field(frame)) {
+            // 16-bit ticks wrap every 131s, events are in order so unwrap
+            if (have_previous) {
+                ms += (unsigned long) ((tick - previous_tick) & 0xFFFF) * TICK_MS;
+            } else {
+                ms = (unsigned long) tick * TICK_MS;
+            }
+            previous_tick = tick;
+            have_previous = 1;
+            print_event(ms, type, arg, (int16_t) value);
+            decoded++;
+        } else if (strncmp(frame, "$MLOGE", 6) == 0) {
+            if (sscanf(frame, "$MLOGE,%u*", &lost) != 1) lost = 0;
+            if (lost > 0) printf("%u events overwritten during the dump\n", lost);
+            if (decoded + lost != count) printf("warning: %u of %u events received\n", decoded, count - lost);
+            decoded = 0;
+        }
+    }
+
+    if (in != stdin) fclose(in);
+    return 0;
+}
+/*================================================================*/